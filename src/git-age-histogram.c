@@ -0,0 +1,203 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtk/gtkdrawingarea.h>
+#include <string.h>
+
+#include "git-age-histogram.h"
+#include "git-annotated-source.h"
+#include "git-common.h"
+#include "intl.h"
+
+static void git_age_histogram_size_request (GtkWidget *widget,
+                                            GtkRequisition *requisition);
+static gboolean git_age_histogram_expose_event (GtkWidget *widget,
+                                                GdkEventExpose *event);
+
+G_DEFINE_TYPE (GitAgeHistogram, git_age_histogram, GTK_TYPE_DRAWING_AREA);
+
+#define GIT_AGE_HISTOGRAM_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_AGE_HISTOGRAM, \
+                                GitAgeHistogramPrivate))
+
+/* Gap in pixels around the labels and bars */
+#define GIT_AGE_HISTOGRAM_GAP 3
+
+struct _GitAgeHistogramPrivate
+{
+  GitAnnotatedSourceAges ages;
+};
+
+static const gchar * const
+git_age_histogram_labels[GIT_ANNOTATED_SOURCE_N_AGES] =
+  {
+    N_("< 1 month"),
+    N_("< 3 months"),
+    N_("< 6 months"),
+    N_("< 1 year"),
+    N_("< 2 years"),
+    N_("< 5 years"),
+    N_("Older")
+  };
+
+static void
+git_age_histogram_class_init (GitAgeHistogramClass *klass)
+{
+  GtkWidgetClass *widget_class = (GtkWidgetClass *) klass;
+
+  widget_class->size_request = git_age_histogram_size_request;
+  widget_class->expose_event = git_age_histogram_expose_event;
+
+  g_type_class_add_private (klass, sizeof (GitAgeHistogramPrivate));
+}
+
+static void
+git_age_histogram_init (GitAgeHistogram *self)
+{
+  self->priv = GIT_AGE_HISTOGRAM_GET_PRIVATE (self);
+}
+
+GtkWidget *
+git_age_histogram_new (void)
+{
+  GtkWidget *self = g_object_new (GIT_TYPE_AGE_HISTOGRAM, NULL);
+
+  return self;
+}
+
+/* Gets the height of a bar and the width of the widest label */
+static void
+git_age_histogram_measure (GtkWidget *widget, PangoLayout *layout,
+                           gint *row_height, gint *label_width)
+{
+  gint i, width, height;
+
+  *row_height = 0;
+  *label_width = 0;
+
+  for (i = 0; i < GIT_ANNOTATED_SOURCE_N_AGES; i++)
+    {
+      pango_layout_set_text (layout, _(git_age_histogram_labels[i]), -1);
+      pango_layout_get_pixel_size (layout, &width, &height);
+
+      *row_height = MAX (*row_height, height + GIT_AGE_HISTOGRAM_GAP);
+      *label_width = MAX (*label_width, width);
+    }
+}
+
+static void
+git_age_histogram_size_request (GtkWidget *widget,
+                                GtkRequisition *requisition)
+{
+  PangoLayout *layout = gtk_widget_create_pango_layout (widget, NULL);
+  gint row_height, label_width;
+
+  git_age_histogram_measure (widget, layout, &row_height, &label_width);
+
+  requisition->width = label_width + GIT_AGE_HISTOGRAM_GAP * 3 + 64;
+  requisition->height = row_height * GIT_ANNOTATED_SOURCE_N_AGES
+    + GIT_AGE_HISTOGRAM_GAP;
+
+  g_object_unref (layout);
+}
+
+static gboolean
+git_age_histogram_expose_event (GtkWidget *widget,
+                                GdkEventExpose *event)
+{
+  GitAgeHistogram *histogram = (GitAgeHistogram *) widget;
+  GitAgeHistogramPrivate *priv = histogram->priv;
+  PangoLayout *layout = gtk_widget_create_pango_layout (widget, NULL);
+  cairo_t *cr = gdk_cairo_create (widget->window);
+  gint row_height, label_width, bar_x, bar_space, i;
+  guint max_lines = 0;
+
+  git_age_histogram_measure (widget, layout, &row_height, &label_width);
+
+  for (i = 0; i < GIT_ANNOTATED_SOURCE_N_AGES; i++)
+    max_lines = MAX (max_lines, priv->ages.n_lines[i]);
+
+  bar_x = label_width + GIT_AGE_HISTOGRAM_GAP * 2;
+  bar_space = widget->allocation.width - bar_x - GIT_AGE_HISTOGRAM_GAP;
+
+  for (i = 0; i < GIT_ANNOTATED_SOURCE_N_AGES; i++)
+    {
+      gint y = GIT_AGE_HISTOGRAM_GAP + i * row_height;
+      guint n_lines = priv->ages.n_lines[i];
+      GdkColor color;
+      gint bar_width;
+      gchar *count;
+
+      pango_layout_set_text (layout, _(git_age_histogram_labels[i]), -1);
+      gtk_paint_layout (widget->style, widget->window,
+                        GTK_WIDGET_STATE (widget), TRUE,
+                        &event->area, widget, NULL,
+                        GIT_AGE_HISTOGRAM_GAP, y, layout);
+
+      bar_width = max_lines && bar_space > 0
+        ? (gint) ((guint64) bar_space * n_lines / max_lines) : 0;
+
+      if (bar_width > 0)
+        {
+          git_age_to_color (i / (gdouble) (GIT_ANNOTATED_SOURCE_N_AGES - 1),
+                            &color);
+          gdk_cairo_set_source_color (cr, &color);
+          cairo_rectangle (cr, bar_x, y, bar_width,
+                           row_height - GIT_AGE_HISTOGRAM_GAP);
+          cairo_fill (cr);
+        }
+
+      /* The number of lines is written over the start of the bar */
+      count = g_strdup_printf ("%u", n_lines);
+      pango_layout_set_text (layout, count, -1);
+      gtk_paint_layout (widget->style, widget->window,
+                        GTK_WIDGET_STATE (widget), TRUE,
+                        &event->area, widget, NULL,
+                        bar_x + GIT_AGE_HISTOGRAM_GAP, y, layout);
+      g_free (count);
+    }
+
+  cairo_destroy (cr);
+  g_object_unref (layout);
+
+  return FALSE;
+}
+
+/* Shows the ages of the lines of a source. Pass NULL to clear the
+   histogram */
+void
+git_age_histogram_set_source (GitAgeHistogram *histogram,
+                              GitAnnotatedSource *source)
+{
+  GitAgeHistogramPrivate *priv;
+
+  g_return_if_fail (GIT_IS_AGE_HISTOGRAM (histogram));
+  g_return_if_fail (source == NULL || GIT_IS_ANNOTATED_SOURCE (source));
+
+  priv = histogram->priv;
+
+  if (source)
+    git_annotated_source_get_ages (source, &priv->ages);
+  else
+    memset (&priv->ages, 0, sizeof (priv->ages));
+
+  gtk_widget_queue_draw (GTK_WIDGET (histogram));
+}
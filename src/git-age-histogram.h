@@ -0,0 +1,72 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_AGE_HISTOGRAM_H__
+#define __GIT_AGE_HISTOGRAM_H__
+
+#include <gtk/gtkdrawingarea.h>
+#include "git-annotated-source.h"
+
+G_BEGIN_DECLS
+
+#define GIT_TYPE_AGE_HISTOGRAM                                          \
+  (git_age_histogram_get_type())
+#define GIT_AGE_HISTOGRAM(obj)                                          \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                   \
+                               GIT_TYPE_AGE_HISTOGRAM,                  \
+                               GitAgeHistogram))
+#define GIT_AGE_HISTOGRAM_CLASS(klass)                                  \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            GIT_TYPE_AGE_HISTOGRAM,                     \
+                            GitAgeHistogramClass))
+#define GIT_IS_AGE_HISTOGRAM(obj)                                       \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),                                   \
+                               GIT_TYPE_AGE_HISTOGRAM))
+#define GIT_IS_AGE_HISTOGRAM_CLASS(klass)                               \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),                                    \
+                            GIT_TYPE_AGE_HISTOGRAM))
+#define GIT_AGE_HISTOGRAM_GET_CLASS(obj)                                \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                    \
+                              GIT_TYPE_AGE_HISTOGRAM,                   \
+                              GitAgeHistogramClass))
+
+typedef struct _GitAgeHistogram        GitAgeHistogram;
+typedef struct _GitAgeHistogramClass   GitAgeHistogramClass;
+typedef struct _GitAgeHistogramPrivate GitAgeHistogramPrivate;
+
+struct _GitAgeHistogramClass
+{
+  GtkDrawingAreaClass parent_class;
+};
+
+struct _GitAgeHistogram
+{
+  GtkDrawingArea parent;
+
+  GitAgeHistogramPrivate *priv;
+};
+
+GType git_age_histogram_get_type (void) G_GNUC_CONST;
+
+GtkWidget *git_age_histogram_new (void);
+
+void git_age_histogram_set_source (GitAgeHistogram *histogram,
+                                   GitAnnotatedSource *source);
+
+G_END_DECLS
+
+#endif /* __GIT_AGE_HISTOGRAM_H__ */
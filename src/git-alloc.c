@@ -0,0 +1,306 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Counts the allocations made while the program is in each phase of
+   loading and painting a blame. The counts are printed to stderr
+   with the time spent whenever the phase changes. The executable
+   defines its own malloc, free, realloc, calloc and the aligned
+   variants, which forward to glibc's __libc_malloc family. Symbols in
+   the executable take precedence over the ones in libc for every
+   shared library too, so GLib, Pango and cairo are counted along with
+   blame-browse itself without needing LD_PRELOAD. GSlice is switched
+   to plain malloc so that each slice is counted separately. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <malloc.h>
+
+#include "git-alloc.h"
+
+#ifdef ENABLE_ALLOC_COUNTING
+
+/* Each block has a header with its size so that freed memory can be
+   subtracted from the live total and the offset from the start of
+   the block that was allocated from libc, which is only bigger than
+   the header for aligned blocks. The union keeps the returned memory
+   aligned as strictly as malloc's */
+typedef union
+{
+  struct
+  {
+    gsize size;
+    gsize offset;
+  } info;
+  gdouble d;
+  gpointer p;
+  long double ld;
+} GitAllocHeader;
+
+void *__libc_malloc (size_t size);
+void *__libc_realloc (void *mem, size_t size);
+void __libc_free (void *mem);
+void *__libc_memalign (size_t alignment, size_t size);
+
+static volatile gint git_alloc_phase = GIT_ALLOC_PHASE_NONE;
+static gboolean git_alloc_enabled = FALSE;
+/* Counts for the current phase. These are reset when the phase
+   changes. They are updated with the GCC atomic builtins because
+   GLib only has atomic operations for gint, which would overflow
+   after 2GiB */
+static volatile gsize git_alloc_count = 0;
+static volatile gsize git_alloc_bytes = 0;
+/* Bytes currently allocated */
+static volatile gsize git_alloc_live = 0;
+static GTimeVal git_alloc_phase_start;
+
+static const gchar * const
+git_alloc_phase_names[GIT_ALLOC_N_PHASES] =
+  {
+    "none",
+    "spawn",
+    "parse",
+    "complete",
+    "first-paint",
+    "steady"
+  };
+
+static void
+git_alloc_count_block (gsize size)
+{
+  __sync_fetch_and_add (&git_alloc_count, 1);
+  __sync_fetch_and_add (&git_alloc_bytes, size);
+  __sync_fetch_and_add (&git_alloc_live, size);
+}
+
+void *
+malloc (size_t n_bytes)
+{
+  GitAllocHeader *header = __libc_malloc (sizeof (GitAllocHeader) + n_bytes);
+
+  if (header == NULL)
+    return NULL;
+
+  header->info.size = n_bytes;
+  header->info.offset = sizeof (GitAllocHeader);
+  git_alloc_count_block (n_bytes);
+
+  return header + 1;
+}
+
+void
+free (void *mem)
+{
+  GitAllocHeader *header;
+
+  if (mem == NULL)
+    return;
+
+  header = (GitAllocHeader *) mem - 1;
+  __sync_fetch_and_sub (&git_alloc_live, header->info.size);
+
+  __libc_free ((gchar *) mem - header->info.offset);
+}
+
+void *
+realloc (void *mem, size_t n_bytes)
+{
+  GitAllocHeader *header;
+  gsize old_size;
+  void *new_mem;
+
+  if (mem == NULL)
+    return malloc (n_bytes);
+
+  header = (GitAllocHeader *) mem - 1;
+  old_size = header->info.size;
+
+  /* An aligned block can't be passed back to libc's realloc because
+     it doesn't start at the header */
+  if (header->info.offset != sizeof (GitAllocHeader))
+    {
+      if ((new_mem = malloc (n_bytes)))
+        {
+          memcpy (new_mem, mem, MIN (old_size, n_bytes));
+          free (mem);
+        }
+
+      return new_mem;
+    }
+
+  if ((header = __libc_realloc (header, sizeof (GitAllocHeader) + n_bytes))
+      == NULL)
+    return NULL;
+
+  header->info.size = n_bytes;
+
+  /* A realloc counts as an allocation of the new size because that
+     is the churn it can cause */
+  __sync_fetch_and_add (&git_alloc_count, 1);
+  __sync_fetch_and_add (&git_alloc_bytes, n_bytes);
+  __sync_fetch_and_add (&git_alloc_live, n_bytes);
+  __sync_fetch_and_sub (&git_alloc_live, old_size);
+
+  return header + 1;
+}
+
+void *
+calloc (size_t n_blocks, size_t n_block_bytes)
+{
+  void *mem;
+
+  if (n_block_bytes > 0 && n_blocks > G_MAXSIZE / n_block_bytes)
+    return NULL;
+
+  mem = malloc (n_blocks * n_block_bytes);
+
+  if (mem)
+    memset (mem, 0, n_blocks * n_block_bytes);
+
+  return mem;
+}
+
+void *
+memalign (size_t alignment, size_t n_bytes)
+{
+  GitAllocHeader *header;
+  gchar *block;
+  gsize offset;
+
+  if (alignment <= sizeof (GitAllocHeader))
+    return malloc (n_bytes);
+
+  /* The header goes just before the aligned memory so there needs to
+     be room for a whole alignment in front of it */
+  if (n_bytes > G_MAXSIZE - alignment)
+    return NULL;
+
+  if ((block = __libc_memalign (alignment, alignment + n_bytes)) == NULL)
+    return NULL;
+
+  offset = alignment;
+  header = (GitAllocHeader *) (block + offset) - 1;
+  header->info.size = n_bytes;
+  header->info.offset = offset;
+  git_alloc_count_block (n_bytes);
+
+  return block + offset;
+}
+
+int
+posix_memalign (void **mem, size_t alignment, size_t n_bytes)
+{
+  void *result;
+
+  if (alignment == 0 || (alignment & (alignment - 1))
+      || alignment % sizeof (void *))
+    return EINVAL;
+
+  if ((result = memalign (alignment, n_bytes)) == NULL)
+    return ENOMEM;
+
+  *mem = result;
+
+  return 0;
+}
+
+void *
+aligned_alloc (size_t alignment, size_t n_bytes)
+{
+  return memalign (alignment, n_bytes);
+}
+
+void *
+valloc (size_t n_bytes)
+{
+  return memalign (sysconf (_SC_PAGESIZE), n_bytes);
+}
+
+size_t
+malloc_usable_size (void *mem)
+{
+  return mem ? ((GitAllocHeader *) mem - 1)->info.size : 0;
+}
+
+/* Starts counting if the environment variable is set. This must be
+   called before anything else uses GLib */
+void
+git_alloc_install (void)
+{
+  const char *value = getenv (GIT_ALLOC_ENV);
+
+  if (value == NULL || *value == '\0' || !strcmp (value, "0"))
+    return;
+
+  /* Slices would otherwise be carved out of big blocks that are
+     only allocated once */
+  g_setenv ("G_SLICE", "always-malloc", TRUE);
+
+  g_get_current_time (&git_alloc_phase_start);
+  git_alloc_enabled = TRUE;
+}
+
+/* Ends the current phase by printing its counts and starts counting
+   for the new phase. This should only be called from the main
+   thread. Allocations from other threads are counted in whatever
+   phase the main thread is in */
+void
+git_alloc_set_phase (GitAllocPhase phase)
+{
+  GitAllocPhase old_phase = g_atomic_int_get (&git_alloc_phase);
+  gsize count, bytes;
+  GTimeVal now;
+
+  g_return_if_fail (phase >= 0 && phase < GIT_ALLOC_N_PHASES);
+
+  if (phase == old_phase)
+    return;
+
+  g_get_current_time (&now);
+
+  /* There may be allocations between reading and resetting the
+     counters but they will just be counted in the next phase */
+  count = __sync_lock_test_and_set (&git_alloc_count, 0);
+  bytes = __sync_lock_test_and_set (&git_alloc_bytes, 0);
+
+  if (git_alloc_enabled && old_phase != GIT_ALLOC_PHASE_NONE)
+    fprintf (stderr, "alloc: %-12s %9" G_GSIZE_FORMAT " allocs "
+             "%11" G_GSIZE_FORMAT " bytes %10.1f ms "
+             "%11" G_GSIZE_FORMAT " live\n",
+             git_alloc_phase_names[old_phase], count, bytes,
+             (now.tv_sec - git_alloc_phase_start.tv_sec) * 1000.0
+             + (now.tv_usec - git_alloc_phase_start.tv_usec) / 1000.0,
+             (gsize) git_alloc_live);
+
+  git_alloc_phase_start = now;
+  g_atomic_int_set (&git_alloc_phase, phase);
+}
+
+GitAllocPhase
+git_alloc_get_phase (void)
+{
+  return g_atomic_int_get (&git_alloc_phase);
+}
+
+#endif /* ENABLE_ALLOC_COUNTING */
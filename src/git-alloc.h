@@ -0,0 +1,59 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_ALLOC_H__
+#define __GIT_ALLOC_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Environment variable that turns on allocation counting in builds
+   configured with --enable-alloc-counting */
+#define GIT_ALLOC_ENV "BLAME_BROWSE_COUNT_ALLOCS"
+
+typedef enum
+  {
+    GIT_ALLOC_PHASE_NONE,
+    GIT_ALLOC_PHASE_SPAWN,
+    GIT_ALLOC_PHASE_PARSE,
+    GIT_ALLOC_PHASE_COMPLETE,
+    GIT_ALLOC_PHASE_FIRST_PAINT,
+    GIT_ALLOC_PHASE_STEADY,
+
+    GIT_ALLOC_N_PHASES
+  } GitAllocPhase;
+
+#ifdef ENABLE_ALLOC_COUNTING
+
+void git_alloc_install (void);
+void git_alloc_set_phase (GitAllocPhase phase);
+GitAllocPhase git_alloc_get_phase (void);
+
+#else /* ENABLE_ALLOC_COUNTING */
+
+/* Everything compiles to nothing without --enable-alloc-counting so
+   that the hooks don't cost anything in normal builds */
+#define git_alloc_install() G_STMT_START { } G_STMT_END
+#define git_alloc_set_phase(phase) G_STMT_START { } G_STMT_END
+#define git_alloc_get_phase() GIT_ALLOC_PHASE_NONE
+
+#endif /* ENABLE_ALLOC_COUNTING */
+
+G_END_DECLS
+
+#endif /* __GIT_ALLOC_H__ */
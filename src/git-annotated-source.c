@@ -28,6 +28,12 @@
 #include "git-commit.h"
 #include "git-commit-bag.h"
 #include "git-common.h"
+#include "git-blame-cache.h"
+#include "git-utf8.h"
+#include "git-column-map.h"
+#include "git-trace.h"
+#include "git-memory.h"
+#include "git-alloc.h"
 
 static void git_annotated_source_dispose (GObject *object);
 static void git_annotated_source_finalize (GObject *object);
@@ -56,18 +62,66 @@ struct _GitAnnotatedSourcePrivate
   GArray *lines;
   GitAnnotatedSourceLine current_line;
 
+  /* Column map for each line. These are created the first time they
+     are needed so most of the entries will be NULL */
+  GPtrArray *column_maps;
+
   gchar *repo;
+
+  /* Character set of the file or NULL to detect it */
+  gchar *encoding;
+
+  /* Whether to run git-blame with --reverse */
+  gboolean reverse;
+
+  /* Name of the cache entry to store the blame in once it has
+     completed or NULL if the blame can't be cached */
+  gchar *cache_key;
+  /* The entry that the lines were loaded from. The text of the lines
+     points into the blocks of this entry */
+  GitBlameCacheEntry *cache_entry;
+  guint cache_idle_source;
+  /* Lines can be read from the highlighter's thread so loading the
+     text of a block is done with this lock held */
+  GMutex *load_mutex;
+
+  /* Ownership summary for each author sorted by the number of lines
+     and a hash table to look them up by the author's name */
+  GPtrArray *owners;
+  GHashTable *owners_by_author;
+  /* Number of lines in each age bucket. This is built in the same
+     pass as the owners */
+  GitAnnotatedSourceAges ages;
+
+  /* Bytes of line text allocated for the parsed lines and how much of
+     that has been reported to the memory accounting. The report is
+     only updated every so often so that it isn't done per line */
+  gsize text_size, accounted_text_size;
+
+  /* Progress of the current fetch */
+  gsize bytes_read;
+  guint expected_lines;
+  GTimer *progress_timer;
+  gdouble last_progress_time;
+  guint progress_countdown;
 };
 
 enum
   {
     COMPLETED,
+    PROGRESS,
 
     LAST_SIGNAL
   };
 
 static guint client_signals[LAST_SIGNAL];
 
+/* Minimum number of seconds between emissions of the progress
+   signal */
+#define GIT_ANNOTATED_SOURCE_PROGRESS_INTERVAL 0.25
+/* Number of lines of output to process between checking the time */
+#define GIT_ANNOTATED_SOURCE_PROGRESS_LINES 256
+
 static void
 git_annotated_source_class_init (GitAnnotatedSourceClass *klass)
 {
@@ -86,6 +140,15 @@ git_annotated_source_class_init (GitAnnotatedSourceClass *klass)
                     G_TYPE_NONE, 1,
                     G_TYPE_POINTER);
 
+  client_signals[PROGRESS]
+    = g_signal_new ("progress",
+                    G_TYPE_FROM_CLASS (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitAnnotatedSourceClass, progress),
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__VOID,
+                    G_TYPE_NONE, 0);
+
   g_type_class_add_private (klass, sizeof (GitAnnotatedSourcePrivate));
 }
 
@@ -108,9 +171,51 @@ git_annotated_source_init (GitAnnotatedSource *self)
                         G_CALLBACK (git_annotated_source_on_line),
                         self);
 
-  priv->lines = g_array_new (FALSE, FALSE, sizeof (GitAnnotatedSourceLine));
+  priv->lines = g_array_new (FALSE, TRUE, sizeof (GitAnnotatedSourceLine));
+  priv->column_maps = g_ptr_array_new ();
+  priv->owners = g_ptr_array_new ();
+  priv->owners_by_author = g_hash_table_new (g_str_hash, g_str_equal);
   priv->current_line.commit = NULL;
   priv->current_line.text = NULL;
+
+  priv->progress_timer = g_timer_new ();
+  priv->load_mutex = g_mutex_new ();
+}
+
+static void
+git_annotated_source_account_text (GitAnnotatedSource *source)
+{
+  GitAnnotatedSourcePrivate *priv = source->priv;
+
+  if (priv->text_size != priv->accounted_text_size)
+    {
+      git_memory_add (GIT_MEMORY_LINE_TEXT,
+                      (gssize) priv->text_size
+                      - (gssize) priv->accounted_text_size);
+      priv->accounted_text_size = priv->text_size;
+    }
+}
+
+static void
+git_annotated_source_free_owners (GitAnnotatedSource *source)
+{
+  GitAnnotatedSourcePrivate *priv = source->priv;
+  guint i;
+
+  for (i = 0; i < priv->owners->len; i++)
+    {
+      GitAnnotatedSourceOwner *owner = g_ptr_array_index (priv->owners, i);
+
+      g_free (owner->author);
+      g_array_free (owner->commits, TRUE);
+      g_array_free (owner->runs, TRUE);
+      g_slice_free (GitAnnotatedSourceOwner, owner);
+    }
+
+  g_ptr_array_set_size (priv->owners, 0);
+  g_hash_table_remove_all (priv->owners_by_author);
+
+  memset (&priv->ages, 0, sizeof (priv->ages));
 }
 
 static void
@@ -125,11 +230,31 @@ git_annotated_source_clear_lines (GitAnnotatedSource *source)
         = &g_array_index (priv->lines, GitAnnotatedSourceLine, i);
 
       g_object_unref (line->commit);
-      g_free (line->text);
+      if (priv->cache_entry == NULL)
+        g_free (line->text);
+      g_free (line->runs);
     }
 
   g_array_set_size (priv->lines, 0);
 
+  git_annotated_source_free_owners (source);
+
+  priv->text_size = 0;
+  git_annotated_source_account_text (source);
+
+  git_annotated_source_free_column_maps (source);
+
+  if (priv->cache_entry)
+    {
+      git_blame_cache_entry_free (priv->cache_entry);
+      priv->cache_entry = NULL;
+    }
+  if (priv->cache_idle_source)
+    {
+      g_source_remove (priv->cache_idle_source);
+      priv->cache_idle_source = 0;
+    }
+
   if (priv->current_line.commit)
     {
       g_object_unref (priv->current_line.commit);
@@ -156,6 +281,12 @@ git_annotated_source_dispose (GObject *object)
       priv->reader = NULL;
     }
 
+  if (priv->cache_idle_source)
+    {
+      g_source_remove (priv->cache_idle_source);
+      priv->cache_idle_source = 0;
+    }
+
   G_OBJECT_CLASS (git_annotated_source_parent_class)->dispose (object);
 }
 
@@ -167,9 +298,19 @@ git_annotated_source_finalize (GObject *object)
 
   git_annotated_source_clear_lines (self);
   g_array_free (priv->lines, TRUE);
+  g_ptr_array_free (priv->column_maps, TRUE);
+  g_ptr_array_free (priv->owners, TRUE);
+  g_hash_table_destroy (priv->owners_by_author);
 
   if (priv->repo)
     g_free (priv->repo);
+  if (priv->cache_key)
+    g_free (priv->cache_key);
+  if (priv->encoding)
+    g_free (priv->encoding);
+
+  g_timer_destroy (priv->progress_timer);
+  g_mutex_free (priv->load_mutex);
 
   G_OBJECT_CLASS (git_annotated_source_parent_class)->finalize (object);
 }
@@ -182,11 +323,93 @@ git_annotated_source_new (void)
   return self;
 }
 
+static void
+git_annotated_source_load_block (GitAnnotatedSource *source, guint block)
+{
+  GitAnnotatedSourcePrivate *priv = source->priv;
+  guint lines_per_block, first, last, line_num;
+  const gchar *text;
+  gsize size, offset = 0;
+  GError *error = NULL;
+
+  lines_per_block
+    = git_blame_cache_entry_get_lines_per_block (priv->cache_entry);
+  first = block * lines_per_block;
+  last = MIN (first + lines_per_block, priv->lines->len);
+
+  text = git_blame_cache_entry_get_block_text (priv->cache_entry, block,
+                                               &size, &error);
+
+  if (text == NULL)
+    {
+      g_warning ("%s", error->message);
+      g_error_free (error);
+    }
+
+  for (line_num = first; line_num < last; line_num++)
+    {
+      GitAnnotatedSourceLine *line
+        = &g_array_index (priv->lines, GitAnnotatedSourceLine, line_num);
+
+      /* The text pointer is set last so that another thread that
+         sees it also sees the length and flags */
+      if (text && offset + line->text_length < size
+          && text[offset + line->text_length] == '\0')
+        {
+          g_atomic_pointer_set ((gpointer *) &line->text,
+                                (gchar *) text + offset);
+          offset += line->text_length + 1;
+        }
+      else
+        {
+          /* If the block is corrupt then show the rest of the lines
+             as empty rather than leaving them unloaded */
+          text = NULL;
+          line->text_length = 0;
+          line->flags = GIT_ANNOTATED_SOURCE_LINE_ASCII;
+          g_atomic_pointer_set ((gpointer *) &line->text, "");
+        }
+    }
+}
+
 const GitAnnotatedSourceLine *
 git_annotated_source_get_line (GitAnnotatedSource *source,
                                gsize line_num)
 {
   GitAnnotatedSourcePrivate *priv;
+  GitAnnotatedSourceLine *line;
+
+  g_return_val_if_fail (GIT_IS_ANNOTATED_SOURCE (source), NULL);
+  priv = source->priv;
+  g_return_val_if_fail (line_num >= 0 && line_num < priv->lines->len, NULL);
+
+  line = &g_array_index (priv->lines, GitAnnotatedSourceLine, line_num);
+
+  /* Lines loaded from the cache only get their text once it is
+     needed */
+  if (g_atomic_pointer_get ((gpointer *) &line->text) == NULL
+      && priv->cache_entry)
+    {
+      g_mutex_lock (priv->load_mutex);
+      if (line->text == NULL)
+        git_annotated_source_load_block
+          (source,
+           line_num / git_blame_cache_entry_get_lines_per_block
+           (priv->cache_entry));
+      g_mutex_unlock (priv->load_mutex);
+    }
+
+  return line;
+}
+
+/* Same as git_annotated_source_get_line except that the text may be
+   NULL if it hasn't been loaded yet. This can be used to avoid
+   loading the text when only the commit or the length is needed */
+const GitAnnotatedSourceLine *
+git_annotated_source_peek_line (GitAnnotatedSource *source,
+                                gsize line_num)
+{
+  GitAnnotatedSourcePrivate *priv;
 
   g_return_val_if_fail (GIT_IS_ANNOTATED_SOURCE (source), NULL);
   priv = source->priv;
@@ -195,6 +418,153 @@ git_annotated_source_get_line (GitAnnotatedSource *source,
   return &g_array_index (priv->lines, GitAnnotatedSourceLine, line_num);
 }
 
+/* Gets the map between byte offsets and columns for a line. The map
+   is built the first time it is requested and then kept until the
+   source is fetched again */
+GitColumnMap *
+git_annotated_source_get_column_map (GitAnnotatedSource *source,
+                                     gsize line_num)
+{
+  GitAnnotatedSourcePrivate *priv;
+  const GitAnnotatedSourceLine *line;
+  GitColumnMap *map;
+
+  g_return_val_if_fail (GIT_IS_ANNOTATED_SOURCE (source), NULL);
+  priv = source->priv;
+  g_return_val_if_fail (line_num >= 0 && line_num < priv->lines->len, NULL);
+
+  if (priv->column_maps->len < priv->lines->len)
+    g_ptr_array_set_size (priv->column_maps, priv->lines->len);
+
+  if ((map = g_ptr_array_index (priv->column_maps, line_num)) == NULL)
+    {
+      line = git_annotated_source_get_line (source, line_num);
+      map = git_column_map_new (line->text, line->text_length);
+      g_ptr_array_index (priv->column_maps, line_num) = map;
+    }
+
+  return map;
+}
+
+/* Frees all of the column maps to save memory. They will be built
+   again when they are next needed */
+void
+git_annotated_source_free_column_maps (GitAnnotatedSource *source)
+{
+  GitAnnotatedSourcePrivate *priv;
+  guint i;
+
+  g_return_if_fail (GIT_IS_ANNOTATED_SOURCE (source));
+  priv = source->priv;
+
+  for (i = 0; i < priv->column_maps->len; i++)
+    if (g_ptr_array_index (priv->column_maps, i))
+      git_column_map_free (g_ptr_array_index (priv->column_maps, i));
+  g_ptr_array_set_size (priv->column_maps, 0);
+}
+
+/* Replaces the syntax highlighting runs of a line. The source takes
+   ownership of the runs */
+void
+git_annotated_source_set_line_runs (GitAnnotatedSource *source,
+                                    gsize line_num,
+                                    GitHighlightRun *runs,
+                                    guint n_runs)
+{
+  GitAnnotatedSourcePrivate *priv;
+  GitAnnotatedSourceLine *line;
+
+  g_return_if_fail (GIT_IS_ANNOTATED_SOURCE (source));
+  priv = source->priv;
+  g_return_if_fail (line_num >= 0 && line_num < priv->lines->len);
+
+  line = &g_array_index (priv->lines, GitAnnotatedSourceLine, line_num);
+
+  g_free (line->runs);
+  line->runs = runs;
+  line->n_runs = n_runs;
+}
+
+/* Sets the character set that the text of the file is in. It takes
+   effect for the next fetch. If it is NULL then lines that are not
+   valid UTF-8 are assumed to be in the locale's character set or
+   ISO-8859-1 */
+void
+git_annotated_source_set_encoding (GitAnnotatedSource *source,
+                                   const gchar *encoding)
+{
+  GitAnnotatedSourcePrivate *priv;
+
+  g_return_if_fail (GIT_IS_ANNOTATED_SOURCE (source));
+
+  priv = source->priv;
+
+  g_free (priv->encoding);
+  priv->encoding = g_strdup (encoding);
+}
+
+/* In reverse mode each line is attributed to the last revision in
+   the range that still had it instead of the one that added it so
+   that it is possible to find when lines were removed. The revision
+   passed to the fetch functions must then be a range like "A..B" or
+   a single revision to go up to HEAD. Reverse blames are never
+   cached */
+void
+git_annotated_source_set_reverse (GitAnnotatedSource *source,
+                                  gboolean reverse)
+{
+  g_return_if_fail (GIT_IS_ANNOTATED_SOURCE (source));
+
+  source->priv->reverse = reverse;
+}
+
+/* The expected number of lines is used to report the progress of a
+   fetch. It is only known in advance if some other part of the
+   program has looked at the file contents */
+void
+git_annotated_source_set_expected_lines (GitAnnotatedSource *source,
+                                         guint expected_lines)
+{
+  g_return_if_fail (GIT_IS_ANNOTATED_SOURCE (source));
+
+  source->priv->expected_lines = expected_lines;
+}
+
+void
+git_annotated_source_get_progress (GitAnnotatedSource *source,
+                                   GitAnnotatedSourceProgress *progress)
+{
+  GitAnnotatedSourcePrivate *priv;
+
+  g_return_if_fail (GIT_IS_ANNOTATED_SOURCE (source));
+  g_return_if_fail (progress != NULL);
+
+  priv = source->priv;
+
+  progress->bytes_read = priv->bytes_read;
+  progress->n_lines = priv->lines->len;
+  progress->expected_lines = priv->expected_lines;
+  progress->elapsed = g_timer_elapsed (priv->progress_timer, NULL);
+}
+
+gboolean
+git_annotated_source_get_cache_stats (GitAnnotatedSource *source,
+                                      GitBlameCacheStats *stats)
+{
+  GitAnnotatedSourcePrivate *priv;
+
+  g_return_val_if_fail (GIT_IS_ANNOTATED_SOURCE (source), FALSE);
+
+  priv = source->priv;
+
+  if (priv->cache_entry == NULL)
+    return FALSE;
+
+  git_blame_cache_entry_get_stats (priv->cache_entry, stats);
+
+  return TRUE;
+}
+
 gsize
 git_annotated_source_get_n_lines (GitAnnotatedSource *source)
 {
@@ -207,11 +577,425 @@ git_annotated_source_get_n_lines (GitAnnotatedSource *source)
   return priv->lines->len;
 }
 
+static void
+git_annotated_source_add_owner_run (GitAnnotatedSource *source,
+                                    GHashTable *share_indices,
+                                    GitCommit *commit,
+                                    guint start, guint end)
+{
+  GitAnnotatedSourcePrivate *priv = source->priv;
+  GitAnnotatedSourceOwner *owner;
+  GitAnnotatedSourceShare *share;
+  GitAnnotatedSourceRun *last_run;
+  const gchar *author = git_commit_get_prop (commit, "author");
+  guint share_index;
+
+  if (author == NULL)
+    author = "";
+
+  if ((owner = g_hash_table_lookup (priv->owners_by_author, author)) == NULL)
+    {
+      owner = g_slice_new0 (GitAnnotatedSourceOwner);
+      owner->author = g_strdup (author);
+      owner->commits = g_array_new (FALSE, FALSE,
+                                    sizeof (GitAnnotatedSourceShare));
+      owner->runs = g_array_new (FALSE, FALSE,
+                                 sizeof (GitAnnotatedSourceRun));
+      g_ptr_array_add (priv->owners, owner);
+      g_hash_table_insert (priv->owners_by_author, owner->author, owner);
+    }
+
+  owner->n_lines += end - start;
+
+  /* The indices are stored plus one so that a missing commit can be
+     told apart from the first one */
+  share_index = GPOINTER_TO_UINT (g_hash_table_lookup (share_indices,
+                                                       commit));
+  if (share_index == 0)
+    {
+      gulong time = git_commit_get_author_time (commit);
+      GitAnnotatedSourceShare new_share;
+
+      new_share.commit = commit;
+      new_share.n_lines = 0;
+      g_array_append_val (owner->commits, new_share);
+      share_index = owner->commits->len;
+      g_hash_table_insert (share_indices, commit,
+                           GUINT_TO_POINTER (share_index));
+
+      if (owner->latest_commit == NULL || time > owner->latest_time)
+        {
+          owner->latest_commit = commit;
+          owner->latest_time = time;
+        }
+    }
+
+  share = &g_array_index (owner->commits, GitAnnotatedSourceShare,
+                          share_index - 1);
+  share->n_lines += end - start;
+
+  /* Neighbouring commits by the same author make one run */
+  last_run = (owner->runs->len > 0
+              ? &g_array_index (owner->runs, GitAnnotatedSourceRun,
+                                owner->runs->len - 1)
+              : NULL);
+  if (last_run && last_run->end == start)
+    last_run->end = end;
+  else
+    {
+      GitAnnotatedSourceRun run;
+
+      run.start = start;
+      run.end = end;
+      g_array_append_val (owner->runs, run);
+    }
+}
+
+/* Upper limit in seconds of each age bucket apart from the last */
+static const gulong
+git_annotated_source_age_limits[GIT_ANNOTATED_SOURCE_N_AGES - 1] =
+  {
+    30 * 24 * 60 * 60,
+    91 * 24 * 60 * 60,
+    182 * 24 * 60 * 60,
+    365 * 24 * 60 * 60,
+    2 * 365 * 24 * 60 * 60,
+    5 * 365 * 24 * 60 * 60
+  };
+
+static void
+git_annotated_source_add_age_run (GitAnnotatedSource *source,
+                                  GitCommit *commit,
+                                  guint n_lines)
+{
+  GitAnnotatedSourceAges *ages = &source->priv->ages;
+  gulong time = git_commit_get_author_time (commit);
+  gulong age = time < ages->now ? ages->now - time : 0;
+  guint bucket;
+
+  for (bucket = 0; bucket < GIT_ANNOTATED_SOURCE_N_AGES - 1; bucket++)
+    if (age < git_annotated_source_age_limits[bucket])
+      break;
+
+  ages->n_lines[bucket] += n_lines;
+
+  if (ages->oldest_time == 0 || time < ages->oldest_time)
+    ages->oldest_time = time;
+  if (time > ages->newest_time)
+    ages->newest_time = time;
+}
+
+static gint
+git_annotated_source_compare_owners (gconstpointer a, gconstpointer b)
+{
+  const GitAnnotatedSourceOwner *owner_a
+    = *(const GitAnnotatedSourceOwner **) a;
+  const GitAnnotatedSourceOwner *owner_b
+    = *(const GitAnnotatedSourceOwner **) b;
+
+  if (owner_a->n_lines != owner_b->n_lines)
+    return owner_a->n_lines > owner_b->n_lines ? -1 : 1;
+  else
+    return strcmp (owner_a->author, owner_b->author);
+}
+
+/* Works out who owns the lines of the file and how old they are in
+   a single pass over the runs of lines from the same commit */
+static void
+git_annotated_source_build_summary (GitAnnotatedSource *source)
+{
+  GitAnnotatedSourcePrivate *priv = source->priv;
+  GHashTable *share_indices;
+  GitCommit *last_commit = NULL;
+  guint line_num, run_start = 0;
+  GTimeVal now;
+
+  git_annotated_source_free_owners (source);
+
+  g_get_current_time (&now);
+  priv->ages.now = now.tv_sec;
+
+  share_indices = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  for (line_num = 0; line_num <= priv->lines->len; line_num++)
+    {
+      GitCommit *commit
+        = (line_num < priv->lines->len
+           ? g_array_index (priv->lines, GitAnnotatedSourceLine,
+                            line_num).commit
+           : NULL);
+
+      if (commit != last_commit)
+        {
+          if (last_commit)
+            {
+              git_annotated_source_add_owner_run (source, share_indices,
+                                                  last_commit,
+                                                  run_start, line_num);
+              git_annotated_source_add_age_run (source, last_commit,
+                                                line_num - run_start);
+            }
+          run_start = line_num;
+          last_commit = commit;
+        }
+    }
+
+  g_hash_table_destroy (share_indices);
+
+  g_ptr_array_sort (priv->owners, git_annotated_source_compare_owners);
+}
+
+guint
+git_annotated_source_get_n_owners (GitAnnotatedSource *source)
+{
+  g_return_val_if_fail (GIT_IS_ANNOTATED_SOURCE (source), 0);
+
+  return source->priv->owners->len;
+}
+
+const GitAnnotatedSourceOwner *
+git_annotated_source_get_owner (GitAnnotatedSource *source, guint owner_num)
+{
+  GitAnnotatedSourcePrivate *priv;
+
+  g_return_val_if_fail (GIT_IS_ANNOTATED_SOURCE (source), NULL);
+
+  priv = source->priv;
+
+  g_return_val_if_fail (owner_num < priv->owners->len, NULL);
+
+  return g_ptr_array_index (priv->owners, owner_num);
+}
+
+void
+git_annotated_source_get_ages (GitAnnotatedSource *source,
+                               GitAnnotatedSourceAges *ages)
+{
+  g_return_if_fail (GIT_IS_ANNOTATED_SOURCE (source));
+  g_return_if_fail (ages != NULL);
+
+  *ages = source->priv->ages;
+}
+
+const GitAnnotatedSourceOwner *
+git_annotated_source_find_owner (GitAnnotatedSource *source,
+                                 const gchar *author)
+{
+  g_return_val_if_fail (GIT_IS_ANNOTATED_SOURCE (source), NULL);
+  g_return_val_if_fail (author != NULL, NULL);
+
+  return g_hash_table_lookup (source->priv->owners_by_author, author);
+}
+
+static gboolean
+git_annotated_source_on_cache_idle (gpointer data)
+{
+  GitAnnotatedSource *source = (GitAnnotatedSource *) data;
+
+  source->priv->cache_idle_source = 0;
+
+  git_annotated_source_build_summary (source);
+
+  g_signal_emit (source, client_signals[COMPLETED], 0, NULL);
+
+  return FALSE;
+}
+
+static gboolean
+git_annotated_source_load_from_cache (GitAnnotatedSource *source)
+{
+  GitAnnotatedSourcePrivate *priv = source->priv;
+  GitBlameCacheEntry *entry;
+  GError *error = NULL;
+
+  if ((entry = git_blame_cache_entry_open (priv->cache_key, &error)) == NULL)
+    {
+      /* A missing entry isn't an error */
+      if (error)
+        {
+          g_warning ("%s", error->message);
+          g_error_free (error);
+        }
+
+      return FALSE;
+    }
+
+  g_array_set_size (priv->lines, git_blame_cache_entry_get_n_lines (entry));
+
+  if (!git_blame_cache_entry_read_lines (entry, priv->repo,
+                                         (GitAnnotatedSourceLine *)
+                                         priv->lines->data,
+                                         &error))
+    {
+      g_warning ("%s", error->message);
+      g_error_free (error);
+      g_array_set_size (priv->lines, 0);
+      git_blame_cache_entry_free (entry);
+
+      return FALSE;
+    }
+
+  priv->cache_entry = entry;
+
+  /* The completed signal is emitted from an idle handler so that it
+     is still asynchronous like a blame from git */
+  priv->cache_idle_source
+    = g_idle_add (git_annotated_source_on_cache_idle, source);
+
+  return TRUE;
+}
+
+/* Copies the text of a line converting it to UTF-8 once here so that
+   Pango doesn't have to validate it every time it is painted */
+static void
+git_annotated_source_set_line_text (GitAnnotatedSource *source,
+                                    GitAnnotatedSourceLine *line,
+                                    const gchar *str, gsize length)
+{
+  GitAnnotatedSourcePrivate *priv = source->priv;
+  gboolean is_ascii;
+
+  if (git_utf8_validate (str, length, &is_ascii)
+      && (is_ascii || priv->encoding == NULL
+          || !g_ascii_strcasecmp (priv->encoding, "UTF-8")))
+    {
+      line->text = g_strndup (str, length);
+      line->text_length = length;
+    }
+  else
+    {
+      gsize converted_length;
+
+      line->text = git_utf8_convert (str, length, priv->encoding,
+                                     &converted_length);
+      line->text_length = converted_length;
+    }
+
+  line->flags = is_ascii ? GIT_ANNOTATED_SOURCE_LINE_ASCII : 0;
+  priv->text_size += line->text_length + 1;
+}
+
+/* Replaces the lines with ones that were worked out without running
+   git-blame. Only the commit, original line number and text of each
+   line are used and they are copied. The completed signal is not
+   emitted */
+void
+git_annotated_source_load_lines (GitAnnotatedSource *source,
+                                 const gchar *repo,
+                                 const GitAnnotatedSourceLine *lines,
+                                 guint n_lines)
+{
+  GitAnnotatedSourcePrivate *priv;
+  guint i;
+
+  g_return_if_fail (GIT_IS_ANNOTATED_SOURCE (source));
+  g_return_if_fail (repo != NULL);
+  g_return_if_fail (n_lines == 0 || lines != NULL);
+
+  priv = source->priv;
+
+  git_reader_cancel (priv->reader);
+  git_annotated_source_clear_lines (source);
+
+  if (priv->cache_key)
+    {
+      g_free (priv->cache_key);
+      priv->cache_key = NULL;
+    }
+
+  g_free (priv->repo);
+  priv->repo = g_strdup (repo);
+
+  g_array_set_size (priv->lines, n_lines);
+
+  for (i = 0; i < n_lines; i++)
+    {
+      GitAnnotatedSourceLine *line
+        = &g_array_index (priv->lines, GitAnnotatedSourceLine, i);
+
+      line->commit = g_object_ref (lines[i].commit);
+      line->orig_line = lines[i].orig_line;
+      line->final_line = i + 1;
+      git_annotated_source_set_line_text (source, line, lines[i].text,
+                                          lines[i].text_length);
+    }
+
+  git_annotated_source_account_text (source);
+  git_annotated_source_build_summary (source);
+}
+
+/* Parses blame output that was produced without running git as if
+   it had been read from git-blame. This is only used for
+   benchmarking the parser */
+void
+_git_annotated_source_parse (GitAnnotatedSource *source,
+                             const gchar *repo,
+                             const gchar *data,
+                             gsize length)
+{
+  GitAnnotatedSourcePrivate *priv;
+  const gchar *end = data + length, *line_end;
+
+  g_return_if_fail (GIT_IS_ANNOTATED_SOURCE (source));
+  g_return_if_fail (repo != NULL);
+
+  priv = source->priv;
+
+  git_reader_cancel (priv->reader);
+  git_annotated_source_clear_lines (source);
+
+  if (priv->cache_key)
+    {
+      g_free (priv->cache_key);
+      priv->cache_key = NULL;
+    }
+
+  g_free (priv->repo);
+  priv->repo = g_strdup (repo);
+
+  priv->bytes_read = 0;
+  priv->expected_lines = 0;
+  priv->last_progress_time = 0.0;
+  priv->progress_countdown = 0;
+  g_timer_start (priv->progress_timer);
+
+  while (data < end)
+    {
+      if ((line_end = memchr (data, '\n', end - data)))
+        line_end++;
+      else
+        line_end = end;
+
+      if (!git_annotated_source_on_line (priv->reader, line_end - data, data,
+                                         source))
+        return;
+
+      data = line_end;
+    }
+
+  git_annotated_source_on_reader_completed (priv->reader, NULL, source);
+}
+
 gboolean
 git_annotated_source_fetch (GitAnnotatedSource *source,
                             const gchar *filename,
                             const gchar *revision,
                             GError **error)
+{
+  return git_annotated_source_fetch_range (source, filename, revision,
+                                           0, 0, error);
+}
+
+/* Fetches the blame for only the lines from first_line to last_line
+   inclusive. The line numbers start from 1. If last_line is 0 then
+   the whole file is fetched. Partial blames are never cached */
+gboolean
+git_annotated_source_fetch_range (GitAnnotatedSource *source,
+                                  const gchar *filename,
+                                  const gchar *revision,
+                                  guint first_line,
+                                  guint last_line,
+                                  GError **error)
 {
   GitAnnotatedSourcePrivate *priv;
   gchar *repo, *base_part;
@@ -221,11 +1005,27 @@ git_annotated_source_fetch (GitAnnotatedSource *source,
   g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
   g_return_val_if_fail (source->priv->reader != NULL, FALSE);
   g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (!source->priv->reverse || revision != NULL, FALSE);
 
   priv = source->priv;
 
+  git_alloc_set_phase (GIT_ALLOC_PHASE_SPAWN);
+
   git_annotated_source_clear_lines (source);
 
+  if (priv->cache_key)
+    {
+      g_free (priv->cache_key);
+      priv->cache_key = NULL;
+    }
+
+  priv->bytes_read = 0;
+  priv->expected_lines
+    = last_line > 0 ? last_line - MAX (first_line, 1) + 1 : 0;
+  priv->last_progress_time = 0.0;
+  priv->progress_countdown = 0;
+  g_timer_start (priv->progress_timer);
+
   if (!git_find_repo (filename, &repo, &base_part))
     {
       g_set_error (error, GIT_ERROR, GIT_ERROR_NO_REPO,
@@ -238,10 +1038,53 @@ git_annotated_source_fetch (GitAnnotatedSource *source,
     g_free (priv->repo);
   priv->repo = g_strdup (repo);
 
-  /* Revision can be NULL in which case it will terminate the argument
-     list early and git will include uncommitted changes */
-  ret = git_reader_start (priv->reader, repo, error, "blame", "-p",
-                          base_part, revision, NULL);
+  if (last_line == 0 && !priv->reverse)
+    priv->cache_key = git_blame_cache_get_key (repo, revision, base_part);
+
+  if (priv->reverse)
+    {
+      /* The output of a reverse blame is in the same porcelain
+         format so it goes through the same parser */
+      if (last_line > 0)
+        {
+          gchar *range = g_strdup_printf ("%u,%u", MAX (first_line, 1),
+                                          last_line);
+
+          ret = git_reader_start (priv->reader, repo, error, "blame", "-p",
+                                  "--reverse", "-L", range, revision,
+                                  "--", base_part, NULL);
+
+          g_free (range);
+        }
+      else
+        ret = git_reader_start (priv->reader, repo, error, "blame", "-p",
+                                "--reverse", revision, "--", base_part,
+                                NULL);
+    }
+  else if (last_line > 0)
+    {
+      gchar *range = g_strdup_printf ("%u,%u", MAX (first_line, 1),
+                                      last_line);
+
+      ret = git_reader_start (priv->reader, repo, error, "blame", "-p",
+                              "-L", range, base_part, revision, NULL);
+
+      g_free (range);
+    }
+  else if (priv->cache_key
+           && git_annotated_source_load_from_cache (source))
+    {
+      /* Make sure a blame started by a previous fetch doesn't add
+         any more lines */
+      git_reader_cancel (priv->reader);
+      ret = TRUE;
+    }
+  else
+    /* Revision can be NULL in which case it will terminate the
+       argument list early and git will include uncommitted
+       changes */
+    ret = git_reader_start (priv->reader, repo, error, "blame", "-p",
+                            base_part, revision, NULL);
 
   g_free (repo);
   g_free (base_part);
@@ -267,12 +1110,33 @@ git_annotated_source_on_reader_completed (GitReader *reader,
                                           const GError *error,
                                           GitAnnotatedSource *source)
 {
+  GitAnnotatedSourcePrivate *priv = source->priv;
+
   /* If we've got a commit for the current line then we must be
      missing the actual code for the line so the output is invalid */
-  if (source->priv->current_line.commit)
+  if (priv->current_line.commit)
     git_annotated_source_parse_error (source);
   else
-    g_signal_emit (source, client_signals[COMPLETED], 0, error);
+    {
+      /* Compressing and writing a big blame would stall the main
+         loop so it is done on the cache's thread */
+      if (error == NULL && priv->cache_key)
+        git_blame_cache_store_async (priv->cache_key,
+                                     (GitAnnotatedSourceLine *)
+                                     priv->lines->data,
+                                     priv->lines->len);
+
+      git_annotated_source_account_text (source);
+
+      if (error == NULL)
+        git_annotated_source_build_summary (source);
+
+      GIT_TRACE1 (blame__completed, priv->lines->len);
+
+      git_alloc_set_phase (GIT_ALLOC_PHASE_COMPLETE);
+
+      g_signal_emit (source, client_signals[COMPLETED], 0, error);
+    }
 }
 
 static gboolean
@@ -285,6 +1149,29 @@ git_annotated_source_on_line (GitReader *reader,
   const gchar *p = str;
   gboolean ret = TRUE;
 
+  if (priv->bytes_read == 0)
+    git_alloc_set_phase (GIT_ALLOC_PHASE_PARSE);
+
+  priv->bytes_read += length;
+
+  /* Only check the time every so often so that we don't call into
+     the system for every line */
+  if (priv->progress_countdown-- == 0)
+    {
+      gdouble now = g_timer_elapsed (priv->progress_timer, NULL);
+
+      priv->progress_countdown = GIT_ANNOTATED_SOURCE_PROGRESS_LINES;
+
+      git_annotated_source_account_text (source);
+
+      if (now - priv->last_progress_time
+          >= GIT_ANNOTATED_SOURCE_PROGRESS_INTERVAL)
+        {
+          priv->last_progress_time = now;
+          g_signal_emit (source, client_signals[PROGRESS], 0);
+        }
+    }
+
   /* If we haven't got a commit yet then we are expecting the first
      line to be the commit hash followed by two or three numbers for
      the lines */
@@ -362,7 +1249,8 @@ git_annotated_source_on_line (GitReader *reader,
   /* If this is the code of the line then it begins with a tab */
   else if (length >= 1 && *str == '\t')
     {
-      priv->current_line.text = g_strndup (str + 1, length - 1);
+      git_annotated_source_set_line_text (source, &priv->current_line,
+                                          str + 1, length - 1);
       g_array_append_val (priv->lines, priv->current_line);
       priv->current_line.commit = NULL;
       priv->current_line.text = NULL;
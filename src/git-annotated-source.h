@@ -20,6 +20,8 @@
 
 #include <glib-object.h>
 #include "git-commit.h"
+#include "git-column-map.h"
+#include "git-highlight-language.h"
 
 G_BEGIN_DECLS
 
@@ -48,12 +50,19 @@ typedef struct _GitAnnotatedSource        GitAnnotatedSource;
 typedef struct _GitAnnotatedSourceClass   GitAnnotatedSourceClass;
 typedef struct _GitAnnotatedSourcePrivate GitAnnotatedSourcePrivate;
 typedef struct _GitAnnotatedSourceLine    GitAnnotatedSourceLine;
+typedef struct _GitBlameCacheStats        GitBlameCacheStats;
+typedef struct _GitAnnotatedSourceProgress GitAnnotatedSourceProgress;
+typedef struct _GitAnnotatedSourceRun     GitAnnotatedSourceRun;
+typedef struct _GitAnnotatedSourceShare   GitAnnotatedSourceShare;
+typedef struct _GitAnnotatedSourceOwner   GitAnnotatedSourceOwner;
+typedef struct _GitAnnotatedSourceAges    GitAnnotatedSourceAges;
 
 struct _GitAnnotatedSourceClass
 {
   GObjectClass parent_class;
 
   void (* completed) (GitAnnotatedSource *source, const GError *error);
+  void (* progress) (GitAnnotatedSource *source);
 };
 
 struct _GitAnnotatedSource
@@ -63,11 +72,92 @@ struct _GitAnnotatedSource
   GitAnnotatedSourcePrivate *priv;
 };
 
+typedef enum {
+  /* The text only contains ASCII characters */
+  GIT_ANNOTATED_SOURCE_LINE_ASCII = 1 << 0
+} GitAnnotatedSourceLineFlags;
+
 struct _GitAnnotatedSourceLine
 {
   GitCommit *commit;
   guint orig_line, final_line;
+  GitAnnotatedSourceLineFlags flags;
+  /* Length of the text in bytes. This is available even if the text
+     hasn't been loaded yet */
+  guint text_length;
   gchar *text;
+  /* Syntax highlighting of the text. This is filled in by a
+     GitHighlighter some time after the source has loaded */
+  guint n_runs;
+  GitHighlightRun *runs;
+};
+
+struct _GitAnnotatedSourceProgress
+{
+  /* Number of bytes of output read from git so far */
+  gsize bytes_read;
+  /* Number of lines that have been attributed to a commit */
+  guint n_lines;
+  /* Number of lines in the file or 0 if not known */
+  guint expected_lines;
+  /* Seconds since the fetch was started */
+  gdouble elapsed;
+};
+
+struct _GitAnnotatedSourceRun
+{
+  /* First line of the run and the line after the last */
+  guint start, end;
+};
+
+struct _GitAnnotatedSourceShare
+{
+  GitCommit *commit;
+  /* Number of lines of the file annotated by the commit */
+  guint n_lines;
+};
+
+/* Summary of the lines of the file that were last touched by one
+   author. These are built when the blame completes and the commits
+   are only valid for as long as the lines are */
+struct _GitAnnotatedSourceOwner
+{
+  gchar *author;
+  guint n_lines;
+  /* The author's most recent commit that touches the file and its
+     author time in seconds since the epoch */
+  GitCommit *latest_commit;
+  gulong latest_time;
+  /* A GitAnnotatedSourceShare for each of the author's commits in
+     the order they first appear in the file */
+  GArray *commits;
+  /* Runs of consecutive lines by the author in order of line
+     number */
+  GArray *runs;
+};
+
+/* Buckets for the time since each line was last changed */
+typedef enum {
+  GIT_ANNOTATED_SOURCE_AGE_MONTH,
+  GIT_ANNOTATED_SOURCE_AGE_QUARTER,
+  GIT_ANNOTATED_SOURCE_AGE_HALF_YEAR,
+  GIT_ANNOTATED_SOURCE_AGE_YEAR,
+  GIT_ANNOTATED_SOURCE_AGE_TWO_YEARS,
+  GIT_ANNOTATED_SOURCE_AGE_FIVE_YEARS,
+  GIT_ANNOTATED_SOURCE_AGE_OLDER
+} GitAnnotatedSourceAge;
+
+#define GIT_ANNOTATED_SOURCE_N_AGES (GIT_ANNOTATED_SOURCE_AGE_OLDER + 1)
+
+struct _GitAnnotatedSourceAges
+{
+  /* Number of lines in each age bucket */
+  guint n_lines[GIT_ANNOTATED_SOURCE_N_AGES];
+  /* Author times of the oldest and newest commits in the file */
+  gulong oldest_time, newest_time;
+  /* The time when the blame completed that the ages are relative
+     to */
+  gulong now;
 };
 
 GType git_annotated_source_get_type (void) G_GNUC_CONST;
@@ -77,11 +167,60 @@ gboolean git_annotated_source_fetch (GitAnnotatedSource *source,
                                      const gchar *filename,
                                      const gchar *revision,
                                      GError **error);
+gboolean git_annotated_source_fetch_range (GitAnnotatedSource *source,
+                                           const gchar *filename,
+                                           const gchar *revision,
+                                           guint first_line,
+                                           guint last_line,
+                                           GError **error);
 
 gsize git_annotated_source_get_n_lines (GitAnnotatedSource *source);
 
 const GitAnnotatedSourceLine *
 git_annotated_source_get_line (GitAnnotatedSource *source, gsize line_num);
+const GitAnnotatedSourceLine *
+git_annotated_source_peek_line (GitAnnotatedSource *source, gsize line_num);
+
+void git_annotated_source_set_encoding (GitAnnotatedSource *source,
+                                        const gchar *encoding);
+void git_annotated_source_set_reverse (GitAnnotatedSource *source,
+                                       gboolean reverse);
+void git_annotated_source_set_expected_lines (GitAnnotatedSource *source,
+                                              guint expected_lines);
+void git_annotated_source_get_progress (GitAnnotatedSource *source,
+                                        GitAnnotatedSourceProgress *progress);
+
+GitColumnMap *git_annotated_source_get_column_map (GitAnnotatedSource *source,
+                                                   gsize line_num);
+void git_annotated_source_free_column_maps (GitAnnotatedSource *source);
+
+void git_annotated_source_set_line_runs (GitAnnotatedSource *source,
+                                         gsize line_num,
+                                         GitHighlightRun *runs,
+                                         guint n_runs);
+
+guint git_annotated_source_get_n_owners (GitAnnotatedSource *source);
+const GitAnnotatedSourceOwner *
+git_annotated_source_get_owner (GitAnnotatedSource *source, guint owner_num);
+const GitAnnotatedSourceOwner *
+git_annotated_source_find_owner (GitAnnotatedSource *source,
+                                 const gchar *author);
+
+void git_annotated_source_get_ages (GitAnnotatedSource *source,
+                                    GitAnnotatedSourceAges *ages);
+
+gboolean git_annotated_source_get_cache_stats (GitAnnotatedSource *source,
+                                               GitBlameCacheStats *stats);
+
+void git_annotated_source_load_lines (GitAnnotatedSource *source,
+                                      const gchar *repo,
+                                      const GitAnnotatedSourceLine *lines,
+                                      guint n_lines);
+
+void _git_annotated_source_parse (GitAnnotatedSource *source,
+                                  const gchar *repo,
+                                  const gchar *data,
+                                  gsize length);
 
 G_END_DECLS
 
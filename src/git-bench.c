@@ -0,0 +1,649 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Micro-benchmarks of the parts of blame-browse that decide how fast
+   a blame appears. Each benchmark is run several times and the median
+   and a 95% confidence interval of the median are reported. The
+   results can be saved as a baseline and later runs compared against
+   it. A difference is only flagged when the confidence intervals
+   don't overlap so that noise isn't reported as a regression. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <pango/pangocairo.h>
+#include <cairo.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+
+#include "git-bench.h"
+#include "git-reader.h"
+#include "git-annotated-source.h"
+#include "git-commit.h"
+#include "git-commit-bag.h"
+#include "git-blame-cache.h"
+#include "git-glyph-cache.h"
+#include "git-common.h"
+
+/* Size of the synthetic blame that the parser, cache and rendering
+   benchmarks work on */
+#define GIT_BENCH_N_LINES   20000
+#define GIT_BENCH_N_COMMITS 500
+
+/* Number of lines drawn by the rendering benchmarks */
+#define GIT_BENCH_N_RENDER_LINES 2000
+
+/* Number of commit lookups done by the commit bag benchmark */
+#define GIT_BENCH_N_LOOKUPS 200000
+
+/* Repository that the synthetic commits claim to come from */
+#define GIT_BENCH_REPO "/blame-browse-bench"
+
+typedef struct _GitBench GitBench;
+typedef struct _GitBenchData GitBenchData;
+typedef struct _GitBenchResult GitBenchResult;
+
+struct _GitBenchData
+{
+  /* Synthetic git-blame porcelain output */
+  GString *blame;
+  /* Source with the synthetic blame already parsed */
+  GitAnnotatedSource *source;
+  gchar **hashes;
+  gchar *cache_key;
+  /* Temporary directory that the cache entry is stored in */
+  gchar *cache_dir;
+  /* Repository in the current directory or NULL if there isn't one */
+  gchar *repo;
+
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  PangoContext *context;
+  PangoLayout *layout;
+  GitGlyphCache *glyph_cache;
+};
+
+struct _GitBench
+{
+  const gchar *name;
+  const gchar *description;
+  /* Returns FALSE if the benchmark can't run in this environment */
+  gboolean (* run) (GitBenchData *data);
+};
+
+struct _GitBenchResult
+{
+  gdouble median, low, high;
+  guint n_runs;
+};
+
+static gboolean
+git_bench_on_reader_line (GitReader *reader, guint length,
+                          const gchar *line, gsize *bytes)
+{
+  *bytes += length;
+
+  return TRUE;
+}
+
+static void
+git_bench_on_reader_completed (GitReader *reader, const GError *error,
+                               GMainLoop *loop)
+{
+  if (error)
+    g_object_set_data (G_OBJECT (reader), "bench-failed",
+                       GINT_TO_POINTER (TRUE));
+
+  g_main_loop_quit (loop);
+}
+
+/* Time to spawn git and read all of its output through a GitReader */
+static gboolean
+git_bench_reader (GitBenchData *data)
+{
+  GitReader *reader;
+  GMainLoop *loop;
+  gsize bytes = 0;
+  gboolean ret;
+
+  if (data->repo == NULL)
+    return FALSE;
+
+  reader = git_reader_new ();
+  loop = g_main_loop_new (NULL, FALSE);
+
+  g_signal_connect (reader, "line",
+                    G_CALLBACK (git_bench_on_reader_line), &bytes);
+  g_signal_connect (reader, "completed",
+                    G_CALLBACK (git_bench_on_reader_completed), loop);
+
+  if ((ret = git_reader_start (reader, data->repo, NULL, "log", "-n", "2000",
+                               "--stat", NULL)))
+    {
+      g_main_loop_run (loop);
+      ret = !g_object_get_data (G_OBJECT (reader), "bench-failed");
+    }
+
+  g_main_loop_unref (loop);
+  g_object_unref (reader);
+
+  return ret;
+}
+
+static gboolean
+git_bench_parse (GitBenchData *data)
+{
+  GitAnnotatedSource *source = git_annotated_source_new ();
+
+  _git_annotated_source_parse (source, GIT_BENCH_REPO,
+                               data->blame->str, data->blame->len);
+
+  g_object_unref (source);
+
+  return TRUE;
+}
+
+/* The commit bag is hit for every line of blame output */
+static gboolean
+git_bench_commit_bag (GitBenchData *data)
+{
+  GitCommitBag *bag = git_commit_bag_get_default ();
+  guint i;
+
+  for (i = 0; i < GIT_BENCH_N_LOOKUPS; i++)
+    {
+      /* The bag keeps the only reference so the commit is not
+         unref'd */
+      git_commit_bag_get (bag, data->hashes[i % GIT_BENCH_N_COMMITS],
+                          GIT_BENCH_REPO);
+    }
+
+  return TRUE;
+}
+
+/* Loading a blame that is already in the cache */
+static gboolean
+git_bench_cache_hit (GitBenchData *data)
+{
+  GitBlameCacheEntry *entry;
+  GitAnnotatedSourceLine *lines;
+  guint i, n_lines, n_blocks;
+  gboolean ret = FALSE;
+
+  if (data->cache_key == NULL
+      || !(entry = git_blame_cache_entry_open (data->cache_key, NULL)))
+    return FALSE;
+
+  n_lines = git_blame_cache_entry_get_n_lines (entry);
+  lines = g_new0 (GitAnnotatedSourceLine, n_lines);
+
+  if (git_blame_cache_entry_read_lines (entry, GIT_BENCH_REPO, lines, NULL))
+    {
+      n_blocks = (n_lines + git_blame_cache_entry_get_lines_per_block (entry)
+                  - 1) / git_blame_cache_entry_get_lines_per_block (entry);
+
+      for (i = 0; i < n_blocks; i++)
+        git_blame_cache_entry_get_block_text (entry, i, NULL, NULL);
+
+      ret = TRUE;
+    }
+
+  for (i = 0; i < n_lines; i++)
+    if (lines[i].commit)
+      g_object_unref (lines[i].commit);
+  g_free (lines);
+
+  git_blame_cache_entry_free (entry);
+
+  return ret;
+}
+
+/* Drawing lines with Pango as the source view does when the glyph
+   cache can't be used */
+static gboolean
+git_bench_render_layout (GitBenchData *data)
+{
+  guint i;
+
+  for (i = 0; i < GIT_BENCH_N_RENDER_LINES; i++)
+    {
+      const GitAnnotatedSourceLine *line
+        = git_annotated_source_get_line (data->source, i);
+
+      pango_layout_set_text (data->layout, line->text, line->text_length);
+      cairo_move_to (data->cr, 0, 0);
+      pango_cairo_show_layout (data->cr, data->layout);
+    }
+
+  return TRUE;
+}
+
+static gboolean
+git_bench_render_glyphs (GitBenchData *data)
+{
+  guint i;
+
+  for (i = 0; i < GIT_BENCH_N_RENDER_LINES; i++)
+    {
+      const GitAnnotatedSourceLine *line
+        = git_annotated_source_get_line (data->source, i);
+
+      git_glyph_cache_draw (data->glyph_cache, data->cr, 0, 0, 0,
+                            line->text, line->text_length);
+    }
+
+  return TRUE;
+}
+
+static const GitBench
+git_bench_benchmarks[] =
+  {
+    { "reader", "git log read through GitReader", git_bench_reader },
+    { "parse", "parsing porcelain blame output", git_bench_parse },
+    { "commit-bag", "commit bag lookups", git_bench_commit_bag },
+    { "cache-hit", "loading a cached blame", git_bench_cache_hit },
+    { "render-layout", "drawing lines with Pango",
+      git_bench_render_layout },
+    { "render-glyphs", "drawing lines from the glyph cache",
+      git_bench_render_glyphs }
+  };
+
+static void
+git_bench_make_blame (GitBenchData *data)
+{
+  GRand *rand = g_rand_new_with_seed (42);
+  guint line_num = 0, i;
+  gboolean *seen = g_new0 (gboolean, GIT_BENCH_N_COMMITS);
+
+  data->hashes = g_new0 (gchar *, GIT_BENCH_N_COMMITS + 1);
+  for (i = 0; i < GIT_BENCH_N_COMMITS; i++)
+    data->hashes[i] = g_strdup_printf ("%08x%032x", g_rand_int (rand), i);
+
+  data->blame = g_string_new (NULL);
+
+  /* Lines are attributed in runs of a random length to random
+     commits like a real blame */
+  while (line_num < GIT_BENCH_N_LINES)
+    {
+      guint commit = g_rand_int_range (rand, 0, GIT_BENCH_N_COMMITS);
+      guint run = g_rand_int_range (rand, 1, 20);
+
+      for (i = 0; i < run && line_num < GIT_BENCH_N_LINES; i++, line_num++)
+        {
+          g_string_append_printf (data->blame, "%s %u %u\n",
+                                  data->hashes[commit],
+                                  line_num + 1, line_num + 1);
+
+          if (!seen[commit])
+            {
+              g_string_append_printf (data->blame,
+                                      "author Author %u\n"
+                                      "author-mail <author%u@example.com>\n"
+                                      "author-time %u\n"
+                                      "author-tz +0000\n"
+                                      "summary Change number %u\n"
+                                      "filename bench.c\n",
+                                      commit, commit,
+                                      1200000000 + commit * 3600, commit);
+              seen[commit] = TRUE;
+            }
+
+          g_string_append_printf (data->blame,
+                                  "\t  if (value_%u > %u)\n",
+                                  line_num, g_rand_int_range (rand, 0, 1000));
+        }
+    }
+
+  g_free (seen);
+  g_rand_free (rand);
+}
+
+static gboolean
+git_bench_setup (GitBenchData *data, GError **error)
+{
+  PangoFontDescription *font;
+  gchar *git_path;
+
+  git_bench_make_blame (data);
+
+  data->source = git_annotated_source_new ();
+  _git_annotated_source_parse (data->source, GIT_BENCH_REPO,
+                               data->blame->str, data->blame->len);
+
+  if (git_annotated_source_get_n_lines (data->source) != GIT_BENCH_N_LINES)
+    {
+      g_set_error (error, GIT_ERROR, GIT_ERROR_PARSE_ERROR,
+                   "The synthetic blame could not be parsed");
+      return FALSE;
+    }
+
+  /* The cache entry is stored in a temporary directory so that the
+     user's cache is left alone */
+  data->cache_dir = g_build_filename (g_get_tmp_dir (),
+                                      "blame-browse-bench-XXXXXX", NULL);
+  if (mkdtemp (data->cache_dir) == NULL)
+    {
+      g_set_error (error, GIT_ERROR, GIT_ERROR_CACHE,
+                   "Failed to create %s: %s", data->cache_dir,
+                   g_strerror (errno));
+      g_free (data->cache_dir);
+      data->cache_dir = NULL;
+      return FALSE;
+    }
+  git_blame_cache_set_dir (data->cache_dir);
+
+  data->cache_key = git_blame_cache_get_key (GIT_BENCH_REPO,
+                                             data->hashes[0], "bench.c");
+  if (!git_blame_cache_store (data->cache_key,
+                              git_annotated_source_peek_line (data->source,
+                                                              0),
+                              GIT_BENCH_N_LINES, error))
+    return FALSE;
+
+  /* The reader benchmark reads the log of the current repo */
+  if ((git_path = g_find_program_in_path ("git")))
+    {
+      git_find_repo (".", &data->repo, NULL);
+      g_free (git_path);
+    }
+
+  data->surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, 800, 20);
+  data->cr = cairo_create (data->surface);
+  data->context = pango_cairo_font_map_create_context
+    (PANGO_CAIRO_FONT_MAP (pango_cairo_font_map_get_default ()));
+  font = pango_font_description_from_string ("Monospace 10");
+  pango_context_set_font_description (data->context, font);
+  pango_font_description_free (font);
+  data->layout = pango_layout_new (data->context);
+  data->glyph_cache = git_glyph_cache_new (data->context);
+
+  return TRUE;
+}
+
+static void
+git_bench_remove_cache_dir (const gchar *cache_dir)
+{
+  GDir *dir;
+  const gchar *name;
+
+  if ((dir = g_dir_open (cache_dir, 0, NULL)))
+    {
+      while ((name = g_dir_read_name (dir)))
+        {
+          gchar *filename = g_build_filename (cache_dir, name, NULL);
+          g_unlink (filename);
+          g_free (filename);
+        }
+
+      g_dir_close (dir);
+    }
+
+  g_rmdir (cache_dir);
+}
+
+static void
+git_bench_teardown (GitBenchData *data)
+{
+  if (data->cache_dir)
+    {
+      git_blame_cache_set_dir (NULL);
+      git_bench_remove_cache_dir (data->cache_dir);
+      g_free (data->cache_dir);
+    }
+  if (data->glyph_cache)
+    git_glyph_cache_free (data->glyph_cache);
+  if (data->layout)
+    g_object_unref (data->layout);
+  if (data->context)
+    g_object_unref (data->context);
+  if (data->cr)
+    cairo_destroy (data->cr);
+  if (data->surface)
+    cairo_surface_destroy (data->surface);
+  if (data->source)
+    g_object_unref (data->source);
+  g_free (data->cache_key);
+  g_free (data->repo);
+  g_strfreev (data->hashes);
+  if (data->blame)
+    g_string_free (data->blame, TRUE);
+}
+
+static gint
+git_bench_compare_doubles (gconstpointer a, gconstpointer b)
+{
+  gdouble da = *(const gdouble *) a, db = *(const gdouble *) b;
+
+  return da < db ? -1 : da > db ? 1 : 0;
+}
+
+/* Gets the 0-based indices of the sorted times that bound a 95%
+   confidence interval for the median. The bounds are the order
+   statistics of rank floor (n/2 - 0.98 sqrt (n)) and
+   ceil (1 + n/2 + 0.98 sqrt (n)) counting from 1 so that no
+   distribution has to be assumed */
+static void
+git_bench_get_interval (guint n_runs, gint *low, gint *high)
+{
+  gdouble spread = 0.98 * sqrt (n_runs);
+
+  *low = (gint) floor (n_runs / 2.0 - spread) - 1;
+  *high = (gint) ceil (n_runs / 2.0 + spread);
+
+  *low = MAX (*low, 0);
+  *high = MIN (*high, (gint) n_runs - 1);
+}
+
+/* Checks the interval against the ranks worked out by hand for ten
+   runs, which are 1 and 9 counting from 1 */
+static void
+git_bench_check_interval (void)
+{
+  gint low, high;
+
+  git_bench_get_interval (10, &low, &high);
+
+  g_assert (low == 0);
+  g_assert (high == 9);
+}
+
+/* Calculates the median of the times and a 95% confidence interval
+   for it */
+static void
+git_bench_summarize (gdouble *times, guint n_runs, GitBenchResult *result)
+{
+  gint low, high;
+
+  qsort (times, n_runs, sizeof (gdouble), git_bench_compare_doubles);
+
+  if (n_runs % 2)
+    result->median = times[n_runs / 2];
+  else
+    result->median = (times[n_runs / 2 - 1] + times[n_runs / 2]) / 2.0;
+
+  git_bench_get_interval (n_runs, &low, &high);
+
+  result->low = times[low];
+  result->high = times[high];
+  result->n_runs = n_runs;
+}
+
+static gboolean
+git_bench_load_result (GKeyFile *key_file, const gchar *name,
+                       GitBenchResult *result)
+{
+  GError *error = NULL;
+
+  if (!g_key_file_has_group (key_file, name))
+    return FALSE;
+
+  result->median = g_key_file_get_double (key_file, name, "median", &error);
+  if (error == NULL)
+    result->low = g_key_file_get_double (key_file, name, "low", &error);
+  if (error == NULL)
+    result->high = g_key_file_get_double (key_file, name, "high", &error);
+  if (error == NULL)
+    result->n_runs = g_key_file_get_integer (key_file, name, "runs", &error);
+
+  if (error)
+    {
+      g_error_free (error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+git_bench_save_result (GKeyFile *key_file, const gchar *name,
+                       const GitBench *bench, const GitBenchResult *result)
+{
+  g_key_file_set_string (key_file, name, "description", bench->description);
+  g_key_file_set_double (key_file, name, "median", result->median);
+  g_key_file_set_double (key_file, name, "low", result->low);
+  g_key_file_set_double (key_file, name, "high", result->high);
+  g_key_file_set_integer (key_file, name, "runs", result->n_runs);
+}
+
+/* Runs all of the benchmarks n_runs times and prints a table of the
+   results. If baseline_filename is given then each result is compared
+   with the baseline and regressed is set if any benchmark is
+   significantly slower. If save_filename is given then the results
+   are written there to be used as a future baseline */
+gboolean
+git_bench_run (guint n_runs,
+               const gchar *baseline_filename,
+               const gchar *save_filename,
+               gboolean *regressed,
+               GError **error)
+{
+  GitBenchData data;
+  GKeyFile *baseline = NULL, *save;
+  gdouble *times;
+  gboolean ret = TRUE;
+  guint i, run;
+
+  g_return_val_if_fail (n_runs > 0, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (regressed)
+    *regressed = FALSE;
+
+  if (baseline_filename)
+    {
+      baseline = g_key_file_new ();
+      if (!g_key_file_load_from_file (baseline, baseline_filename,
+                                      G_KEY_FILE_NONE, error))
+        {
+          g_key_file_free (baseline);
+          return FALSE;
+        }
+    }
+
+  git_bench_check_interval ();
+
+  memset (&data, 0, sizeof (data));
+
+  if (!git_bench_setup (&data, error))
+    {
+      git_bench_teardown (&data);
+      if (baseline)
+        g_key_file_free (baseline);
+      return FALSE;
+    }
+
+  save = g_key_file_new ();
+  times = g_new (gdouble, n_runs);
+
+  printf ("%-14s %10s %10s %10s %8s\n",
+          "benchmark", "median ms", "low ms", "high ms", "delta");
+
+  for (i = 0; i < G_N_ELEMENTS (git_bench_benchmarks); i++)
+    {
+      const GitBench *bench = git_bench_benchmarks + i;
+      GitBenchResult result, base;
+      GTimer *timer = g_timer_new ();
+      gboolean skipped;
+
+      /* The first run warms up the caches and isn't counted */
+      skipped = !bench->run (&data);
+
+      for (run = 0; !skipped && run < n_runs; run++)
+        {
+          g_timer_start (timer);
+          skipped = !bench->run (&data);
+          times[run] = g_timer_elapsed (timer, NULL) * 1000.0;
+        }
+
+      g_timer_destroy (timer);
+
+      if (skipped)
+        {
+          printf ("%-14s %10s\n", bench->name, "skipped");
+          continue;
+        }
+
+      git_bench_summarize (times, n_runs, &result);
+      git_bench_save_result (save, bench->name, bench, &result);
+
+      printf ("%-14s %10.2f %10.2f %10.2f", bench->name,
+              result.median, result.low, result.high);
+
+      if (baseline && git_bench_load_result (baseline, bench->name, &base))
+        {
+          printf (" %+7.1f%%",
+                  (result.median - base.median) * 100.0 / base.median);
+
+          /* Only report a change when the intervals don't overlap */
+          if (result.low > base.high)
+            {
+              printf (" SLOWER");
+              if (regressed)
+                *regressed = TRUE;
+            }
+          else if (result.high < base.low)
+            printf (" faster");
+        }
+
+      putchar ('\n');
+    }
+
+  fflush (stdout);
+
+  if (save_filename)
+    {
+      gchar *contents = g_key_file_to_data (save, NULL, NULL);
+
+      ret = g_file_set_contents (save_filename, contents, -1, error);
+
+      g_free (contents);
+    }
+
+  g_free (times);
+  g_key_file_free (save);
+  if (baseline)
+    g_key_file_free (baseline);
+  git_bench_teardown (&data);
+
+  return ret;
+}
@@ -0,0 +1,33 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_BENCH_H__
+#define __GIT_BENCH_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gboolean git_bench_run (guint n_runs,
+                        const gchar *baseline_filename,
+                        const gchar *save_filename,
+                        gboolean *regressed,
+                        GError **error);
+
+G_END_DECLS
+
+#endif /* __GIT_BENCH_H__ */
@@ -0,0 +1,803 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* On-disk store for parsed blames. Each entry is a single file with
+   a header followed by separately compressed sections: the table of
+   commits and their properties, an array of line records and then
+   the text of the lines split into blocks. Only the header is read
+   when an entry is opened. The commit table and line records are
+   decompressed when the lines are read and each block of text is
+   only decompressed when a line in it is first needed. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include "git-blame-cache.h"
+#include "git-compress.h"
+#include "git-commit.h"
+#include "git-commit-bag.h"
+#include "git-common.h"
+#include "git-trace.h"
+#include "git-memory.h"
+
+#define GIT_BLAME_CACHE_MAGIC "BBLC"
+#define GIT_BLAME_CACHE_VERSION 2
+#define GIT_BLAME_CACHE_LINES_PER_BLOCK 256
+
+/* Magic, version, number of lines, number of commits, lines per
+   block and number of blocks */
+#define GIT_BLAME_CACHE_HEADER_SIZE (6 * 4)
+/* Offset, compressed size and raw size */
+#define GIT_BLAME_CACHE_SECTION_SIZE (3 * 4)
+/* Commit index, original line, final line, text length and flags */
+#define GIT_BLAME_CACHE_LINE_SIZE (5 * 4)
+
+typedef struct _GitBlameCacheSection GitBlameCacheSection;
+
+struct _GitBlameCacheSection
+{
+  guint32 offset, compressed_size, raw_size;
+};
+
+struct _GitBlameCacheEntry
+{
+  GMappedFile *file;
+  const guint8 *data;
+  gsize size;
+
+  guint n_lines, n_commits, lines_per_block, n_blocks;
+
+  GitBlameCacheSection commits, lines;
+  GitBlameCacheSection *blocks;
+  gchar **block_text;
+
+  guint n_blocks_decoded;
+  gdouble decode_time;
+};
+
+static guint32
+git_blame_cache_get_u32 (const guint8 *p)
+{
+  guint32 value;
+
+  memcpy (&value, p, sizeof (value));
+
+  return GUINT32_FROM_LE (value);
+}
+
+static void
+git_blame_cache_set_u32 (GByteArray *buf, guint offset, guint32 value)
+{
+  value = GUINT32_TO_LE (value);
+  memcpy (buf->data + offset, &value, sizeof (value));
+}
+
+static void
+git_blame_cache_append_u32 (GByteArray *buf, guint32 value)
+{
+  value = GUINT32_TO_LE (value);
+  g_byte_array_append (buf, (const guint8 *) &value, sizeof (value));
+}
+
+/* Directory that overrides the user's cache or NULL */
+static gchar *git_blame_cache_dir = NULL;
+
+static gchar *
+git_blame_cache_get_filename (const gchar *key)
+{
+  if (git_blame_cache_dir)
+    return g_build_filename (git_blame_cache_dir, key, NULL);
+  else
+    return g_build_filename (g_get_user_cache_dir (), "blame-browse",
+                             "blame", key, NULL);
+}
+
+/* Stores the entries in dir instead of the user's cache directory.
+   This is for the benchmarks so that they don't touch the real cache.
+   NULL puts back the default */
+void
+git_blame_cache_set_dir (const gchar *dir)
+{
+  g_free (git_blame_cache_dir);
+  git_blame_cache_dir = g_strdup (dir);
+}
+
+static gboolean
+git_blame_cache_is_hash (const gchar *revision)
+{
+  int i;
+
+  for (i = 0; i < GIT_COMMIT_HASH_LENGTH; i++)
+    if ((revision[i] < '0' || revision[i] > '9')
+        && (revision[i] < 'a' || revision[i] > 'f'))
+      return FALSE;
+
+  return revision[i] == '\0';
+}
+
+/* Returns the name to store a blame under or NULL if the blame can't
+   be cached. Only blames of a full commit hash are cached because
+   anything else (including the working copy) can change */
+gchar *
+git_blame_cache_get_key (const gchar *repo,
+                         const gchar *revision,
+                         const gchar *filename)
+{
+  gchar *str, *key;
+
+  g_return_val_if_fail (repo != NULL, NULL);
+  g_return_val_if_fail (filename != NULL, NULL);
+
+  if (revision == NULL || !git_blame_cache_is_hash (revision))
+    return NULL;
+
+  str = g_strconcat (repo, "\n", revision, "\n", filename, NULL);
+  key = g_compute_checksum_for_string (G_CHECKSUM_SHA1, str, -1);
+  g_free (str);
+
+  return key;
+}
+
+static void
+git_blame_cache_append_prop (const gchar *key, const gchar *value,
+                             GByteArray *buf)
+{
+  g_byte_array_append (buf, (const guint8 *) key, strlen (key) + 1);
+  g_byte_array_append (buf, (const guint8 *) value, strlen (value) + 1);
+}
+
+static void
+git_blame_cache_append_commit (GByteArray *buf, GitCommit *commit)
+{
+  g_byte_array_append (buf, (const guint8 *) git_commit_get_hash (commit),
+                       GIT_COMMIT_HASH_LENGTH);
+  git_commit_foreach_prop (commit, (GHFunc) git_blame_cache_append_prop, buf);
+  /* An empty key terminates the properties */
+  g_byte_array_append (buf, (const guint8 *) "", 1);
+}
+
+/* Compresses the raw data onto the end of the buffer and fills in
+   the section descriptor at table_offset. If the data doesn't
+   compress then it is stored as is which is marked by having the
+   same compressed and raw size */
+static void
+git_blame_cache_append_section (GByteArray *buf, guint table_offset,
+                                const guint8 *raw, gsize raw_size)
+{
+  gsize bound = git_compress_bound (raw_size), compressed_size;
+  guint offset = buf->len;
+
+  g_byte_array_set_size (buf, offset + bound);
+
+  compressed_size = git_compress (raw, raw_size, buf->data + offset, bound);
+
+  if (compressed_size == 0 || compressed_size >= raw_size)
+    {
+      memcpy (buf->data + offset, raw, raw_size);
+      compressed_size = raw_size;
+    }
+
+  g_byte_array_set_size (buf, offset + compressed_size);
+
+  git_blame_cache_set_u32 (buf, table_offset, offset);
+  git_blame_cache_set_u32 (buf, table_offset + 4, compressed_size);
+  git_blame_cache_set_u32 (buf, table_offset + 8, raw_size);
+}
+
+/* Everything that is needed to write an entry. This is gathered on
+   the main thread so that the compression and the write can be done
+   on another thread without touching the commits or the lines */
+typedef struct _GitBlameCacheStoreData GitBlameCacheStoreData;
+
+struct _GitBlameCacheStoreData
+{
+  gchar *filename;
+  guint n_lines, n_commits, n_blocks;
+  GByteArray *commits_buf, *lines_buf;
+  /* The text of all of the lines, each terminated with a nul, and
+     the offset of the start of each block in it followed by the
+     total length */
+  GByteArray *text_buf;
+  gsize *block_offsets;
+};
+
+/* Pool with a single thread that writes the entries queued with
+   git_blame_cache_store_async one at a time */
+static GThreadPool *git_blame_cache_store_pool = NULL;
+
+static GitBlameCacheStoreData *
+git_blame_cache_prepare_store (const gchar *key,
+                               const GitAnnotatedSourceLine *lines,
+                               guint n_lines)
+{
+  GitBlameCacheStoreData *data = g_slice_new (GitBlameCacheStoreData);
+  GHashTable *commit_indices;
+  guint i;
+
+  data->filename = git_blame_cache_get_filename (key);
+  data->n_lines = n_lines;
+  data->n_commits = 0;
+  data->n_blocks = (n_lines + GIT_BLAME_CACHE_LINES_PER_BLOCK - 1)
+    / GIT_BLAME_CACHE_LINES_PER_BLOCK;
+  data->commits_buf = g_byte_array_new ();
+  data->lines_buf = g_byte_array_new ();
+  data->text_buf = g_byte_array_new ();
+  data->block_offsets = g_new (gsize, data->n_blocks + 1);
+
+  commit_indices = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  for (i = 0; i < n_lines; i++)
+    {
+      const GitAnnotatedSourceLine *line = lines + i;
+      gpointer value;
+      guint index;
+
+      if (g_hash_table_lookup_extended (commit_indices, line->commit,
+                                        NULL, &value))
+        index = GPOINTER_TO_UINT (value);
+      else
+        {
+          index = data->n_commits++;
+          g_hash_table_insert (commit_indices, line->commit,
+                               GUINT_TO_POINTER (index));
+          git_blame_cache_append_commit (data->commits_buf, line->commit);
+        }
+
+      git_blame_cache_append_u32 (data->lines_buf, index);
+      git_blame_cache_append_u32 (data->lines_buf, line->orig_line);
+      git_blame_cache_append_u32 (data->lines_buf, line->final_line);
+      git_blame_cache_append_u32 (data->lines_buf, line->text_length);
+      git_blame_cache_append_u32 (data->lines_buf, line->flags);
+
+      if (i % GIT_BLAME_CACHE_LINES_PER_BLOCK == 0)
+        data->block_offsets[i / GIT_BLAME_CACHE_LINES_PER_BLOCK]
+          = data->text_buf->len;
+
+      /* Each line is terminated with a nul so that the text can be
+         used directly from the decompressed block */
+      g_byte_array_append (data->text_buf, (const guint8 *) line->text,
+                           line->text_length + 1);
+    }
+
+  data->block_offsets[data->n_blocks] = data->text_buf->len;
+
+  g_hash_table_destroy (commit_indices);
+
+  return data;
+}
+
+static void
+git_blame_cache_free_store_data (GitBlameCacheStoreData *data)
+{
+  g_free (data->filename);
+  g_byte_array_free (data->commits_buf, TRUE);
+  g_byte_array_free (data->lines_buf, TRUE);
+  g_byte_array_free (data->text_buf, TRUE);
+  g_free (data->block_offsets);
+  g_slice_free (GitBlameCacheStoreData, data);
+}
+
+/* Compresses the sections and writes the file. This can be called
+   from any thread */
+static gboolean
+git_blame_cache_write (GitBlameCacheStoreData *data, GError **error)
+{
+  GByteArray *buf;
+  gchar *dirname;
+  guint block;
+  gboolean ret;
+
+  buf = g_byte_array_new ();
+  g_byte_array_append (buf, (const guint8 *) GIT_BLAME_CACHE_MAGIC, 4);
+  git_blame_cache_append_u32 (buf, GIT_BLAME_CACHE_VERSION);
+  git_blame_cache_append_u32 (buf, data->n_lines);
+  git_blame_cache_append_u32 (buf, data->n_commits);
+  git_blame_cache_append_u32 (buf, GIT_BLAME_CACHE_LINES_PER_BLOCK);
+  git_blame_cache_append_u32 (buf, data->n_blocks);
+  /* Leave space for the section table. It gets filled in as each
+     section is appended */
+  g_byte_array_set_size (buf, GIT_BLAME_CACHE_HEADER_SIZE
+                         + (data->n_blocks + 2)
+                         * GIT_BLAME_CACHE_SECTION_SIZE);
+
+  git_blame_cache_append_section (buf, GIT_BLAME_CACHE_HEADER_SIZE,
+                                  data->commits_buf->data,
+                                  data->commits_buf->len);
+  git_blame_cache_append_section (buf, GIT_BLAME_CACHE_HEADER_SIZE
+                                  + GIT_BLAME_CACHE_SECTION_SIZE,
+                                  data->lines_buf->data,
+                                  data->lines_buf->len);
+
+  for (block = 0; block < data->n_blocks; block++)
+    git_blame_cache_append_section (buf, GIT_BLAME_CACHE_HEADER_SIZE
+                                    + (block + 2)
+                                    * GIT_BLAME_CACHE_SECTION_SIZE,
+                                    data->text_buf->data
+                                    + data->block_offsets[block],
+                                    data->block_offsets[block + 1]
+                                    - data->block_offsets[block]);
+
+  dirname = g_path_get_dirname (data->filename);
+
+  if (g_mkdir_with_parents (dirname, 0755) == -1)
+    {
+      g_set_error (error, GIT_ERROR, GIT_ERROR_CACHE,
+                   "Failed to create %s", dirname);
+      ret = FALSE;
+    }
+  else
+    ret = g_file_set_contents (data->filename, (const gchar *) buf->data,
+                               buf->len, error);
+
+  g_free (dirname);
+  g_byte_array_free (buf, TRUE);
+
+  return ret;
+}
+
+gboolean
+git_blame_cache_store (const gchar *key,
+                       const GitAnnotatedSourceLine *lines,
+                       guint n_lines,
+                       GError **error)
+{
+  GitBlameCacheStoreData *data;
+  gboolean ret;
+
+  g_return_val_if_fail (key != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  data = git_blame_cache_prepare_store (key, lines, n_lines);
+  ret = git_blame_cache_write (data, error);
+  git_blame_cache_free_store_data (data);
+
+  return ret;
+}
+
+static void
+git_blame_cache_store_thread_func (gpointer task, gpointer user_data)
+{
+  GitBlameCacheStoreData *data = task;
+  GError *error = NULL;
+
+  if (!git_blame_cache_write (data, &error))
+    {
+      g_warning ("Failed to store blame in cache: %s", error->message);
+      g_error_free (error);
+    }
+
+  git_blame_cache_free_store_data (data);
+}
+
+/* Same as git_blame_cache_store except that only the lines are
+   copied straight away. The compression and the write are done on
+   another thread so that a big blame doesn't stall the main loop
+   when it finishes. Any error is only logged */
+void
+git_blame_cache_store_async (const gchar *key,
+                             const GitAnnotatedSourceLine *lines,
+                             guint n_lines)
+{
+  GError *error = NULL;
+
+  g_return_if_fail (key != NULL);
+
+  if (git_blame_cache_store_pool == NULL
+      && (git_blame_cache_store_pool
+          = g_thread_pool_new (git_blame_cache_store_thread_func, NULL,
+                               1, FALSE, &error)) == NULL)
+    {
+      g_warning ("%s", error->message);
+      g_error_free (error);
+      return;
+    }
+
+  g_thread_pool_push (git_blame_cache_store_pool,
+                      git_blame_cache_prepare_store (key, lines, n_lines),
+                      NULL);
+}
+
+/* Waits for all of the entries queued with git_blame_cache_store_async
+   to be written */
+void
+git_blame_cache_flush (void)
+{
+  if (git_blame_cache_store_pool)
+    {
+      g_thread_pool_free (git_blame_cache_store_pool, FALSE, TRUE);
+      git_blame_cache_store_pool = NULL;
+    }
+}
+
+static gboolean
+git_blame_cache_read_section (GitBlameCacheEntry *entry,
+                              guint table_offset,
+                              GitBlameCacheSection *section)
+{
+  const guint8 *p = entry->data + table_offset;
+
+  section->offset = git_blame_cache_get_u32 (p);
+  section->compressed_size = git_blame_cache_get_u32 (p + 4);
+  section->raw_size = git_blame_cache_get_u32 (p + 8);
+
+  return ((gsize) section->offset + section->compressed_size <= entry->size
+          && section->compressed_size <= section->raw_size);
+}
+
+static void
+git_blame_cache_corrupt_error (GError **error)
+{
+  g_set_error (error, GIT_ERROR, GIT_ERROR_CACHE,
+               "Corrupt blame cache entry");
+}
+
+/* Checks whether there is an entry for the key without reading
+   it */
+gboolean
+git_blame_cache_has_entry (const gchar *key)
+{
+  gchar *filename;
+  gboolean ret;
+
+  g_return_val_if_fail (key != NULL, FALSE);
+
+  filename = git_blame_cache_get_filename (key);
+  ret = g_file_test (filename, G_FILE_TEST_IS_REGULAR);
+  g_free (filename);
+
+  return ret;
+}
+
+/* Returns NULL without setting an error if there is no entry for
+   the key */
+GitBlameCacheEntry *
+git_blame_cache_entry_open (const gchar *key, GError **error)
+{
+  GitBlameCacheEntry *entry;
+  GMappedFile *file;
+  gchar *filename;
+  guint i;
+
+  g_return_val_if_fail (key != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  filename = git_blame_cache_get_filename (key);
+
+  if (!g_file_test (filename, G_FILE_TEST_IS_REGULAR))
+    {
+      GIT_TRACE (cache__miss);
+      g_free (filename);
+      return NULL;
+    }
+
+  file = g_mapped_file_new (filename, FALSE, error);
+  g_free (filename);
+
+  if (file == NULL)
+    return NULL;
+
+  entry = g_slice_new0 (GitBlameCacheEntry);
+  entry->file = file;
+  entry->data = (const guint8 *) g_mapped_file_get_contents (file);
+  entry->size = g_mapped_file_get_length (file);
+
+  if (entry->size < GIT_BLAME_CACHE_HEADER_SIZE
+      || memcmp (entry->data, GIT_BLAME_CACHE_MAGIC, 4))
+    goto corrupt;
+
+  /* Entries from other versions are treated as missing so that they
+     will be replaced */
+  if (git_blame_cache_get_u32 (entry->data + 4) != GIT_BLAME_CACHE_VERSION)
+    {
+      GIT_TRACE (cache__miss);
+      git_blame_cache_entry_free (entry);
+      return NULL;
+    }
+
+  entry->n_lines = git_blame_cache_get_u32 (entry->data + 8);
+  entry->n_commits = git_blame_cache_get_u32 (entry->data + 12);
+  entry->lines_per_block = git_blame_cache_get_u32 (entry->data + 16);
+  entry->n_blocks = git_blame_cache_get_u32 (entry->data + 20);
+
+  if (entry->lines_per_block == 0
+      || entry->n_blocks != ((gsize) entry->n_lines
+                             + entry->lines_per_block - 1)
+      / entry->lines_per_block
+      || (entry->size - GIT_BLAME_CACHE_HEADER_SIZE)
+      / GIT_BLAME_CACHE_SECTION_SIZE < (gsize) entry->n_blocks + 2)
+    goto corrupt;
+
+  if (!git_blame_cache_read_section (entry, GIT_BLAME_CACHE_HEADER_SIZE,
+                                     &entry->commits)
+      || !git_blame_cache_read_section (entry, GIT_BLAME_CACHE_HEADER_SIZE
+                                        + GIT_BLAME_CACHE_SECTION_SIZE,
+                                        &entry->lines)
+      || entry->lines.raw_size
+      != (gsize) entry->n_lines * GIT_BLAME_CACHE_LINE_SIZE)
+    goto corrupt;
+
+  entry->blocks = g_new (GitBlameCacheSection, entry->n_blocks);
+  entry->block_text = g_new0 (gchar *, entry->n_blocks);
+
+  for (i = 0; i < entry->n_blocks; i++)
+    if (!git_blame_cache_read_section (entry, GIT_BLAME_CACHE_HEADER_SIZE
+                                       + (i + 2)
+                                       * GIT_BLAME_CACHE_SECTION_SIZE,
+                                       entry->blocks + i))
+      goto corrupt;
+
+  GIT_TRACE1 (cache__hit, entry->n_lines);
+
+  return entry;
+
+ corrupt:
+  git_blame_cache_corrupt_error (error);
+  git_blame_cache_entry_free (entry);
+
+  return NULL;
+}
+
+void
+git_blame_cache_entry_free (GitBlameCacheEntry *entry)
+{
+  guint i;
+
+  g_return_if_fail (entry != NULL);
+
+  if (entry->block_text)
+    {
+      for (i = 0; i < entry->n_blocks; i++)
+        if (entry->block_text[i])
+          {
+            git_memory_add (GIT_MEMORY_LINE_TEXT,
+                            -(gssize) entry->blocks[i].raw_size);
+            g_free (entry->block_text[i]);
+          }
+      g_free (entry->block_text);
+    }
+
+  g_free (entry->blocks);
+  g_mapped_file_free (entry->file);
+
+  g_slice_free (GitBlameCacheEntry, entry);
+}
+
+guint
+git_blame_cache_entry_get_n_lines (GitBlameCacheEntry *entry)
+{
+  g_return_val_if_fail (entry != NULL, 0);
+
+  return entry->n_lines;
+}
+
+guint
+git_blame_cache_entry_get_lines_per_block (GitBlameCacheEntry *entry)
+{
+  g_return_val_if_fail (entry != NULL, 0);
+
+  return entry->lines_per_block;
+}
+
+/* Returns a newly allocated buffer containing the decompressed
+   section with an extra nul byte at the end */
+static guint8 *
+git_blame_cache_decode (GitBlameCacheEntry *entry,
+                        const GitBlameCacheSection *section,
+                        GError **error)
+{
+  GTimer *timer = g_timer_new ();
+  guint8 *buf = g_malloc (section->raw_size + 1);
+
+  if (section->compressed_size == section->raw_size)
+    memcpy (buf, entry->data + section->offset, section->raw_size);
+  else if (!git_decompress (entry->data + section->offset,
+                            section->compressed_size,
+                            buf, section->raw_size))
+    {
+      g_free (buf);
+      buf = NULL;
+      git_blame_cache_corrupt_error (error);
+    }
+
+  if (buf)
+    buf[section->raw_size] = '\0';
+
+  entry->decode_time += g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return buf;
+}
+
+static GitCommit **
+git_blame_cache_read_commits (GitBlameCacheEntry *entry,
+                              const gchar *repo,
+                              GError **error)
+{
+  GitCommitBag *commit_bag = git_commit_bag_get_default ();
+  GitCommit **commits;
+  const gchar *p, *end;
+  guint8 *data;
+  guint i;
+
+  if ((data = git_blame_cache_decode (entry, &entry->commits, error)) == NULL)
+    return NULL;
+
+  commits = g_new (GitCommit *, entry->n_commits);
+  p = (const gchar *) data;
+  end = p + entry->commits.raw_size;
+
+  for (i = 0; i < entry->n_commits; i++)
+    {
+      gchar *hash;
+
+      if (end - p < GIT_COMMIT_HASH_LENGTH)
+        goto corrupt;
+
+      hash = g_strndup (p, GIT_COMMIT_HASH_LENGTH);
+      commits[i] = git_commit_bag_get (commit_bag, hash, repo);
+      g_free (hash);
+      p += GIT_COMMIT_HASH_LENGTH;
+
+      while (p < end && *p)
+        {
+          const gchar *key = p, *value, *value_end;
+
+          if ((value = memchr (key, '\0', end - key)) == NULL)
+            goto corrupt;
+          value++;
+          if ((value_end = memchr (value, '\0', end - value)) == NULL)
+            goto corrupt;
+
+          /* The properties don't change for a commit so there's no
+             need to set them again if we've already seen it */
+          if (git_commit_get_prop (commits[i], key) == NULL)
+            git_commit_set_prop (commits[i], key, value);
+
+          p = value_end + 1;
+        }
+
+      if (p >= end)
+        goto corrupt;
+      /* Skip the terminator */
+      p++;
+    }
+
+  g_free (data);
+
+  return commits;
+
+ corrupt:
+  git_blame_cache_corrupt_error (error);
+  g_free (commits);
+  g_free (data);
+
+  return NULL;
+}
+
+/* Fills in the commit and line numbers of n_lines records in
+   lines. The text is left as NULL so that it can be loaded in blocks
+   with git_blame_cache_entry_get_block_text */
+gboolean
+git_blame_cache_entry_read_lines (GitBlameCacheEntry *entry,
+                                  const gchar *repo,
+                                  GitAnnotatedSourceLine *lines,
+                                  GError **error)
+{
+  GitCommit **commits;
+  guint8 *data;
+  guint i;
+
+  g_return_val_if_fail (entry != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if ((commits = git_blame_cache_read_commits (entry, repo, error)) == NULL)
+    return FALSE;
+
+  if ((data = git_blame_cache_decode (entry, &entry->lines, error)) == NULL)
+    {
+      g_free (commits);
+      return FALSE;
+    }
+
+  /* Check all of the commit indices before taking any references so
+     that nothing needs to be undone if the data is corrupt */
+  for (i = 0; i < entry->n_lines; i++)
+    if (git_blame_cache_get_u32 (data + i * GIT_BLAME_CACHE_LINE_SIZE)
+        >= entry->n_commits)
+      {
+        git_blame_cache_corrupt_error (error);
+        g_free (data);
+        g_free (commits);
+        return FALSE;
+      }
+
+  for (i = 0; i < entry->n_lines; i++)
+    {
+      const guint8 *p = data + i * GIT_BLAME_CACHE_LINE_SIZE;
+
+      lines[i].commit = g_object_ref (commits[git_blame_cache_get_u32 (p)]);
+      lines[i].orig_line = git_blame_cache_get_u32 (p + 4);
+      lines[i].final_line = git_blame_cache_get_u32 (p + 8);
+      lines[i].text_length = git_blame_cache_get_u32 (p + 12);
+      lines[i].flags = git_blame_cache_get_u32 (p + 16);
+      lines[i].text = NULL;
+    }
+
+  g_free (data);
+  g_free (commits);
+
+  return TRUE;
+}
+
+/* Returns the text of all of the lines in the block, each terminated
+   by a nul. The block is decompressed the first time it is needed
+   and then kept until the entry is freed */
+const gchar *
+git_blame_cache_entry_get_block_text (GitBlameCacheEntry *entry,
+                                      guint block,
+                                      gsize *size,
+                                      GError **error)
+{
+  g_return_val_if_fail (entry != NULL, NULL);
+  g_return_val_if_fail (block < entry->n_blocks, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (entry->block_text[block] == NULL)
+    {
+      entry->block_text[block]
+        = (gchar *) git_blame_cache_decode (entry, entry->blocks + block,
+                                            error);
+
+      if (entry->block_text[block] == NULL)
+        return NULL;
+
+      git_memory_add (GIT_MEMORY_LINE_TEXT, entry->blocks[block].raw_size);
+      entry->n_blocks_decoded++;
+    }
+
+  if (size)
+    *size = entry->blocks[block].raw_size;
+
+  return entry->block_text[block];
+}
+
+void
+git_blame_cache_entry_get_stats (GitBlameCacheEntry *entry,
+                                 GitBlameCacheStats *stats)
+{
+  guint i;
+
+  g_return_if_fail (entry != NULL);
+  g_return_if_fail (stats != NULL);
+
+  stats->raw_size = (GIT_BLAME_CACHE_HEADER_SIZE
+                     + (entry->n_blocks + 2) * GIT_BLAME_CACHE_SECTION_SIZE
+                     + entry->commits.raw_size + entry->lines.raw_size);
+  for (i = 0; i < entry->n_blocks; i++)
+    stats->raw_size += entry->blocks[i].raw_size;
+
+  stats->compressed_size = entry->size;
+  stats->n_blocks = entry->n_blocks;
+  stats->n_blocks_decoded = entry->n_blocks_decoded;
+  stats->decode_time = entry->decode_time;
+}
@@ -0,0 +1,79 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __GIT_BLAME_CACHE_H__
+#define __GIT_BLAME_CACHE_H__
+
+#include <glib.h>
+#include "git-annotated-source.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GitBlameCacheEntry GitBlameCacheEntry;
+
+struct _GitBlameCacheStats
+{
+  /* Total size of all of the sections once decompressed and the size
+     of the file on disk */
+  gsize raw_size, compressed_size;
+  /* Number of blocks of line text and how many of them have been
+     decompressed so far */
+  guint n_blocks, n_blocks_decoded;
+  /* Total time spent decompressing in seconds */
+  gdouble decode_time;
+};
+
+gchar *git_blame_cache_get_key (const gchar *repo,
+                                const gchar *revision,
+                                const gchar *filename);
+
+void git_blame_cache_set_dir (const gchar *dir);
+
+gboolean git_blame_cache_store (const gchar *key,
+                                const GitAnnotatedSourceLine *lines,
+                                guint n_lines,
+                                GError **error);
+void git_blame_cache_store_async (const gchar *key,
+                                  const GitAnnotatedSourceLine *lines,
+                                  guint n_lines);
+void git_blame_cache_flush (void);
+
+gboolean git_blame_cache_has_entry (const gchar *key);
+
+GitBlameCacheEntry *git_blame_cache_entry_open (const gchar *key,
+                                                GError **error);
+void git_blame_cache_entry_free (GitBlameCacheEntry *entry);
+
+guint git_blame_cache_entry_get_n_lines (GitBlameCacheEntry *entry);
+guint git_blame_cache_entry_get_lines_per_block (GitBlameCacheEntry *entry);
+
+gboolean git_blame_cache_entry_read_lines (GitBlameCacheEntry *entry,
+                                           const gchar *repo,
+                                           GitAnnotatedSourceLine *lines,
+                                           GError **error);
+const gchar *git_blame_cache_entry_get_block_text (GitBlameCacheEntry *entry,
+                                                   guint block,
+                                                   gsize *size,
+                                                   GError **error);
+
+void git_blame_cache_entry_get_stats (GitBlameCacheEntry *entry,
+                                      GitBlameCacheStats *stats);
+
+G_END_DECLS
+
+#endif /* __GIT_BLAME_CACHE_H__ */
@@ -0,0 +1,772 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib-object.h>
+#include <glib/gstdio.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "git-blame-estimator.h"
+#include "git-blame-cache.h"
+#include "git-reader.h"
+#include "git-common.h"
+
+static void git_blame_estimator_dispose (GObject *object);
+static void git_blame_estimator_finalize (GObject *object);
+
+static gboolean git_blame_estimator_on_line (GitReader *reader,
+                                             guint length,
+                                             const gchar *str,
+                                             GitBlameEstimator *estimator);
+static void git_blame_estimator_on_completed (GitReader *reader,
+                                              const GError *error,
+                                              GitBlameEstimator *estimator);
+
+G_DEFINE_TYPE (GitBlameEstimator, git_blame_estimator, G_TYPE_OBJECT);
+
+#define GIT_BLAME_ESTIMATOR_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_BLAME_ESTIMATOR, \
+                                GitBlameEstimatorPrivate))
+
+typedef enum
+  {
+    GIT_BLAME_ESTIMATOR_IDLE,
+    GIT_BLAME_ESTIMATOR_READING_SIZE,
+    GIT_BLAME_ESTIMATOR_READING_ATTRIBUTES,
+    GIT_BLAME_ESTIMATOR_READING_BLOB,
+    GIT_BLAME_ESTIMATOR_COUNTING_COMMITS
+  } GitBlameEstimatorStage;
+
+struct _GitBlameEstimatorPrivate
+{
+  GitReader *reader;
+  guint line_handler, completed_handler;
+
+  GitBlameEstimatorStage stage;
+  gchar *repo, *base_part, *revision;
+  gchar *encoding;
+
+  guint n_lines, n_commits;
+  /* Number of lines that the file is known to have. This is the same
+     as n_lines unless the file is too large to read completely, in
+     which case n_lines is only a guess */
+  guint min_lines;
+  gsize size, bytes_sniffed, bytes_read;
+  /* Whether the last piece of the blob that was read didn't end with
+     a newline */
+  gboolean partial_line;
+  gboolean cached;
+  GitBlameEstimatorFlags flags;
+
+  guint idle_source;
+};
+
+enum
+  {
+    COMPLETED,
+
+    LAST_SIGNAL
+  };
+
+static guint client_signals[LAST_SIGNAL];
+
+/* Time taken by git-blame is modelled as a fixed start up time plus a
+   rate multiplied by the number of lines and the number of commits
+   that touch the file. The rate is adjusted every time a blame
+   finishes so that the estimates adapt to the speed of the machine
+   and the shape of the repository */
+#define GIT_BLAME_ESTIMATOR_OVERHEAD     0.05
+#define GIT_BLAME_ESTIMATOR_DEFAULT_RATE 2e-7
+/* How much weight to give a new sample when adjusting the rate */
+#define GIT_BLAME_ESTIMATOR_SAMPLE_WEIGHT 0.3
+
+/* Blames estimated to take less than this many seconds are just run */
+#define GIT_BLAME_ESTIMATOR_FULL_LIMIT 2.0
+/* Blames taking less than this first blame the visible lines so
+   there's something to look at. Longer blames ask first */
+#define GIT_BLAME_ESTIMATOR_VIEWPORT_LIMIT 30.0
+
+/* Files bigger than this are assumed to be something that isn't
+   worth blaming and only the start of them is read */
+#define GIT_BLAME_ESTIMATOR_LARGE_SIZE (4 * 1024 * 1024)
+/* Number of bytes to search for a zero byte to detect binary files.
+   This is the same amount that git itself checks */
+#define GIT_BLAME_ESTIMATOR_SNIFF_SIZE 8000
+/* Used to guess the number of lines in files that are too large to
+   read completely */
+#define GIT_BLAME_ESTIMATOR_AVERAGE_LINE_LENGTH 40
+/* Number of bytes at the start of a large file in which the lines are
+   counted so that blaming the first lines never goes past the end */
+#define GIT_BLAME_ESTIMATOR_HEAD_SIZE (64 * 1024)
+
+static gdouble git_blame_estimator_rate = GIT_BLAME_ESTIMATOR_DEFAULT_RATE;
+
+static void
+git_blame_estimator_class_init (GitBlameEstimatorClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->dispose = git_blame_estimator_dispose;
+  gobject_class->finalize = git_blame_estimator_finalize;
+
+  client_signals[COMPLETED]
+    = g_signal_new ("completed",
+                    G_TYPE_FROM_CLASS (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitBlameEstimatorClass, completed),
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__POINTER,
+                    G_TYPE_NONE, 1,
+                    G_TYPE_POINTER);
+
+  g_type_class_add_private (klass, sizeof (GitBlameEstimatorPrivate));
+}
+
+static void
+git_blame_estimator_init (GitBlameEstimator *self)
+{
+  GitBlameEstimatorPrivate *priv;
+
+  priv = self->priv = GIT_BLAME_ESTIMATOR_GET_PRIVATE (self);
+
+  priv->reader = git_reader_new ();
+
+  priv->completed_handler
+    = g_signal_connect (priv->reader, "completed",
+                        G_CALLBACK (git_blame_estimator_on_completed),
+                        self);
+  priv->line_handler
+    = g_signal_connect (priv->reader, "line",
+                        G_CALLBACK (git_blame_estimator_on_line),
+                        self);
+}
+
+static void
+git_blame_estimator_dispose (GObject *object)
+{
+  GitBlameEstimator *self = (GitBlameEstimator *) object;
+  GitBlameEstimatorPrivate *priv = self->priv;
+
+  if (priv->reader)
+    {
+      g_signal_handler_disconnect (priv->reader, priv->completed_handler);
+      g_signal_handler_disconnect (priv->reader, priv->line_handler);
+      g_object_unref (priv->reader);
+      priv->reader = NULL;
+    }
+
+  if (priv->idle_source)
+    {
+      g_source_remove (priv->idle_source);
+      priv->idle_source = 0;
+    }
+
+  G_OBJECT_CLASS (git_blame_estimator_parent_class)->dispose (object);
+}
+
+static void
+git_blame_estimator_free_strings (GitBlameEstimator *estimator)
+{
+  GitBlameEstimatorPrivate *priv = estimator->priv;
+
+  if (priv->repo)
+    {
+      g_free (priv->repo);
+      priv->repo = NULL;
+    }
+  if (priv->base_part)
+    {
+      g_free (priv->base_part);
+      priv->base_part = NULL;
+    }
+  if (priv->revision)
+    {
+      g_free (priv->revision);
+      priv->revision = NULL;
+    }
+  if (priv->encoding)
+    {
+      g_free (priv->encoding);
+      priv->encoding = NULL;
+    }
+}
+
+static void
+git_blame_estimator_finalize (GObject *object)
+{
+  git_blame_estimator_free_strings ((GitBlameEstimator *) object);
+
+  G_OBJECT_CLASS (git_blame_estimator_parent_class)->finalize (object);
+}
+
+GitBlameEstimator *
+git_blame_estimator_new (void)
+{
+  GitBlameEstimator *self = g_object_new (GIT_TYPE_BLAME_ESTIMATOR, NULL);
+
+  return self;
+}
+
+static gboolean
+git_blame_estimator_on_idle (gpointer data)
+{
+  GitBlameEstimator *estimator = (GitBlameEstimator *) data;
+
+  estimator->priv->idle_source = 0;
+
+  g_signal_emit (estimator, client_signals[COMPLETED], 0, NULL);
+
+  return FALSE;
+}
+
+static void
+git_blame_estimator_sniff (GitBlameEstimator *estimator,
+                           const gchar *data, gsize length)
+{
+  GitBlameEstimatorPrivate *priv = estimator->priv;
+
+  if (priv->bytes_sniffed < GIT_BLAME_ESTIMATOR_SNIFF_SIZE)
+    {
+      length = MIN (length,
+                    GIT_BLAME_ESTIMATOR_SNIFF_SIZE - priv->bytes_sniffed);
+
+      if (memchr (data, '\0', length))
+        priv->flags |= GIT_BLAME_ESTIMATOR_BINARY;
+
+      priv->bytes_sniffed += length;
+    }
+}
+
+static gboolean
+git_blame_estimator_run_stage (GitBlameEstimator *estimator,
+                               GitBlameEstimatorStage stage,
+                               GError **error)
+{
+  GitBlameEstimatorPrivate *priv = estimator->priv;
+  gchar *object_name = NULL;
+  gboolean ret = FALSE;
+
+  priv->stage = stage;
+
+  /* The blob is read in pieces so that a file without newlines isn't
+     buffered completely by the reader */
+  git_reader_set_max_line_length (priv->reader,
+                                  stage == GIT_BLAME_ESTIMATOR_READING_BLOB
+                                  ? GIT_BLAME_ESTIMATOR_SNIFF_SIZE : 0);
+
+  if (priv->revision)
+    object_name = g_strconcat (priv->revision, ":", priv->base_part, NULL);
+
+  switch (stage)
+    {
+    case GIT_BLAME_ESTIMATOR_READING_SIZE:
+      ret = git_reader_start (priv->reader, priv->repo, error,
+                              "cat-file", "-s", object_name, NULL);
+      break;
+
+    case GIT_BLAME_ESTIMATOR_READING_ATTRIBUTES:
+      /* The attributes are read from the working copy even when
+         blaming an older revision. The encoding attribute is the
+         same one that gitk and git-gui use to display files */
+      ret = git_reader_start (priv->reader, priv->repo, error,
+                              "check-attr", "binary", "linguist-generated",
+                              "encoding", "--", priv->base_part, NULL);
+      break;
+
+    case GIT_BLAME_ESTIMATOR_READING_BLOB:
+      ret = git_reader_start (priv->reader, priv->repo, error,
+                              "cat-file", "blob", object_name, NULL);
+      break;
+
+    case GIT_BLAME_ESTIMATOR_COUNTING_COMMITS:
+      /* rev-list will use the commit graph if the repository has one
+         so this is usually much quicker than the blame */
+      ret = git_reader_start (priv->reader, priv->repo, error,
+                              "rev-list", "--count",
+                              priv->revision ? priv->revision : "HEAD",
+                              "--", priv->base_part, NULL);
+      break;
+
+    case GIT_BLAME_ESTIMATOR_IDLE:
+      g_assert_not_reached ();
+      break;
+    }
+
+  g_free (object_name);
+
+  if (!ret)
+    priv->stage = GIT_BLAME_ESTIMATOR_IDLE;
+
+  return ret;
+}
+
+static void
+git_blame_estimator_continue (GitBlameEstimator *estimator,
+                              GitBlameEstimatorStage stage)
+{
+  GError *error = NULL;
+
+  if (!git_blame_estimator_run_stage (estimator, stage, &error))
+    {
+      g_signal_emit (estimator, client_signals[COMPLETED], 0, error);
+      g_error_free (error);
+    }
+}
+
+static gboolean
+git_blame_estimator_on_continue_idle (gpointer data)
+{
+  GitBlameEstimator *estimator = (GitBlameEstimator *) data;
+
+  estimator->priv->idle_source = 0;
+
+  git_blame_estimator_continue (estimator,
+                                GIT_BLAME_ESTIMATOR_COUNTING_COMMITS);
+
+  return FALSE;
+}
+
+static void
+git_blame_estimator_read_working_copy (GitBlameEstimator *estimator,
+                                       const gchar *filename)
+{
+  GitBlameEstimatorPrivate *priv = estimator->priv;
+  struct stat buf;
+
+  if (g_stat (filename, &buf) == -1)
+    return;
+
+  priv->size = buf.st_size;
+
+  if (priv->size > GIT_BLAME_ESTIMATOR_LARGE_SIZE)
+    {
+      gchar *head, *p;
+      gsize length;
+      FILE *file;
+
+      /* Only look at the start of large files */
+      if ((file = g_fopen (filename, "rb")))
+        {
+          head = g_malloc (GIT_BLAME_ESTIMATOR_HEAD_SIZE);
+          length = fread (head, 1, GIT_BLAME_ESTIMATOR_HEAD_SIZE, file);
+          git_blame_estimator_sniff (estimator, head, length);
+
+          for (p = head; (p = memchr (p, '\n', head + length - p)); p++)
+            priv->min_lines++;
+
+          g_free (head);
+          fclose (file);
+        }
+
+      priv->flags |= GIT_BLAME_ESTIMATOR_LARGE;
+      priv->n_lines
+        = priv->size / GIT_BLAME_ESTIMATOR_AVERAGE_LINE_LENGTH + 1;
+      /* The file isn't empty so it has at least one line */
+      priv->min_lines = MAX (priv->min_lines, 1);
+    }
+  else
+    {
+      gchar *contents, *p;
+      gsize length;
+
+      if (g_file_get_contents (filename, &contents, &length, NULL))
+        {
+          git_blame_estimator_sniff (estimator, contents, length);
+
+          for (p = contents; (p = memchr (p, '\n', contents + length - p));
+               p++)
+            priv->n_lines++;
+          if (length > 0 && contents[length - 1] != '\n')
+            priv->n_lines++;
+          g_free (contents);
+        }
+
+      priv->min_lines = priv->n_lines;
+    }
+}
+
+gboolean
+git_blame_estimator_start (GitBlameEstimator *estimator,
+                           const gchar *filename,
+                           const gchar *revision,
+                           GError **error)
+{
+  GitBlameEstimatorPrivate *priv;
+  gchar *key;
+
+  g_return_val_if_fail (GIT_IS_BLAME_ESTIMATOR (estimator), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_val_if_fail (filename != NULL, FALSE);
+
+  priv = estimator->priv;
+
+  git_blame_estimator_cancel (estimator);
+  git_blame_estimator_free_strings (estimator);
+
+  priv->n_lines = 0;
+  priv->min_lines = 0;
+  priv->n_commits = 0;
+  priv->size = 0;
+  priv->bytes_sniffed = 0;
+  priv->bytes_read = 0;
+  priv->partial_line = FALSE;
+  priv->cached = FALSE;
+  priv->flags = 0;
+
+  if (!git_find_repo (filename, &priv->repo, &priv->base_part))
+    {
+      g_set_error (error, GIT_ERROR, GIT_ERROR_NO_REPO,
+                   "No repo found for %s", filename);
+
+      return FALSE;
+    }
+
+  priv->revision = g_strdup (revision);
+
+  /* If the blame is already in the cache then it will be quick to
+     load regardless of the size */
+  if ((key = git_blame_cache_get_key (priv->repo, revision,
+                                      priv->base_part)))
+    {
+      priv->cached = git_blame_cache_has_entry (key);
+      g_free (key);
+
+      if (priv->cached)
+        {
+          priv->idle_source = g_idle_add (git_blame_estimator_on_idle,
+                                          estimator);
+          return TRUE;
+        }
+    }
+
+  /* Without a revision the working copy is blamed so we can measure
+     the file directly */
+  if (revision == NULL)
+    git_blame_estimator_read_working_copy (estimator, filename);
+
+  return git_blame_estimator_run_stage
+    (estimator,
+     revision ? GIT_BLAME_ESTIMATOR_READING_SIZE
+     : GIT_BLAME_ESTIMATOR_READING_ATTRIBUTES,
+     error);
+}
+
+void
+git_blame_estimator_cancel (GitBlameEstimator *estimator)
+{
+  GitBlameEstimatorPrivate *priv;
+
+  g_return_if_fail (GIT_IS_BLAME_ESTIMATOR (estimator));
+
+  priv = estimator->priv;
+
+  git_reader_cancel (priv->reader);
+  priv->stage = GIT_BLAME_ESTIMATOR_IDLE;
+
+  if (priv->idle_source)
+    {
+      g_source_remove (priv->idle_source);
+      priv->idle_source = 0;
+    }
+}
+
+static void
+git_blame_estimator_parse_attribute (GitBlameEstimator *estimator,
+                                     guint length,
+                                     const gchar *str)
+{
+  gchar *line = g_strndup (str, length), *value, *attr;
+
+  g_strchomp (line);
+
+  /* The output is "<path>: <attribute>: <info>". The path may contain
+     colons so it is parsed from the end */
+  if ((value = g_strrstr (line, ": ")))
+    {
+      *value = '\0';
+      value += 2;
+
+      if ((attr = g_strrstr (line, ": ")))
+        {
+          attr += 2;
+
+          if (strcmp (attr, "encoding") == 0)
+            {
+              if (strcmp (value, "unspecified") && strcmp (value, "unset")
+                  && strcmp (value, "set"))
+                {
+                  g_free (estimator->priv->encoding);
+                  estimator->priv->encoding = g_strdup (value);
+                }
+            }
+          /* 'unspecified' and 'unset' are ignored. The binary
+             attribute can only be 'set' but linguist-generated is
+             usually given a value of 'true' */
+          else if (strcmp (value, "set") == 0
+                   || strcmp (value, "true") == 0)
+            {
+              if (strcmp (attr, "binary") == 0)
+                estimator->priv->flags |= GIT_BLAME_ESTIMATOR_BINARY;
+              else if (strcmp (attr, "linguist-generated") == 0)
+                estimator->priv->flags |= GIT_BLAME_ESTIMATOR_GENERATED;
+            }
+        }
+    }
+
+  g_free (line);
+}
+
+static gboolean
+git_blame_estimator_on_line (GitReader *reader,
+                             guint length,
+                             const gchar *str,
+                             GitBlameEstimator *estimator)
+{
+  GitBlameEstimatorPrivate *priv = estimator->priv;
+
+  switch (priv->stage)
+    {
+    case GIT_BLAME_ESTIMATOR_READING_SIZE:
+      priv->size = strtoul (str, NULL, 10);
+      break;
+
+    case GIT_BLAME_ESTIMATOR_READING_ATTRIBUTES:
+      git_blame_estimator_parse_attribute (estimator, length, str);
+      break;
+
+    case GIT_BLAME_ESTIMATOR_READING_BLOB:
+      /* Long lines arrive in pieces and only the last piece ends with
+         a newline */
+      git_blame_estimator_sniff (estimator, str, length);
+      priv->bytes_read += length;
+      priv->partial_line = length == 0 || str[length - 1] != '\n';
+      if (!priv->partial_line)
+        priv->min_lines++;
+
+      /* For large files we only want to look at the start. Stopping
+         here kills cat-file without emitting the completed signal so
+         the next stage is started from an idle handler */
+      if ((priv->flags & GIT_BLAME_ESTIMATOR_LARGE)
+          && priv->bytes_read >= GIT_BLAME_ESTIMATOR_HEAD_SIZE)
+        {
+          priv->min_lines = MAX (priv->min_lines, 1);
+          priv->stage = GIT_BLAME_ESTIMATOR_IDLE;
+          priv->idle_source
+            = g_idle_add (git_blame_estimator_on_continue_idle, estimator);
+          return FALSE;
+        }
+      break;
+
+    case GIT_BLAME_ESTIMATOR_COUNTING_COMMITS:
+      priv->n_commits = strtoul (str, NULL, 10);
+      break;
+
+    case GIT_BLAME_ESTIMATOR_IDLE:
+      break;
+    }
+
+  return TRUE;
+}
+
+static void
+git_blame_estimator_on_completed (GitReader *reader,
+                                  const GError *error,
+                                  GitBlameEstimator *estimator)
+{
+  GitBlameEstimatorPrivate *priv = estimator->priv;
+
+  if (error)
+    {
+      priv->stage = GIT_BLAME_ESTIMATOR_IDLE;
+      g_signal_emit (estimator, client_signals[COMPLETED], 0, error);
+      return;
+    }
+
+  switch (priv->stage)
+    {
+    case GIT_BLAME_ESTIMATOR_READING_SIZE:
+      if (priv->size > GIT_BLAME_ESTIMATOR_LARGE_SIZE)
+        {
+          priv->flags |= GIT_BLAME_ESTIMATOR_LARGE;
+          priv->n_lines
+            = priv->size / GIT_BLAME_ESTIMATOR_AVERAGE_LINE_LENGTH + 1;
+        }
+      git_blame_estimator_continue (estimator,
+                                    GIT_BLAME_ESTIMATOR_READING_ATTRIBUTES);
+      break;
+
+    case GIT_BLAME_ESTIMATOR_READING_ATTRIBUTES:
+      /* The working copy has already been read */
+      git_blame_estimator_continue (estimator,
+                                    priv->revision
+                                    ? GIT_BLAME_ESTIMATOR_READING_BLOB
+                                    : GIT_BLAME_ESTIMATOR_COUNTING_COMMITS);
+      break;
+
+    case GIT_BLAME_ESTIMATOR_READING_BLOB:
+      /* The whole blob has been read so the count is exact */
+      if (priv->partial_line)
+        priv->min_lines++;
+      if (!(priv->flags & GIT_BLAME_ESTIMATOR_LARGE))
+        priv->n_lines = priv->min_lines;
+      git_blame_estimator_continue (estimator,
+                                    GIT_BLAME_ESTIMATOR_COUNTING_COMMITS);
+      break;
+
+    case GIT_BLAME_ESTIMATOR_COUNTING_COMMITS:
+    case GIT_BLAME_ESTIMATOR_IDLE:
+      priv->stage = GIT_BLAME_ESTIMATOR_IDLE;
+      g_signal_emit (estimator, client_signals[COMPLETED], 0, NULL);
+      break;
+    }
+}
+
+guint
+git_blame_estimator_get_n_lines (GitBlameEstimator *estimator)
+{
+  g_return_val_if_fail (GIT_IS_BLAME_ESTIMATOR (estimator), 0);
+
+  return estimator->priv->n_lines;
+}
+
+/* Returns the number of lines that the file is known to have. Unlike
+   git_blame_estimator_get_n_lines this is never a guess so it is
+   safe to use as the end of a git-blame -L range. Zero means the
+   number isn't known */
+guint
+git_blame_estimator_get_min_lines (GitBlameEstimator *estimator)
+{
+  g_return_val_if_fail (GIT_IS_BLAME_ESTIMATOR (estimator), 0);
+
+  return estimator->priv->min_lines;
+}
+
+gsize
+git_blame_estimator_get_size (GitBlameEstimator *estimator)
+{
+  g_return_val_if_fail (GIT_IS_BLAME_ESTIMATOR (estimator), 0);
+
+  return estimator->priv->size;
+}
+
+guint
+git_blame_estimator_get_n_commits (GitBlameEstimator *estimator)
+{
+  g_return_val_if_fail (GIT_IS_BLAME_ESTIMATOR (estimator), 0);
+
+  return estimator->priv->n_commits;
+}
+
+gboolean
+git_blame_estimator_get_cached (GitBlameEstimator *estimator)
+{
+  g_return_val_if_fail (GIT_IS_BLAME_ESTIMATOR (estimator), FALSE);
+
+  return estimator->priv->cached;
+}
+
+static gdouble
+git_blame_estimator_get_work (GitBlameEstimator *estimator)
+{
+  GitBlameEstimatorPrivate *priv = estimator->priv;
+
+  return (priv->n_lines + 1.0) * (priv->n_commits + 1.0);
+}
+
+/* Returns the estimated number of seconds that a full blame of the
+   file will take */
+gdouble
+git_blame_estimator_get_estimate (GitBlameEstimator *estimator)
+{
+  g_return_val_if_fail (GIT_IS_BLAME_ESTIMATOR (estimator), 0.0);
+
+  if (estimator->priv->cached)
+    return 0.0;
+  else
+    return GIT_BLAME_ESTIMATOR_OVERHEAD
+      + git_blame_estimator_get_work (estimator) * git_blame_estimator_rate;
+}
+
+/* Returns the character set given by the encoding attribute or NULL
+   if it isn't set */
+const gchar *
+git_blame_estimator_get_encoding (GitBlameEstimator *estimator)
+{
+  g_return_val_if_fail (GIT_IS_BLAME_ESTIMATOR (estimator), NULL);
+
+  return estimator->priv->encoding;
+}
+
+GitBlameEstimatorFlags
+git_blame_estimator_get_flags (GitBlameEstimator *estimator)
+{
+  g_return_val_if_fail (GIT_IS_BLAME_ESTIMATOR (estimator), 0);
+
+  return estimator->priv->flags;
+}
+
+GitBlameStrategy
+git_blame_estimator_get_strategy (GitBlameEstimator *estimator)
+{
+  gdouble estimate;
+
+  g_return_val_if_fail (GIT_IS_BLAME_ESTIMATOR (estimator),
+                        GIT_BLAME_STRATEGY_FULL);
+
+  estimate = git_blame_estimator_get_estimate (estimator);
+
+  /* Binary and generated files are probably not worth blaming so
+     always check first even if the blame would be quick */
+  if (estimator->priv->flags && !estimator->priv->cached)
+    return GIT_BLAME_STRATEGY_ASK;
+  else if (estimate < GIT_BLAME_ESTIMATOR_FULL_LIMIT)
+    return GIT_BLAME_STRATEGY_FULL;
+  else if (estimate < GIT_BLAME_ESTIMATOR_VIEWPORT_LIMIT)
+    return GIT_BLAME_STRATEGY_VIEWPORT_FIRST;
+  else
+    return GIT_BLAME_STRATEGY_ASK;
+}
+
+/* Feeds back the time that the full blame of the last estimated file
+   actually took so that later estimates are more accurate */
+void
+git_blame_estimator_add_sample (GitBlameEstimator *estimator,
+                                gdouble seconds)
+{
+  gdouble rate;
+
+  g_return_if_fail (GIT_IS_BLAME_ESTIMATOR (estimator));
+
+  /* Very short blames are dominated by the start up time so they
+     don't tell us much about the rate */
+  if (estimator->priv->cached
+      || seconds < GIT_BLAME_ESTIMATOR_OVERHEAD * 2.0)
+    return;
+
+  rate = (seconds - GIT_BLAME_ESTIMATOR_OVERHEAD)
+    / git_blame_estimator_get_work (estimator);
+
+  git_blame_estimator_rate
+    = git_blame_estimator_rate * (1.0 - GIT_BLAME_ESTIMATOR_SAMPLE_WEIGHT)
+    + rate * GIT_BLAME_ESTIMATOR_SAMPLE_WEIGHT;
+}
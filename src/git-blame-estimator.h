@@ -0,0 +1,103 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_BLAME_ESTIMATOR_H__
+#define __GIT_BLAME_ESTIMATOR_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GIT_TYPE_BLAME_ESTIMATOR                                        \
+  (git_blame_estimator_get_type())
+#define GIT_BLAME_ESTIMATOR(obj)                                        \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                   \
+                               GIT_TYPE_BLAME_ESTIMATOR,                \
+                               GitBlameEstimator))
+#define GIT_BLAME_ESTIMATOR_CLASS(klass)                                \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            GIT_TYPE_BLAME_ESTIMATOR,                   \
+                            GitBlameEstimatorClass))
+#define GIT_IS_BLAME_ESTIMATOR(obj)                                     \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),                                   \
+                               GIT_TYPE_BLAME_ESTIMATOR))
+#define GIT_IS_BLAME_ESTIMATOR_CLASS(klass)                             \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),                                    \
+                            GIT_TYPE_BLAME_ESTIMATOR))
+#define GIT_BLAME_ESTIMATOR_GET_CLASS(obj)                              \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                    \
+                              GIT_TYPE_BLAME_ESTIMATOR,                 \
+                              GitBlameEstimatorClass))
+
+typedef struct _GitBlameEstimator        GitBlameEstimator;
+typedef struct _GitBlameEstimatorClass   GitBlameEstimatorClass;
+typedef struct _GitBlameEstimatorPrivate GitBlameEstimatorPrivate;
+
+typedef enum {
+  GIT_BLAME_STRATEGY_FULL,
+  GIT_BLAME_STRATEGY_VIEWPORT_FIRST,
+  GIT_BLAME_STRATEGY_ASK
+} GitBlameStrategy;
+
+typedef enum {
+  GIT_BLAME_ESTIMATOR_BINARY    = 1 << 0,
+  GIT_BLAME_ESTIMATOR_GENERATED = 1 << 1,
+  GIT_BLAME_ESTIMATOR_LARGE     = 1 << 2
+} GitBlameEstimatorFlags;
+
+struct _GitBlameEstimatorClass
+{
+  GObjectClass parent_class;
+
+  void (* completed) (GitBlameEstimator *estimator, const GError *error);
+};
+
+struct _GitBlameEstimator
+{
+  GObject parent;
+
+  GitBlameEstimatorPrivate *priv;
+};
+
+GType git_blame_estimator_get_type (void) G_GNUC_CONST;
+
+GitBlameEstimator *git_blame_estimator_new (void);
+
+gboolean git_blame_estimator_start (GitBlameEstimator *estimator,
+                                    const gchar *filename,
+                                    const gchar *revision,
+                                    GError **error);
+void git_blame_estimator_cancel (GitBlameEstimator *estimator);
+
+guint git_blame_estimator_get_n_lines (GitBlameEstimator *estimator);
+guint git_blame_estimator_get_min_lines (GitBlameEstimator *estimator);
+gsize git_blame_estimator_get_size (GitBlameEstimator *estimator);
+guint git_blame_estimator_get_n_commits (GitBlameEstimator *estimator);
+gboolean git_blame_estimator_get_cached (GitBlameEstimator *estimator);
+const gchar *git_blame_estimator_get_encoding (GitBlameEstimator *estimator);
+GitBlameEstimatorFlags git_blame_estimator_get_flags
+                                   (GitBlameEstimator *estimator);
+gdouble git_blame_estimator_get_estimate (GitBlameEstimator *estimator);
+GitBlameStrategy git_blame_estimator_get_strategy
+                                   (GitBlameEstimator *estimator);
+
+void git_blame_estimator_add_sample (GitBlameEstimator *estimator,
+                                     gdouble seconds);
+
+G_END_DECLS
+
+#endif /* __GIT_BLAME_ESTIMATOR_H__ */
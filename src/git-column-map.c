@@ -0,0 +1,167 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* A column map converts between byte offsets in a line of text and
+   the visual column after tabs have been expanded. Both directions
+   are a single array lookup. Lines that are plain ASCII without tabs
+   map every byte to the same column so no arrays are stored for
+   them. Wide characters take two columns. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <string.h>
+
+#include "git-column-map.h"
+#include "git-utf8.h"
+
+struct _GitColumnMap
+{
+  gsize length;
+  guint n_columns;
+
+  /* Both of these are NULL if the bytes and columns are the same.
+     byte_to_column has length + 1 entries and column_to_byte has
+     n_columns + 1 entries so that the end of the line can be looked
+     up too */
+  guint32 *byte_to_column;
+  guint32 *column_to_byte;
+};
+
+GitColumnMap *
+git_column_map_new (const gchar *text, gsize length)
+{
+  GitColumnMap *map;
+  const gchar *p, *end = text + length, *next;
+  guint column = 0, next_column, i, start;
+
+  map = g_slice_new0 (GitColumnMap);
+  map->length = length;
+
+  if (memchr (text, '\t', length) == NULL
+      && git_utf8_is_ascii (text, length))
+    {
+      map->n_columns = length;
+      return map;
+    }
+
+  map->byte_to_column = g_new (guint32, length + 1);
+
+  /* Work out the column at the start of each character. Bytes in the
+     middle of a character get the same column as its first byte */
+  for (p = text; p < end; p = next)
+    {
+      if (*p == '\t')
+        {
+          next = p + 1;
+          next_column = (column / GIT_COLUMN_MAP_TAB_WIDTH + 1)
+            * GIT_COLUMN_MAP_TAB_WIDTH;
+        }
+      else if ((guchar) *p < 0x80)
+        {
+          next = p + 1;
+          next_column = column + 1;
+        }
+      else
+        {
+          /* The text has already been validated when it was loaded */
+          next = g_utf8_next_char (p);
+          if (next > end)
+            next = end;
+          next_column = column
+            + (g_unichar_iswide (g_utf8_get_char (p)) ? 2 : 1);
+        }
+
+      for (i = p - text; i < (guint) (next - text); i++)
+        map->byte_to_column[i] = column;
+
+      column = next_column;
+    }
+
+  map->byte_to_column[length] = column;
+  map->n_columns = column;
+
+  map->column_to_byte = g_new (guint32, map->n_columns + 1);
+
+  /* Columns in the middle of a tab or a wide character map to the
+     first byte of that character */
+  for (i = 0, start = 0; i < length; i++)
+    {
+      guint c;
+
+      if (i == 0 || map->byte_to_column[i] != map->byte_to_column[i - 1])
+        start = i;
+
+      for (c = map->byte_to_column[i]; c < map->byte_to_column[i + 1]; c++)
+        map->column_to_byte[c] = start;
+    }
+
+  map->column_to_byte[map->n_columns] = length;
+
+  return map;
+}
+
+void
+git_column_map_free (GitColumnMap *map)
+{
+  g_return_if_fail (map != NULL);
+
+  g_free (map->byte_to_column);
+  g_free (map->column_to_byte);
+
+  g_slice_free (GitColumnMap, map);
+}
+
+guint
+git_column_map_get_n_columns (GitColumnMap *map)
+{
+  g_return_val_if_fail (map != NULL, 0);
+
+  return map->n_columns;
+}
+
+gsize
+git_column_map_get_length (GitColumnMap *map)
+{
+  g_return_val_if_fail (map != NULL, 0);
+
+  return map->length;
+}
+
+guint
+git_column_map_byte_to_column (GitColumnMap *map, gsize byte)
+{
+  g_return_val_if_fail (map != NULL, 0);
+
+  if (byte > map->length)
+    byte = map->length;
+
+  return map->byte_to_column ? map->byte_to_column[byte] : byte;
+}
+
+gsize
+git_column_map_column_to_byte (GitColumnMap *map, guint column)
+{
+  g_return_val_if_fail (map != NULL, 0);
+
+  if (column > map->n_columns)
+    column = map->n_columns;
+
+  return map->column_to_byte ? map->column_to_byte[column] : column;
+}
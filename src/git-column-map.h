@@ -0,0 +1,40 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_COLUMN_MAP_H__
+#define __GIT_COLUMN_MAP_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Columns between each tab stop. This is the same as Pango's default */
+#define GIT_COLUMN_MAP_TAB_WIDTH 8
+
+typedef struct _GitColumnMap GitColumnMap;
+
+GitColumnMap *git_column_map_new (const gchar *text, gsize length);
+void git_column_map_free (GitColumnMap *map);
+
+guint git_column_map_get_n_columns (GitColumnMap *map);
+gsize git_column_map_get_length (GitColumnMap *map);
+guint git_column_map_byte_to_column (GitColumnMap *map, gsize byte);
+gsize git_column_map_column_to_byte (GitColumnMap *map, guint column);
+
+G_END_DECLS
+
+#endif /* __GIT_COLUMN_MAP_H__ */
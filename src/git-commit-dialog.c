@@ -29,6 +29,7 @@
 
 #include "git-commit-dialog.h"
 #include "git-commit-link-button.h"
+#include "git-watchdog.h"
 #include "intl.h"
 
 static void git_commit_dialog_dispose (GObject *object);
@@ -322,6 +323,9 @@ git_commit_dialog_update (GitCommitDialog *cdiag)
     {
       GtkTextBuffer *buffer
         = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->log_view));
+      /* Setting a huge log message can take a long time */
+      const gchar *old_operation
+        = git_watchdog_set_operation ("setting commit log text");
 
       gtk_text_buffer_set_text (buffer,
                                 priv->commit == NULL ? ""
@@ -329,6 +333,8 @@ git_commit_dialog_update (GitCommitDialog *cdiag)
                                 ? git_commit_get_log_data (priv->commit)
                                 : _("Loading..."),
                                 -1);
+
+      git_watchdog_set_operation (old_operation);
     }
 }
 
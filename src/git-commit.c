@@ -21,14 +21,20 @@
 
 #include <glib-object.h>
 #include <string.h>
+#include <stdlib.h>
 
 #include "git-commit.h"
 #include "git-reader.h"
 #include "git-common.h"
 #include "git-commit-bag.h"
+#include "git-memory.h"
 
 #define GIT_COMMIT_DEFAULT_HASH "0000000000000000000000000000000000000000"
 
+/* Estimate of the bytes used by the hash table for each property on
+   top of the key and value */
+#define GIT_COMMIT_PROP_OVERHEAD (3 * sizeof (gpointer) + sizeof (guint))
+
 static void git_commit_finalize (GObject *object);
 static void git_commit_dispose (GObject *object);
 static void git_commit_set_property (GObject *object, guint property_id,
@@ -48,6 +54,9 @@ struct _GitCommitPrivate
 {
   gchar *hash, *repo;
   GHashTable *props;
+  /* The author-time property parsed when it is set so that it can be
+     compared without touching the string */
+  gulong author_time;
 
   gboolean has_log_data;
   GSList *parents;
@@ -57,6 +66,9 @@ struct _GitCommitPrivate
   guint line_handler, completed_handler;
   GString *log_buf;
   gboolean got_parents;
+
+  /* Bytes that this commit has added to the memory accounting */
+  gsize memory_size;
 };
 
 enum
@@ -107,6 +119,13 @@ git_commit_class_init (GitCommitClass *klass)
   g_type_class_add_private (klass, sizeof (GitCommitPrivate));
 }
 
+static void
+git_commit_account (GitCommit *commit, gssize bytes)
+{
+  commit->priv->memory_size += bytes;
+  git_memory_add (GIT_MEMORY_COMMITS, bytes);
+}
+
 static void
 git_commit_init (GitCommit *self)
 {
@@ -116,6 +135,8 @@ git_commit_init (GitCommit *self)
 
   priv->props = g_hash_table_new_full (g_str_hash, g_str_equal,
                                        g_free, g_free);
+
+  git_commit_account (self, sizeof (GitCommit) + sizeof (GitCommitPrivate));
 }
 
 static void
@@ -132,6 +153,8 @@ git_commit_finalize (GObject *object)
     g_string_free (priv->log_buf, TRUE);
   g_hash_table_destroy (priv->props);
 
+  git_memory_add (GIT_MEMORY_COMMITS, -(gssize) priv->memory_size);
+
   G_OBJECT_CLASS (git_commit_parent_class)->finalize (object);
 }
 
@@ -157,8 +180,13 @@ git_commit_set_property (GObject *object, guint property_id,
     {
     case PROP_HASH:
       if (priv->hash)
-        g_free (priv->hash);
+        {
+          git_commit_account (commit, -(gssize) strlen (priv->hash) - 1);
+          g_free (priv->hash);
+        }
       priv->hash = g_strdup (g_value_get_string (value));
+      if (priv->hash)
+        git_commit_account (commit, strlen (priv->hash) + 1);
       break;
 
     case PROP_REPO:
@@ -273,6 +301,8 @@ git_commit_on_completed (GitReader *reader, const GError *error,
       priv->log_buf = NULL;
     }
 
+  git_commit_account (commit, strlen (priv->log_data) + 1);
+
   priv->has_log_data = TRUE;
   g_object_notify (G_OBJECT (commit), "has-log-data");
 }
@@ -392,11 +422,24 @@ void
 git_commit_set_prop (GitCommit *commit, const gchar *prop_name,
                      const gchar *value)
 {
+  const gchar *old_value;
+
   g_return_if_fail (GIT_IS_COMMIT (commit));
 
+  if ((old_value = g_hash_table_lookup (commit->priv->props, prop_name)))
+    git_commit_account (commit, -(gssize) strlen (old_value) - 1);
+  else
+    git_commit_account (commit, strlen (prop_name) + 1
+                        + GIT_COMMIT_PROP_OVERHEAD);
+
+  git_commit_account (commit, strlen (value) + 1);
+
   g_hash_table_insert (commit->priv->props,
                        g_strdup (prop_name),
                        g_strdup (value));
+
+  if (!strcmp (prop_name, "author-time"))
+    commit->priv->author_time = strtoul (value, NULL, 10);
 }
 
 const gchar *
@@ -407,6 +450,25 @@ git_commit_get_prop (GitCommit *commit, const gchar *prop_name)
   return g_hash_table_lookup (commit->priv->props, prop_name);
 }
 
+/* Returns the author time in seconds since the epoch or 0 if the
+   commit doesn't have one */
+gulong
+git_commit_get_author_time (GitCommit *commit)
+{
+  g_return_val_if_fail (GIT_IS_COMMIT (commit), 0);
+
+  return commit->priv->author_time;
+}
+
+void
+git_commit_foreach_prop (GitCommit *commit, GHFunc func, gpointer user_data)
+{
+  g_return_if_fail (GIT_IS_COMMIT (commit));
+  g_return_if_fail (func != NULL);
+
+  g_hash_table_foreach (commit->priv->props, func, user_data);
+}
+
 void
 git_commit_get_color (GitCommit *commit, GdkColor *color)
 {
@@ -77,6 +77,9 @@ void git_commit_fetch_log_data (GitCommit *commit);
 void git_commit_set_prop (GitCommit *commit, const gchar *prop_name,
                           const gchar *value);
 const gchar *git_commit_get_prop (GitCommit *commit, const gchar *prop_name);
+gulong git_commit_get_author_time (GitCommit *commit);
+void git_commit_foreach_prop (GitCommit *commit, GHFunc func,
+                              gpointer user_data);
 
 void git_commit_get_color (GitCommit *commit, GdkColor *color);
 
@@ -249,3 +249,25 @@ git_show_url (GtkWidget      *widget,
 
   g_strfreev (argv);
 }
+
+/* Picks a colour for code of the given relative age where 0.0 is the
+   newest and 1.0 is the oldest. New code is hot red going through
+   yellow to cold blue */
+void
+git_age_to_color (gdouble age, GdkColor *color)
+{
+  static const guint8 stops[][3] =
+    {
+      { 0xe0, 0x40, 0x30 },
+      { 0xe8, 0xc8, 0x40 },
+      { 0x38, 0x68, 0xc8 }
+    };
+  gdouble pos = CLAMP (age, 0.0, 1.0) * (G_N_ELEMENTS (stops) - 1);
+  guint stop = MIN ((guint) pos, G_N_ELEMENTS (stops) - 2);
+  gdouble t = pos - stop;
+
+  color->pixel = 0;
+  color->red = (stops[stop][0] * (1.0 - t) + stops[stop + 1][0] * t) * 257;
+  color->green = (stops[stop][1] * (1.0 - t) + stops[stop + 1][1] * t) * 257;
+  color->blue = (stops[stop][2] * (1.0 - t) + stops[stop + 1][2] * t) * 257;
+}
@@ -27,7 +27,11 @@
 typedef enum {
   GIT_ERROR_EXIT_STATUS,
   GIT_ERROR_PARSE_ERROR,
-  GIT_ERROR_NO_REPO
+  GIT_ERROR_NO_REPO,
+  GIT_ERROR_CACHE,
+  GIT_ERROR_CANCELLED,
+  GIT_ERROR_RECORDING,
+  GIT_ERROR_LOCAL_CHANGES
 } GitError;
 
 GQuark git_error_quark (void);
@@ -42,4 +46,6 @@ void git_show_url (GtkWidget *widget, const gchar *link_);
 gboolean git_find_repo (const gchar *full_filename, gchar **repo,
                         gchar **relative_filename);
 
+void git_age_to_color (gdouble age, GdkColor *color);
+
 #endif /* __GIT_COMMON_H__ */
@@ -0,0 +1,248 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* A small LZ77 block codec in the style of LZ4. The compressed data
+   is a sequence of tokens. The high nibble of each token is the
+   number of literal bytes that follow it and the low nibble is the
+   length of the match minus four. A nibble of 15 means that the
+   length continues in following bytes which are added to it until
+   a byte that isn't 255 is found. The literals are followed by a
+   two byte little-endian offset back into the output to copy the
+   match from. The last token only has literals. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <string.h>
+
+#include "git-compress.h"
+
+#define GIT_COMPRESS_MIN_MATCH   4
+#define GIT_COMPRESS_MAX_OFFSET  0xffff
+#define GIT_COMPRESS_HASH_BITS   12
+#define GIT_COMPRESS_HASH_SIZE   (1 << GIT_COMPRESS_HASH_BITS)
+
+static guint32
+git_compress_read32 (const guint8 *p)
+{
+  guint32 value;
+
+  memcpy (&value, p, sizeof (value));
+
+  return value;
+}
+
+static guint
+git_compress_hash (guint32 value)
+{
+  return (value * 2654435761U) >> (32 - GIT_COMPRESS_HASH_BITS);
+}
+
+static guint8 *
+git_compress_write_length (guint8 *op, gsize length)
+{
+  while (length >= 255)
+    {
+      *(op++) = 255;
+      length -= 255;
+    }
+  *(op++) = length;
+
+  return op;
+}
+
+gsize
+git_compress_bound (gsize src_len)
+{
+  return src_len + src_len / 255 + 16;
+}
+
+static guint8 *
+git_compress_write_literals (guint8 *op, guint8 *op_end,
+                             const guint8 *literals, gsize n_literals,
+                             gsize match_length)
+{
+  guint8 *token;
+
+  /* Make sure there's enough space for the token, the length bytes,
+     the literals and the offset */
+  if (op_end - op < n_literals + n_literals / 255 + 4)
+    return NULL;
+
+  token = op++;
+
+  if (n_literals >= 15)
+    {
+      *token = 15 << 4;
+      op = git_compress_write_length (op, n_literals - 15);
+    }
+  else
+    *token = n_literals << 4;
+
+  memcpy (op, literals, n_literals);
+  op += n_literals;
+
+  if (match_length > 0)
+    {
+      match_length -= GIT_COMPRESS_MIN_MATCH;
+
+      if (match_length >= 15)
+        *token |= 15;
+      else
+        *token |= match_length;
+    }
+
+  return op;
+}
+
+/* Compresses src_len bytes from src into dst. Returns the size of
+   the compressed data or 0 if it didn't fit in dst_len bytes */
+gsize
+git_compress (const guint8 *src, gsize src_len,
+              guint8 *dst, gsize dst_len)
+{
+  const guint8 *ip = src, *anchor = src, *end = src + src_len;
+  guint8 *op = dst, *op_end = dst + dst_len;
+  gsize table[GIT_COMPRESS_HASH_SIZE];
+
+  /* Positions in the table are stored plus one so that zero can
+     mean an empty slot */
+  memset (table, 0, sizeof (table));
+
+  while (end - ip >= GIT_COMPRESS_MIN_MATCH)
+    {
+      guint32 seq = git_compress_read32 (ip);
+      guint hash = git_compress_hash (seq);
+      gsize ref_pos = table[hash];
+      gsize pos = ip - src;
+
+      table[hash] = pos + 1;
+
+      if (ref_pos > 0
+          && pos - (ref_pos - 1) <= GIT_COMPRESS_MAX_OFFSET
+          && git_compress_read32 (src + ref_pos - 1) == seq)
+        {
+          const guint8 *ref = src + ref_pos - 1;
+          gsize match_length = GIT_COMPRESS_MIN_MATCH, offset = ip - ref;
+
+          while (ip + match_length < end && ref[match_length] == ip[match_length])
+            match_length++;
+
+          if ((op = git_compress_write_literals (op, op_end,
+                                                 anchor, ip - anchor,
+                                                 match_length)) == NULL)
+            return 0;
+
+          *(op++) = offset & 0xff;
+          *(op++) = offset >> 8;
+
+          if (match_length - GIT_COMPRESS_MIN_MATCH >= 15)
+            {
+              if (op_end - op < (match_length - GIT_COMPRESS_MIN_MATCH) / 255 + 1)
+                return 0;
+              op = git_compress_write_length (op, match_length
+                                              - GIT_COMPRESS_MIN_MATCH - 15);
+            }
+
+          ip += match_length;
+          anchor = ip;
+        }
+      else
+        ip++;
+    }
+
+  /* The rest of the data is stored as literals in a final token
+     without a match */
+  if ((op = git_compress_write_literals (op, op_end,
+                                         anchor, end - anchor, 0)) == NULL)
+    return 0;
+
+  return op - dst;
+}
+
+static gboolean
+git_decompress_read_length (const guint8 **ip, const guint8 *ip_end,
+                            gsize *length)
+{
+  guint8 byte;
+
+  do
+    {
+      if (*ip >= ip_end)
+        return FALSE;
+      byte = *((*ip)++);
+      *length += byte;
+    }
+  while (byte == 255);
+
+  return TRUE;
+}
+
+/* Decompresses the data in src into dst which must be exactly the
+   size of the original data. Returns FALSE if the data is corrupt */
+gboolean
+git_decompress (const guint8 *src, gsize src_len,
+                guint8 *dst, gsize dst_len)
+{
+  const guint8 *ip = src, *ip_end = src + src_len;
+  guint8 *op = dst, *op_end = dst + dst_len;
+
+  while (ip < ip_end)
+    {
+      guint token = *(ip++);
+      gsize length = token >> 4, offset;
+      const guint8 *match;
+
+      if (length == 15 && !git_decompress_read_length (&ip, ip_end, &length))
+        return FALSE;
+      if (length > ip_end - ip || length > op_end - op)
+        return FALSE;
+
+      memcpy (op, ip, length);
+      op += length;
+      ip += length;
+
+      /* The last token doesn't have a match */
+      if (ip >= ip_end)
+        break;
+
+      if (ip_end - ip < 2)
+        return FALSE;
+      offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+
+      if (offset == 0 || offset > op - dst)
+        return FALSE;
+
+      length = (token & 15) + GIT_COMPRESS_MIN_MATCH;
+      if ((token & 15) == 15
+          && !git_decompress_read_length (&ip, ip_end, &length))
+        return FALSE;
+      if (length > op_end - op)
+        return FALSE;
+
+      /* The match can overlap with the output so it has to be
+         copied a byte at a time */
+      for (match = op - offset; length > 0; length--)
+        *(op++) = *(match++);
+    }
+
+  return op == op_end;
+}
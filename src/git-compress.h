@@ -0,0 +1,36 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __GIT_COMPRESS_H__
+#define __GIT_COMPRESS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gsize git_compress_bound (gsize src_len);
+
+gsize git_compress (const guint8 *src, gsize src_len,
+                    guint8 *dst, gsize dst_len);
+
+gboolean git_decompress (const guint8 *src, gsize src_len,
+                         guint8 *dst, gsize dst_len);
+
+G_END_DECLS
+
+#endif /* __GIT_COMPRESS_H__ */
@@ -0,0 +1,368 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtk/gtkdialog.h>
+#include <gtk/gtkvbox.h>
+#include <gtk/gtkprogressbar.h>
+#include <gtk/gtkscrolledwindow.h>
+#include <gtk/gtktreeview.h>
+#include <gtk/gtktreestore.h>
+#include <gtk/gtkcellrenderertext.h>
+#include <gtk/gtkstock.h>
+
+#include "git-dir-owners-dialog.h"
+#include "git-dir-owners.h"
+#include "intl.h"
+
+static void git_dir_owners_dialog_dispose (GObject *object);
+
+static gboolean
+git_dir_owners_dialog_on_test_expand_row (GtkTreeView *tree_view,
+                                          GtkTreeIter *iter,
+                                          GtkTreePath *path,
+                                          GitDirOwnersDialog *dodiag);
+
+G_DEFINE_TYPE (GitDirOwnersDialog, git_dir_owners_dialog, GTK_TYPE_DIALOG);
+
+#define GIT_DIR_OWNERS_DIALOG_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_DIR_OWNERS_DIALOG, \
+                                GitDirOwnersDialogPrivate))
+
+struct _GitDirOwnersDialogPrivate
+{
+  GitDirOwners *owners;
+  guint completed_handler, progress_handler;
+
+  GtkWidget *progress_bar, *tree_view;
+  GtkTreeStore *store;
+  guint test_expand_row_handler;
+};
+
+/* The children of a directory are only added when its row is first
+   expanded. Until then it has a single placeholder child with a NULL
+   node so that it can be expanded */
+enum
+  {
+    GIT_DIR_OWNERS_DIALOG_COL_NAME,
+    GIT_DIR_OWNERS_DIALOG_COL_LINES,
+    GIT_DIR_OWNERS_DIALOG_COL_TOP_AUTHOR,
+    GIT_DIR_OWNERS_DIALOG_COL_N_AUTHORS,
+    GIT_DIR_OWNERS_DIALOG_COL_NODE,
+
+    GIT_DIR_OWNERS_DIALOG_N_COLUMNS
+  };
+
+static void
+git_dir_owners_dialog_class_init (GitDirOwnersDialogClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->dispose = git_dir_owners_dialog_dispose;
+
+  g_type_class_add_private (klass, sizeof (GitDirOwnersDialogPrivate));
+}
+
+static void
+git_dir_owners_dialog_add_column (GitDirOwnersDialog *dodiag,
+                                  const gchar *title,
+                                  gint column, gfloat xalign)
+{
+  GtkCellRenderer *renderer = gtk_cell_renderer_text_new ();
+  GtkTreeViewColumn *tree_column;
+
+  g_object_set (renderer, "xalign", xalign, NULL);
+
+  tree_column = gtk_tree_view_column_new_with_attributes (title, renderer,
+                                                          "text", column,
+                                                          NULL);
+  gtk_tree_view_column_set_resizable (tree_column, TRUE);
+  gtk_tree_view_append_column (GTK_TREE_VIEW (dodiag->priv->tree_view),
+                               tree_column);
+}
+
+static void
+git_dir_owners_dialog_init (GitDirOwnersDialog *self)
+{
+  GitDirOwnersDialogPrivate *priv;
+  GtkWidget *content, *scrolled_window;
+
+  priv = self->priv = GIT_DIR_OWNERS_DIALOG_GET_PRIVATE (self);
+
+  gtk_window_set_title (GTK_WINDOW (self), _("Directory Ownership"));
+  gtk_window_set_default_size (GTK_WINDOW (self), 500, 400);
+  gtk_dialog_set_has_separator (GTK_DIALOG (self), FALSE);
+  gtk_container_set_border_width (GTK_CONTAINER (self), 5);
+
+  content = gtk_vbox_new (FALSE, 6);
+  gtk_container_set_border_width (GTK_CONTAINER (content), 5);
+
+  priv->progress_bar = g_object_ref_sink (gtk_progress_bar_new ());
+  gtk_widget_show (priv->progress_bar);
+  gtk_box_pack_start (GTK_BOX (content), priv->progress_bar,
+                      FALSE, FALSE, 0);
+
+  priv->store = gtk_tree_store_new (GIT_DIR_OWNERS_DIALOG_N_COLUMNS,
+                                    G_TYPE_STRING,
+                                    G_TYPE_UINT,
+                                    G_TYPE_STRING,
+                                    G_TYPE_UINT,
+                                    G_TYPE_POINTER);
+
+  priv->tree_view = g_object_ref_sink
+    (gtk_tree_view_new_with_model (GTK_TREE_MODEL (priv->store)));
+  git_dir_owners_dialog_add_column (self, _("Name"),
+                                    GIT_DIR_OWNERS_DIALOG_COL_NAME, 0.0f);
+  git_dir_owners_dialog_add_column (self, _("Lines"),
+                                    GIT_DIR_OWNERS_DIALOG_COL_LINES, 1.0f);
+  git_dir_owners_dialog_add_column (self, _("Main Owner"),
+                                    GIT_DIR_OWNERS_DIALOG_COL_TOP_AUTHOR,
+                                    0.0f);
+  git_dir_owners_dialog_add_column (self, _("Authors"),
+                                    GIT_DIR_OWNERS_DIALOG_COL_N_AUTHORS,
+                                    1.0f);
+  priv->test_expand_row_handler
+    = g_signal_connect (priv->tree_view, "test-expand-row",
+                        G_CALLBACK (git_dir_owners_dialog_on_test_expand_row),
+                        self);
+  gtk_widget_show (priv->tree_view);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
+                                  GTK_POLICY_AUTOMATIC,
+                                  GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scrolled_window),
+                                       GTK_SHADOW_IN);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), priv->tree_view);
+  gtk_widget_show (scrolled_window);
+  gtk_box_pack_start (GTK_BOX (content), scrolled_window, TRUE, TRUE, 0);
+
+  gtk_widget_show (content);
+  gtk_box_pack_start (GTK_BOX (GTK_DIALOG (self)->vbox), content,
+                      TRUE, TRUE, 0);
+
+  gtk_dialog_add_button (GTK_DIALOG (self), GTK_STOCK_CLOSE,
+                         GTK_RESPONSE_CLOSE);
+}
+
+static void
+git_dir_owners_dialog_dispose (GObject *object)
+{
+  GitDirOwnersDialog *self = (GitDirOwnersDialog *) object;
+  GitDirOwnersDialogPrivate *priv = self->priv;
+
+  if (priv->owners)
+    {
+      g_signal_handler_disconnect (priv->owners, priv->completed_handler);
+      g_signal_handler_disconnect (priv->owners, priv->progress_handler);
+      g_object_unref (priv->owners);
+      priv->owners = NULL;
+    }
+
+  if (priv->tree_view)
+    {
+      g_signal_handler_disconnect (priv->tree_view,
+                                   priv->test_expand_row_handler);
+      g_object_unref (priv->tree_view);
+      priv->tree_view = NULL;
+    }
+
+  if (priv->store)
+    {
+      g_object_unref (priv->store);
+      priv->store = NULL;
+    }
+
+  if (priv->progress_bar)
+    {
+      g_object_unref (priv->progress_bar);
+      priv->progress_bar = NULL;
+    }
+
+  G_OBJECT_CLASS (git_dir_owners_dialog_parent_class)->dispose (object);
+}
+
+GtkWidget *
+git_dir_owners_dialog_new (void)
+{
+  GtkWidget *self = g_object_new (GIT_TYPE_DIR_OWNERS_DIALOG, NULL);
+
+  return self;
+}
+
+static void
+git_dir_owners_dialog_add_node (GitDirOwnersDialog *dodiag,
+                                GtkTreeIter *parent,
+                                const GitDirOwnersNode *node)
+{
+  GitDirOwnersDialogPrivate *priv = dodiag->priv;
+  GtkTreeIter iter, placeholder;
+  const gchar *author;
+  gchar *top_author = NULL;
+  guint n_lines;
+
+  if ((author = git_dir_owners_node_get_top_author (node, &n_lines)))
+    top_author = g_strdup_printf ("%s (%.0f%%)", author,
+                                  n_lines * 100.0 / node->n_lines);
+
+  gtk_tree_store_append (priv->store, &iter, parent);
+  gtk_tree_store_set (priv->store, &iter,
+                      GIT_DIR_OWNERS_DIALOG_COL_NAME, node->name,
+                      GIT_DIR_OWNERS_DIALOG_COL_LINES, node->n_lines,
+                      GIT_DIR_OWNERS_DIALOG_COL_TOP_AUTHOR,
+                      top_author ? top_author : "",
+                      GIT_DIR_OWNERS_DIALOG_COL_N_AUTHORS,
+                      g_hash_table_size (node->authors),
+                      GIT_DIR_OWNERS_DIALOG_COL_NODE, node,
+                      -1);
+
+  if (node->children && node->children->len > 0)
+    {
+      gtk_tree_store_append (priv->store, &placeholder, &iter);
+      gtk_tree_store_set (priv->store, &placeholder,
+                          GIT_DIR_OWNERS_DIALOG_COL_NODE, NULL,
+                          -1);
+    }
+
+  g_free (top_author);
+}
+
+static gboolean
+git_dir_owners_dialog_on_test_expand_row (GtkTreeView *tree_view,
+                                          GtkTreeIter *iter,
+                                          GtkTreePath *path,
+                                          GitDirOwnersDialog *dodiag)
+{
+  GitDirOwnersDialogPrivate *priv = dodiag->priv;
+  GtkTreeModel *model = GTK_TREE_MODEL (priv->store);
+  const GitDirOwnersNode *node, *child_node;
+  GtkTreeIter child;
+  guint i;
+
+  if (!gtk_tree_model_iter_children (model, &child, iter))
+    return FALSE;
+
+  gtk_tree_model_get (model, &child,
+                      GIT_DIR_OWNERS_DIALOG_COL_NODE, &child_node,
+                      -1);
+
+  /* Replace the placeholder with the real children */
+  if (child_node == NULL)
+    {
+      gtk_tree_model_get (model, iter,
+                          GIT_DIR_OWNERS_DIALOG_COL_NODE, &node,
+                          -1);
+      gtk_tree_store_remove (priv->store, &child);
+
+      for (i = 0; i < node->children->len; i++)
+        git_dir_owners_dialog_add_node (dodiag, iter,
+                                        g_ptr_array_index (node->children,
+                                                           i));
+    }
+
+  /* Allow the row to expand */
+  return FALSE;
+}
+
+static void
+git_dir_owners_dialog_on_progress (GitDirOwners *owners,
+                                   GitDirOwnersDialog *dodiag)
+{
+  GitDirOwnersDialogPrivate *priv = dodiag->priv;
+  guint n_files_done, n_files_cached, n_files;
+  gchar *text;
+
+  git_dir_owners_get_progress (owners, &n_files_done, &n_files_cached,
+                               &n_files);
+
+  text = g_strdup_printf (_("%u of %u files (%u from cache)"),
+                          n_files_done, n_files, n_files_cached);
+  gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar), text);
+  g_free (text);
+
+  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 n_files ? n_files_done / (gdouble) n_files
+                                 : 0.0);
+}
+
+static void
+git_dir_owners_dialog_on_completed (GitDirOwners *owners,
+                                    const GError *error,
+                                    GitDirOwnersDialog *dodiag)
+{
+  GitDirOwnersDialogPrivate *priv = dodiag->priv;
+  GtkTreePath *path;
+
+  if (error)
+    {
+      gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 error->message);
+      return;
+    }
+
+  git_dir_owners_dialog_on_progress (owners, dodiag);
+
+  gtk_tree_store_clear (priv->store);
+  git_dir_owners_dialog_add_node (dodiag, NULL,
+                                  git_dir_owners_get_root (owners));
+
+  path = gtk_tree_path_new_first ();
+  gtk_tree_view_expand_row (GTK_TREE_VIEW (priv->tree_view), path, FALSE);
+  gtk_tree_path_free (path);
+}
+
+/* Starts working out the ownership of the directory at path in the
+   given revision or HEAD if revision is NULL. Any error is shown in
+   the dialog */
+void
+git_dir_owners_dialog_start (GitDirOwnersDialog *dodiag,
+                             const gchar *path,
+                             const gchar *revision)
+{
+  GitDirOwnersDialogPrivate *priv;
+  GError *error = NULL;
+
+  g_return_if_fail (GIT_IS_DIR_OWNERS_DIALOG (dodiag));
+  g_return_if_fail (path != NULL);
+
+  priv = dodiag->priv;
+
+  g_return_if_fail (priv->owners == NULL);
+
+  priv->owners = git_dir_owners_new ();
+  priv->completed_handler
+    = g_signal_connect (priv->owners, "completed",
+                        G_CALLBACK (git_dir_owners_dialog_on_completed),
+                        dodiag);
+  priv->progress_handler
+    = g_signal_connect (priv->owners, "progress",
+                        G_CALLBACK (git_dir_owners_dialog_on_progress),
+                        dodiag);
+
+  if (git_dir_owners_start (priv->owners, path, revision, &error))
+    gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                               _("Listing files"));
+  else
+    {
+      gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 error->message);
+      g_error_free (error);
+    }
+}
@@ -0,0 +1,72 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_DIR_OWNERS_DIALOG_H__
+#define __GIT_DIR_OWNERS_DIALOG_H__
+
+#include <gtk/gtkdialog.h>
+
+G_BEGIN_DECLS
+
+#define GIT_TYPE_DIR_OWNERS_DIALOG                                      \
+  (git_dir_owners_dialog_get_type())
+#define GIT_DIR_OWNERS_DIALOG(obj)                                      \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                   \
+                               GIT_TYPE_DIR_OWNERS_DIALOG,              \
+                               GitDirOwnersDialog))
+#define GIT_DIR_OWNERS_DIALOG_CLASS(klass)                              \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            GIT_TYPE_DIR_OWNERS_DIALOG,                 \
+                            GitDirOwnersDialogClass))
+#define GIT_IS_DIR_OWNERS_DIALOG(obj)                                   \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),                                   \
+                               GIT_TYPE_DIR_OWNERS_DIALOG))
+#define GIT_IS_DIR_OWNERS_DIALOG_CLASS(klass)                           \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),                                    \
+                            GIT_TYPE_DIR_OWNERS_DIALOG))
+#define GIT_DIR_OWNERS_DIALOG_GET_CLASS(obj)                            \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                    \
+                              GIT_TYPE_DIR_OWNERS_DIALOG,               \
+                              GitDirOwnersDialogClass))
+
+typedef struct _GitDirOwnersDialog        GitDirOwnersDialog;
+typedef struct _GitDirOwnersDialogClass   GitDirOwnersDialogClass;
+typedef struct _GitDirOwnersDialogPrivate GitDirOwnersDialogPrivate;
+
+struct _GitDirOwnersDialogClass
+{
+  GtkDialogClass parent_class;
+};
+
+struct _GitDirOwnersDialog
+{
+  GtkDialog parent;
+
+  GitDirOwnersDialogPrivate *priv;
+};
+
+GType git_dir_owners_dialog_get_type (void) G_GNUC_CONST;
+
+GtkWidget *git_dir_owners_dialog_new (void);
+
+void git_dir_owners_dialog_start (GitDirOwnersDialog *dodiag,
+                                  const gchar *path,
+                                  const gchar *revision);
+
+G_END_DECLS
+
+#endif /* __GIT_DIR_OWNERS_DIALOG_H__ */
@@ -0,0 +1,787 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Works out who owns the lines of every file under a directory. The
+   files are listed with git-ls-tree and then blamed with a small pool
+   of GitAnnotatedSources so that a few git processes run at the same
+   time. The number of lines per author for each file is saved in the
+   cache directory named after the blob id so that files that haven't
+   changed don't need to be blamed again */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib-object.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "git-dir-owners.h"
+#include "git-annotated-source.h"
+#include "git-reader.h"
+#include "git-commit.h"
+#include "git-common.h"
+
+static void git_dir_owners_dispose (GObject *object);
+static void git_dir_owners_finalize (GObject *object);
+
+static gboolean git_dir_owners_on_list_line (GitReader *reader,
+                                             guint length,
+                                             const gchar *str,
+                                             GitDirOwners *owners);
+static void git_dir_owners_on_list_completed (GitReader *reader,
+                                              const GError *error,
+                                              GitDirOwners *owners);
+
+G_DEFINE_TYPE (GitDirOwners, git_dir_owners, G_TYPE_OBJECT);
+
+#define GIT_DIR_OWNERS_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_DIR_OWNERS, \
+                                GitDirOwnersPrivate))
+
+typedef struct _GitDirOwnersFile   GitDirOwnersFile;
+typedef struct _GitDirOwnersWorker GitDirOwnersWorker;
+
+struct _GitDirOwnersFile
+{
+  GitDirOwnersNode *node;
+  /* Path of the file relative to the top of the repo */
+  gchar *path;
+  gchar blob[GIT_COMMIT_HASH_LENGTH + 1];
+};
+
+struct _GitDirOwnersWorker
+{
+  GitDirOwners *owners;
+  GitAnnotatedSource *source;
+  guint completed_handler;
+  /* The file being blamed or NULL if the worker is free */
+  GitDirOwnersFile *file;
+};
+
+struct _GitDirOwnersPrivate
+{
+  GitReader *list_reader;
+  guint list_line_handler, list_completed_handler;
+
+  gchar *repo, *revision;
+  /* Path of the root directory relative to the top of the repo
+     without a trailing separator. This is empty for the whole repo */
+  gchar *prefix;
+
+  GitDirOwnersNode *root;
+  /* Map from the path of each directory relative to the root to its
+     node */
+  GHashTable *dir_nodes;
+
+  /* Files that are waiting to be blamed */
+  GQueue *pending;
+  GitDirOwnersWorker workers[GIT_DIR_OWNERS_MAX_WORKERS];
+  /* Starting a blame from a completed handler would restart a reader
+     from its own signal so the workers are always started from an
+     idle handler */
+  guint run_idle;
+
+  gboolean listing_done, finished;
+  guint n_files, n_files_done, n_files_cached;
+};
+
+enum
+  {
+    COMPLETED,
+    PROGRESS,
+
+    LAST_SIGNAL
+  };
+
+static guint client_signals[LAST_SIGNAL];
+
+static void
+git_dir_owners_class_init (GitDirOwnersClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->dispose = git_dir_owners_dispose;
+  gobject_class->finalize = git_dir_owners_finalize;
+
+  client_signals[COMPLETED]
+    = g_signal_new ("completed",
+                    G_TYPE_FROM_CLASS (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitDirOwnersClass, completed),
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__POINTER,
+                    G_TYPE_NONE, 1,
+                    G_TYPE_POINTER);
+
+  client_signals[PROGRESS]
+    = g_signal_new ("progress",
+                    G_TYPE_FROM_CLASS (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitDirOwnersClass, progress),
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__VOID,
+                    G_TYPE_NONE, 0);
+
+  g_type_class_add_private (klass, sizeof (GitDirOwnersPrivate));
+}
+
+static void
+git_dir_owners_init (GitDirOwners *self)
+{
+  GitDirOwnersPrivate *priv;
+
+  priv = self->priv = GIT_DIR_OWNERS_GET_PRIVATE (self);
+
+  priv->list_reader = git_reader_new ();
+  git_reader_set_line_terminator (priv->list_reader, '\0');
+  priv->list_line_handler
+    = g_signal_connect (priv->list_reader, "line",
+                        G_CALLBACK (git_dir_owners_on_list_line),
+                        self);
+  priv->list_completed_handler
+    = g_signal_connect (priv->list_reader, "completed",
+                        G_CALLBACK (git_dir_owners_on_list_completed),
+                        self);
+
+  priv->dir_nodes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, NULL);
+  priv->pending = g_queue_new ();
+}
+
+static GitDirOwnersNode *
+git_dir_owners_node_new (const gchar *name, GitDirOwnersNode *parent,
+                         gboolean is_dir)
+{
+  GitDirOwnersNode *node = g_slice_new (GitDirOwnersNode);
+
+  node->name = g_strdup (name);
+  node->parent = parent;
+  node->children = is_dir ? g_ptr_array_new () : NULL;
+  node->n_lines = 0;
+  node->authors = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, NULL);
+
+  if (parent)
+    g_ptr_array_add (parent->children, node);
+
+  return node;
+}
+
+static void
+git_dir_owners_node_free (GitDirOwnersNode *node)
+{
+  if (node->children)
+    {
+      g_ptr_array_foreach (node->children,
+                           (GFunc) git_dir_owners_node_free, NULL);
+      g_ptr_array_free (node->children, TRUE);
+    }
+
+  g_hash_table_destroy (node->authors);
+  g_free (node->name);
+  g_slice_free (GitDirOwnersNode, node);
+}
+
+static void
+git_dir_owners_file_free (GitDirOwnersFile *file)
+{
+  g_free (file->path);
+  g_slice_free (GitDirOwnersFile, file);
+}
+
+/* Stops any blames that are running and throws away their sources */
+static void
+git_dir_owners_stop_workers (GitDirOwners *owners)
+{
+  GitDirOwnersPrivate *priv = owners->priv;
+  int i;
+
+  for (i = 0; i < GIT_DIR_OWNERS_MAX_WORKERS; i++)
+    {
+      GitDirOwnersWorker *worker = priv->workers + i;
+
+      if (worker->source)
+        {
+          g_signal_handler_disconnect (worker->source,
+                                       worker->completed_handler);
+          g_object_unref (worker->source);
+          worker->source = NULL;
+        }
+      if (worker->file)
+        {
+          git_dir_owners_file_free (worker->file);
+          worker->file = NULL;
+        }
+    }
+
+  if (priv->run_idle)
+    {
+      g_source_remove (priv->run_idle);
+      priv->run_idle = 0;
+    }
+}
+
+static void
+git_dir_owners_dispose (GObject *object)
+{
+  GitDirOwners *self = (GitDirOwners *) object;
+  GitDirOwnersPrivate *priv = self->priv;
+
+  if (priv->list_reader)
+    {
+      g_signal_handler_disconnect (priv->list_reader,
+                                   priv->list_line_handler);
+      g_signal_handler_disconnect (priv->list_reader,
+                                   priv->list_completed_handler);
+      g_object_unref (priv->list_reader);
+      priv->list_reader = NULL;
+    }
+
+  git_dir_owners_stop_workers (self);
+
+  G_OBJECT_CLASS (git_dir_owners_parent_class)->dispose (object);
+}
+
+static void
+git_dir_owners_finalize (GObject *object)
+{
+  GitDirOwners *self = (GitDirOwners *) object;
+  GitDirOwnersPrivate *priv = self->priv;
+
+  g_queue_foreach (priv->pending, (GFunc) git_dir_owners_file_free, NULL);
+  g_queue_free (priv->pending);
+  g_hash_table_destroy (priv->dir_nodes);
+
+  if (priv->root)
+    git_dir_owners_node_free (priv->root);
+
+  g_free (priv->repo);
+  g_free (priv->revision);
+  g_free (priv->prefix);
+
+  G_OBJECT_CLASS (git_dir_owners_parent_class)->finalize (object);
+}
+
+GitDirOwners *
+git_dir_owners_new (void)
+{
+  GitDirOwners *self = g_object_new (GIT_TYPE_DIR_OWNERS, NULL);
+
+  return self;
+}
+
+/* Adds lines owned by an author to a node and all of its parents */
+static void
+git_dir_owners_add_lines (GitDirOwnersNode *node, const gchar *author,
+                          guint n_lines)
+{
+  for (; node; node = node->parent)
+    {
+      gpointer key, value;
+
+      node->n_lines += n_lines;
+
+      if (g_hash_table_lookup_extended (node->authors, author, &key, &value))
+        g_hash_table_insert (node->authors, g_strdup (author),
+                             GUINT_TO_POINTER (GPOINTER_TO_UINT (value)
+                                               + n_lines));
+      else
+        g_hash_table_insert (node->authors, g_strdup (author),
+                             GUINT_TO_POINTER (n_lines));
+    }
+}
+
+static gchar *
+git_dir_owners_get_cache_filename (const gchar *blob)
+{
+  return g_build_filename (g_get_user_cache_dir (), "blame-browse", "owners",
+                           blob, NULL);
+}
+
+/* The cache file has a line for each author with the number of lines
+   followed by a space and the name */
+static gboolean
+git_dir_owners_load_cached (GitDirOwnersFile *file)
+{
+  gchar *filename = git_dir_owners_get_cache_filename (file->blob);
+  gchar *contents, *p, *end;
+
+  if (!g_file_get_contents (filename, &contents, NULL, NULL))
+    {
+      g_free (filename);
+      return FALSE;
+    }
+
+  g_free (filename);
+
+  for (p = contents; *p; p = end + 1)
+    {
+      gchar *author;
+      gulong n_lines;
+
+      if ((end = strchr (p, '\n')) == NULL)
+        break;
+      *end = '\0';
+
+      n_lines = strtoul (p, &author, 10);
+      if (*author == ' ')
+        git_dir_owners_add_lines (file->node, author + 1, n_lines);
+    }
+
+  g_free (contents);
+
+  return TRUE;
+}
+
+static void
+git_dir_owners_store_cached (GitDirOwnersFile *file,
+                             GitAnnotatedSource *source)
+{
+  gchar *filename = git_dir_owners_get_cache_filename (file->blob);
+  gchar *dirname = g_path_get_dirname (filename);
+  GString *contents = g_string_new (NULL);
+  GError *error = NULL;
+  guint owner_num, n_owners;
+
+  n_owners = git_annotated_source_get_n_owners (source);
+  for (owner_num = 0; owner_num < n_owners; owner_num++)
+    {
+      const GitAnnotatedSourceOwner *owner
+        = git_annotated_source_get_owner (source, owner_num);
+
+      /* A newline in the name would break the format */
+      if (strchr (owner->author, '\n') == NULL)
+        g_string_append_printf (contents, "%u %s\n",
+                                owner->n_lines, owner->author);
+    }
+
+  if (g_mkdir_with_parents (dirname, 0755) == -1
+      || !g_file_set_contents (filename, contents->str, contents->len,
+                               &error))
+    {
+      if (error)
+        {
+          g_warning ("Failed to store ownership in cache: %s",
+                     error->message);
+          g_error_free (error);
+        }
+      else
+        g_warning ("Failed to create %s", dirname);
+    }
+
+  g_string_free (contents, TRUE);
+  g_free (dirname);
+  g_free (filename);
+}
+
+static gint
+git_dir_owners_compare_nodes (gconstpointer a, gconstpointer b)
+{
+  const GitDirOwnersNode *node_a = *(const GitDirOwnersNode **) a;
+  const GitDirOwnersNode *node_b = *(const GitDirOwnersNode **) b;
+
+  /* Directories go before files */
+  if ((node_a->children == NULL) != (node_b->children == NULL))
+    return node_a->children ? -1 : 1;
+  else
+    return strcmp (node_a->name, node_b->name);
+}
+
+static void
+git_dir_owners_sort_node (GitDirOwnersNode *node)
+{
+  if (node->children)
+    {
+      g_ptr_array_sort (node->children, git_dir_owners_compare_nodes);
+      g_ptr_array_foreach (node->children,
+                           (GFunc) git_dir_owners_sort_node, NULL);
+    }
+}
+
+static void
+git_dir_owners_finish (GitDirOwners *owners, const GError *error)
+{
+  GitDirOwnersPrivate *priv = owners->priv;
+
+  if (priv->finished)
+    return;
+
+  priv->finished = TRUE;
+
+  if (error == NULL)
+    git_dir_owners_sort_node (priv->root);
+
+  g_signal_emit (owners, client_signals[COMPLETED], 0, error);
+}
+
+static void
+git_dir_owners_run_workers (GitDirOwners *owners)
+{
+  GitDirOwnersPrivate *priv = owners->priv;
+  gboolean busy = FALSE;
+  int i;
+
+  if (priv->finished)
+    return;
+
+  for (i = 0; i < GIT_DIR_OWNERS_MAX_WORKERS; i++)
+    {
+      GitDirOwnersWorker *worker = priv->workers + i;
+
+      while (worker->file == NULL && !g_queue_is_empty (priv->pending))
+        {
+          GitDirOwnersFile *file = g_queue_pop_head (priv->pending);
+          gchar *filename = g_build_filename (priv->repo, file->path, NULL);
+          GError *error = NULL;
+
+          if (git_annotated_source_fetch (worker->source, filename,
+                                          priv->revision, &error))
+            worker->file = file;
+          else
+            {
+              g_warning ("Failed to blame %s: %s", file->path,
+                         error->message);
+              g_error_free (error);
+              git_dir_owners_file_free (file);
+              priv->n_files_done++;
+            }
+
+          g_free (filename);
+        }
+
+      if (worker->file)
+        busy = TRUE;
+    }
+
+  if (!busy && priv->listing_done)
+    git_dir_owners_finish (owners, NULL);
+}
+
+static gboolean
+git_dir_owners_on_run_idle (gpointer data)
+{
+  GitDirOwners *owners = (GitDirOwners *) data;
+
+  owners->priv->run_idle = 0;
+
+  git_dir_owners_run_workers (owners);
+
+  return FALSE;
+}
+
+static void
+git_dir_owners_queue_run (GitDirOwners *owners)
+{
+  GitDirOwnersPrivate *priv = owners->priv;
+
+  if (priv->run_idle == 0)
+    priv->run_idle = g_idle_add (git_dir_owners_on_run_idle, owners);
+}
+
+static void
+git_dir_owners_on_worker_completed (GitAnnotatedSource *source,
+                                    const GError *error,
+                                    GitDirOwnersWorker *worker)
+{
+  GitDirOwners *owners = worker->owners;
+  GitDirOwnersPrivate *priv = owners->priv;
+  GitDirOwnersFile *file = worker->file;
+
+  if (file == NULL)
+    return;
+
+  if (error)
+    g_warning ("Failed to blame %s: %s", file->path, error->message);
+  else
+    {
+      guint owner_num, n_owners = git_annotated_source_get_n_owners (source);
+
+      for (owner_num = 0; owner_num < n_owners; owner_num++)
+        {
+          const GitAnnotatedSourceOwner *owner
+            = git_annotated_source_get_owner (source, owner_num);
+
+          git_dir_owners_add_lines (file->node, owner->author,
+                                    owner->n_lines);
+        }
+
+      git_dir_owners_store_cached (file, source);
+    }
+
+  git_dir_owners_file_free (file);
+  worker->file = NULL;
+  priv->n_files_done++;
+
+  g_signal_emit (owners, client_signals[PROGRESS], 0);
+
+  git_dir_owners_queue_run (owners);
+}
+
+/* Gets the node for a directory relative to the root, creating it
+   and its parents if they don't exist yet */
+static GitDirOwnersNode *
+git_dir_owners_get_dir_node (GitDirOwners *owners, const gchar *dir)
+{
+  GitDirOwnersPrivate *priv = owners->priv;
+  GitDirOwnersNode *node, *parent;
+  const gchar *slash;
+  gchar *parent_dir;
+
+  if (*dir == '\0')
+    return priv->root;
+
+  if ((node = g_hash_table_lookup (priv->dir_nodes, dir)))
+    return node;
+
+  if ((slash = strrchr (dir, '/')))
+    {
+      parent_dir = g_strndup (dir, slash - dir);
+      parent = git_dir_owners_get_dir_node (owners, parent_dir);
+      g_free (parent_dir);
+      node = git_dir_owners_node_new (slash + 1, parent, TRUE);
+    }
+  else
+    node = git_dir_owners_node_new (dir, priv->root, TRUE);
+
+  g_hash_table_insert (priv->dir_nodes, g_strdup (dir), node);
+
+  return node;
+}
+
+/* Each line from git-ls-tree -z looks like
+   "<mode> blob <id>\t<path>\0" */
+static gboolean
+git_dir_owners_on_list_line (GitReader *reader,
+                             guint length, const gchar *str,
+                             GitDirOwners *owners)
+{
+  GitDirOwnersPrivate *priv = owners->priv;
+  const gchar *type, *tab, *path, *slash;
+  gsize prefix_len = strlen (priv->prefix);
+  GitDirOwnersFile *file;
+  gchar *full_path, *dir;
+
+  if ((type = memchr (str, ' ', length)) == NULL
+      || (tab = memchr (str, '\t', length)) == NULL
+      || tab - type != strlen (" blob ") + GIT_COMMIT_HASH_LENGTH
+      || strncmp (type, " blob ", strlen (" blob ")))
+    /* Skip submodules and anything we don't understand */
+    return TRUE;
+
+  full_path = g_strndup (tab + 1, str + length - tab - 2);
+
+  if (prefix_len > 0
+      && (strncmp (full_path, priv->prefix, prefix_len)
+          || full_path[prefix_len] != '/'))
+    {
+      g_free (full_path);
+      return TRUE;
+    }
+
+  path = full_path + (prefix_len > 0 ? prefix_len + 1 : 0);
+
+  if ((slash = strrchr (path, '/')))
+    {
+      dir = g_strndup (path, slash - path);
+      slash++;
+    }
+  else
+    {
+      dir = g_strdup ("");
+      slash = path;
+    }
+
+  file = g_slice_new (GitDirOwnersFile);
+  file->node = git_dir_owners_node_new (slash,
+                                        git_dir_owners_get_dir_node (owners,
+                                                                     dir),
+                                        FALSE);
+  file->path = full_path;
+  memcpy (file->blob, type + strlen (" blob "), GIT_COMMIT_HASH_LENGTH);
+  file->blob[GIT_COMMIT_HASH_LENGTH] = '\0';
+
+  g_free (dir);
+
+  priv->n_files++;
+
+  if (git_dir_owners_load_cached (file))
+    {
+      priv->n_files_cached++;
+      priv->n_files_done++;
+      git_dir_owners_file_free (file);
+    }
+  else
+    {
+      g_queue_push_tail (priv->pending, file);
+      git_dir_owners_queue_run (owners);
+    }
+
+  return TRUE;
+}
+
+static void
+git_dir_owners_on_list_completed (GitReader *reader,
+                                  const GError *error,
+                                  GitDirOwners *owners)
+{
+  GitDirOwnersPrivate *priv = owners->priv;
+
+  priv->listing_done = TRUE;
+
+  g_signal_emit (owners, client_signals[PROGRESS], 0);
+
+  if (error)
+    {
+      /* The blames of the files that were listed before the error
+         would otherwise keep running after the completed signal */
+      git_dir_owners_stop_workers (owners);
+      git_dir_owners_finish (owners, error);
+    }
+  else
+    git_dir_owners_queue_run (owners);
+}
+
+/* Starts working out the ownership of all of the files under the
+   directory at path in the given revision or HEAD if revision is
+   NULL. This can only be called once */
+gboolean
+git_dir_owners_start (GitDirOwners *owners,
+                      const gchar *path,
+                      const gchar *revision,
+                      GError **error)
+{
+  GitDirOwnersPrivate *priv;
+  gchar *dot_path, *relative, *root_name;
+  gsize len;
+  int i;
+
+  g_return_val_if_fail (GIT_IS_DIR_OWNERS (owners), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_val_if_fail (path != NULL, FALSE);
+
+  priv = owners->priv;
+
+  g_return_val_if_fail (priv->root == NULL, FALSE);
+
+  /* git_find_repo looks for the repo above the last component so a
+     dot is added to allow the directory itself to be the top of the
+     repo */
+  dot_path = g_build_filename (path, ".", NULL);
+
+  if (!git_find_repo (dot_path, &priv->repo, &relative))
+    {
+      g_set_error (error, GIT_ERROR, GIT_ERROR_NO_REPO,
+                   "No repo found for %s", path);
+      g_free (dot_path);
+
+      return FALSE;
+    }
+
+  g_free (dot_path);
+
+  /* Strip the dot and any separators to get the prefix */
+  len = strlen (relative);
+  if (len > 0 && relative[len - 1] == '.')
+    len--;
+  while (len > 0 && G_IS_DIR_SEPARATOR (relative[len - 1]))
+    len--;
+  relative[len] = '\0';
+  priv->prefix = relative;
+
+  priv->revision = g_strdup (revision ? revision : "HEAD");
+
+  if (len > 0)
+    root_name = g_path_get_basename (priv->prefix);
+  else
+    root_name = g_path_get_basename (priv->repo);
+  priv->root = git_dir_owners_node_new (root_name, NULL, TRUE);
+  g_free (root_name);
+
+  for (i = 0; i < GIT_DIR_OWNERS_MAX_WORKERS; i++)
+    {
+      GitDirOwnersWorker *worker = priv->workers + i;
+
+      worker->owners = owners;
+      worker->source = git_annotated_source_new ();
+      worker->completed_handler
+        = g_signal_connect (worker->source, "completed",
+                            G_CALLBACK (git_dir_owners_on_worker_completed),
+                            worker);
+    }
+
+  return git_reader_start (priv->list_reader, priv->repo, error,
+                           "ls-tree", "-r", "-z", priv->revision, "--",
+                           len > 0 ? priv->prefix : ".", NULL);
+}
+
+const GitDirOwnersNode *
+git_dir_owners_get_root (GitDirOwners *owners)
+{
+  g_return_val_if_fail (GIT_IS_DIR_OWNERS (owners), NULL);
+
+  return owners->priv->root;
+}
+
+void
+git_dir_owners_get_progress (GitDirOwners *owners,
+                             guint *n_files_done,
+                             guint *n_files_cached,
+                             guint *n_files)
+{
+  GitDirOwnersPrivate *priv;
+
+  g_return_if_fail (GIT_IS_DIR_OWNERS (owners));
+
+  priv = owners->priv;
+
+  if (n_files_done)
+    *n_files_done = priv->n_files_done;
+  if (n_files_cached)
+    *n_files_cached = priv->n_files_cached;
+  if (n_files)
+    *n_files = priv->n_files;
+}
+
+/* Returns the author who owns the most lines under the node or NULL
+   if there are no lines */
+const gchar *
+git_dir_owners_node_get_top_author (const GitDirOwnersNode *node,
+                                    guint *n_lines)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  const gchar *top_author = NULL;
+  guint top_lines = 0;
+
+  g_return_val_if_fail (node != NULL, NULL);
+
+  g_hash_table_iter_init (&iter, node->authors);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    if (GPOINTER_TO_UINT (value) > top_lines
+        || (GPOINTER_TO_UINT (value) == top_lines
+            && top_author && strcmp (key, top_author) < 0))
+      {
+        top_author = key;
+        top_lines = GPOINTER_TO_UINT (value);
+      }
+
+  if (n_lines)
+    *n_lines = top_lines;
+
+  return top_author;
+}
@@ -0,0 +1,104 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_DIR_OWNERS_H__
+#define __GIT_DIR_OWNERS_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GIT_TYPE_DIR_OWNERS                                             \
+  (git_dir_owners_get_type())
+#define GIT_DIR_OWNERS(obj)                                             \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                   \
+                               GIT_TYPE_DIR_OWNERS,                     \
+                               GitDirOwners))
+#define GIT_DIR_OWNERS_CLASS(klass)                                     \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            GIT_TYPE_DIR_OWNERS,                        \
+                            GitDirOwnersClass))
+#define GIT_IS_DIR_OWNERS(obj)                                          \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),                                   \
+                               GIT_TYPE_DIR_OWNERS))
+#define GIT_IS_DIR_OWNERS_CLASS(klass)                                  \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),                                    \
+                            GIT_TYPE_DIR_OWNERS))
+#define GIT_DIR_OWNERS_GET_CLASS(obj)                                   \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                    \
+                              GIT_TYPE_DIR_OWNERS,                      \
+                              GitDirOwnersClass))
+
+typedef struct _GitDirOwners        GitDirOwners;
+typedef struct _GitDirOwnersClass   GitDirOwnersClass;
+typedef struct _GitDirOwnersPrivate GitDirOwnersPrivate;
+typedef struct _GitDirOwnersNode    GitDirOwnersNode;
+
+struct _GitDirOwnersClass
+{
+  GObjectClass parent_class;
+
+  void (* completed) (GitDirOwners *owners, const GError *error);
+  void (* progress) (GitDirOwners *owners);
+};
+
+struct _GitDirOwners
+{
+  GObject parent;
+
+  GitDirOwnersPrivate *priv;
+};
+
+struct _GitDirOwnersNode
+{
+  /* Last component of the path */
+  gchar *name;
+  GitDirOwnersNode *parent;
+  /* The nodes in a directory sorted by name or NULL if the node is a
+     file */
+  GPtrArray *children;
+  /* Number of lines in all of the files under the node */
+  guint n_lines;
+  /* Map from the name of each author to the number of lines they
+     own under the node stored with GUINT_TO_POINTER */
+  GHashTable *authors;
+};
+
+/* Maximum number of blames that are run at the same time */
+#define GIT_DIR_OWNERS_MAX_WORKERS 4
+
+GType git_dir_owners_get_type (void) G_GNUC_CONST;
+
+GitDirOwners *git_dir_owners_new (void);
+
+gboolean git_dir_owners_start (GitDirOwners *owners,
+                               const gchar *path,
+                               const gchar *revision,
+                               GError **error);
+
+const GitDirOwnersNode *git_dir_owners_get_root (GitDirOwners *owners);
+void git_dir_owners_get_progress (GitDirOwners *owners,
+                                  guint *n_files_done,
+                                  guint *n_files_cached,
+                                  guint *n_files);
+
+const gchar *git_dir_owners_node_get_top_author (const GitDirOwnersNode *node,
+                                                guint *n_lines);
+
+G_END_DECLS
+
+#endif /* __GIT_DIR_OWNERS_H__ */
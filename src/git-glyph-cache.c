@@ -0,0 +1,279 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The glyph cache keeps a small image for each printable ASCII
+   character so that lines of plain ASCII text in a monospace font can
+   be painted by masking each glyph directly instead of going through
+   Pango's itemization and shaping every time. The cache is only
+   usable if every character has the same whole number of pixels as
+   its advance, otherwise the text would not line up with what Pango
+   paints for the other lines. The digits are always cached so that
+   line numbers can be painted even with a proportional font. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <pango/pangocairo.h>
+#include <cairo.h>
+
+#include "git-glyph-cache.h"
+#include "git-column-map.h"
+
+#define GIT_GLYPH_CACHE_FIRST_CHAR ' '
+#define GIT_GLYPH_CACHE_LAST_CHAR  '~'
+#define GIT_GLYPH_CACHE_N_GLYPHS \
+  (GIT_GLYPH_CACHE_LAST_CHAR - GIT_GLYPH_CACHE_FIRST_CHAR + 1)
+
+typedef struct _GitGlyphCacheGlyph GitGlyphCacheGlyph;
+
+struct _GitGlyphCacheGlyph
+{
+  /* Image of the glyph or NULL if it has no ink */
+  cairo_surface_t *surface;
+  /* Position of the image relative to the top left of the logical
+     rectangle of the character */
+  gint x, y;
+};
+
+struct _GitGlyphCache
+{
+  gboolean is_monospace;
+  gint advance;
+  /* Width of the widest digit */
+  gint digit_width;
+
+  GitGlyphCacheGlyph glyphs[GIT_GLYPH_CACHE_N_GLYPHS];
+};
+
+static void
+git_glyph_cache_render_glyph (GitGlyphCacheGlyph *glyph,
+                              PangoLayout *layout,
+                              const PangoRectangle *ink_rect)
+{
+  cairo_t *cr;
+
+  if (ink_rect->width <= 0 || ink_rect->height <= 0)
+    return;
+
+  glyph->x = ink_rect->x;
+  glyph->y = ink_rect->y;
+
+  /* Only the alpha is needed because the glyph is used as a mask
+     with the colour of the text */
+  glyph->surface = cairo_image_surface_create (CAIRO_FORMAT_A8,
+                                               ink_rect->width,
+                                               ink_rect->height);
+
+  cr = cairo_create (glyph->surface);
+  cairo_move_to (cr, -ink_rect->x, -ink_rect->y);
+  pango_cairo_show_layout (cr, layout);
+  cairo_destroy (cr);
+}
+
+GitGlyphCache *
+git_glyph_cache_new (PangoContext *context)
+{
+  GitGlyphCache *cache;
+  PangoLayout *layout;
+  PangoRectangle ink_rect, logical_rect;
+  gint i, advance = -1;
+  gchar ch;
+
+  g_return_val_if_fail (context != NULL, NULL);
+
+  cache = g_slice_new0 (GitGlyphCache);
+  cache->is_monospace = TRUE;
+
+  layout = pango_layout_new (context);
+
+  /* First measure every character to check whether the font is
+     monospace so that nothing is rendered if it isn't */
+  for (i = 0; i < GIT_GLYPH_CACHE_N_GLYPHS; i++)
+    {
+      ch = GIT_GLYPH_CACHE_FIRST_CHAR + i;
+      pango_layout_set_text (layout, &ch, 1);
+      pango_layout_get_extents (layout, NULL, &logical_rect);
+
+      if ((advance != -1 && logical_rect.width != advance)
+          || logical_rect.width % PANGO_SCALE)
+        {
+          cache->is_monospace = FALSE;
+          break;
+        }
+
+      advance = logical_rect.width;
+    }
+
+  if (cache->is_monospace)
+    cache->advance = advance / PANGO_SCALE;
+
+  for (i = 0; i < GIT_GLYPH_CACHE_N_GLYPHS; i++)
+    {
+      ch = GIT_GLYPH_CACHE_FIRST_CHAR + i;
+
+      if (!cache->is_monospace && !g_ascii_isdigit (ch))
+        continue;
+
+      pango_layout_set_text (layout, &ch, 1);
+      pango_layout_get_pixel_extents (layout, &ink_rect, &logical_rect);
+      git_glyph_cache_render_glyph (cache->glyphs + i, layout, &ink_rect);
+
+      if (g_ascii_isdigit (ch) && logical_rect.width > cache->digit_width)
+        cache->digit_width = logical_rect.width;
+    }
+
+  g_object_unref (layout);
+
+  return cache;
+}
+
+void
+git_glyph_cache_free (GitGlyphCache *cache)
+{
+  gint i;
+
+  g_return_if_fail (cache != NULL);
+
+  for (i = 0; i < GIT_GLYPH_CACHE_N_GLYPHS; i++)
+    if (cache->glyphs[i].surface)
+      cairo_surface_destroy (cache->glyphs[i].surface);
+
+  g_slice_free (GitGlyphCache, cache);
+}
+
+gboolean
+git_glyph_cache_is_monospace (GitGlyphCache *cache)
+{
+  g_return_val_if_fail (cache != NULL, FALSE);
+
+  return cache->is_monospace;
+}
+
+gint
+git_glyph_cache_get_advance (GitGlyphCache *cache)
+{
+  g_return_val_if_fail (cache != NULL, 0);
+
+  return cache->advance;
+}
+
+/* Checks whether all of the characters in the text have a glyph in
+   the cache so that the text can be drawn in pieces without having
+   to fall back to Pango half way through */
+gboolean
+git_glyph_cache_can_draw (GitGlyphCache *cache,
+                          const gchar *text,
+                          gsize length)
+{
+  gsize i;
+
+  g_return_val_if_fail (cache != NULL, FALSE);
+
+  if (!cache->is_monospace)
+    return FALSE;
+
+  for (i = 0; i < length; i++)
+    if (text[i] != '\t'
+        && (text[i] < GIT_GLYPH_CACHE_FIRST_CHAR
+            || text[i] > GIT_GLYPH_CACHE_LAST_CHAR))
+      return FALSE;
+
+  return TRUE;
+}
+
+/* Paints some text with the logical rectangle of the character in
+   column 0 at x,y using the current source of the cairo context. The
+   first byte of the text is painted at the given column so that
+   a visible range of a line can be painted with the tab stops in the
+   right place. If the text contains anything other than printable
+   ASCII characters and tabs then nothing is painted and FALSE is
+   returned so that the caller can fall back to Pango */
+gboolean
+git_glyph_cache_draw (GitGlyphCache *cache,
+                      cairo_t *cr,
+                      gint x, gint y,
+                      guint column,
+                      const gchar *text,
+                      gsize length)
+{
+  gsize i;
+
+  g_return_val_if_fail (cache != NULL, FALSE);
+
+  if (!git_glyph_cache_can_draw (cache, text, length))
+    return FALSE;
+
+  for (i = 0; i < length; i++)
+    {
+      if (text[i] == '\t')
+        column = (column / GIT_COLUMN_MAP_TAB_WIDTH + 1)
+          * GIT_COLUMN_MAP_TAB_WIDTH;
+      else
+        {
+          GitGlyphCacheGlyph *glyph
+            = cache->glyphs + text[i] - GIT_GLYPH_CACHE_FIRST_CHAR;
+
+          if (glyph->surface)
+            cairo_mask_surface (cr, glyph->surface,
+                                x + column * cache->advance + glyph->x,
+                                y + glyph->y);
+
+          column++;
+        }
+    }
+
+  return TRUE;
+}
+
+gint
+git_glyph_cache_get_digit_width (GitGlyphCache *cache)
+{
+  g_return_val_if_fail (cache != NULL, 0);
+
+  return cache->digit_width;
+}
+
+/* Paints a number so that its right edge is at x. Each digit is
+   given the width of the widest digit so that the numbers on each
+   line line up */
+void
+git_glyph_cache_draw_number (GitGlyphCache *cache,
+                             cairo_t *cr,
+                             gint x, gint y,
+                             guint number)
+{
+  gchar buf[16];
+  gint length, i;
+
+  g_return_if_fail (cache != NULL);
+
+  length = g_snprintf (buf, sizeof (buf), "%u", number);
+  x -= length * cache->digit_width;
+
+  for (i = 0; i < length; i++)
+    {
+      GitGlyphCacheGlyph *glyph
+        = cache->glyphs + buf[i] - GIT_GLYPH_CACHE_FIRST_CHAR;
+
+      if (glyph->surface)
+        cairo_mask_surface (cr, glyph->surface,
+                            x + i * cache->digit_width + glyph->x,
+                            y + glyph->y);
+    }
+}
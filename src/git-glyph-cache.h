@@ -0,0 +1,52 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_GLYPH_CACHE_H__
+#define __GIT_GLYPH_CACHE_H__
+
+#include <glib.h>
+#include <pango/pango.h>
+#include <cairo.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GitGlyphCache GitGlyphCache;
+
+GitGlyphCache *git_glyph_cache_new (PangoContext *context);
+void git_glyph_cache_free (GitGlyphCache *cache);
+
+gboolean git_glyph_cache_is_monospace (GitGlyphCache *cache);
+gint git_glyph_cache_get_advance (GitGlyphCache *cache);
+gint git_glyph_cache_get_digit_width (GitGlyphCache *cache);
+
+gboolean git_glyph_cache_can_draw (GitGlyphCache *cache,
+                                   const gchar *text,
+                                   gsize length);
+gboolean git_glyph_cache_draw (GitGlyphCache *cache,
+                               cairo_t *cr,
+                               gint x, gint y,
+                               guint column,
+                               const gchar *text,
+                               gsize length);
+void git_glyph_cache_draw_number (GitGlyphCache *cache,
+                                  cairo_t *cr,
+                                  gint x, gint y,
+                                  guint number);
+
+G_END_DECLS
+
+#endif /* __GIT_GLYPH_CACHE_H__ */
@@ -0,0 +1,421 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <string.h>
+
+#include "git-highlight-language.h"
+
+/* States for the C-like languages */
+enum
+  {
+    GIT_HIGHLIGHT_C_NORMAL,
+    GIT_HIGHLIGHT_C_COMMENT
+  };
+
+/* States for the languages with hash comments */
+enum
+  {
+    GIT_HIGHLIGHT_SCRIPT_NORMAL,
+    GIT_HIGHLIGHT_SCRIPT_DOUBLE_QUOTES,
+    GIT_HIGHLIGHT_SCRIPT_SINGLE_QUOTES
+  };
+
+/* These must be kept in ASCII order for the binary search */
+static const gchar * const
+git_highlight_c_keywords[] =
+  {
+    "NULL", "async", "auto", "await", "break", "case", "catch", "class",
+    "const", "constexpr", "continue", "default", "delete", "do", "else",
+    "enum", "explicit", "extends", "extern", "false", "final", "finally",
+    "for", "friend", "function", "goto", "if", "implements", "import",
+    "inline", "instanceof", "interface", "let", "namespace", "new",
+    "noexcept", "null", "nullptr", "operator", "override", "package",
+    "private", "protected", "public", "register", "restrict", "return",
+    "sizeof", "static", "static_cast", "struct", "switch", "template",
+    "this", "throw", "true", "try", "typedef", "typename", "union",
+    "using", "var", "virtual", "volatile", "while", "yield"
+  };
+
+static const gchar * const
+git_highlight_c_types[] =
+  {
+    "bool", "boolean", "byte", "char", "double", "float", "gboolean",
+    "gchar", "gconstpointer", "gdouble", "gfloat", "gint", "gint16",
+    "gint32", "gint64", "gint8", "gpointer", "gsize", "gssize", "guint",
+    "guint16", "guint32", "guint64", "guint8", "int", "int16_t", "int32_t",
+    "int64_t", "int8_t", "long", "short", "signed", "size_t", "ssize_t",
+    "string", "uint16_t", "uint32_t", "uint64_t", "uint8_t", "unsigned",
+    "void"
+  };
+
+static const gchar * const
+git_highlight_script_keywords[] =
+  {
+    "False", "None", "True", "and", "as", "assert", "begin", "break",
+    "case", "class", "continue", "def", "del", "do", "done", "echo",
+    "elif", "else", "elsif", "end", "esac", "except", "exit", "export",
+    "fi", "finally", "for", "from", "function", "global", "if", "import",
+    "in", "is", "lambda", "local", "module", "my", "not", "or", "pass",
+    "raise", "read", "require", "return", "self", "set", "shift", "source",
+    "sub", "then", "try", "unless", "until", "use", "while", "with",
+    "yield"
+  };
+
+static const gchar * const
+git_highlight_c_patterns[] =
+  {
+    "*.c", "*.h", "*.cc", "*.cpp", "*.cxx", "*.hh", "*.hpp", "*.hxx",
+    "*.C", "*.H", "*.m", "*.java", "*.js", "*.cs", "*.vala", "*.go",
+    NULL
+  };
+
+static const gchar * const
+git_highlight_script_patterns[] =
+  {
+    "*.sh", "*.py", "*.pl", "*.pm", "*.rb", "*.mk", "*.am", "*.ac",
+    "*.cmake", "*.yml", "*.yaml", "*.conf", "Makefile", "GNUmakefile",
+    "CMakeLists.txt", "configure", "*.spec",
+    NULL
+  };
+
+static guint git_highlight_c_line (guint state, const gchar *text,
+                                   gsize length, GArray *runs);
+static guint git_highlight_script_line (guint state, const gchar *text,
+                                        gsize length, GArray *runs);
+
+static const GitHighlightLanguage
+git_highlight_builtin_languages[] =
+  {
+    { "C", git_highlight_c_patterns, git_highlight_c_line },
+    { "Script", git_highlight_script_patterns, git_highlight_script_line }
+  };
+
+/* Languages added with git_highlight_language_register. These are
+   searched before the builtin languages */
+static GSList *git_highlight_languages = NULL;
+
+/* Appends a run for the given range of bytes. Runs longer than can
+   be stored are split and adjacent runs in the same style are
+   merged */
+void
+git_highlight_add_run (GArray *runs, gsize start, gsize end,
+                       GitHighlightStyle style)
+{
+  GitHighlightRun run;
+
+  g_return_if_fail (runs != NULL);
+
+  while (start < end)
+    {
+      if (runs->len > 0)
+        {
+          GitHighlightRun *last = &g_array_index (runs, GitHighlightRun,
+                                                  runs->len - 1);
+
+          if (last->style == style && last->start + last->length == start
+              && last->length < G_MAXUINT16)
+            {
+              gsize extra = MIN (end - start, G_MAXUINT16 - last->length);
+
+              last->length += extra;
+              start += extra;
+              continue;
+            }
+        }
+
+      run.start = start;
+      run.length = MIN (end - start, G_MAXUINT16);
+      run.style = style;
+      g_array_append_val (runs, run);
+
+      start += run.length;
+    }
+}
+
+static gboolean
+git_highlight_is_word (const gchar * const *words, guint n_words,
+                       const gchar *text, gsize length)
+{
+  guint min = 0, max = n_words;
+
+  while (max > min)
+    {
+      guint mid = (min + max) / 2;
+      gsize word_length = strlen (words[mid]);
+      int cmp = memcmp (text, words[mid], MIN (length, word_length));
+
+      if (cmp == 0)
+        cmp = length < word_length ? -1 : length > word_length ? 1 : 0;
+
+      if (cmp == 0)
+        return TRUE;
+      else if (cmp < 0)
+        max = mid;
+      else
+        min = mid + 1;
+    }
+
+  return FALSE;
+}
+
+/* Finds a delimiter in the text and returns the offset after it or
+   -1 if it wasn't found */
+static gssize
+git_highlight_find_end (const gchar *text, gsize start, gsize length,
+                        const gchar *delim)
+{
+  gsize delim_length = strlen (delim), i;
+
+  for (i = start; i + delim_length <= length; i++)
+    if (text[i] == '\\' && delim_length == 1)
+      i++;
+    else if (memcmp (text + i, delim, delim_length) == 0)
+      return i + delim_length;
+
+  return -1;
+}
+
+/* Handles the tokens that are common to all of the languages.
+   Returns the offset after the token */
+static gsize
+git_highlight_common_token (const gchar *text, gsize i, gsize length,
+                            const gchar * const *keywords, guint n_keywords,
+                            const gchar * const *types, guint n_types,
+                            GArray *runs)
+{
+  gsize start = i;
+
+  if (text[i] == '"' || text[i] == '\'')
+    {
+      gchar delim[2] = { text[i], '\0' };
+      gssize end = git_highlight_find_end (text, i + 1, length, delim);
+
+      i = end < 0 ? length : end;
+      git_highlight_add_run (runs, start, i, GIT_HIGHLIGHT_STYLE_STRING);
+    }
+  else if (g_ascii_isdigit (text[i]))
+    {
+      while (i < length && (g_ascii_isalnum (text[i]) || text[i] == '.'))
+        i++;
+      git_highlight_add_run (runs, start, i, GIT_HIGHLIGHT_STYLE_NUMBER);
+    }
+  else if (g_ascii_isalpha (text[i]) || text[i] == '_')
+    {
+      while (i < length && (g_ascii_isalnum (text[i]) || text[i] == '_'))
+        i++;
+
+      if (git_highlight_is_word (keywords, n_keywords, text + start,
+                                 i - start))
+        git_highlight_add_run (runs, start, i, GIT_HIGHLIGHT_STYLE_KEYWORD);
+      else if (types
+               && git_highlight_is_word (types, n_types, text + start,
+                                         i - start))
+        git_highlight_add_run (runs, start, i, GIT_HIGHLIGHT_STYLE_TYPE);
+    }
+  else
+    i++;
+
+  return i;
+}
+
+static guint
+git_highlight_c_line (guint state, const gchar *text, gsize length,
+                      GArray *runs)
+{
+  gsize i = 0, start;
+  gssize end;
+
+  if (state == GIT_HIGHLIGHT_C_COMMENT)
+    {
+      if ((end = git_highlight_find_end (text, 0, length, "*/")) < 0)
+        {
+          git_highlight_add_run (runs, 0, length,
+                                 GIT_HIGHLIGHT_STYLE_COMMENT);
+          return GIT_HIGHLIGHT_C_COMMENT;
+        }
+
+      git_highlight_add_run (runs, 0, end, GIT_HIGHLIGHT_STYLE_COMMENT);
+      i = end;
+    }
+  else
+    {
+      /* Highlight the directive of preprocessor lines */
+      while (i < length && (text[i] == ' ' || text[i] == '\t'))
+        i++;
+      if (i < length && text[i] == '#')
+        {
+          start = i++;
+          while (i < length && (text[i] == ' ' || text[i] == '\t'))
+            i++;
+          while (i < length && g_ascii_isalpha (text[i]))
+            i++;
+          git_highlight_add_run (runs, start, i,
+                                 GIT_HIGHLIGHT_STYLE_PREPROCESSOR);
+        }
+    }
+
+  while (i < length)
+    {
+      if (text[i] == '/' && i + 1 < length && text[i + 1] == '/')
+        {
+          git_highlight_add_run (runs, i, length, GIT_HIGHLIGHT_STYLE_COMMENT);
+          break;
+        }
+      else if (text[i] == '/' && i + 1 < length && text[i + 1] == '*')
+        {
+          start = i;
+          if ((end = git_highlight_find_end (text, i + 2, length, "*/")) < 0)
+            {
+              git_highlight_add_run (runs, start, length,
+                                     GIT_HIGHLIGHT_STYLE_COMMENT);
+              return GIT_HIGHLIGHT_C_COMMENT;
+            }
+          git_highlight_add_run (runs, start, end,
+                                 GIT_HIGHLIGHT_STYLE_COMMENT);
+          i = end;
+        }
+      else
+        i = git_highlight_common_token
+          (text, i, length,
+           git_highlight_c_keywords,
+           G_N_ELEMENTS (git_highlight_c_keywords),
+           git_highlight_c_types,
+           G_N_ELEMENTS (git_highlight_c_types),
+           runs);
+    }
+
+  return GIT_HIGHLIGHT_C_NORMAL;
+}
+
+static guint
+git_highlight_script_line (guint state, const gchar *text, gsize length,
+                           GArray *runs)
+{
+  gsize i = 0, start;
+  gssize end;
+
+  /* Continue a triple-quoted string from the previous line */
+  if (state != GIT_HIGHLIGHT_SCRIPT_NORMAL)
+    {
+      const gchar *delim = (state == GIT_HIGHLIGHT_SCRIPT_DOUBLE_QUOTES
+                            ? "\"\"\"" : "'''");
+
+      if ((end = git_highlight_find_end (text, 0, length, delim)) < 0)
+        {
+          git_highlight_add_run (runs, 0, length, GIT_HIGHLIGHT_STYLE_STRING);
+          return state;
+        }
+
+      git_highlight_add_run (runs, 0, end, GIT_HIGHLIGHT_STYLE_STRING);
+      i = end;
+    }
+
+  while (i < length)
+    {
+      if (text[i] == '#')
+        {
+          git_highlight_add_run (runs, i, length, GIT_HIGHLIGHT_STYLE_COMMENT);
+          break;
+        }
+      else if (i + 2 < length
+               && (text[i] == '"' || text[i] == '\'')
+               && text[i + 1] == text[i] && text[i + 2] == text[i])
+        {
+          const gchar *delim = text[i] == '"' ? "\"\"\"" : "'''";
+
+          start = i;
+          if ((end = git_highlight_find_end (text, i + 3, length, delim)) < 0)
+            {
+              git_highlight_add_run (runs, start, length,
+                                     GIT_HIGHLIGHT_STYLE_STRING);
+              return (text[start] == '"'
+                      ? GIT_HIGHLIGHT_SCRIPT_DOUBLE_QUOTES
+                      : GIT_HIGHLIGHT_SCRIPT_SINGLE_QUOTES);
+            }
+          git_highlight_add_run (runs, start, end, GIT_HIGHLIGHT_STYLE_STRING);
+          i = end;
+        }
+      else
+        i = git_highlight_common_token
+          (text, i, length,
+           git_highlight_script_keywords,
+           G_N_ELEMENTS (git_highlight_script_keywords),
+           NULL, 0,
+           runs);
+    }
+
+  return GIT_HIGHLIGHT_SCRIPT_NORMAL;
+}
+
+/* Adds a language that will be used for files matching its
+   patterns. The language is not copied so it must remain valid */
+void
+git_highlight_language_register (const GitHighlightLanguage *language)
+{
+  g_return_if_fail (language != NULL);
+  g_return_if_fail (language->highlight_line != NULL);
+
+  git_highlight_languages = g_slist_prepend (git_highlight_languages,
+                                             (gpointer) language);
+}
+
+static gboolean
+git_highlight_language_matches (const GitHighlightLanguage *language,
+                                const gchar *basename)
+{
+  const gchar * const *pattern;
+
+  for (pattern = language->patterns; pattern && *pattern; pattern++)
+    if (g_pattern_match_simple (*pattern, basename))
+      return TRUE;
+
+  return FALSE;
+}
+
+/* Finds the language to highlight a file with or returns NULL if the
+   file shouldn't be highlighted */
+const GitHighlightLanguage *
+git_highlight_language_for_filename (const gchar *filename)
+{
+  const GitHighlightLanguage *ret = NULL;
+  gchar *basename;
+  GSList *node;
+  guint i;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+
+  basename = g_path_get_basename (filename);
+
+  for (node = git_highlight_languages; node && ret == NULL; node = node->next)
+    if (git_highlight_language_matches (node->data, basename))
+      ret = node->data;
+
+  for (i = 0; i < G_N_ELEMENTS (git_highlight_builtin_languages)
+         && ret == NULL; i++)
+    if (git_highlight_language_matches (git_highlight_builtin_languages + i,
+                                        basename))
+      ret = git_highlight_builtin_languages + i;
+
+  g_free (basename);
+
+  return ret;
+}
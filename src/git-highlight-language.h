@@ -0,0 +1,78 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_HIGHLIGHT_LANGUAGE_H__
+#define __GIT_HIGHLIGHT_LANGUAGE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GitHighlightRun      GitHighlightRun;
+typedef struct _GitHighlightLanguage GitHighlightLanguage;
+
+typedef enum {
+  GIT_HIGHLIGHT_STYLE_NONE,
+  GIT_HIGHLIGHT_STYLE_KEYWORD,
+  GIT_HIGHLIGHT_STYLE_TYPE,
+  GIT_HIGHLIGHT_STYLE_STRING,
+  GIT_HIGHLIGHT_STYLE_COMMENT,
+  GIT_HIGHLIGHT_STYLE_NUMBER,
+  GIT_HIGHLIGHT_STYLE_PREPROCESSOR,
+
+  GIT_HIGHLIGHT_N_STYLES
+} GitHighlightStyle;
+
+/* A range of bytes in a line that are drawn in the same style. Bytes
+   that aren't covered by a run have no style */
+struct _GitHighlightRun
+{
+  guint32 start;
+  guint16 length;
+  guint8 style;
+};
+
+/* Highlights one line of text and appends the runs to the array. The
+   state is an opaque value passed between lines, for example to
+   remember that the line starts inside a comment. The first line
+   always gets state 0. Returns the state at the end of the line.
+   This is called from the highlighter's thread so it must not touch
+   any global data */
+typedef guint (* GitHighlightLineFunc) (guint state,
+                                        const gchar *text,
+                                        gsize length,
+                                        GArray *runs);
+
+struct _GitHighlightLanguage
+{
+  const gchar *name;
+  /* NULL-terminated list of glob patterns for the base name of files
+     in this language */
+  const gchar * const *patterns;
+  GitHighlightLineFunc highlight_line;
+};
+
+void git_highlight_language_register (const GitHighlightLanguage *language);
+const GitHighlightLanguage *
+git_highlight_language_for_filename (const gchar *filename);
+
+void git_highlight_add_run (GArray *runs, gsize start, gsize end,
+                            GitHighlightStyle style);
+
+G_END_DECLS
+
+#endif /* __GIT_HIGHLIGHT_LANGUAGE_H__ */
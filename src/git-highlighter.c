@@ -0,0 +1,425 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The highlighter runs the line-state machine of a language over all
+   of the lines of a source in a separate thread. The lines are split
+   into blocks and the state at the start of each block is remembered.
+   When the visible lines haven't been highlighted yet their blocks
+   are done first using a guess of the starting state. The main pass
+   then goes through the file in order and only redoes a block if the
+   guess turned out to be wrong. The runs are handed back to the main
+   thread in an idle handler which stores them in the source lines */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib-object.h>
+
+#include "git-highlighter.h"
+#include "git-annotated-source.h"
+#include "git-marshal.h"
+
+static void git_highlighter_dispose (GObject *object);
+static void git_highlighter_finalize (GObject *object);
+
+G_DEFINE_TYPE (GitHighlighter, git_highlighter, G_TYPE_OBJECT);
+
+#define GIT_HIGHLIGHTER_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_HIGHLIGHTER, \
+                                GitHighlighterPrivate))
+
+typedef struct _GitHighlighterBlock  GitHighlighterBlock;
+typedef struct _GitHighlighterResult GitHighlighterResult;
+
+struct _GitHighlighterPrivate
+{
+  GitAnnotatedSource *source;
+  const GitHighlightLanguage *language;
+  guint n_lines, n_blocks;
+
+  GThread *thread;
+
+  /* The blocks are only touched by the thread */
+  GitHighlighterBlock *blocks;
+
+  /* Everything below is protected by the mutex */
+  GMutex *mutex;
+  gboolean cancelled;
+  /* Range of blocks that are visible or -1 */
+  gint visible_first, visible_last;
+  /* Queue of GitHighlighterResults waiting for the main thread */
+  GQueue *results;
+  guint results_idle;
+};
+
+typedef enum
+  {
+    /* The block has runs in the source */
+    GIT_HIGHLIGHTER_BLOCK_DONE = 1 << 0,
+    /* The start state is known to be right */
+    GIT_HIGHLIGHTER_BLOCK_EXACT = 1 << 1
+  } GitHighlighterBlockFlags;
+
+struct _GitHighlighterBlock
+{
+  guint start_state, end_state;
+  GitHighlighterBlockFlags flags;
+};
+
+struct _GitHighlighterResult
+{
+  guint first_line, n_lines;
+  GitHighlightRun **runs;
+  guint *n_runs;
+};
+
+enum
+  {
+    CHANGED,
+
+    LAST_SIGNAL
+  };
+
+static guint client_signals[LAST_SIGNAL];
+
+/* Number of lines between each saved state */
+#define GIT_HIGHLIGHTER_BLOCK_SIZE 64
+
+static void
+git_highlighter_class_init (GitHighlighterClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->dispose = git_highlighter_dispose;
+  gobject_class->finalize = git_highlighter_finalize;
+
+  client_signals[CHANGED]
+    = g_signal_new ("changed",
+                    G_TYPE_FROM_CLASS (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitHighlighterClass, changed),
+                    NULL, NULL,
+                    _git_marshal_VOID__UINT_UINT,
+                    G_TYPE_NONE, 2,
+                    G_TYPE_UINT,
+                    G_TYPE_UINT);
+
+  g_type_class_add_private (klass, sizeof (GitHighlighterPrivate));
+}
+
+static void
+git_highlighter_init (GitHighlighter *self)
+{
+  GitHighlighterPrivate *priv;
+
+  priv = self->priv = GIT_HIGHLIGHTER_GET_PRIVATE (self);
+
+  priv->mutex = g_mutex_new ();
+  priv->results = g_queue_new ();
+  priv->visible_first = -1;
+  priv->visible_last = -1;
+}
+
+static void
+git_highlighter_free_result (GitHighlighterResult *result)
+{
+  guint i;
+
+  for (i = 0; i < result->n_lines; i++)
+    g_free (result->runs[i]);
+  g_free (result->runs);
+  g_free (result->n_runs);
+
+  g_slice_free (GitHighlighterResult, result);
+}
+
+static void
+git_highlighter_stop (GitHighlighter *highlighter)
+{
+  GitHighlighterPrivate *priv = highlighter->priv;
+  GitHighlighterResult *result;
+
+  if (priv->thread)
+    {
+      g_mutex_lock (priv->mutex);
+      priv->cancelled = TRUE;
+      g_mutex_unlock (priv->mutex);
+
+      /* The thread checks the flag between each block so this won't
+         wait long */
+      g_thread_join (priv->thread);
+      priv->thread = NULL;
+    }
+
+  if (priv->results_idle)
+    {
+      g_source_remove (priv->results_idle);
+      priv->results_idle = 0;
+    }
+
+  while ((result = g_queue_pop_head (priv->results)))
+    git_highlighter_free_result (result);
+}
+
+static void
+git_highlighter_dispose (GObject *object)
+{
+  GitHighlighter *self = (GitHighlighter *) object;
+  GitHighlighterPrivate *priv = self->priv;
+
+  git_highlighter_stop (self);
+
+  if (priv->source)
+    {
+      g_object_unref (priv->source);
+      priv->source = NULL;
+    }
+
+  G_OBJECT_CLASS (git_highlighter_parent_class)->dispose (object);
+}
+
+static void
+git_highlighter_finalize (GObject *object)
+{
+  GitHighlighter *self = (GitHighlighter *) object;
+  GitHighlighterPrivate *priv = self->priv;
+
+  g_free (priv->blocks);
+  g_queue_free (priv->results);
+  g_mutex_free (priv->mutex);
+
+  G_OBJECT_CLASS (git_highlighter_parent_class)->finalize (object);
+}
+
+/* Creates a highlighter for a source that has finished loading */
+GitHighlighter *
+git_highlighter_new (GitAnnotatedSource *source,
+                     const GitHighlightLanguage *language)
+{
+  GitHighlighter *self;
+  GitHighlighterPrivate *priv;
+
+  g_return_val_if_fail (GIT_IS_ANNOTATED_SOURCE (source), NULL);
+  g_return_val_if_fail (language != NULL, NULL);
+
+  self = g_object_new (GIT_TYPE_HIGHLIGHTER, NULL);
+  priv = self->priv;
+
+  priv->source = g_object_ref (source);
+  priv->language = language;
+  priv->n_lines = git_annotated_source_get_n_lines (source);
+  priv->n_blocks = (priv->n_lines + GIT_HIGHLIGHTER_BLOCK_SIZE - 1)
+    / GIT_HIGHLIGHTER_BLOCK_SIZE;
+  priv->blocks = g_new0 (GitHighlighterBlock, priv->n_blocks);
+
+  return self;
+}
+
+static gboolean
+git_highlighter_on_results (gpointer data)
+{
+  GitHighlighter *highlighter = (GitHighlighter *) data;
+  GitHighlighterPrivate *priv = highlighter->priv;
+  GQueue results = G_QUEUE_INIT;
+  GitHighlighterResult *result;
+  guint i;
+
+  g_mutex_lock (priv->mutex);
+  results = *priv->results;
+  g_queue_init (priv->results);
+  priv->results_idle = 0;
+  g_mutex_unlock (priv->mutex);
+
+  while ((result = g_queue_pop_head (&results)))
+    {
+      /* The runs are given to the source */
+      for (i = 0; i < result->n_lines; i++)
+        {
+          git_annotated_source_set_line_runs (priv->source,
+                                              result->first_line + i,
+                                              result->runs[i],
+                                              result->n_runs[i]);
+          result->runs[i] = NULL;
+        }
+
+      g_signal_emit (highlighter, client_signals[CHANGED], 0,
+                     result->first_line, result->n_lines);
+
+      git_highlighter_free_result (result);
+    }
+
+  return FALSE;
+}
+
+/* Runs the state machine over a block and queues the runs for the
+   main thread. Called from the thread */
+static void
+git_highlighter_do_block (GitHighlighter *highlighter, guint block_num,
+                          guint state)
+{
+  GitHighlighterPrivate *priv = highlighter->priv;
+  GitHighlighterBlock *block = priv->blocks + block_num;
+  GitHighlighterResult *result;
+  GArray *runs;
+  guint i;
+
+  result = g_slice_new (GitHighlighterResult);
+  result->first_line = block_num * GIT_HIGHLIGHTER_BLOCK_SIZE;
+  result->n_lines = MIN (GIT_HIGHLIGHTER_BLOCK_SIZE,
+                         priv->n_lines - result->first_line);
+  result->runs = g_new (GitHighlightRun *, result->n_lines);
+  result->n_runs = g_new (guint, result->n_lines);
+
+  block->start_state = state;
+
+  runs = g_array_new (FALSE, FALSE, sizeof (GitHighlightRun));
+
+  for (i = 0; i < result->n_lines; i++)
+    {
+      /* Getting the line is safe from this thread. Loading the text
+         of a cached line is guarded by a lock in the source */
+      const GitAnnotatedSourceLine *line
+        = git_annotated_source_get_line (priv->source,
+                                         result->first_line + i);
+
+      g_array_set_size (runs, 0);
+      state = priv->language->highlight_line (state, line->text,
+                                              line->text_length, runs);
+
+      result->n_runs[i] = runs->len;
+      result->runs[i] = (runs->len
+                         ? g_memdup (runs->data,
+                                     runs->len * sizeof (GitHighlightRun))
+                         : NULL);
+    }
+
+  g_array_free (runs, TRUE);
+
+  block->end_state = state;
+  block->flags |= GIT_HIGHLIGHTER_BLOCK_DONE;
+
+  g_mutex_lock (priv->mutex);
+  g_queue_push_tail (priv->results, result);
+  if (priv->results_idle == 0)
+    priv->results_idle = g_idle_add (git_highlighter_on_results, highlighter);
+  g_mutex_unlock (priv->mutex);
+}
+
+static gpointer
+git_highlighter_thread_func (gpointer data)
+{
+  GitHighlighter *highlighter = (GitHighlighter *) data;
+  GitHighlighterPrivate *priv = highlighter->priv;
+  guint next_exact = 0, exact_state = 0;
+
+  while (next_exact < priv->n_blocks)
+    {
+      gint visible_first, visible_last, block_num = -1, i;
+      GitHighlighterBlock *block;
+
+      g_mutex_lock (priv->mutex);
+      if (priv->cancelled)
+        {
+          g_mutex_unlock (priv->mutex);
+          break;
+        }
+      visible_first = priv->visible_first;
+      visible_last = priv->visible_last;
+      g_mutex_unlock (priv->mutex);
+
+      /* Look for a visible block that hasn't been done yet */
+      for (i = MAX (visible_first, 0);
+           visible_first >= 0 && i <= visible_last && block_num < 0; i++)
+        if (!(priv->blocks[i].flags & GIT_HIGHLIGHTER_BLOCK_DONE))
+          block_num = i;
+
+      if (block_num >= 0)
+        {
+          guint state;
+
+          /* Guess the state from the block before or use the known
+             state if this is the next block anyway */
+          if (block_num == next_exact)
+            state = exact_state;
+          else if (block_num > 0
+                   && (priv->blocks[block_num - 1].flags
+                       & GIT_HIGHLIGHTER_BLOCK_DONE))
+            state = priv->blocks[block_num - 1].end_state;
+          else
+            state = 0;
+
+          git_highlighter_do_block (highlighter, block_num, state);
+          continue;
+        }
+
+      block = priv->blocks + next_exact;
+
+      /* The block only needs highlighting again if the guessed state
+         was wrong */
+      if (!(block->flags & GIT_HIGHLIGHTER_BLOCK_DONE)
+          || block->start_state != exact_state)
+        git_highlighter_do_block (highlighter, next_exact, exact_state);
+
+      block->flags |= GIT_HIGHLIGHTER_BLOCK_EXACT;
+      exact_state = block->end_state;
+      next_exact++;
+    }
+
+  return NULL;
+}
+
+gboolean
+git_highlighter_start (GitHighlighter *highlighter, GError **error)
+{
+  GitHighlighterPrivate *priv;
+
+  g_return_val_if_fail (GIT_IS_HIGHLIGHTER (highlighter), FALSE);
+
+  priv = highlighter->priv;
+
+  g_return_val_if_fail (priv->thread == NULL, FALSE);
+
+  priv->thread = g_thread_create (git_highlighter_thread_func, highlighter,
+                                  TRUE, error);
+
+  return priv->thread != NULL;
+}
+
+/* Tells the highlighter which lines are on screen so that they can
+   be highlighted first */
+void
+git_highlighter_set_visible_lines (GitHighlighter *highlighter,
+                                   guint first_line,
+                                   guint last_line)
+{
+  GitHighlighterPrivate *priv;
+
+  g_return_if_fail (GIT_IS_HIGHLIGHTER (highlighter));
+
+  priv = highlighter->priv;
+
+  if (priv->n_blocks == 0)
+    return;
+
+  g_mutex_lock (priv->mutex);
+  priv->visible_first = MIN (first_line / GIT_HIGHLIGHTER_BLOCK_SIZE,
+                             priv->n_blocks - 1);
+  priv->visible_last = MIN (last_line / GIT_HIGHLIGHTER_BLOCK_SIZE,
+                            priv->n_blocks - 1);
+  g_mutex_unlock (priv->mutex);
+}
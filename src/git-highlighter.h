@@ -0,0 +1,78 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_HIGHLIGHTER_H__
+#define __GIT_HIGHLIGHTER_H__
+
+#include <glib-object.h>
+#include "git-annotated-source.h"
+#include "git-highlight-language.h"
+
+G_BEGIN_DECLS
+
+#define GIT_TYPE_HIGHLIGHTER                                            \
+  (git_highlighter_get_type())
+#define GIT_HIGHLIGHTER(obj)                                            \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                   \
+                               GIT_TYPE_HIGHLIGHTER,                    \
+                               GitHighlighter))
+#define GIT_HIGHLIGHTER_CLASS(klass)                                    \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            GIT_TYPE_HIGHLIGHTER,                       \
+                            GitHighlighterClass))
+#define GIT_IS_HIGHLIGHTER(obj)                                         \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),                                   \
+                               GIT_TYPE_HIGHLIGHTER))
+#define GIT_IS_HIGHLIGHTER_CLASS(klass)                                 \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),                                    \
+                            GIT_TYPE_HIGHLIGHTER))
+#define GIT_HIGHLIGHTER_GET_CLASS(obj)                                  \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                    \
+                              GIT_TYPE_HIGHLIGHTER,                     \
+                              GitHighlighterClass))
+
+typedef struct _GitHighlighter        GitHighlighter;
+typedef struct _GitHighlighterClass   GitHighlighterClass;
+typedef struct _GitHighlighterPrivate GitHighlighterPrivate;
+
+struct _GitHighlighterClass
+{
+  GObjectClass parent_class;
+
+  void (* changed) (GitHighlighter *highlighter,
+                    guint first_line, guint n_lines);
+};
+
+struct _GitHighlighter
+{
+  GObject parent;
+
+  GitHighlighterPrivate *priv;
+};
+
+GType git_highlighter_get_type (void) G_GNUC_CONST;
+
+GitHighlighter *git_highlighter_new (GitAnnotatedSource *source,
+                                     const GitHighlightLanguage *language);
+gboolean git_highlighter_start (GitHighlighter *highlighter, GError **error);
+void git_highlighter_set_visible_lines (GitHighlighter *highlighter,
+                                        guint first_line,
+                                        guint last_line);
+
+G_END_DECLS
+
+#endif /* __GIT_HIGHLIGHTER_H__ */
@@ -0,0 +1,480 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtk/gtkdialog.h>
+#include <gtk/gtkvbox.h>
+#include <gtk/gtkhbox.h>
+#include <gtk/gtkvpaned.h>
+#include <gtk/gtkbutton.h>
+#include <gtk/gtkprogressbar.h>
+#include <gtk/gtkscrolledwindow.h>
+#include <gtk/gtktreeview.h>
+#include <gtk/gtkliststore.h>
+#include <gtk/gtkcellrenderertext.h>
+#include <gtk/gtktextview.h>
+#include <gtk/gtkstock.h>
+#include <string.h>
+
+#include "git-line-log-dialog.h"
+#include "git-line-log.h"
+#include "git-common.h"
+#include "intl.h"
+
+static void git_line_log_dialog_dispose (GObject *object);
+
+static void git_line_log_dialog_on_stop (GtkButton *button,
+                                         GitLineLogDialog *ldiag);
+static void git_line_log_dialog_on_selection_changed
+                                        (GtkTreeSelection *selection,
+                                         GitLineLogDialog *ldiag);
+
+G_DEFINE_TYPE (GitLineLogDialog, git_line_log_dialog, GTK_TYPE_DIALOG);
+
+#define GIT_LINE_LOG_DIALOG_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_LINE_LOG_DIALOG, \
+                                GitLineLogDialogPrivate))
+
+struct _GitLineLogDialogPrivate
+{
+  GitLineLog *log;
+  guint completed_handler, progress_handler;
+
+  GtkWidget *progress_bar, *stop_button, *tree_view, *patch_view;
+  GtkListStore *store;
+  guint stop_clicked_handler, selection_changed_handler;
+
+  /* Number of entries of the log that have been added to the
+     store */
+  guint n_rows;
+};
+
+/* Only the summary of each commit goes in the list. The patch is
+   looked up from the entry when the row is selected so only one
+   patch is ever rendered */
+enum
+  {
+    GIT_LINE_LOG_DIALOG_COL_HASH,
+    GIT_LINE_LOG_DIALOG_COL_AUTHOR,
+    GIT_LINE_LOG_DIALOG_COL_DATE,
+    GIT_LINE_LOG_DIALOG_COL_SUMMARY,
+    GIT_LINE_LOG_DIALOG_COL_ENTRY,
+
+    GIT_LINE_LOG_DIALOG_N_COLUMNS
+  };
+
+static void
+git_line_log_dialog_class_init (GitLineLogDialogClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->dispose = git_line_log_dialog_dispose;
+
+  g_type_class_add_private (klass, sizeof (GitLineLogDialogPrivate));
+}
+
+/* The tree view is in fixed height mode so that it doesn't have to
+   measure every row as the commits stream in. That needs all of the
+   columns to have a fixed width */
+static void
+git_line_log_dialog_add_column (GitLineLogDialog *ldiag,
+                                const gchar *title,
+                                gint column, gint width)
+{
+  GtkCellRenderer *renderer = gtk_cell_renderer_text_new ();
+  GtkTreeViewColumn *tree_column;
+
+  tree_column = gtk_tree_view_column_new_with_attributes (title, renderer,
+                                                          "text", column,
+                                                          NULL);
+  gtk_tree_view_column_set_sizing (tree_column,
+                                   GTK_TREE_VIEW_COLUMN_FIXED);
+  gtk_tree_view_column_set_fixed_width (tree_column, width);
+  gtk_tree_view_column_set_resizable (tree_column, TRUE);
+  gtk_tree_view_append_column (GTK_TREE_VIEW (ldiag->priv->tree_view),
+                               tree_column);
+}
+
+static void
+git_line_log_dialog_init (GitLineLogDialog *self)
+{
+  GitLineLogDialogPrivate *priv;
+  GtkWidget *content, *hbox, *paned, *scrolled_window;
+  GtkTextBuffer *buffer;
+
+  priv = self->priv = GIT_LINE_LOG_DIALOG_GET_PRIVATE (self);
+
+  gtk_window_set_title (GTK_WINDOW (self), _("Line History"));
+  gtk_window_set_default_size (GTK_WINDOW (self), 600, 500);
+  gtk_dialog_set_has_separator (GTK_DIALOG (self), FALSE);
+  gtk_container_set_border_width (GTK_CONTAINER (self), 5);
+
+  content = gtk_vbox_new (FALSE, 6);
+  gtk_container_set_border_width (GTK_CONTAINER (content), 5);
+
+  hbox = gtk_hbox_new (FALSE, 6);
+
+  priv->progress_bar = g_object_ref_sink (gtk_progress_bar_new ());
+  gtk_widget_show (priv->progress_bar);
+  gtk_box_pack_start (GTK_BOX (hbox), priv->progress_bar, TRUE, TRUE, 0);
+
+  priv->stop_button
+    = g_object_ref_sink (gtk_button_new_from_stock (GTK_STOCK_STOP));
+  priv->stop_clicked_handler
+    = g_signal_connect (priv->stop_button, "clicked",
+                        G_CALLBACK (git_line_log_dialog_on_stop), self);
+  gtk_widget_show (priv->stop_button);
+  gtk_box_pack_start (GTK_BOX (hbox), priv->stop_button, FALSE, FALSE, 0);
+
+  gtk_widget_show (hbox);
+  gtk_box_pack_start (GTK_BOX (content), hbox, FALSE, FALSE, 0);
+
+  priv->store = gtk_list_store_new (GIT_LINE_LOG_DIALOG_N_COLUMNS,
+                                    G_TYPE_STRING,
+                                    G_TYPE_STRING,
+                                    G_TYPE_STRING,
+                                    G_TYPE_STRING,
+                                    G_TYPE_UINT);
+
+  priv->tree_view = g_object_ref_sink
+    (gtk_tree_view_new_with_model (GTK_TREE_MODEL (priv->store)));
+  git_line_log_dialog_add_column (self, _("Commit"),
+                                  GIT_LINE_LOG_DIALOG_COL_HASH, 80);
+  git_line_log_dialog_add_column (self, _("Author"),
+                                  GIT_LINE_LOG_DIALOG_COL_AUTHOR, 130);
+  git_line_log_dialog_add_column (self, _("Date"),
+                                  GIT_LINE_LOG_DIALOG_COL_DATE, 130);
+  git_line_log_dialog_add_column (self, _("Summary"),
+                                  GIT_LINE_LOG_DIALOG_COL_SUMMARY, 300);
+  gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (priv->tree_view),
+                                       TRUE);
+  priv->selection_changed_handler
+    = g_signal_connect (gtk_tree_view_get_selection
+                        (GTK_TREE_VIEW (priv->tree_view)),
+                        "changed",
+                        G_CALLBACK (git_line_log_dialog_on_selection_changed),
+                        self);
+  gtk_widget_show (priv->tree_view);
+
+  paned = gtk_vpaned_new ();
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
+                                  GTK_POLICY_AUTOMATIC,
+                                  GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scrolled_window),
+                                       GTK_SHADOW_IN);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), priv->tree_view);
+  gtk_widget_show (scrolled_window);
+  gtk_paned_pack1 (GTK_PANED (paned), scrolled_window, TRUE, FALSE);
+
+  priv->patch_view = g_object_ref_sink (gtk_text_view_new ());
+  g_object_set (priv->patch_view,
+                "editable", FALSE,
+                "cursor-visible", FALSE,
+                "left-margin", 8,
+                "right-margin", 8,
+                NULL);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->patch_view));
+  gtk_text_buffer_create_tag (buffer, "patch", "family", "monospace", NULL);
+  gtk_text_buffer_create_tag (buffer, "added",
+                              "foreground", "dark green", NULL);
+  gtk_text_buffer_create_tag (buffer, "removed",
+                              "foreground", "dark red", NULL);
+  gtk_text_buffer_create_tag (buffer, "hunk",
+                              "foreground", "dark blue", NULL);
+  gtk_widget_show (priv->patch_view);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
+                                  GTK_POLICY_AUTOMATIC,
+                                  GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scrolled_window),
+                                       GTK_SHADOW_IN);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), priv->patch_view);
+  gtk_widget_show (scrolled_window);
+  gtk_paned_pack2 (GTK_PANED (paned), scrolled_window, TRUE, FALSE);
+
+  gtk_widget_show (paned);
+  gtk_box_pack_start (GTK_BOX (content), paned, TRUE, TRUE, 0);
+
+  gtk_widget_show (content);
+  gtk_box_pack_start (GTK_BOX (GTK_DIALOG (self)->vbox), content,
+                      TRUE, TRUE, 0);
+
+  gtk_dialog_add_button (GTK_DIALOG (self), GTK_STOCK_CLOSE,
+                         GTK_RESPONSE_CLOSE);
+}
+
+static void
+git_line_log_dialog_dispose (GObject *object)
+{
+  GitLineLogDialog *self = (GitLineLogDialog *) object;
+  GitLineLogDialogPrivate *priv = self->priv;
+
+  /* Closing the dialog stops the log if it is still running */
+  if (priv->log)
+    {
+      g_signal_handler_disconnect (priv->log, priv->completed_handler);
+      g_signal_handler_disconnect (priv->log, priv->progress_handler);
+      git_line_log_cancel (priv->log);
+      g_object_unref (priv->log);
+      priv->log = NULL;
+    }
+
+  if (priv->tree_view)
+    {
+      g_signal_handler_disconnect (gtk_tree_view_get_selection
+                                   (GTK_TREE_VIEW (priv->tree_view)),
+                                   priv->selection_changed_handler);
+      g_object_unref (priv->tree_view);
+      priv->tree_view = NULL;
+    }
+
+  if (priv->stop_button)
+    {
+      g_signal_handler_disconnect (priv->stop_button,
+                                   priv->stop_clicked_handler);
+      g_object_unref (priv->stop_button);
+      priv->stop_button = NULL;
+    }
+
+  if (priv->store)
+    {
+      g_object_unref (priv->store);
+      priv->store = NULL;
+    }
+
+  if (priv->progress_bar)
+    {
+      g_object_unref (priv->progress_bar);
+      priv->progress_bar = NULL;
+    }
+
+  if (priv->patch_view)
+    {
+      g_object_unref (priv->patch_view);
+      priv->patch_view = NULL;
+    }
+
+  G_OBJECT_CLASS (git_line_log_dialog_parent_class)->dispose (object);
+}
+
+GtkWidget *
+git_line_log_dialog_new (void)
+{
+  GtkWidget *self = g_object_new (GIT_TYPE_LINE_LOG_DIALOG, NULL);
+
+  return self;
+}
+
+static void
+git_line_log_dialog_add_rows (GitLineLogDialog *ldiag)
+{
+  GitLineLogDialogPrivate *priv = ldiag->priv;
+  guint n_entries = git_line_log_get_n_entries (priv->log);
+
+  for (; priv->n_rows < n_entries; priv->n_rows++)
+    {
+      const GitLineLogEntry *entry
+        = git_line_log_get_entry (priv->log, priv->n_rows);
+      const gchar *author = git_commit_get_prop (entry->commit, "author");
+      const gchar *summary = git_commit_get_prop (entry->commit, "summary");
+      gchar *hash = g_strndup (git_commit_get_hash (entry->commit), 8);
+      gchar *display_time = NULL;
+      GtkTreeIter iter;
+      GTimeVal time_;
+
+      if ((time_.tv_sec = git_commit_get_author_time (entry->commit)))
+        {
+          time_.tv_usec = 0;
+          display_time = git_format_time_for_display (&time_);
+        }
+
+      gtk_list_store_append (priv->store, &iter);
+      gtk_list_store_set (priv->store, &iter,
+                          GIT_LINE_LOG_DIALOG_COL_HASH, hash,
+                          GIT_LINE_LOG_DIALOG_COL_AUTHOR,
+                          author ? author : "",
+                          GIT_LINE_LOG_DIALOG_COL_DATE,
+                          display_time ? display_time : "",
+                          GIT_LINE_LOG_DIALOG_COL_SUMMARY,
+                          summary ? summary : "",
+                          GIT_LINE_LOG_DIALOG_COL_ENTRY, priv->n_rows,
+                          -1);
+
+      g_free (display_time);
+      g_free (hash);
+    }
+}
+
+static void
+git_line_log_dialog_on_selection_changed (GtkTreeSelection *selection,
+                                          GitLineLogDialog *ldiag)
+{
+  GitLineLogDialogPrivate *priv = ldiag->priv;
+  GtkTextBuffer *buffer;
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+  GtkTextIter text_iter;
+  const GitLineLogEntry *entry;
+  const gchar *p, *end, *line_end;
+  guint entry_num;
+
+  if (priv->patch_view == NULL)
+    return;
+
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->patch_view));
+  gtk_text_buffer_set_text (buffer, "", 0);
+
+  if (priv->log == NULL
+      || !gtk_tree_selection_get_selected (selection, &model, &iter))
+    return;
+
+  gtk_tree_model_get (model, &iter,
+                      GIT_LINE_LOG_DIALOG_COL_ENTRY, &entry_num,
+                      -1);
+  entry = git_line_log_get_entry (priv->log, entry_num);
+
+  gtk_text_buffer_get_start_iter (buffer, &text_iter);
+
+  for (p = entry->patch, end = p + entry->patch_length; p < end;
+       p = line_end)
+    {
+      const gchar *tag_name = NULL;
+
+      if ((line_end = memchr (p, '\n', end - p)))
+        line_end++;
+      else
+        line_end = end;
+
+      /* The file headers also start with +++ and --- */
+      if (*p == '@')
+        tag_name = "hunk";
+      else if (*p == '+' && strncmp (p, "+++ ", 4))
+        tag_name = "added";
+      else if (*p == '-' && strncmp (p, "--- ", 4))
+        tag_name = "removed";
+
+      gtk_text_buffer_insert_with_tags_by_name (buffer, &text_iter,
+                                                p, line_end - p,
+                                                "patch", tag_name, NULL);
+    }
+}
+
+static void
+git_line_log_dialog_on_progress (GitLineLog *log,
+                                 GitLineLogDialog *ldiag)
+{
+  GitLineLogDialogPrivate *priv = ldiag->priv;
+  gchar *text;
+
+  git_line_log_dialog_add_rows (ldiag);
+
+  text = g_strdup_printf (_("Read %u commits"), priv->n_rows);
+  gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar), text);
+  g_free (text);
+
+  gtk_progress_bar_pulse (GTK_PROGRESS_BAR (priv->progress_bar));
+}
+
+static void
+git_line_log_dialog_on_completed (GitLineLog *log,
+                                  const GError *error,
+                                  GitLineLogDialog *ldiag)
+{
+  GitLineLogDialogPrivate *priv = ldiag->priv;
+
+  git_line_log_dialog_add_rows (ldiag);
+
+  gtk_widget_set_sensitive (priv->stop_button, FALSE);
+  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 error ? 0.0 : 1.0);
+
+  if (error)
+    gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                               error->message);
+  else
+    {
+      gchar *text = g_strdup_printf (_("%u commits"), priv->n_rows);
+      gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 text);
+      g_free (text);
+    }
+}
+
+static void
+git_line_log_dialog_on_stop (GtkButton *button,
+                             GitLineLogDialog *ldiag)
+{
+  if (ldiag->priv->log)
+    git_line_log_cancel (ldiag->priv->log);
+}
+
+/* Starts reading the history of the lines from first_line to
+   last_line inclusive. Any error is shown in the dialog */
+void
+git_line_log_dialog_start (GitLineLogDialog *ldiag,
+                           const gchar *filename,
+                           const gchar *revision,
+                           guint first_line,
+                           guint last_line)
+{
+  GitLineLogDialogPrivate *priv;
+  GError *error = NULL;
+  gchar *title, *basename;
+
+  g_return_if_fail (GIT_IS_LINE_LOG_DIALOG (ldiag));
+  g_return_if_fail (filename != NULL);
+
+  priv = ldiag->priv;
+
+  g_return_if_fail (priv->log == NULL);
+
+  basename = g_path_get_basename (filename);
+  title = g_strdup_printf (_("History of %s:%u-%u"), basename,
+                           first_line, last_line);
+  gtk_window_set_title (GTK_WINDOW (ldiag), title);
+  g_free (title);
+  g_free (basename);
+
+  priv->log = git_line_log_new ();
+
+  priv->completed_handler
+    = g_signal_connect (priv->log, "completed",
+                        G_CALLBACK (git_line_log_dialog_on_completed),
+                        ldiag);
+  priv->progress_handler
+    = g_signal_connect (priv->log, "progress",
+                        G_CALLBACK (git_line_log_dialog_on_progress),
+                        ldiag);
+
+  if (git_line_log_start (priv->log, filename, revision,
+                               first_line, last_line, &error))
+    gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                               _("Reading history"));
+  else
+    {
+      gtk_widget_set_sensitive (priv->stop_button, FALSE);
+      gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 error->message);
+      g_error_free (error);
+    }
+}
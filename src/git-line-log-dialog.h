@@ -0,0 +1,74 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_LINE_LOG_DIALOG_H__
+#define __GIT_LINE_LOG_DIALOG_H__
+
+#include <gtk/gtkdialog.h>
+
+G_BEGIN_DECLS
+
+#define GIT_TYPE_LINE_LOG_DIALOG                                        \
+  (git_line_log_dialog_get_type())
+#define GIT_LINE_LOG_DIALOG(obj)                                        \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                   \
+                               GIT_TYPE_LINE_LOG_DIALOG,                \
+                               GitLineLogDialog))
+#define GIT_LINE_LOG_DIALOG_CLASS(klass)                                \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            GIT_TYPE_LINE_LOG_DIALOG,                   \
+                            GitLineLogDialogClass))
+#define GIT_IS_LINE_LOG_DIALOG(obj)                                     \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),                                   \
+                               GIT_TYPE_LINE_LOG_DIALOG))
+#define GIT_IS_LINE_LOG_DIALOG_CLASS(klass)                             \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),                                    \
+                            GIT_TYPE_LINE_LOG_DIALOG))
+#define GIT_LINE_LOG_DIALOG_GET_CLASS(obj)                              \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                    \
+                              GIT_TYPE_LINE_LOG_DIALOG,                 \
+                              GitLineLogDialogClass))
+
+typedef struct _GitLineLogDialog        GitLineLogDialog;
+typedef struct _GitLineLogDialogClass   GitLineLogDialogClass;
+typedef struct _GitLineLogDialogPrivate GitLineLogDialogPrivate;
+
+struct _GitLineLogDialogClass
+{
+  GtkDialogClass parent_class;
+};
+
+struct _GitLineLogDialog
+{
+  GtkDialog parent;
+
+  GitLineLogDialogPrivate *priv;
+};
+
+GType git_line_log_dialog_get_type (void) G_GNUC_CONST;
+
+GtkWidget *git_line_log_dialog_new (void);
+
+void git_line_log_dialog_start (GitLineLogDialog *ldiag,
+                                const gchar *filename,
+                                const gchar *revision,
+                                guint first_line,
+                                guint last_line);
+
+G_END_DECLS
+
+#endif /* __GIT_LINE_LOG_DIALOG_H__ */
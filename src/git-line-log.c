@@ -0,0 +1,617 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Reads the history of a range of lines with git log -L. Each
+   commit is made available as soon as its patch has been read so
+   that the list can be shown while git is still walking the
+   history. Logs that finish are remembered for the rest of the
+   session keyed on the commit hash and range */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib-object.h>
+#include <string.h>
+
+#include "git-line-log.h"
+#include "git-commit-bag.h"
+#include "git-reader.h"
+#include "git-common.h"
+
+static void git_line_log_dispose (GObject *object);
+static void git_line_log_finalize (GObject *object);
+
+static gboolean git_line_log_on_line (GitReader *reader,
+                                      guint length,
+                                      const gchar *str,
+                                      GitLineLog *log);
+static void git_line_log_on_completed (GitReader *reader,
+                                       const GError *error,
+                                       GitLineLog *log);
+
+G_DEFINE_TYPE (GitLineLog, git_line_log, G_TYPE_OBJECT);
+
+typedef enum
+  {
+    /* Checking that the working copy has no changes so that its line
+       numbers are the same as in HEAD */
+    GIT_LINE_LOG_STAGE_CHECKING_WORK_TREE,
+    /* Resolving the revision to a commit hash */
+    GIT_LINE_LOG_STAGE_RESOLVING,
+    GIT_LINE_LOG_STAGE_READING
+  } GitLineLogStage;
+
+#define GIT_LINE_LOG_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_LINE_LOG, \
+                                GitLineLogPrivate))
+
+struct _GitLineLogPrivate
+{
+  GitReader *reader;
+  guint line_handler, completed_handler;
+
+  GitLineLogStage stage;
+
+  gchar *repo, *base_part, *revision;
+  guint first_line, last_line;
+  gboolean has_local_changes;
+  /* Key to store the log under when it finishes. This is only known
+     once the revision has been resolved */
+  gchar *cache_key;
+
+  /* A GitLineLogEntry for each commit that has been completely
+     read */
+  GArray *entries;
+
+  /* The commit that is currently being read and its patch */
+  GitCommit *current_commit;
+  GString *current_patch;
+  gboolean in_header, finished;
+};
+
+enum
+  {
+    COMPLETED,
+    PROGRESS,
+
+    LAST_SIGNAL
+  };
+
+static guint client_signals[LAST_SIGNAL];
+
+/* Map from a cache key to a finished GitLineLog and the keys in the
+   order they were added so that the oldest can be thrown away */
+static GHashTable *git_line_log_cache = NULL;
+static GQueue *git_line_log_cache_order = NULL;
+
+static void
+git_line_log_class_init (GitLineLogClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->dispose = git_line_log_dispose;
+  gobject_class->finalize = git_line_log_finalize;
+
+  client_signals[COMPLETED]
+    = g_signal_new ("completed",
+                    G_TYPE_FROM_CLASS (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitLineLogClass, completed),
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__POINTER,
+                    G_TYPE_NONE, 1,
+                    G_TYPE_POINTER);
+
+  client_signals[PROGRESS]
+    = g_signal_new ("progress",
+                    G_TYPE_FROM_CLASS (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitLineLogClass, progress),
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__VOID,
+                    G_TYPE_NONE, 0);
+
+  g_type_class_add_private (klass, sizeof (GitLineLogPrivate));
+}
+
+static void
+git_line_log_init (GitLineLog *self)
+{
+  GitLineLogPrivate *priv;
+
+  priv = self->priv = GIT_LINE_LOG_GET_PRIVATE (self);
+
+  priv->reader = git_reader_new ();
+  priv->line_handler
+    = g_signal_connect (priv->reader, "line",
+                        G_CALLBACK (git_line_log_on_line), self);
+  priv->completed_handler
+    = g_signal_connect (priv->reader, "completed",
+                        G_CALLBACK (git_line_log_on_completed), self);
+
+  priv->entries = g_array_new (FALSE, FALSE, sizeof (GitLineLogEntry));
+  priv->current_patch = g_string_new (NULL);
+}
+
+static void
+git_line_log_dispose (GObject *object)
+{
+  GitLineLog *self = (GitLineLog *) object;
+  GitLineLogPrivate *priv = self->priv;
+
+  if (priv->reader)
+    {
+      g_signal_handler_disconnect (priv->reader, priv->line_handler);
+      g_signal_handler_disconnect (priv->reader, priv->completed_handler);
+      g_object_unref (priv->reader);
+      priv->reader = NULL;
+    }
+
+  if (priv->current_commit)
+    {
+      g_object_unref (priv->current_commit);
+      priv->current_commit = NULL;
+    }
+
+  G_OBJECT_CLASS (git_line_log_parent_class)->dispose (object);
+}
+
+static void
+git_line_log_finalize (GObject *object)
+{
+  GitLineLog *self = (GitLineLog *) object;
+  GitLineLogPrivate *priv = self->priv;
+  guint i;
+
+  for (i = 0; i < priv->entries->len; i++)
+    {
+      GitLineLogEntry *entry = &g_array_index (priv->entries,
+                                               GitLineLogEntry, i);
+
+      g_object_unref (entry->commit);
+      g_free (entry->patch);
+    }
+
+  g_array_free (priv->entries, TRUE);
+  g_string_free (priv->current_patch, TRUE);
+  g_free (priv->repo);
+  g_free (priv->base_part);
+  g_free (priv->revision);
+  g_free (priv->cache_key);
+
+  G_OBJECT_CLASS (git_line_log_parent_class)->finalize (object);
+}
+
+GitLineLog *
+git_line_log_new (void)
+{
+  GitLineLog *self = g_object_new (GIT_TYPE_LINE_LOG, NULL);
+
+  return self;
+}
+
+static gchar *
+git_line_log_get_cache_key (const gchar *repo, const gchar *hash,
+                            const gchar *base_part,
+                            guint first_line, guint last_line)
+{
+  return g_strdup_printf ("%s\n%s\n%s\n%u,%u", repo, hash, base_part,
+                          first_line, last_line);
+}
+
+static void
+git_line_log_store_in_cache (GitLineLog *log)
+{
+  GitLineLogPrivate *priv = log->priv;
+
+  if (git_line_log_cache == NULL)
+    {
+      git_line_log_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  g_free, g_object_unref);
+      git_line_log_cache_order = g_queue_new ();
+    }
+
+  if (g_hash_table_lookup (git_line_log_cache, priv->cache_key))
+    return;
+
+  g_hash_table_insert (git_line_log_cache, g_strdup (priv->cache_key),
+                       g_object_ref (log));
+  g_queue_push_tail (git_line_log_cache_order, g_strdup (priv->cache_key));
+
+  if (g_queue_get_length (git_line_log_cache_order)
+      > GIT_LINE_LOG_CACHE_SIZE)
+    {
+      gchar *oldest = g_queue_pop_head (git_line_log_cache_order);
+      g_hash_table_remove (git_line_log_cache, oldest);
+      g_free (oldest);
+    }
+}
+
+/* Takes a copy of the entries of a finished log of the same range */
+static void
+git_line_log_copy_entries (GitLineLog *log, GitLineLog *other)
+{
+  GitLineLogPrivate *priv = log->priv;
+  guint i;
+
+  for (i = 0; i < other->priv->entries->len; i++)
+    {
+      GitLineLogEntry entry
+        = g_array_index (other->priv->entries, GitLineLogEntry, i);
+
+      g_object_ref (entry.commit);
+      entry.patch = g_memdup (entry.patch, entry.patch_length + 1);
+      g_array_append_val (priv->entries, entry);
+    }
+}
+
+/* Moves the commit that has been read into the list of entries */
+static void
+git_line_log_end_commit (GitLineLog *log)
+{
+  GitLineLogPrivate *priv = log->priv;
+  GitLineLogEntry entry;
+
+  if (priv->current_commit == NULL)
+    return;
+
+  /* Strip the blank line that separates the commits */
+  while (priv->current_patch->len > 0
+         && priv->current_patch->str[priv->current_patch->len - 1] == '\n'
+         && (priv->current_patch->len == 1
+             || priv->current_patch->str[priv->current_patch->len - 2]
+             == '\n'))
+    g_string_truncate (priv->current_patch, priv->current_patch->len - 1);
+
+  entry.commit = priv->current_commit;
+  entry.patch = g_strndup (priv->current_patch->str,
+                           priv->current_patch->len);
+  entry.patch_length = priv->current_patch->len;
+  g_array_append_val (priv->entries, entry);
+
+  priv->current_commit = NULL;
+  g_string_truncate (priv->current_patch, 0);
+
+  g_signal_emit (log, client_signals[PROGRESS], 0);
+}
+
+static void
+git_line_log_finish (GitLineLog *log, const GError *error)
+{
+  GitLineLogPrivate *priv = log->priv;
+
+  if (priv->finished)
+    return;
+
+  priv->finished = TRUE;
+
+  if (error == NULL)
+    git_line_log_store_in_cache (log);
+
+  g_signal_emit (log, client_signals[COMPLETED], 0, error);
+}
+
+/* Each commit has a header with a "key value" line for each of the
+   properties in the format passed in git_line_log_start followed by
+   a blank line and the patch */
+static gboolean
+git_line_log_on_line (GitReader *reader,
+                      guint length, const gchar *str,
+                      GitLineLog *log)
+{
+  GitLineLogPrivate *priv = log->priv;
+
+  /* git diff --name-only only outputs the file if it has changed */
+  if (priv->stage == GIT_LINE_LOG_STAGE_CHECKING_WORK_TREE)
+    {
+      priv->has_local_changes = TRUE;
+      return TRUE;
+    }
+  else if (priv->stage == GIT_LINE_LOG_STAGE_RESOLVING)
+    {
+      if (length > 0 && str[length - 1] == '\n')
+        length--;
+
+      g_free (priv->revision);
+      priv->revision = g_strndup (str, length);
+
+      return TRUE;
+    }
+
+  /* The lines of the patch all start with a diff marker so they
+     can't be mistaken for the start of a commit */
+  if (length == strlen ("commit ") + GIT_COMMIT_HASH_LENGTH + 1
+      && !strncmp (str, "commit ", strlen ("commit ")))
+    {
+      GitCommitBag *commit_bag = git_commit_bag_get_default ();
+      gchar *hash = g_strndup (str + strlen ("commit "),
+                               GIT_COMMIT_HASH_LENGTH);
+
+      git_line_log_end_commit (log);
+
+      priv->current_commit
+        = g_object_ref (git_commit_bag_get (commit_bag, hash, priv->repo));
+      g_free (hash);
+
+      priv->in_header = TRUE;
+    }
+  else if (priv->current_commit == NULL)
+    {
+      GError *error = NULL;
+
+      g_set_error (&error, GIT_ERROR, GIT_ERROR_PARSE_ERROR,
+                   "Invalid data from git-log received");
+      git_line_log_finish (log, error);
+      g_error_free (error);
+
+      return FALSE;
+    }
+  else if (priv->in_header && !strncmp (str, "diff ", strlen ("diff ")))
+    {
+      priv->in_header = FALSE;
+      g_string_append_len (priv->current_patch, str, length);
+    }
+  else if (priv->in_header)
+    {
+      const gchar *sep;
+
+      if (length > 0 && str[length - 1] == '\n')
+        length--;
+
+      if (length == 0)
+        priv->in_header = FALSE;
+      else if ((sep = memchr (str, ' ', length)))
+        {
+          gchar *key = g_strndup (str, sep - str);
+
+          if (git_commit_get_prop (priv->current_commit, key) == NULL)
+            {
+              gchar *value = g_strndup (sep + 1, str + length - sep - 1);
+              git_commit_set_prop (priv->current_commit, key, value);
+              g_free (value);
+            }
+
+          g_free (key);
+        }
+    }
+  else
+    g_string_append_len (priv->current_patch, str, length);
+
+  return TRUE;
+}
+
+static gboolean
+git_line_log_run_stage (GitLineLog *log, GError **error)
+{
+  GitLineLogPrivate *priv = log->priv;
+  gchar *range, *revision;
+  gboolean ret;
+
+  switch (priv->stage)
+    {
+    case GIT_LINE_LOG_STAGE_CHECKING_WORK_TREE:
+      return git_reader_start (priv->reader, priv->repo, error,
+                               "diff", "--name-only", "--no-ext-diff",
+                               "HEAD", "--", priv->base_part, NULL);
+
+    case GIT_LINE_LOG_STAGE_RESOLVING:
+      revision = g_strconcat (priv->revision, "^{commit}", NULL);
+      ret = git_reader_start (priv->reader, priv->repo, error,
+                              "rev-parse", "--verify", revision, NULL);
+      g_free (revision);
+      return ret;
+
+    case GIT_LINE_LOG_STAGE_READING:
+      break;
+    }
+
+  range = g_strdup_printf ("%u,%u:%s", priv->first_line, priv->last_line,
+                           priv->base_part);
+
+  ret = git_reader_start (priv->reader, priv->repo, error,
+                          "log", "-L", range, "--no-color", "--no-ext-diff",
+                          "--format=commit %H%n"
+                          "author %an%n"
+                          "author-mail <%ae>%n"
+                          "author-time %at%n"
+                          "summary %s",
+                          priv->revision, NULL);
+
+  g_free (range);
+
+  return ret;
+}
+
+static void
+git_line_log_on_completed (GitReader *reader,
+                           const GError *error,
+                           GitLineLog *log)
+{
+  GitLineLogPrivate *priv = log->priv;
+  GitLineLog *cached;
+  GError *stage_error = NULL;
+
+  switch (priv->stage)
+    {
+    case GIT_LINE_LOG_STAGE_CHECKING_WORK_TREE:
+      if (error)
+        stage_error = g_error_copy (error);
+      else if (priv->has_local_changes)
+        g_set_error (&stage_error, GIT_ERROR, GIT_ERROR_LOCAL_CHANGES,
+                     "The file has local changes so the lines can't be "
+                     "found in the history");
+      else
+        {
+          priv->stage = GIT_LINE_LOG_STAGE_RESOLVING;
+          git_line_log_run_stage (log, &stage_error);
+        }
+      break;
+
+    case GIT_LINE_LOG_STAGE_RESOLVING:
+      if (error)
+        stage_error = g_error_copy (error);
+      else if (priv->revision == NULL
+               || strlen (priv->revision) != GIT_COMMIT_HASH_LENGTH)
+        g_set_error (&stage_error, GIT_ERROR, GIT_ERROR_PARSE_ERROR,
+                     "Invalid data from git-rev-parse received");
+      else
+        {
+          priv->cache_key
+            = git_line_log_get_cache_key (priv->repo, priv->revision,
+                                          priv->base_part,
+                                          priv->first_line,
+                                          priv->last_line);
+
+          if (git_line_log_cache
+              && (cached = g_hash_table_lookup (git_line_log_cache,
+                                                priv->cache_key)))
+            {
+              git_line_log_copy_entries (log, cached);
+              g_signal_emit (log, client_signals[PROGRESS], 0);
+              git_line_log_finish (log, NULL);
+            }
+          else
+            {
+              priv->stage = GIT_LINE_LOG_STAGE_READING;
+              git_line_log_run_stage (log, &stage_error);
+            }
+        }
+      break;
+
+    case GIT_LINE_LOG_STAGE_READING:
+      git_line_log_end_commit (log);
+      git_line_log_finish (log, error);
+      break;
+    }
+
+  if (stage_error)
+    {
+      git_line_log_finish (log, stage_error);
+      g_error_free (stage_error);
+    }
+}
+
+/* Starts reading the commits that touched the lines from first_line
+   to last_line inclusive in the given revision or the working copy
+   if revision is NULL. The line numbers start from 1. The working
+   copy can only be used if the file has no local changes because
+   otherwise the line numbers would not match HEAD. The revision is
+   resolved to a commit hash before reading so that a log of the same
+   commit that has already finished is reused. This can only be
+   called once */
+gboolean
+git_line_log_start (GitLineLog *log,
+                    const gchar *filename,
+                    const gchar *revision,
+                    guint first_line,
+                    guint last_line,
+                    GError **error)
+{
+  GitLineLogPrivate *priv;
+
+  g_return_val_if_fail (GIT_IS_LINE_LOG (log), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (first_line > 0 && last_line >= first_line, FALSE);
+
+  priv = log->priv;
+
+  g_return_val_if_fail (priv->repo == NULL, FALSE);
+
+  if (!git_find_repo (filename, &priv->repo, &priv->base_part))
+    {
+      g_set_error (error, GIT_ERROR, GIT_ERROR_NO_REPO,
+                   "No repo found for %s", filename);
+      return FALSE;
+    }
+
+  priv->first_line = first_line;
+  priv->last_line = last_line;
+
+  if (revision)
+    {
+      priv->revision = g_strdup (revision);
+      priv->stage = GIT_LINE_LOG_STAGE_RESOLVING;
+    }
+  else
+    {
+      priv->revision = g_strdup ("HEAD");
+      priv->stage = GIT_LINE_LOG_STAGE_CHECKING_WORK_TREE;
+    }
+
+  return git_line_log_run_stage (log, error);
+}
+
+/* Stops reading the log. The entries that have already been read are
+   kept but the log is not cached */
+void
+git_line_log_cancel (GitLineLog *log)
+{
+  GitLineLogPrivate *priv;
+  GError *error = NULL;
+
+  g_return_if_fail (GIT_IS_LINE_LOG (log));
+
+  priv = log->priv;
+
+  if (priv->finished || priv->repo == NULL)
+    return;
+
+  git_reader_cancel (priv->reader);
+
+  /* The partial commit may be missing some of its patch */
+  if (priv->current_commit)
+    {
+      g_object_unref (priv->current_commit);
+      priv->current_commit = NULL;
+    }
+
+  g_set_error (&error, GIT_ERROR, GIT_ERROR_CANCELLED, "Log cancelled");
+  git_line_log_finish (log, error);
+  g_error_free (error);
+}
+
+gboolean
+git_line_log_is_finished (GitLineLog *log)
+{
+  g_return_val_if_fail (GIT_IS_LINE_LOG (log), FALSE);
+
+  return log->priv->finished;
+}
+
+guint
+git_line_log_get_n_entries (GitLineLog *log)
+{
+  g_return_val_if_fail (GIT_IS_LINE_LOG (log), 0);
+
+  return log->priv->entries->len;
+}
+
+const GitLineLogEntry *
+git_line_log_get_entry (GitLineLog *log, guint entry_num)
+{
+  GitLineLogPrivate *priv;
+
+  g_return_val_if_fail (GIT_IS_LINE_LOG (log), NULL);
+
+  priv = log->priv;
+
+  g_return_val_if_fail (entry_num < priv->entries->len, NULL);
+
+  return &g_array_index (priv->entries, GitLineLogEntry, entry_num);
+}
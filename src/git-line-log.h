@@ -0,0 +1,98 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_LINE_LOG_H__
+#define __GIT_LINE_LOG_H__
+
+#include <glib-object.h>
+#include "git-commit.h"
+
+G_BEGIN_DECLS
+
+#define GIT_TYPE_LINE_LOG                                               \
+  (git_line_log_get_type())
+#define GIT_LINE_LOG(obj)                                               \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                   \
+                               GIT_TYPE_LINE_LOG,                       \
+                               GitLineLog))
+#define GIT_LINE_LOG_CLASS(klass)                                       \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            GIT_TYPE_LINE_LOG,                          \
+                            GitLineLogClass))
+#define GIT_IS_LINE_LOG(obj)                                            \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),                                   \
+                               GIT_TYPE_LINE_LOG))
+#define GIT_IS_LINE_LOG_CLASS(klass)                                    \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),                                    \
+                            GIT_TYPE_LINE_LOG))
+#define GIT_LINE_LOG_GET_CLASS(obj)                                     \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                    \
+                              GIT_TYPE_LINE_LOG,                        \
+                              GitLineLogClass))
+
+typedef struct _GitLineLog        GitLineLog;
+typedef struct _GitLineLogClass   GitLineLogClass;
+typedef struct _GitLineLogPrivate GitLineLogPrivate;
+typedef struct _GitLineLogEntry   GitLineLogEntry;
+
+struct _GitLineLogClass
+{
+  GObjectClass parent_class;
+
+  void (* completed) (GitLineLog *log, const GError *error);
+  void (* progress) (GitLineLog *log);
+};
+
+struct _GitLineLog
+{
+  GObject parent;
+
+  GitLineLogPrivate *priv;
+};
+
+struct _GitLineLogEntry
+{
+  GitCommit *commit;
+  /* The diff of the range in the commit including the file
+     headers */
+  gchar *patch;
+  gsize patch_length;
+};
+
+/* Number of finished logs that are remembered */
+#define GIT_LINE_LOG_CACHE_SIZE 16
+
+GType git_line_log_get_type (void) G_GNUC_CONST;
+
+GitLineLog *git_line_log_new (void);
+
+gboolean git_line_log_start (GitLineLog *log,
+                             const gchar *filename,
+                             const gchar *revision,
+                             guint first_line,
+                             guint last_line,
+                             GError **error);
+void git_line_log_cancel (GitLineLog *log);
+gboolean git_line_log_is_finished (GitLineLog *log);
+
+guint git_line_log_get_n_entries (GitLineLog *log);
+const GitLineLogEntry *git_line_log_get_entry (GitLineLog *log,
+                                               guint entry_num);
+
+G_END_DECLS
+
+#endif /* __GIT_LINE_LOG_H__ */
@@ -25,17 +25,33 @@
 #include <gtk/gtkcontainer.h>
 #include <gtk/gtkscrolledwindow.h>
 #include <gtk/gtkuimanager.h>
+#include <gtk/gtktoggleaction.h>
 #include <gtk/gtkstock.h>
 #include <gtk/gtkaboutdialog.h>
 #include <gtk/gtkfilechooserdialog.h>
 #include <gtk/gtkentry.h>
+#include <gtk/gtkeditable.h>
 #include <gtk/gtktoolbar.h>
+#include <gtk/gtkmessagedialog.h>
+#include <gtk/gtkprogressbar.h>
+#include <gtk/gtkhpaned.h>
+#include <gtk/gtkhbox.h>
+#include <gtk/gtklabel.h>
 #include <string.h>
 
 #include "git-main-window.h"
 #include "git-source-view.h"
+#include "git-blame-cache.h"
 #include "git-commit-dialog.h"
 #include "git-common.h"
+#include "git-memory.h"
+#include "git-recorder.h"
+#include "git-owner-panel.h"
+#include "git-age-histogram.h"
+#include "git-dir-owners-dialog.h"
+#include "git-timeline-dialog.h"
+#include "git-line-log-dialog.h"
+#include "git-pickaxe-dialog.h"
 #include "intl.h"
 
 typedef struct _GitMainWindowHistoryItem GitMainWindowHistoryItem;
@@ -44,6 +60,7 @@ static void git_main_window_dispose (GObject *object);
 static void git_main_window_finalize (GObject *object);
 
 static void git_main_window_update_source_state (GitMainWindow *main_window);
+static void git_main_window_update_progress (GitMainWindow *main_window);
 static void git_main_window_update_history_actions (GitMainWindow *main_window);
 
 static void git_main_window_on_commit_selected (GitSourceView *sview,
@@ -56,10 +73,37 @@ static void git_main_window_free_history_item (GitMainWindowHistoryItem *item);
 
 static void git_main_window_on_open (GtkAction *action,
                                      GitMainWindow *main_window);
+static void git_main_window_on_dir_ownership (GtkAction *action,
+                                              GitMainWindow *main_window);
 static void git_main_window_on_quit (GtkAction *action,
                                      GitMainWindow *main_window);
 static void git_main_window_on_about (GtkAction *action,
                                       GitMainWindow *main_window);
+static void git_main_window_on_memory_usage (GtkAction *action,
+                                             GitMainWindow *main_window);
+static void git_main_window_on_copy (GtkAction *action,
+                                     GitMainWindow *main_window);
+static void git_main_window_on_copy_annotated (GtkAction *action,
+                                               GitMainWindow *main_window);
+static void git_main_window_on_select_all (GtkAction *action,
+                                           GitMainWindow *main_window);
+static void git_main_window_on_line_numbers (GtkToggleAction *action,
+                                             GitMainWindow *main_window);
+static void git_main_window_on_ownership (GtkToggleAction *action,
+                                          GitMainWindow *main_window);
+static void git_main_window_on_age_colors (GtkToggleAction *action,
+                                           GitMainWindow *main_window);
+static void git_main_window_on_reverse (GtkToggleAction *action,
+                                        GitMainWindow *main_window);
+static void git_main_window_on_author_selected (GitOwnerPanel *panel,
+                                                const gchar *author,
+                                                GitMainWindow *main_window);
+static void git_main_window_on_timeline (GtkAction *action,
+                                         GitMainWindow *main_window);
+static void git_main_window_on_line_history (GtkAction *action,
+                                             GitMainWindow *main_window);
+static void git_main_window_on_search_history (GtkAction *action,
+                                               GitMainWindow *main_window);
 static void git_main_window_on_back (GtkAction *action,
                                      GitMainWindow *main_window);
 static void git_main_window_on_forward (GtkAction *action,
@@ -68,6 +112,9 @@ static void git_main_window_on_forward (GtkAction *action,
 static void git_main_window_on_revision (GtkEntry *entry,
                                          GitMainWindow *main_window);
 
+static void git_main_window_destroy_confirm_dialog
+                                          (GitMainWindow *main_window);
+
 G_DEFINE_TYPE (GitMainWindow, git_main_window, GTK_TYPE_WINDOW);
 
 #define GIT_MAIN_WINDOW_GET_PRIVATE(obj) \
@@ -76,27 +123,42 @@ G_DEFINE_TYPE (GitMainWindow, git_main_window, GTK_TYPE_WINDOW);
 
 struct _GitMainWindowPrivate
 {
-  GtkWidget *revision_bar, *source_view, *statusbar;
-  GtkWidget *commit_dialog, *file_dialog;
+  GtkWidget *revision_bar, *source_view, *statusbar, *progress_bar;
+  /* Entry for the end of the range in reverse mode and the tool item
+     containing it which is only shown in that mode */
+  GtkWidget *revision_end_bar, *revision_end_item;
+  GtkWidget *commit_dialog, *file_dialog, *confirm_dialog;
+  GtkWidget *side_pane, *owner_panel, *age_histogram;
 
   guint source_state_context;
   guint source_state_id;
   guint source_state_handler;
   guint commit_selected_handler;
+  guint load_progress_handler;
   guint commit_response_handler;
   guint file_response_handler;
+  guint confirm_response_handler;
+  guint eta_timeout;
   guint revision_activated_handler;
+  guint revision_end_activated_handler;
+  guint author_selected_handler;
 
   GList *history;
   GList *history_pos;
 
   GtkAction *back_action, *forward_action;
+  GtkToggleAction *line_numbers_action, *orig_line_numbers_action;
+  GtkToggleAction *reverse_action;
+
+  /* Whether the current file is shown with a reverse blame */
+  gboolean reverse;
 };
 
 struct _GitMainWindowHistoryItem
 {
   gchar *filename;
   gchar *revision;
+  gboolean reverse;
 };
 
 static GtkActionEntry
@@ -104,16 +166,45 @@ git_main_window_actions[] =
   {
     { "File", NULL, N_("_File"), NULL,
       NULL, NULL },
+    { "Edit", NULL, N_("_Edit"), NULL,
+      NULL, NULL },
+    { "View", NULL, N_("_View"), NULL,
+      NULL, NULL },
     { "Go", NULL, N_("_Go"), NULL,
       NULL, NULL },
     { "Help", NULL, N_("_Help"), NULL,
       NULL, NULL },
     { "FileOpen", GTK_STOCK_OPEN, N_("_Open"), NULL,
       NULL, G_CALLBACK (git_main_window_on_open) },
+    { "FileDirOwnership", NULL, N_("_Directory Ownership..."), NULL,
+      N_("Show who owns the files under a directory"),
+      G_CALLBACK (git_main_window_on_dir_ownership) },
     { "FileQuit", GTK_STOCK_QUIT, N_("_Quit"), NULL,
       NULL, G_CALLBACK (git_main_window_on_quit) },
     { "HelpAbout", GTK_STOCK_ABOUT, N_("_About"), NULL,
       NULL, G_CALLBACK (git_main_window_on_about) },
+    { "HelpMemoryUsage", NULL, N_("_Memory Usage"), NULL,
+      N_("Show how much memory is used by each part of the program"),
+      G_CALLBACK (git_main_window_on_memory_usage) },
+    { "EditCopy", GTK_STOCK_COPY, N_("_Copy"), "<Control>C",
+      NULL, G_CALLBACK (git_main_window_on_copy) },
+    { "EditCopyAnnotated", NULL, N_("Copy with _Annotations"),
+      "<Control><Shift>C",
+      N_("Copy the selected lines along with their commits and authors"),
+      G_CALLBACK (git_main_window_on_copy_annotated) },
+    { "EditSelectAll", GTK_STOCK_SELECT_ALL, N_("Select _All"), "<Control>A",
+      NULL, G_CALLBACK (git_main_window_on_select_all) },
+    { "EditSearchHistory", GTK_STOCK_FIND, N_("_Search History..."),
+      "<Control><Shift>F",
+      N_("Find the commits that added or removed the selected text"),
+      G_CALLBACK (git_main_window_on_search_history) },
+    { "ViewTimeline", NULL, N_("_Timeline..."), "<Control>T",
+      N_("Show how the blame of the file changed over its history"),
+      G_CALLBACK (git_main_window_on_timeline) },
+    { "ViewLineHistory", NULL, N_("_History of Selected Lines..."),
+      "<Control>L",
+      N_("Show the commits that changed the selected lines"),
+      G_CALLBACK (git_main_window_on_line_history) },
     { "GoBack", GTK_STOCK_GO_BACK, N_("_Back"), "<Alt>Left",
       N_("Go back to previously visited commit"),
       G_CALLBACK (git_main_window_on_back) },
@@ -122,6 +213,27 @@ git_main_window_actions[] =
       G_CALLBACK (git_main_window_on_forward) },
   };
 
+static GtkToggleActionEntry
+git_main_window_toggle_actions[] =
+  {
+    { "ViewLineNumbers", NULL, N_("_Line Numbers"), NULL,
+      N_("Show the number of each line"),
+      G_CALLBACK (git_main_window_on_line_numbers), TRUE },
+    { "ViewOrigLineNumbers", NULL, N_("_Original Line Numbers"), NULL,
+      N_("Show the number that each line had in the commit it came from"),
+      G_CALLBACK (git_main_window_on_line_numbers), FALSE },
+    { "ViewOwnership", NULL, N_("_Ownership"), "F9",
+      N_("Show who owns the lines of the file and how old they are"),
+      G_CALLBACK (git_main_window_on_ownership), FALSE },
+    { "ViewAgeColors", NULL, N_("Color by _Age"), NULL,
+      N_("Color the commits by how long ago they were made"),
+      G_CALLBACK (git_main_window_on_age_colors), FALSE },
+    { "ViewReverse", NULL, N_("_Reverse Blame"), "<Control>R",
+      N_("Show the last revision in a range that still had each line "
+         "to find when lines were removed"),
+      G_CALLBACK (git_main_window_on_reverse), FALSE },
+  };
+
 static void
 git_main_window_class_init (GitMainWindowClass *klass)
 {
@@ -137,7 +249,7 @@ static void
 git_main_window_init (GitMainWindow *self)
 {
   GitMainWindowPrivate *priv;
-  GtkWidget *layout, *scrolled_win;
+  GtkWidget *layout, *scrolled_win, *paned;
   GtkUIManager *ui_manager;
 
   priv = self->priv = GIT_MAIN_WINDOW_GET_PRIVATE (self);
@@ -146,7 +258,7 @@ git_main_window_init (GitMainWindow *self)
 
   if ((ui_manager = git_main_window_create_ui_manager ()))
     {
-      GtkWidget *widget;
+      GtkWidget *widget, *hbox, *label;
       GtkActionGroup *action_group;
       GtkAccelGroup *accel_group;
 
@@ -156,6 +268,9 @@ git_main_window_init (GitMainWindow *self)
       gtk_action_group_add_actions (action_group, git_main_window_actions,
                                     G_N_ELEMENTS (git_main_window_actions),
                                     self);
+      gtk_action_group_add_toggle_actions
+        (action_group, git_main_window_toggle_actions,
+         G_N_ELEMENTS (git_main_window_toggle_actions), self);
 
       if ((priv->back_action = gtk_action_group_get_action (action_group,
                                                             "GoBack")))
@@ -163,6 +278,15 @@ git_main_window_init (GitMainWindow *self)
       if ((priv->forward_action = gtk_action_group_get_action (action_group,
                                                                "GoForward")))
         g_object_ref (priv->forward_action);
+      if ((priv->line_numbers_action = (GtkToggleAction *)
+           gtk_action_group_get_action (action_group, "ViewLineNumbers")))
+        g_object_ref (priv->line_numbers_action);
+      if ((priv->orig_line_numbers_action = (GtkToggleAction *)
+           gtk_action_group_get_action (action_group, "ViewOrigLineNumbers")))
+        g_object_ref (priv->orig_line_numbers_action);
+      if ((priv->reverse_action = (GtkToggleAction *)
+           gtk_action_group_get_action (action_group, "ViewReverse")))
+        g_object_ref (priv->reverse_action);
 
       gtk_ui_manager_insert_action_group (ui_manager, action_group, 0);
 
@@ -189,6 +313,29 @@ git_main_window_init (GitMainWindow *self)
                                           _("Revision"));
           gtk_widget_show (GTK_WIDGET (tool_item));
           gtk_toolbar_insert (GTK_TOOLBAR (widget), tool_item, -1);
+
+          /* The end of the range for a reverse blame */
+          tool_item = gtk_tool_item_new ();
+          hbox = gtk_hbox_new (FALSE, 6);
+          label = gtk_label_new (_("to"));
+          gtk_widget_show (label);
+          gtk_box_pack_start (GTK_BOX (hbox), label, FALSE, FALSE, 6);
+          priv->revision_end_bar = g_object_ref_sink (gtk_entry_new ());
+          priv->revision_end_activated_handler
+            = g_signal_connect (priv->revision_end_bar, "activate",
+                                G_CALLBACK (git_main_window_on_revision),
+                                self);
+          gtk_widget_show (priv->revision_end_bar);
+          gtk_box_pack_start (GTK_BOX (hbox), priv->revision_end_bar,
+                              TRUE, TRUE, 0);
+          gtk_widget_show (hbox);
+          gtk_container_add (GTK_CONTAINER (tool_item), hbox);
+          gtk_tool_item_set_expand (tool_item, TRUE);
+          gtk_tool_item_set_tooltip_text (tool_item,
+                                          _("End of the range or empty "
+                                            "for HEAD"));
+          priv->revision_end_item = g_object_ref_sink (tool_item);
+          gtk_toolbar_insert (GTK_TOOLBAR (widget), tool_item, -1);
         }
 
       accel_group = gtk_ui_manager_get_accel_group (ui_manager);
@@ -211,16 +358,46 @@ git_main_window_init (GitMainWindow *self)
   priv->commit_selected_handler = g_signal_connect
     (priv->source_view, "commit-selected",
      G_CALLBACK (git_main_window_on_commit_selected), self);
+  priv->load_progress_handler = g_signal_connect_swapped
+    (priv->source_view, "load-progress",
+     G_CALLBACK (git_main_window_update_progress), self);
   gtk_widget_show (priv->source_view);
   gtk_container_add (GTK_CONTAINER (scrolled_win), priv->source_view);
 
+  paned = gtk_hpaned_new ();
+
   gtk_widget_show (scrolled_win);
-  gtk_box_pack_start (GTK_BOX (layout), scrolled_win, TRUE, TRUE, 0);
+  gtk_paned_pack1 (GTK_PANED (paned), scrolled_win, TRUE, FALSE);
+
+  /* The ownership panel and the age histogram are in a side pane
+     that is hidden until it is turned on from the View menu */
+  priv->side_pane = g_object_ref_sink (gtk_vbox_new (FALSE, 3));
+
+  priv->owner_panel = g_object_ref_sink (git_owner_panel_new ());
+  priv->author_selected_handler = g_signal_connect
+    (priv->owner_panel, "author-selected",
+     G_CALLBACK (git_main_window_on_author_selected), self);
+  gtk_widget_show (priv->owner_panel);
+  gtk_box_pack_start (GTK_BOX (priv->side_pane), priv->owner_panel,
+                      TRUE, TRUE, 0);
+
+  priv->age_histogram = g_object_ref_sink (git_age_histogram_new ());
+  gtk_widget_show (priv->age_histogram);
+  gtk_box_pack_start (GTK_BOX (priv->side_pane), priv->age_histogram,
+                      FALSE, FALSE, 0);
+
+  gtk_paned_pack2 (GTK_PANED (paned), priv->side_pane, FALSE, TRUE);
+
+  gtk_widget_show (paned);
+  gtk_box_pack_start (GTK_BOX (layout), paned, TRUE, TRUE, 0);
 
   priv->statusbar = g_object_ref_sink (gtk_statusbar_new ());
   priv->source_state_context
     = gtk_statusbar_get_context_id (GTK_STATUSBAR (priv->statusbar),
                                     "source-state");
+  priv->progress_bar = g_object_ref_sink (gtk_progress_bar_new ());
+  gtk_box_pack_end (GTK_BOX (priv->statusbar), priv->progress_bar,
+                    FALSE, FALSE, 0);
   gtk_widget_show (priv->statusbar);
   gtk_box_pack_start (GTK_BOX (layout), priv->statusbar, FALSE, FALSE, 0);
 
@@ -243,10 +420,32 @@ git_main_window_dispose (GObject *object)
                                    priv->source_state_handler);
       g_signal_handler_disconnect (priv->source_view,
                                    priv->commit_selected_handler);
+      g_signal_handler_disconnect (priv->source_view,
+                                   priv->load_progress_handler);
       g_object_unref (priv->source_view);
       priv->source_view = NULL;
     }
 
+  if (priv->owner_panel)
+    {
+      g_signal_handler_disconnect (priv->owner_panel,
+                                   priv->author_selected_handler);
+      g_object_unref (priv->owner_panel);
+      priv->owner_panel = NULL;
+    }
+
+  if (priv->age_histogram)
+    {
+      g_object_unref (priv->age_histogram);
+      priv->age_histogram = NULL;
+    }
+
+  if (priv->side_pane)
+    {
+      g_object_unref (priv->side_pane);
+      priv->side_pane = NULL;
+    }
+
   if (priv->revision_bar)
     {
       g_signal_handler_disconnect (priv->revision_bar,
@@ -255,12 +454,32 @@ git_main_window_dispose (GObject *object)
       priv->revision_bar = NULL;
     }
 
+  if (priv->revision_end_bar)
+    {
+      g_signal_handler_disconnect (priv->revision_end_bar,
+                                   priv->revision_end_activated_handler);
+      g_object_unref (priv->revision_end_bar);
+      priv->revision_end_bar = NULL;
+    }
+
+  if (priv->revision_end_item)
+    {
+      g_object_unref (priv->revision_end_item);
+      priv->revision_end_item = NULL;
+    }
+
   if (priv->statusbar)
     {
       g_object_unref (priv->statusbar);
       priv->statusbar = NULL;
     }
 
+  if (priv->progress_bar)
+    {
+      g_object_unref (priv->progress_bar);
+      priv->progress_bar = NULL;
+    }
+
   if (priv->commit_dialog)
     {
       g_signal_handler_disconnect (priv->commit_dialog,
@@ -275,16 +494,39 @@ git_main_window_dispose (GObject *object)
       priv->file_dialog = NULL;
     }
 
+  git_main_window_destroy_confirm_dialog (self);
+
+  if (priv->eta_timeout)
+    {
+      g_source_remove (priv->eta_timeout);
+      priv->eta_timeout = 0;
+    }
+
   if (priv->back_action)
     {
       g_object_unref (priv->back_action);
       priv->back_action = NULL;
     }
+  if (priv->line_numbers_action)
+    {
+      g_object_unref (priv->line_numbers_action);
+      priv->line_numbers_action = NULL;
+    }
+  if (priv->orig_line_numbers_action)
+    {
+      g_object_unref (priv->orig_line_numbers_action);
+      priv->orig_line_numbers_action = NULL;
+    }
   if (priv->forward_action)
     {
       g_object_unref (priv->forward_action);
       priv->forward_action = NULL;
     }
+  if (priv->reverse_action)
+    {
+      g_object_unref (priv->reverse_action);
+      priv->reverse_action = NULL;
+    }
 
   G_OBJECT_CLASS (git_main_window_parent_class)->dispose (object);
 }
@@ -315,19 +557,45 @@ git_main_window_new (void)
 static void
 git_main_window_do_set_file (GitMainWindow *main_window,
                              const gchar *filename,
-                             const gchar *revision)
+                             const gchar *revision,
+                             gboolean reverse)
 {
   GitMainWindowPrivate *priv;
+  const gchar *dots = NULL;
 
   priv = main_window->priv;
 
+  /* The toggle handler ignores the change when priv->reverse
+     already matches */
+  priv->reverse = reverse;
+  if (priv->reverse_action)
+    gtk_toggle_action_set_active (priv->reverse_action, reverse);
+  if (priv->revision_end_item)
+    g_object_set (priv->revision_end_item, "visible", reverse, NULL);
+
   if (priv->source_view)
-    git_source_view_set_file (GIT_SOURCE_VIEW (priv->source_view),
-                              filename, revision);
+    {
+      git_source_view_set_reverse (GIT_SOURCE_VIEW (priv->source_view),
+                                   reverse);
+      git_source_view_set_file (GIT_SOURCE_VIEW (priv->source_view),
+                                filename, revision);
+    }
+
+  /* A reverse range is split between the two entries */
+  if (reverse && revision)
+    dots = strstr (revision, "..");
 
   if (priv->revision_bar)
-    gtk_entry_set_text (GTK_ENTRY (priv->revision_bar),
-                        revision ? revision : "");
+    {
+      gchar *start = dots ? g_strndup (revision, dots - revision) : NULL;
+
+      gtk_entry_set_text (GTK_ENTRY (priv->revision_bar),
+                          start ? start : revision ? revision : "");
+      g_free (start);
+    }
+  if (priv->revision_end_bar)
+    gtk_entry_set_text (GTK_ENTRY (priv->revision_end_bar),
+                        dots ? dots + 2 : "");
 }
 
 static void
@@ -343,7 +611,8 @@ git_main_window_free_history_item (GitMainWindowHistoryItem *item)
 static void
 git_main_window_add_history (GitMainWindow *main_window,
                              const gchar *filename,
-                             const gchar *revision)
+                             const gchar *revision,
+                             gboolean reverse)
 {
   GitMainWindowPrivate *priv;
   GitMainWindowHistoryItem *item;
@@ -353,6 +622,7 @@ git_main_window_add_history (GitMainWindow *main_window,
   item = g_slice_new (GitMainWindowHistoryItem);
   item->filename = g_strdup (filename);
   item->revision = revision ? g_strdup (revision) : NULL;
+  item->reverse = reverse;
 
   if (priv->history_pos == NULL)
     priv->history = priv->history_pos = g_list_prepend (NULL, item);
@@ -373,30 +643,245 @@ git_main_window_add_history (GitMainWindow *main_window,
   git_main_window_update_history_actions (main_window);
 }
 
+static void
+git_main_window_set_file_full (GitMainWindow *main_window,
+                               const gchar *filename,
+                               const gchar *revision,
+                               gboolean reverse)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+
+  /* Changing the revision of the current file is recorded separately
+     from opening a new file */
+  if (git_recorder_is_recording ())
+    {
+      GitMainWindowHistoryItem *item
+        = priv->history_pos ? priv->history_pos->data : NULL;
+
+      git_recorder_record (item && !strcmp (item->filename, filename)
+                           ? GIT_RECORDER_REVISION : GIT_RECORDER_OPEN,
+                           filename, revision ? revision : "");
+    }
+
+  git_main_window_do_set_file (main_window, filename, revision, reverse);
+
+  git_main_window_add_history (main_window, filename, revision, reverse);
+
+  if (priv->source_view)
+    gtk_widget_grab_focus (priv->source_view);
+}
+
 void
 git_main_window_set_file (GitMainWindow *main_window,
                           const gchar *filename,
                           const gchar *revision)
 {
-  GitMainWindowPrivate *priv;
-
   g_return_if_fail (GIT_IS_MAIN_WINDOW (main_window));
   g_return_if_fail (filename != NULL);
 
-  priv = main_window->priv;
+  git_main_window_set_file_full (main_window, filename, revision,
+                                 main_window->priv->reverse);
+}
+
+static void
+git_main_window_update_progress (GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+  GitAnnotatedSourceProgress progress;
+  gchar *text;
+
+  if (priv->progress_bar == NULL || priv->source_view == NULL)
+    return;
+
+  if (!git_source_view_get_load_progress (GIT_SOURCE_VIEW
+                                          (priv->source_view),
+                                          &progress))
+    {
+      gtk_widget_hide (priv->progress_bar);
+      return;
+    }
+
+  /* git-blame doesn't write anything in porcelain mode until it has
+     attributed every line so until the first line arrives there's
+     nothing to measure */
+  if (progress.expected_lines > 0)
+    {
+      gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (priv->progress_bar),
+                                     MIN ((gdouble) progress.n_lines
+                                          / progress.expected_lines, 1.0));
+      text = g_strdup_printf (_("%u of %u lines, %.0f KiB/s"),
+                              progress.n_lines, progress.expected_lines,
+                              progress.elapsed > 0.0
+                              ? progress.bytes_read / 1024.0
+                              / progress.elapsed : 0.0);
+    }
+  else
+    {
+      gtk_progress_bar_pulse (GTK_PROGRESS_BAR (priv->progress_bar));
+      text = g_strdup_printf (_("%u lines, %.0f KiB/s"),
+                              progress.n_lines,
+                              progress.elapsed > 0.0
+                              ? progress.bytes_read / 1024.0
+                              / progress.elapsed : 0.0);
+    }
+
+  gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar), text);
+  g_free (text);
+
+  gtk_widget_show (priv->progress_bar);
+}
+
+static gboolean
+git_main_window_on_eta_timeout (gpointer data)
+{
+  git_main_window_update_source_state ((GitMainWindow *) data);
+
+  return TRUE;
+}
+
+static void
+git_main_window_destroy_confirm_dialog (GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+
+  if (priv->confirm_dialog)
+    {
+      g_signal_handler_disconnect (priv->confirm_dialog,
+                                   priv->confirm_response_handler);
+      gtk_widget_destroy (priv->confirm_dialog);
+      g_object_unref (priv->confirm_dialog);
+      priv->confirm_dialog = NULL;
+    }
+}
 
-  git_main_window_do_set_file (main_window, filename, revision);
+static void
+git_main_window_on_confirm_response (GtkDialog *dialog,
+                                     gint response_id,
+                                     GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+  GitSourceViewLoadMode mode;
 
-  git_main_window_add_history (main_window, filename, revision);
+  git_main_window_destroy_confirm_dialog (main_window);
+
+  if (response_id == GTK_RESPONSE_ACCEPT)
+    mode = GIT_SOURCE_VIEW_LOAD_FULL;
+  else if (response_id == GTK_RESPONSE_APPLY)
+    mode = git_blame_estimator_get_flags
+      (git_source_view_get_estimator (GIT_SOURCE_VIEW (priv->source_view)))
+      ? GIT_SOURCE_VIEW_LOAD_HEADER : GIT_SOURCE_VIEW_LOAD_VISIBLE;
+  else
+    mode = GIT_SOURCE_VIEW_LOAD_CANCEL;
 
   if (priv->source_view)
-    gtk_widget_grab_focus (priv->source_view);
+    git_source_view_confirm_load (GIT_SOURCE_VIEW (priv->source_view), mode);
+}
+
+static gchar *
+git_main_window_format_duration (gdouble seconds)
+{
+  gint value = (gint) (seconds + 0.5);
+
+  if (value < 60)
+    return g_strdup_printf (ngettext ("about %d second",
+                                      "about %d seconds",
+                                      value), value);
+  else
+    {
+      value = (value + 30) / 60;
+
+      return g_strdup_printf (ngettext ("about %d minute",
+                                        "about %d minutes",
+                                        value), value);
+    }
+}
+
+static void
+git_main_window_show_confirm_dialog (GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+  GitSourceView *sview = GIT_SOURCE_VIEW (priv->source_view);
+  GitBlameEstimator *estimator = git_source_view_get_estimator (sview);
+  GitBlameEstimatorFlags flags = git_blame_estimator_get_flags (estimator);
+  gchar *duration, *message, *size, *header_label;
+
+  if (priv->confirm_dialog)
+    return;
+
+  duration = git_main_window_format_duration
+    (git_blame_estimator_get_estimate (estimator));
+  size = g_format_size_for_display (git_blame_estimator_get_size
+                                    (estimator));
+
+  if ((flags & GIT_BLAME_ESTIMATOR_BINARY))
+    message = g_strdup (_("This looks like a binary file"));
+  else if ((flags & GIT_BLAME_ESTIMATOR_GENERATED))
+    message = g_strdup (_("This file is marked as generated"));
+  else if ((flags & GIT_BLAME_ESTIMATOR_LARGE))
+    message = g_strdup_printf (_("This file is %s"), size);
+  else
+    message = g_strdup_printf (_("Blaming this file will take %s"),
+                               duration);
+
+  priv->confirm_dialog
+    = gtk_message_dialog_new (GTK_WINDOW (main_window),
+                              GTK_DIALOG_DESTROY_WITH_PARENT,
+                              flags ? GTK_MESSAGE_WARNING
+                              : GTK_MESSAGE_QUESTION,
+                              GTK_BUTTONS_NONE,
+                              "%s", message);
+  g_object_ref_sink (priv->confirm_dialog);
+  gtk_message_dialog_format_secondary_text
+    (GTK_MESSAGE_DIALOG (priv->confirm_dialog),
+     _("The file is %s with %u lines and %u commits in its history. "
+       "Blaming all of it will take %s."),
+     size,
+     git_blame_estimator_get_n_lines (estimator),
+     git_blame_estimator_get_n_commits (estimator),
+     duration);
+
+  gtk_dialog_add_button (GTK_DIALOG (priv->confirm_dialog),
+                         GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL);
+
+  /* Suspicious files are offered a blame of just the first few lines
+     instead of the visible lines so that the size of the blame is
+     limited regardless of the size of the window */
+  if (flags)
+    {
+      header_label = g_strdup_printf (_("Blame _First %u Lines"),
+                                      git_source_view_get_header_lines
+                                      (sview));
+      gtk_dialog_add_button (GTK_DIALOG (priv->confirm_dialog),
+                             header_label, GTK_RESPONSE_APPLY);
+      g_free (header_label);
+    }
+  else
+    gtk_dialog_add_button (GTK_DIALOG (priv->confirm_dialog),
+                           _("Blame _Visible Lines"), GTK_RESPONSE_APPLY);
+
+  gtk_dialog_add_button (GTK_DIALOG (priv->confirm_dialog),
+                         _("Blame _Whole File"), GTK_RESPONSE_ACCEPT);
+  gtk_dialog_set_default_response (GTK_DIALOG (priv->confirm_dialog),
+                                   flags ? GTK_RESPONSE_CANCEL
+                                   : GTK_RESPONSE_APPLY);
+
+  priv->confirm_response_handler
+    = g_signal_connect (priv->confirm_dialog, "response",
+                        G_CALLBACK (git_main_window_on_confirm_response),
+                        main_window);
+
+  gtk_widget_show (priv->confirm_dialog);
+
+  g_free (message);
+  g_free (size);
+  g_free (duration);
 }
 
 static void
 git_main_window_update_source_state (GitMainWindow *main_window)
 {
   GitMainWindowPrivate *priv = main_window->priv;
+  GitSourceViewState state;
 
   if (priv->statusbar && priv->source_view)
     {
@@ -408,9 +893,68 @@ git_main_window_update_source_state (GitMainWindow *main_window)
           priv->source_state_id = 0;
         }
 
-      switch (git_source_view_get_state (GIT_SOURCE_VIEW (priv->source_view)))
+      state = git_source_view_get_state (GIT_SOURCE_VIEW (priv->source_view));
+
+      /* Keep updating the estimated time remaining while loading */
+      if (state == GIT_SOURCE_VIEW_LOADING)
+        {
+          if (priv->eta_timeout == 0)
+            priv->eta_timeout
+              = g_timeout_add_seconds (1, git_main_window_on_eta_timeout,
+                                       main_window);
+        }
+      else if (priv->eta_timeout)
+        {
+          g_source_remove (priv->eta_timeout);
+          priv->eta_timeout = 0;
+        }
+
+      if (state != GIT_SOURCE_VIEW_CONFIRM)
+        git_main_window_destroy_confirm_dialog (main_window);
+
+      git_main_window_update_progress (main_window);
+
+      switch (state)
         {
         case GIT_SOURCE_VIEW_READY:
+          {
+            GitAnnotatedSource *source
+              = git_source_view_get_source (GIT_SOURCE_VIEW
+                                            (priv->source_view));
+            GitBlameCacheStats stats;
+
+            if (priv->owner_panel && source)
+              git_owner_panel_set_source (GIT_OWNER_PANEL (priv->owner_panel),
+                                          source);
+            if (priv->age_histogram && source)
+              git_age_histogram_set_source (GIT_AGE_HISTOGRAM
+                                            (priv->age_histogram),
+                                            source);
+
+            /* Show how much of the cached blame had to be decoded */
+            if (source && git_annotated_source_get_cache_stats (source,
+                                                                &stats))
+              {
+                gchar *message
+                  = g_strdup_printf (_("Loaded from cache "
+                                       "(%.0f%% of original size, "
+                                       "%u of %u blocks decoded "
+                                       "in %.1f ms)"),
+                                     stats.raw_size
+                                     ? stats.compressed_size * 100.0
+                                     / stats.raw_size : 100.0,
+                                     stats.n_blocks_decoded,
+                                     stats.n_blocks,
+                                     stats.decode_time * 1000.0);
+
+                priv->source_state_id
+                  = gtk_statusbar_push (GTK_STATUSBAR (priv->statusbar),
+                                        priv->source_state_context,
+                                        message);
+
+                g_free (message);
+              }
+          }
           break;
 
         case GIT_SOURCE_VIEW_ERROR:
@@ -433,10 +977,47 @@ git_main_window_update_source_state (GitMainWindow *main_window)
           break;
 
         case GIT_SOURCE_VIEW_LOADING:
+          {
+            gdouble eta
+              = git_source_view_get_load_eta (GIT_SOURCE_VIEW
+                                              (priv->source_view));
+            gchar *message, *duration;
+
+            /* Cached blames are estimated to take no time at all so
+               they are allowed to go a little over before saying
+               so */
+            if (eta < 0.0)
+              message = g_strdup (_("Loading..."));
+            else if (git_source_view_get_load_overrun
+                     (GIT_SOURCE_VIEW (priv->source_view)) >= 1.0)
+              message = g_strdup (_("Loading, taking longer "
+                                    "than expected..."));
+            else if (eta < 1.0)
+              message = g_strdup (_("Loading, less than a second "
+                                    "remaining..."));
+            else
+              {
+                duration = git_main_window_format_duration (eta);
+                message = g_strdup_printf (_("Loading, %s remaining..."),
+                                           duration);
+                g_free (duration);
+              }
+
+            priv->source_state_id
+              = gtk_statusbar_push (GTK_STATUSBAR (priv->statusbar),
+                                    priv->source_state_context,
+                                    message);
+
+            g_free (message);
+          }
+          break;
+
+        case GIT_SOURCE_VIEW_CONFIRM:
           priv->source_state_id
             = gtk_statusbar_push (GTK_STATUSBAR (priv->statusbar),
                                   priv->source_state_context,
-                                  _("Loading..."));
+                                  _("Waiting for confirmation"));
+          git_main_window_show_confirm_dialog (main_window);
           break;
         }
     }
@@ -457,6 +1038,9 @@ git_main_window_update_history_actions (GitMainWindow *main_window)
   if (priv->revision_bar)
     gtk_widget_set_sensitive (priv->revision_bar,
                               priv->history_pos != NULL);
+  if (priv->revision_end_bar)
+    gtk_widget_set_sensitive (priv->revision_end_bar,
+                              priv->history_pos != NULL);
 }
 
 static void
@@ -488,6 +1072,9 @@ git_main_window_on_commit_selected (GitSourceView *sview,
 {
   GitMainWindowPrivate *priv = main_window->priv;
 
+  git_recorder_record (GIT_RECORDER_SELECT_COMMIT,
+                       git_commit_get_hash (commit), NULL);
+
   if (priv->commit_dialog == NULL)
     {
       priv->commit_dialog = g_object_ref_sink (git_commit_dialog_new ());
@@ -562,6 +1149,61 @@ git_main_window_on_file_response (GtkDialog *dialog, gint response,
   gtk_widget_hide (GTK_WIDGET (dialog));
 }
 
+static void
+git_main_window_on_dir_chooser_response (GtkDialog *dialog, gint response,
+                                         GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+
+  if (response == GTK_RESPONSE_OK)
+    {
+      gchar *dirname
+        = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (dialog));
+
+      if (dirname)
+        {
+          GtkWidget *dodiag = git_dir_owners_dialog_new ();
+          const gchar *revision = NULL;
+
+          /* Use the revision that is being viewed */
+          if (priv->history_pos)
+            revision = ((GitMainWindowHistoryItem *)
+                        priv->history_pos->data)->revision;
+
+          gtk_window_set_transient_for (GTK_WINDOW (dodiag),
+                                        GTK_WINDOW (main_window));
+          g_signal_connect (dodiag, "response",
+                            G_CALLBACK (gtk_widget_destroy), NULL);
+          git_dir_owners_dialog_start (GIT_DIR_OWNERS_DIALOG (dodiag),
+                                       dirname, revision);
+          gtk_widget_show (dodiag);
+
+          g_free (dirname);
+        }
+    }
+
+  gtk_widget_destroy (GTK_WIDGET (dialog));
+}
+
+static void
+git_main_window_on_dir_ownership (GtkAction *action,
+                                  GitMainWindow *main_window)
+{
+  GtkWidget *dialog
+    = gtk_file_chooser_dialog_new (_("Directory Ownership"),
+                                   GTK_WINDOW (main_window),
+                                   GTK_FILE_CHOOSER_ACTION_SELECT_FOLDER,
+                                   GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+                                   GTK_STOCK_OK, GTK_RESPONSE_OK,
+                                   NULL);
+
+  g_signal_connect (dialog, "response",
+                    G_CALLBACK (git_main_window_on_dir_chooser_response),
+                    main_window);
+
+  gtk_widget_show (dialog);
+}
+
 static void
 git_main_window_on_open (GtkAction *action,
                          GitMainWindow *main_window)
@@ -658,53 +1300,402 @@ git_main_window_on_about (GtkAction *action,
                          NULL);
 }
 
+static void
+git_main_window_on_memory_usage (GtkAction *action,
+                                 GitMainWindow *main_window)
+{
+  GtkWidget *dialog;
+  gchar *report = git_memory_get_report ();
+
+  dialog = gtk_message_dialog_new (GTK_WINDOW (main_window),
+                                   GTK_DIALOG_DESTROY_WITH_PARENT,
+                                   GTK_MESSAGE_INFO,
+                                   GTK_BUTTONS_CLOSE,
+                                   "%s", _("Memory usage"));
+  gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dialog),
+                                            "%s", report);
+  g_signal_connect (dialog, "response",
+                    G_CALLBACK (gtk_widget_destroy), NULL);
+  gtk_widget_show (dialog);
+
+  g_free (report);
+}
+
+/* The accelerators for the edit actions take precedence over the key
+   bindings of the focused widget so the revision entry has to be
+   handled here as well */
+static GtkEditable *
+git_main_window_get_focus_editable (GitMainWindow *main_window)
+{
+  GtkWidget *focus = gtk_window_get_focus (GTK_WINDOW (main_window));
+
+  return GTK_IS_EDITABLE (focus) ? GTK_EDITABLE (focus) : NULL;
+}
+
+static void
+git_main_window_on_copy (GtkAction *action,
+                         GitMainWindow *main_window)
+{
+  GtkEditable *editable = git_main_window_get_focus_editable (main_window);
+
+  if (editable)
+    gtk_editable_copy_clipboard (editable);
+  else
+    git_source_view_copy_clipboard
+      (GIT_SOURCE_VIEW (main_window->priv->source_view), FALSE);
+}
+
+static void
+git_main_window_on_copy_annotated (GtkAction *action,
+                                   GitMainWindow *main_window)
+{
+  git_source_view_copy_clipboard
+    (GIT_SOURCE_VIEW (main_window->priv->source_view), TRUE);
+}
+
+static void
+git_main_window_on_select_all (GtkAction *action,
+                               GitMainWindow *main_window)
+{
+  GtkEditable *editable = git_main_window_get_focus_editable (main_window);
+
+  if (editable)
+    gtk_editable_select_region (editable, 0, -1);
+  else
+    git_source_view_select_all
+      (GIT_SOURCE_VIEW (main_window->priv->source_view));
+}
+
+static void
+git_main_window_on_line_numbers (GtkToggleAction *action,
+                                 GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+
+  if (priv->source_view == NULL
+      || priv->line_numbers_action == NULL
+      || priv->orig_line_numbers_action == NULL)
+    return;
+
+  git_source_view_set_show_line_numbers
+    (GIT_SOURCE_VIEW (priv->source_view),
+     gtk_toggle_action_get_active (priv->line_numbers_action),
+     gtk_toggle_action_get_active (priv->orig_line_numbers_action));
+}
+
+static void
+git_main_window_on_ownership (GtkToggleAction *action,
+                              GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+
+  if (priv->side_pane == NULL)
+    return;
+
+  if (gtk_toggle_action_get_active (action))
+    gtk_widget_show (priv->side_pane);
+  else
+    gtk_widget_hide (priv->side_pane);
+}
+
+static void
+git_main_window_on_age_colors (GtkToggleAction *action,
+                               GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+
+  if (priv->source_view)
+    git_source_view_set_color_mode (GIT_SOURCE_VIEW (priv->source_view),
+                                    gtk_toggle_action_get_active (action)
+                                    ? GIT_SOURCE_VIEW_COLOR_AGE
+                                    : GIT_SOURCE_VIEW_COLOR_COMMIT);
+}
+
+/* Returns the revision whose version of the file is shown. For a
+   reverse blame this is the start of the range */
+static gchar *
+git_main_window_get_shown_revision (GitMainWindowHistoryItem *item)
+{
+  const gchar *dots;
+
+  if (item->revision && item->reverse
+      && (dots = strstr (item->revision, "..")))
+    return g_strndup (item->revision, dots - item->revision);
+  else
+    return g_strdup (item->revision);
+}
+
+static void
+git_main_window_on_timeline (GtkAction *action,
+                             GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+  GitMainWindowHistoryItem *item;
+  GtkWidget *tdiag;
+  gchar *revision;
+
+  if (priv->history_pos == NULL)
+    return;
+
+  /* Show the history up to the revision that is being viewed */
+  item = (GitMainWindowHistoryItem *) priv->history_pos->data;
+  revision = git_main_window_get_shown_revision (item);
+
+  tdiag = git_timeline_dialog_new ();
+  gtk_window_set_transient_for (GTK_WINDOW (tdiag),
+                                GTK_WINDOW (main_window));
+  g_signal_connect (tdiag, "response",
+                    G_CALLBACK (gtk_widget_destroy), NULL);
+  git_timeline_dialog_start (GIT_TIMELINE_DIALOG (tdiag),
+                             item->filename, revision);
+  gtk_widget_show (tdiag);
+
+  g_free (revision);
+}
+
+static void
+git_main_window_on_line_history (GtkAction *action,
+                                 GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+  GitMainWindowHistoryItem *item;
+  GtkWidget *ldiag;
+  guint first_line, last_line;
+  gchar *revision;
+
+  if (priv->history_pos == NULL || priv->source_view == NULL
+      || !git_source_view_get_selected_lines (GIT_SOURCE_VIEW
+                                              (priv->source_view),
+                                              &first_line, &last_line))
+    return;
+
+  item = (GitMainWindowHistoryItem *) priv->history_pos->data;
+  revision = git_main_window_get_shown_revision (item);
+
+  ldiag = git_line_log_dialog_new ();
+  gtk_window_set_transient_for (GTK_WINDOW (ldiag),
+                                GTK_WINDOW (main_window));
+  g_signal_connect (ldiag, "response",
+                    G_CALLBACK (gtk_widget_destroy), NULL);
+  git_line_log_dialog_start (GIT_LINE_LOG_DIALOG (ldiag),
+                             item->filename, revision,
+                             first_line, last_line);
+  gtk_widget_show (ldiag);
+
+  g_free (revision);
+}
+
+static void
+git_main_window_on_pickaxe_response (GtkDialog *dialog, gint response,
+                                     GitMainWindow *main_window)
+{
+  GitPickaxeDialog *pdiag = GIT_PICKAXE_DIALOG (dialog);
+  GitCommit *commit;
+
+  /* The dialog is kept open so that the other matches can be
+     viewed. The match is always shown with a forward blame because
+     the commit is not the start of a range */
+  if (response == GIT_PICKAXE_DIALOG_RESPONSE_VIEW_BLAME)
+    {
+      if ((commit = git_pickaxe_dialog_get_selected_commit (pdiag)))
+        git_main_window_set_file_full (main_window,
+                                       git_pickaxe_dialog_get_filename
+                                       (pdiag),
+                                       git_commit_get_hash (commit),
+                                       FALSE);
+    }
+  else
+    gtk_widget_destroy (GTK_WIDGET (dialog));
+}
+
+static void
+git_main_window_on_search_history (GtkAction *action,
+                                   GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+  GitMainWindowHistoryItem *item;
+  GtkWidget *pdiag;
+  gchar *revision, *text = NULL, *line_end;
+
+  if (priv->history_pos == NULL)
+    return;
+
+  item = (GitMainWindowHistoryItem *) priv->history_pos->data;
+  revision = git_main_window_get_shown_revision (item);
+
+  /* Only the first line of the selection is used because the text is
+     edited in a single line entry */
+  if (priv->source_view
+      && (text = git_source_view_get_selected_text (GIT_SOURCE_VIEW
+                                                    (priv->source_view)))
+      && (line_end = strchr (text, '\n')))
+    *line_end = '\0';
+
+  pdiag = git_pickaxe_dialog_new ();
+  gtk_window_set_transient_for (GTK_WINDOW (pdiag),
+                                GTK_WINDOW (main_window));
+  /* The response handler uses the main window */
+  gtk_window_set_destroy_with_parent (GTK_WINDOW (pdiag), TRUE);
+  g_signal_connect (pdiag, "response",
+                    G_CALLBACK (git_main_window_on_pickaxe_response),
+                    main_window);
+  git_pickaxe_dialog_start (GIT_PICKAXE_DIALOG (pdiag),
+                            item->filename, revision, text);
+  gtk_widget_show (pdiag);
+
+  g_free (text);
+  g_free (revision);
+}
+
+static void
+git_main_window_on_author_selected (GitOwnerPanel *panel,
+                                    const gchar *author,
+                                    GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+
+  if (priv->source_view)
+    git_source_view_set_highlight_author (GIT_SOURCE_VIEW
+                                          (priv->source_view),
+                                          author);
+}
+
 static void
 git_main_window_on_back (GtkAction *action,
                          GitMainWindow *main_window)
+{
+  git_main_window_go_back (main_window);
+}
+
+static void
+git_main_window_on_forward (GtkAction *action,
+                            GitMainWindow *main_window)
+{
+  git_main_window_go_forward (main_window);
+}
+
+static void
+git_main_window_reload_revision (GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv = main_window->priv;
+  GitMainWindowHistoryItem *item;
+  const gchar *start, *end;
+  gchar *revision;
+
+  if (priv->history_pos == NULL || priv->revision_bar == NULL)
+    return;
+
+  item = (GitMainWindowHistoryItem *) priv->history_pos->data;
+  start = gtk_entry_get_text (GTK_ENTRY (priv->revision_bar));
+
+  if (!priv->reverse)
+    revision = *start ? g_strdup (start) : NULL;
+  /* A reverse blame needs somewhere to start from */
+  else if (*start == '\0')
+    {
+      gtk_widget_grab_focus (priv->revision_bar);
+      return;
+    }
+  else if (priv->revision_end_bar
+           && *(end = gtk_entry_get_text (GTK_ENTRY
+                                          (priv->revision_end_bar))))
+    revision = g_strconcat (start, "..", end, NULL);
+  else
+    revision = g_strdup (start);
+
+  git_main_window_set_file (main_window, item->filename, revision);
+
+  g_free (revision);
+}
+
+static void
+git_main_window_on_revision (GtkEntry *entry,
+                             GitMainWindow *main_window)
+{
+  git_main_window_reload_revision (main_window);
+}
+
+static void
+git_main_window_on_reverse (GtkToggleAction *action,
+                            GitMainWindow *main_window)
 {
   GitMainWindowPrivate *priv = main_window->priv;
+  gboolean reverse = gtk_toggle_action_get_active (action);
+
+  if (reverse == priv->reverse)
+    return;
+
+  /* A reverse blame needs somewhere to start from so the toggle is
+     put back until a start revision has been entered */
+  if (reverse
+      && (priv->revision_bar == NULL
+          || *gtk_entry_get_text (GTK_ENTRY (priv->revision_bar)) == '\0'))
+    {
+      gtk_toggle_action_set_active (action, FALSE);
+      if (priv->revision_bar)
+        gtk_widget_grab_focus (priv->revision_bar);
+      return;
+    }
+
+  priv->reverse = reverse;
+  if (priv->revision_end_item)
+    g_object_set (priv->revision_end_item, "visible", reverse, NULL);
+
+  git_main_window_reload_revision (main_window);
+}
+
+void
+git_main_window_go_back (GitMainWindow *main_window)
+{
+  GitMainWindowPrivate *priv;
+
+  g_return_if_fail (GIT_IS_MAIN_WINDOW (main_window));
+
+  priv = main_window->priv;
 
   if (priv->history_pos && priv->history_pos->prev)
     {
       GitMainWindowHistoryItem *item;
+
+      git_recorder_record (GIT_RECORDER_BACK, NULL, NULL);
+
       priv->history_pos = priv->history_pos->prev;
       item = (GitMainWindowHistoryItem *) priv->history_pos->data;
-      git_main_window_do_set_file (main_window, item->filename, item->revision);
+      git_main_window_do_set_file (main_window, item->filename,
+                                   item->revision, item->reverse);
 
       git_main_window_update_history_actions (main_window);
     }
 }
 
-static void
-git_main_window_on_forward (GtkAction *action,
-                            GitMainWindow *main_window)
+void
+git_main_window_go_forward (GitMainWindow *main_window)
 {
-  GitMainWindowPrivate *priv = main_window->priv;
+  GitMainWindowPrivate *priv;
+
+  g_return_if_fail (GIT_IS_MAIN_WINDOW (main_window));
+
+  priv = main_window->priv;
 
   if (priv->history_pos && priv->history_pos->next)
     {
       GitMainWindowHistoryItem *item;
+
+      git_recorder_record (GIT_RECORDER_FORWARD, NULL, NULL);
+
       priv->history_pos = priv->history_pos->next;
       item = (GitMainWindowHistoryItem *) priv->history_pos->data;
-      git_main_window_do_set_file (main_window, item->filename, item->revision);
+      git_main_window_do_set_file (main_window, item->filename,
+                                   item->revision, item->reverse);
 
       git_main_window_update_history_actions (main_window);
     }
 }
 
-static void
-git_main_window_on_revision (GtkEntry *entry,
-                             GitMainWindow *main_window)
+GtkWidget *
+git_main_window_get_source_view (GitMainWindow *main_window)
 {
-  GitMainWindowPrivate *priv = main_window->priv;
-
-  if (priv->history_pos)
-    {
-      GitMainWindowHistoryItem *item
-        = (GitMainWindowHistoryItem *) priv->history_pos->data;
-      const gchar *revision = gtk_entry_get_text (entry);
+  g_return_val_if_fail (GIT_IS_MAIN_WINDOW (main_window), NULL);
 
-      git_main_window_set_file (main_window, item->filename,
-                                strlen (revision) ? revision : NULL);
-    }
+  return main_window->priv->source_view;
 }
@@ -66,6 +66,9 @@ GtkWidget *git_main_window_new (void);
 void git_main_window_set_file (GitMainWindow *main_window,
                                const gchar *filename,
                                const gchar *revision);
+void git_main_window_go_back (GitMainWindow *main_window);
+void git_main_window_go_forward (GitMainWindow *main_window);
+GtkWidget *git_main_window_get_source_view (GitMainWindow *main_window);
 
 G_END_DECLS
 
@@ -0,0 +1,362 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Keeps a count of the bytes used by each of the big consumers of
+   memory so that the cost of a blame can be seen. The counts are
+   estimates of the memory that each subsystem allocates itself
+   rather than exact figures from the allocator. If a budget is set
+   then going over it causes the registered trim functions to be
+   called from the main loop to release whatever caches can be
+   rebuilt. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef G_OS_UNIX
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#ifdef HAVE_MALLOC_TRIM
+#include <malloc.h>
+#endif
+
+#include "git-memory.h"
+#include "intl.h"
+
+/* Minimum number of seconds between each automatic trim so that
+   being over budget doesn't cause the caches to be constantly
+   thrown away */
+#define GIT_MEMORY_TRIM_INTERVAL 5
+/* Going over budget only causes a trim if the caches that can be
+   trimmed are using at least this fraction of the budget. Otherwise a
+   file whose text alone is over budget would have its caches rebuilt
+   and thrown away over and over without getting any closer */
+#define GIT_MEMORY_TRIM_MIN_FRACTION 0.1
+
+typedef struct _GitMemoryTrimClosure GitMemoryTrimClosure;
+
+struct _GitMemoryTrimClosure
+{
+  GitMemoryTrimFunc func;
+  gpointer data;
+};
+
+G_LOCK_DEFINE_STATIC (git_memory);
+
+static gsize git_memory_counters[GIT_MEMORY_N_CATEGORIES];
+static gsize git_memory_budget = 0;
+static guint git_memory_trim_source = 0;
+static GTimeVal git_memory_last_trim;
+static GSList *git_memory_trim_funcs = NULL;
+
+/* Only the layouts are released by the trim functions. The line text
+   and commits are needed for as long as the file is shown */
+static const gboolean
+git_memory_category_trimmable[GIT_MEMORY_N_CATEGORIES] =
+  {
+    FALSE,
+    FALSE,
+    TRUE,
+    FALSE
+  };
+
+static const gchar * const
+git_memory_category_names[GIT_MEMORY_N_CATEGORIES] =
+  {
+    N_("Line text"),
+    N_("Commits"),
+    N_("Layouts"),
+    N_("Reader buffers")
+  };
+
+#ifdef G_OS_UNIX
+static int git_memory_signal_pipe[2] = { -1, -1 };
+#endif
+
+static gboolean
+git_memory_on_trim_source (gpointer data)
+{
+  G_LOCK (git_memory);
+  git_memory_trim_source = 0;
+  G_UNLOCK (git_memory);
+
+  git_memory_trim ();
+
+  return FALSE;
+}
+
+/* Adds bytes to the count for a category. Bytes can be negative
+   when memory is released. This can be called from any thread */
+void
+git_memory_add (GitMemoryCategory category, gssize bytes)
+{
+  gsize total = 0, trimmable = 0;
+  guint i;
+
+  g_return_if_fail (category >= 0 && category < GIT_MEMORY_N_CATEGORIES);
+
+  G_LOCK (git_memory);
+
+  git_memory_counters[category] += bytes;
+
+  if (git_memory_budget > 0 && bytes > 0 && git_memory_trim_source == 0)
+    {
+      for (i = 0; i < GIT_MEMORY_N_CATEGORIES; i++)
+        {
+          total += git_memory_counters[i];
+          if (git_memory_category_trimmable[i])
+            trimmable += git_memory_counters[i];
+        }
+
+      if (total > git_memory_budget
+          && trimmable >= git_memory_budget * GIT_MEMORY_TRIM_MIN_FRACTION)
+        {
+          GTimeVal now;
+
+          /* The trim is always done from the main loop because the
+             trim functions aren't thread safe */
+          g_get_current_time (&now);
+          if (now.tv_sec - git_memory_last_trim.tv_sec
+              >= GIT_MEMORY_TRIM_INTERVAL)
+            git_memory_trim_source
+              = g_idle_add (git_memory_on_trim_source, NULL);
+          else
+            git_memory_trim_source
+              = g_timeout_add_seconds (GIT_MEMORY_TRIM_INTERVAL,
+                                       git_memory_on_trim_source, NULL);
+        }
+    }
+
+  G_UNLOCK (git_memory);
+}
+
+gsize
+git_memory_get (GitMemoryCategory category)
+{
+  gsize ret;
+
+  g_return_val_if_fail (category >= 0
+                        && category < GIT_MEMORY_N_CATEGORIES, 0);
+
+  G_LOCK (git_memory);
+  ret = git_memory_counters[category];
+  G_UNLOCK (git_memory);
+
+  return ret;
+}
+
+gsize
+git_memory_get_total (void)
+{
+  gsize ret = 0;
+  guint i;
+
+  G_LOCK (git_memory);
+  for (i = 0; i < GIT_MEMORY_N_CATEGORIES; i++)
+    ret += git_memory_counters[i];
+  G_UNLOCK (git_memory);
+
+  return ret;
+}
+
+/* Sets the number of bytes that can be used before the caches are
+   trimmed. 0 means there is no limit */
+void
+git_memory_set_budget (gsize budget)
+{
+  G_LOCK (git_memory);
+  git_memory_budget = budget;
+  G_UNLOCK (git_memory);
+}
+
+/* Registers a function that will be called from the main loop to
+   release memory when the budget is exceeded */
+void
+git_memory_add_trim_func (GitMemoryTrimFunc func, gpointer data)
+{
+  GitMemoryTrimClosure *closure;
+
+  g_return_if_fail (func != NULL);
+
+  closure = g_slice_new (GitMemoryTrimClosure);
+  closure->func = func;
+  closure->data = data;
+
+  git_memory_trim_funcs = g_slist_prepend (git_memory_trim_funcs, closure);
+}
+
+void
+git_memory_remove_trim_func (GitMemoryTrimFunc func, gpointer data)
+{
+  GSList *l;
+
+  for (l = git_memory_trim_funcs; l; l = l->next)
+    {
+      GitMemoryTrimClosure *closure = l->data;
+
+      if (closure->func == func && closure->data == data)
+        {
+          git_memory_trim_funcs
+            = g_slist_delete_link (git_memory_trim_funcs, l);
+          g_slice_free (GitMemoryTrimClosure, closure);
+          return;
+        }
+    }
+
+  g_warning ("Trim function %p with data %p not found", func, data);
+}
+
+/* Releases as much memory as possible by calling all of the trim
+   functions and then giving free memory back to the system */
+void
+git_memory_trim (void)
+{
+  GSList *l, *next;
+
+  G_LOCK (git_memory);
+  g_get_current_time (&git_memory_last_trim);
+  G_UNLOCK (git_memory);
+
+  /* The trim function is allowed to remove itself */
+  for (l = git_memory_trim_funcs; l; l = next)
+    {
+      GitMemoryTrimClosure *closure = l->data;
+
+      next = l->next;
+      closure->func (closure->data);
+    }
+
+#ifdef HAVE_MALLOC_TRIM
+  malloc_trim (0);
+#endif
+}
+
+/* Returns a description of the memory used by each category */
+gchar *
+git_memory_get_report (void)
+{
+  GString *report = g_string_new (NULL);
+  gsize counters[GIT_MEMORY_N_CATEGORIES], total = 0, budget;
+  gchar *size;
+  guint i;
+
+  G_LOCK (git_memory);
+  for (i = 0; i < GIT_MEMORY_N_CATEGORIES; i++)
+    counters[i] = git_memory_counters[i];
+  budget = git_memory_budget;
+  G_UNLOCK (git_memory);
+
+  for (i = 0; i < GIT_MEMORY_N_CATEGORIES; i++)
+    {
+      size = g_format_size_for_display (counters[i]);
+      g_string_append_printf (report, "%s: %s\n",
+                              _(git_memory_category_names[i]), size);
+      g_free (size);
+
+      total += counters[i];
+    }
+
+  size = g_format_size_for_display (total);
+  g_string_append_printf (report, _("Total: %s"), size);
+  g_free (size);
+
+  if (budget > 0)
+    {
+      size = g_format_size_for_display (budget);
+      g_string_append_printf (report, _(" (budget %s)"), size);
+      g_free (size);
+    }
+
+  g_string_append_c (report, '\n');
+
+  return g_string_free (report, FALSE);
+}
+
+#ifdef G_OS_UNIX
+
+static void
+git_memory_on_signal (int signum)
+{
+  int saved_errno = errno;
+  ssize_t ret;
+
+  /* Only async-signal-safe functions can be used here so the dump
+     is done from the main loop when it sees the byte. If the pipe is
+     full then a dump is already pending so the result is ignored */
+  ret = write (git_memory_signal_pipe[1], "", 1);
+  (void) ret;
+
+  errno = saved_errno;
+}
+
+static gboolean
+git_memory_on_signal_pipe (GIOChannel *source, GIOCondition condition,
+                           gpointer data)
+{
+  gchar buf[16], *report;
+
+  /* Multiple signals can be collapsed into one dump */
+  while (read (git_memory_signal_pipe[0], buf, sizeof (buf)) > 0);
+
+  report = git_memory_get_report ();
+  fprintf (stderr, "%s: memory usage\n%s", g_get_prgname (), report);
+  fflush (stderr);
+  g_free (report);
+
+  return TRUE;
+}
+
+#endif /* G_OS_UNIX */
+
+/* Makes SIGUSR1 dump the memory report to stderr */
+void
+git_memory_install_dump_signal (void)
+{
+#ifdef G_OS_UNIX
+  struct sigaction sa;
+  GIOChannel *channel;
+
+  g_return_if_fail (git_memory_signal_pipe[0] == -1);
+
+  if (pipe (git_memory_signal_pipe) == -1)
+    {
+      g_warning ("pipe: %s", g_strerror (errno));
+      return;
+    }
+
+  fcntl (git_memory_signal_pipe[0], F_SETFL, O_NONBLOCK);
+  fcntl (git_memory_signal_pipe[1], F_SETFL, O_NONBLOCK);
+
+  channel = g_io_channel_unix_new (git_memory_signal_pipe[0]);
+  g_io_add_watch (channel, G_IO_IN, git_memory_on_signal_pipe, NULL);
+  g_io_channel_unref (channel);
+
+  memset (&sa, 0, sizeof (sa));
+  sa.sa_handler = git_memory_on_signal;
+  sigemptyset (&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  sigaction (SIGUSR1, &sa, NULL);
+#endif /* G_OS_UNIX */
+}
@@ -0,0 +1,55 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_MEMORY_H__
+#define __GIT_MEMORY_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Environment variable with the number of megabytes that can be used
+   before the caches are trimmed. 0 or unset means no limit */
+#define GIT_MEMORY_BUDGET_ENV "BLAME_BROWSE_MEMORY_BUDGET"
+
+typedef enum
+  {
+    GIT_MEMORY_LINE_TEXT,
+    GIT_MEMORY_COMMITS,
+    GIT_MEMORY_LAYOUTS,
+    GIT_MEMORY_READER_BUFFERS,
+
+    GIT_MEMORY_N_CATEGORIES
+  } GitMemoryCategory;
+
+typedef void (* GitMemoryTrimFunc) (gpointer data);
+
+void git_memory_add (GitMemoryCategory category, gssize bytes);
+gsize git_memory_get (GitMemoryCategory category);
+gsize git_memory_get_total (void);
+
+void git_memory_set_budget (gsize budget);
+void git_memory_add_trim_func (GitMemoryTrimFunc func, gpointer data);
+void git_memory_remove_trim_func (GitMemoryTrimFunc func, gpointer data);
+void git_memory_trim (void);
+
+gchar *git_memory_get_report (void);
+void git_memory_install_dump_signal (void);
+
+G_END_DECLS
+
+#endif /* __GIT_MEMORY_H__ */
@@ -0,0 +1,293 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtk/gtkscrolledwindow.h>
+#include <gtk/gtktreeview.h>
+#include <gtk/gtktreestore.h>
+#include <gtk/gtkcellrenderertext.h>
+#include <string.h>
+
+#include "git-owner-panel.h"
+#include "git-annotated-source.h"
+#include "git-common.h"
+#include "intl.h"
+
+static void git_owner_panel_dispose (GObject *object);
+
+static void git_owner_panel_on_selection_changed (GtkTreeSelection *selection,
+                                                  GitOwnerPanel *panel);
+
+G_DEFINE_TYPE (GitOwnerPanel, git_owner_panel, GTK_TYPE_SCROLLED_WINDOW);
+
+#define GIT_OWNER_PANEL_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_OWNER_PANEL, \
+                                GitOwnerPanelPrivate))
+
+struct _GitOwnerPanelPrivate
+{
+  GtkWidget *tree_view;
+  GtkTreeStore *store;
+  guint selection_changed_handler;
+};
+
+enum
+  {
+    AUTHOR_SELECTED,
+
+    LAST_SIGNAL
+  };
+
+static guint client_signals[LAST_SIGNAL];
+
+/* Authors are top level rows and their commits are the children. The
+   author column is filled in for both so that selecting a commit
+   still highlights the author */
+enum
+  {
+    GIT_OWNER_PANEL_COL_NAME,
+    GIT_OWNER_PANEL_COL_LINES,
+    GIT_OWNER_PANEL_COL_PERCENT,
+    GIT_OWNER_PANEL_COL_LATEST,
+    GIT_OWNER_PANEL_COL_AUTHOR,
+
+    GIT_OWNER_PANEL_N_COLUMNS
+  };
+
+static void
+git_owner_panel_class_init (GitOwnerPanelClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->dispose = git_owner_panel_dispose;
+
+  client_signals[AUTHOR_SELECTED]
+    = g_signal_new ("author-selected",
+                    G_TYPE_FROM_CLASS (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitOwnerPanelClass, author_selected),
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__STRING,
+                    G_TYPE_NONE, 1,
+                    G_TYPE_STRING);
+
+  g_type_class_add_private (klass, sizeof (GitOwnerPanelPrivate));
+}
+
+static void
+git_owner_panel_add_column (GitOwnerPanel *panel, const gchar *title,
+                            gint column, gfloat xalign)
+{
+  GtkCellRenderer *renderer = gtk_cell_renderer_text_new ();
+  GtkTreeViewColumn *tree_column;
+
+  g_object_set (renderer, "xalign", xalign, NULL);
+
+  tree_column = gtk_tree_view_column_new_with_attributes (title, renderer,
+                                                          "text", column,
+                                                          NULL);
+  gtk_tree_view_column_set_resizable (tree_column, TRUE);
+  gtk_tree_view_append_column (GTK_TREE_VIEW (panel->priv->tree_view),
+                               tree_column);
+}
+
+static void
+git_owner_panel_init (GitOwnerPanel *self)
+{
+  GitOwnerPanelPrivate *priv;
+  GtkTreeSelection *selection;
+
+  priv = self->priv = GIT_OWNER_PANEL_GET_PRIVATE (self);
+
+  gtk_scrolled_window_set_hadjustment (GTK_SCROLLED_WINDOW (self), NULL);
+  gtk_scrolled_window_set_vadjustment (GTK_SCROLLED_WINDOW (self), NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (self),
+                                  GTK_POLICY_AUTOMATIC,
+                                  GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (self),
+                                       GTK_SHADOW_IN);
+
+  priv->store = gtk_tree_store_new (GIT_OWNER_PANEL_N_COLUMNS,
+                                    G_TYPE_STRING,
+                                    G_TYPE_UINT,
+                                    G_TYPE_STRING,
+                                    G_TYPE_STRING,
+                                    G_TYPE_STRING);
+
+  priv->tree_view = g_object_ref_sink
+    (gtk_tree_view_new_with_model (GTK_TREE_MODEL (priv->store)));
+
+  git_owner_panel_add_column (self, _("Author"),
+                              GIT_OWNER_PANEL_COL_NAME, 0.0f);
+  git_owner_panel_add_column (self, _("Lines"),
+                              GIT_OWNER_PANEL_COL_LINES, 1.0f);
+  git_owner_panel_add_column (self, "%",
+                              GIT_OWNER_PANEL_COL_PERCENT, 1.0f);
+  git_owner_panel_add_column (self, _("Last Touched"),
+                              GIT_OWNER_PANEL_COL_LATEST, 0.0f);
+
+  selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (priv->tree_view));
+  priv->selection_changed_handler
+    = g_signal_connect (selection, "changed",
+                        G_CALLBACK (git_owner_panel_on_selection_changed),
+                        self);
+
+  gtk_widget_show (priv->tree_view);
+  gtk_container_add (GTK_CONTAINER (self), priv->tree_view);
+}
+
+static void
+git_owner_panel_dispose (GObject *object)
+{
+  GitOwnerPanel *self = (GitOwnerPanel *) object;
+  GitOwnerPanelPrivate *priv = self->priv;
+
+  if (priv->tree_view)
+    {
+      g_signal_handler_disconnect
+        (gtk_tree_view_get_selection (GTK_TREE_VIEW (priv->tree_view)),
+         priv->selection_changed_handler);
+      g_object_unref (priv->tree_view);
+      priv->tree_view = NULL;
+    }
+
+  if (priv->store)
+    {
+      g_object_unref (priv->store);
+      priv->store = NULL;
+    }
+
+  G_OBJECT_CLASS (git_owner_panel_parent_class)->dispose (object);
+}
+
+GtkWidget *
+git_owner_panel_new (void)
+{
+  GtkWidget *self = g_object_new (GIT_TYPE_OWNER_PANEL, NULL);
+
+  return self;
+}
+
+static gchar *
+git_owner_panel_format_percent (guint n_lines, guint total)
+{
+  return g_strdup_printf ("%.1f", total ? n_lines * 100.0 / total : 0.0);
+}
+
+static gchar *
+git_owner_panel_format_time (gulong time)
+{
+  GTimeVal time_val;
+
+  time_val.tv_sec = time;
+  time_val.tv_usec = 0;
+
+  return git_format_time_for_display (&time_val);
+}
+
+/* Fills the panel from the ownership summary of a source. Pass NULL
+   to empty it */
+void
+git_owner_panel_set_source (GitOwnerPanel *panel,
+                            GitAnnotatedSource *source)
+{
+  GitOwnerPanelPrivate *priv;
+  guint owner_num, n_owners, total;
+
+  g_return_if_fail (GIT_IS_OWNER_PANEL (panel));
+  g_return_if_fail (source == NULL || GIT_IS_ANNOTATED_SOURCE (source));
+
+  priv = panel->priv;
+
+  gtk_tree_store_clear (priv->store);
+
+  if (source == NULL)
+    return;
+
+  n_owners = git_annotated_source_get_n_owners (source);
+  total = git_annotated_source_get_n_lines (source);
+
+  for (owner_num = 0; owner_num < n_owners; owner_num++)
+    {
+      const GitAnnotatedSourceOwner *owner
+        = git_annotated_source_get_owner (source, owner_num);
+      GtkTreeIter owner_iter, commit_iter;
+      gchar *percent, *latest;
+      guint i;
+
+      percent = git_owner_panel_format_percent (owner->n_lines, total);
+      latest = git_owner_panel_format_time (owner->latest_time);
+      gtk_tree_store_append (priv->store, &owner_iter, NULL);
+      gtk_tree_store_set (priv->store, &owner_iter,
+                          GIT_OWNER_PANEL_COL_NAME, owner->author,
+                          GIT_OWNER_PANEL_COL_LINES, owner->n_lines,
+                          GIT_OWNER_PANEL_COL_PERCENT, percent,
+                          GIT_OWNER_PANEL_COL_LATEST, latest,
+                          GIT_OWNER_PANEL_COL_AUTHOR, owner->author,
+                          -1);
+      g_free (percent);
+      g_free (latest);
+
+      for (i = 0; i < owner->commits->len; i++)
+        {
+          const GitAnnotatedSourceShare *share
+            = &g_array_index (owner->commits, GitAnnotatedSourceShare, i);
+          const gchar *summary = git_commit_get_prop (share->commit,
+                                                      "summary");
+          gchar *name;
+
+          name = g_strdup_printf ("%.8s %s",
+                                  git_commit_get_hash (share->commit),
+                                  summary ? summary : "");
+          percent = git_owner_panel_format_percent (share->n_lines, total);
+          latest = git_owner_panel_format_time
+            (git_commit_get_author_time (share->commit));
+          gtk_tree_store_append (priv->store, &commit_iter, &owner_iter);
+          gtk_tree_store_set (priv->store, &commit_iter,
+                              GIT_OWNER_PANEL_COL_NAME, name,
+                              GIT_OWNER_PANEL_COL_LINES, share->n_lines,
+                              GIT_OWNER_PANEL_COL_PERCENT, percent,
+                              GIT_OWNER_PANEL_COL_LATEST, latest,
+                              GIT_OWNER_PANEL_COL_AUTHOR, owner->author,
+                              -1);
+          g_free (name);
+          g_free (percent);
+          g_free (latest);
+        }
+    }
+}
+
+static void
+git_owner_panel_on_selection_changed (GtkTreeSelection *selection,
+                                      GitOwnerPanel *panel)
+{
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+  gchar *author = NULL;
+
+  if (gtk_tree_selection_get_selected (selection, &model, &iter))
+    gtk_tree_model_get (model, &iter,
+                        GIT_OWNER_PANEL_COL_AUTHOR, &author,
+                        -1);
+
+  g_signal_emit (panel, client_signals[AUTHOR_SELECTED], 0, author);
+
+  g_free (author);
+}
@@ -0,0 +1,74 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_OWNER_PANEL_H__
+#define __GIT_OWNER_PANEL_H__
+
+#include <gtk/gtkscrolledwindow.h>
+#include "git-annotated-source.h"
+
+G_BEGIN_DECLS
+
+#define GIT_TYPE_OWNER_PANEL                                            \
+  (git_owner_panel_get_type())
+#define GIT_OWNER_PANEL(obj)                                            \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                   \
+                               GIT_TYPE_OWNER_PANEL,                    \
+                               GitOwnerPanel))
+#define GIT_OWNER_PANEL_CLASS(klass)                                    \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            GIT_TYPE_OWNER_PANEL,                       \
+                            GitOwnerPanelClass))
+#define GIT_IS_OWNER_PANEL(obj)                                         \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),                                   \
+                               GIT_TYPE_OWNER_PANEL))
+#define GIT_IS_OWNER_PANEL_CLASS(klass)                                 \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),                                    \
+                            GIT_TYPE_OWNER_PANEL))
+#define GIT_OWNER_PANEL_GET_CLASS(obj)                                  \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                    \
+                              GIT_TYPE_OWNER_PANEL,                     \
+                              GitOwnerPanelClass))
+
+typedef struct _GitOwnerPanel        GitOwnerPanel;
+typedef struct _GitOwnerPanelClass   GitOwnerPanelClass;
+typedef struct _GitOwnerPanelPrivate GitOwnerPanelPrivate;
+
+struct _GitOwnerPanelClass
+{
+  GtkScrolledWindowClass parent_class;
+
+  void (* author_selected) (GitOwnerPanel *panel, const gchar *author);
+};
+
+struct _GitOwnerPanel
+{
+  GtkScrolledWindow parent;
+
+  GitOwnerPanelPrivate *priv;
+};
+
+GType git_owner_panel_get_type (void) G_GNUC_CONST;
+
+GtkWidget *git_owner_panel_new (void);
+
+void git_owner_panel_set_source (GitOwnerPanel *panel,
+                                 GitAnnotatedSource *source);
+
+G_END_DECLS
+
+#endif /* __GIT_OWNER_PANEL_H__ */
@@ -0,0 +1,597 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtk/gtkdialog.h>
+#include <gtk/gtkvbox.h>
+#include <gtk/gtkhbox.h>
+#include <gtk/gtklabel.h>
+#include <gtk/gtkentry.h>
+#include <gtk/gtkcheckbutton.h>
+#include <gtk/gtkbutton.h>
+#include <gtk/gtkprogressbar.h>
+#include <gtk/gtkscrolledwindow.h>
+#include <gtk/gtktreeview.h>
+#include <gtk/gtkliststore.h>
+#include <gtk/gtkcellrenderertext.h>
+#include <gtk/gtkstock.h>
+
+#include "git-pickaxe-dialog.h"
+#include "git-pickaxe.h"
+#include "git-common.h"
+#include "intl.h"
+
+static void git_pickaxe_dialog_dispose (GObject *object);
+static void git_pickaxe_dialog_finalize (GObject *object);
+
+static void git_pickaxe_dialog_on_find (GtkWidget *widget,
+                                        GitPickaxeDialog *pdiag);
+static void git_pickaxe_dialog_on_stop (GtkButton *button,
+                                        GitPickaxeDialog *pdiag);
+static void git_pickaxe_dialog_on_row_activated (GtkTreeView *tree_view,
+                                                 GtkTreePath *path,
+                                                 GtkTreeViewColumn *column,
+                                                 GitPickaxeDialog *pdiag);
+static void git_pickaxe_dialog_on_selection_changed
+                                        (GtkTreeSelection *selection,
+                                         GitPickaxeDialog *pdiag);
+
+G_DEFINE_TYPE (GitPickaxeDialog, git_pickaxe_dialog, GTK_TYPE_DIALOG);
+
+#define GIT_PICKAXE_DIALOG_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_PICKAXE_DIALOG, \
+                                GitPickaxeDialogPrivate))
+
+struct _GitPickaxeDialogPrivate
+{
+  GitPickaxe *pickaxe;
+  guint completed_handler, progress_handler;
+
+  gchar *filename, *revision;
+
+  GtkWidget *entry, *regex_button, *find_button, *stop_button;
+  GtkWidget *progress_bar, *tree_view;
+  GtkListStore *store;
+  guint entry_activate_handler, find_clicked_handler, stop_clicked_handler;
+  guint row_activated_handler, selection_changed_handler;
+
+  /* Number of matches of the search that have been added to the
+     store */
+  guint n_rows;
+};
+
+/* The matches arrive in whatever order the searches finish so the
+   store is sorted on the position of the commit in the history to
+   keep the newest at the top */
+enum
+  {
+    GIT_PICKAXE_DIALOG_COL_HASH,
+    GIT_PICKAXE_DIALOG_COL_AUTHOR,
+    GIT_PICKAXE_DIALOG_COL_DATE,
+    GIT_PICKAXE_DIALOG_COL_SUMMARY,
+    GIT_PICKAXE_DIALOG_COL_POSITION,
+    GIT_PICKAXE_DIALOG_COL_MATCH,
+
+    GIT_PICKAXE_DIALOG_N_COLUMNS
+  };
+
+static void
+git_pickaxe_dialog_class_init (GitPickaxeDialogClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->dispose = git_pickaxe_dialog_dispose;
+  gobject_class->finalize = git_pickaxe_dialog_finalize;
+
+  g_type_class_add_private (klass, sizeof (GitPickaxeDialogPrivate));
+}
+
+static void
+git_pickaxe_dialog_add_column (GitPickaxeDialog *pdiag,
+                               const gchar *title,
+                               gint column, gint width)
+{
+  GtkCellRenderer *renderer = gtk_cell_renderer_text_new ();
+  GtkTreeViewColumn *tree_column;
+
+  tree_column = gtk_tree_view_column_new_with_attributes (title, renderer,
+                                                          "text", column,
+                                                          NULL);
+  gtk_tree_view_column_set_sizing (tree_column,
+                                   GTK_TREE_VIEW_COLUMN_FIXED);
+  gtk_tree_view_column_set_fixed_width (tree_column, width);
+  gtk_tree_view_column_set_resizable (tree_column, TRUE);
+  gtk_tree_view_append_column (GTK_TREE_VIEW (pdiag->priv->tree_view),
+                               tree_column);
+}
+
+static void
+git_pickaxe_dialog_init (GitPickaxeDialog *self)
+{
+  GitPickaxeDialogPrivate *priv;
+  GtkWidget *content, *hbox, *label, *scrolled_window;
+
+  priv = self->priv = GIT_PICKAXE_DIALOG_GET_PRIVATE (self);
+
+  gtk_window_set_title (GTK_WINDOW (self), _("Search History"));
+  gtk_window_set_default_size (GTK_WINDOW (self), 600, 400);
+  gtk_dialog_set_has_separator (GTK_DIALOG (self), FALSE);
+  gtk_container_set_border_width (GTK_CONTAINER (self), 5);
+
+  content = gtk_vbox_new (FALSE, 6);
+  gtk_container_set_border_width (GTK_CONTAINER (content), 5);
+
+  hbox = gtk_hbox_new (FALSE, 6);
+
+  label = gtk_label_new_with_mnemonic (_("_Search for:"));
+  gtk_widget_show (label);
+  gtk_box_pack_start (GTK_BOX (hbox), label, FALSE, FALSE, 0);
+
+  priv->entry = g_object_ref_sink (gtk_entry_new ());
+  gtk_label_set_mnemonic_widget (GTK_LABEL (label), priv->entry);
+  priv->entry_activate_handler
+    = g_signal_connect (priv->entry, "activate",
+                        G_CALLBACK (git_pickaxe_dialog_on_find), self);
+  gtk_widget_show (priv->entry);
+  gtk_box_pack_start (GTK_BOX (hbox), priv->entry, TRUE, TRUE, 0);
+
+  priv->regex_button = g_object_ref_sink
+    (gtk_check_button_new_with_mnemonic (_("_Regular expression")));
+  gtk_widget_show (priv->regex_button);
+  gtk_box_pack_start (GTK_BOX (hbox), priv->regex_button, FALSE, FALSE, 0);
+
+  priv->find_button
+    = g_object_ref_sink (gtk_button_new_from_stock (GTK_STOCK_FIND));
+  priv->find_clicked_handler
+    = g_signal_connect (priv->find_button, "clicked",
+                        G_CALLBACK (git_pickaxe_dialog_on_find), self);
+  gtk_widget_show (priv->find_button);
+  gtk_box_pack_start (GTK_BOX (hbox), priv->find_button, FALSE, FALSE, 0);
+
+  gtk_widget_show (hbox);
+  gtk_box_pack_start (GTK_BOX (content), hbox, FALSE, FALSE, 0);
+
+  hbox = gtk_hbox_new (FALSE, 6);
+
+  priv->progress_bar = g_object_ref_sink (gtk_progress_bar_new ());
+  gtk_widget_show (priv->progress_bar);
+  gtk_box_pack_start (GTK_BOX (hbox), priv->progress_bar, TRUE, TRUE, 0);
+
+  priv->stop_button
+    = g_object_ref_sink (gtk_button_new_from_stock (GTK_STOCK_STOP));
+  priv->stop_clicked_handler
+    = g_signal_connect (priv->stop_button, "clicked",
+                        G_CALLBACK (git_pickaxe_dialog_on_stop), self);
+  gtk_widget_set_sensitive (priv->stop_button, FALSE);
+  gtk_widget_show (priv->stop_button);
+  gtk_box_pack_start (GTK_BOX (hbox), priv->stop_button, FALSE, FALSE, 0);
+
+  gtk_widget_show (hbox);
+  gtk_box_pack_start (GTK_BOX (content), hbox, FALSE, FALSE, 0);
+
+  priv->store = gtk_list_store_new (GIT_PICKAXE_DIALOG_N_COLUMNS,
+                                    G_TYPE_STRING,
+                                    G_TYPE_STRING,
+                                    G_TYPE_STRING,
+                                    G_TYPE_STRING,
+                                    G_TYPE_UINT,
+                                    G_TYPE_UINT);
+  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (priv->store),
+                                        GIT_PICKAXE_DIALOG_COL_POSITION,
+                                        GTK_SORT_ASCENDING);
+
+  priv->tree_view = g_object_ref_sink
+    (gtk_tree_view_new_with_model (GTK_TREE_MODEL (priv->store)));
+  git_pickaxe_dialog_add_column (self, _("Commit"),
+                                 GIT_PICKAXE_DIALOG_COL_HASH, 80);
+  git_pickaxe_dialog_add_column (self, _("Author"),
+                                 GIT_PICKAXE_DIALOG_COL_AUTHOR, 130);
+  git_pickaxe_dialog_add_column (self, _("Date"),
+                                 GIT_PICKAXE_DIALOG_COL_DATE, 130);
+  git_pickaxe_dialog_add_column (self, _("Summary"),
+                                 GIT_PICKAXE_DIALOG_COL_SUMMARY, 300);
+  gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (priv->tree_view),
+                                       TRUE);
+  priv->row_activated_handler
+    = g_signal_connect (priv->tree_view, "row-activated",
+                        G_CALLBACK (git_pickaxe_dialog_on_row_activated),
+                        self);
+  priv->selection_changed_handler
+    = g_signal_connect (gtk_tree_view_get_selection
+                        (GTK_TREE_VIEW (priv->tree_view)),
+                        "changed",
+                        G_CALLBACK (git_pickaxe_dialog_on_selection_changed),
+                        self);
+  gtk_widget_show (priv->tree_view);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
+                                  GTK_POLICY_AUTOMATIC,
+                                  GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scrolled_window),
+                                       GTK_SHADOW_IN);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), priv->tree_view);
+  gtk_widget_show (scrolled_window);
+  gtk_box_pack_start (GTK_BOX (content), scrolled_window, TRUE, TRUE, 0);
+
+  gtk_widget_show (content);
+  gtk_box_pack_start (GTK_BOX (GTK_DIALOG (self)->vbox), content,
+                      TRUE, TRUE, 0);
+
+  gtk_dialog_add_buttons (GTK_DIALOG (self),
+                          _("View _blame"),
+                          GIT_PICKAXE_DIALOG_RESPONSE_VIEW_BLAME,
+                          GTK_STOCK_CLOSE, GTK_RESPONSE_CLOSE,
+                          NULL);
+  gtk_dialog_set_response_sensitive (GTK_DIALOG (self),
+                                     GIT_PICKAXE_DIALOG_RESPONSE_VIEW_BLAME,
+                                     FALSE);
+}
+
+static void
+git_pickaxe_dialog_unref_pickaxe (GitPickaxeDialog *pdiag)
+{
+  GitPickaxeDialogPrivate *priv = pdiag->priv;
+
+  /* The search is stopped if it is still running */
+  if (priv->pickaxe)
+    {
+      g_signal_handler_disconnect (priv->pickaxe, priv->completed_handler);
+      g_signal_handler_disconnect (priv->pickaxe, priv->progress_handler);
+      git_pickaxe_cancel (priv->pickaxe);
+      g_object_unref (priv->pickaxe);
+      priv->pickaxe = NULL;
+    }
+}
+
+static void
+git_pickaxe_dialog_dispose (GObject *object)
+{
+  GitPickaxeDialog *self = (GitPickaxeDialog *) object;
+  GitPickaxeDialogPrivate *priv = self->priv;
+
+  git_pickaxe_dialog_unref_pickaxe (self);
+
+  if (priv->entry)
+    {
+      g_signal_handler_disconnect (priv->entry,
+                                   priv->entry_activate_handler);
+      g_object_unref (priv->entry);
+      priv->entry = NULL;
+    }
+
+  if (priv->find_button)
+    {
+      g_signal_handler_disconnect (priv->find_button,
+                                   priv->find_clicked_handler);
+      g_object_unref (priv->find_button);
+      priv->find_button = NULL;
+    }
+
+  if (priv->stop_button)
+    {
+      g_signal_handler_disconnect (priv->stop_button,
+                                   priv->stop_clicked_handler);
+      g_object_unref (priv->stop_button);
+      priv->stop_button = NULL;
+    }
+
+  if (priv->tree_view)
+    {
+      g_signal_handler_disconnect (priv->tree_view,
+                                   priv->row_activated_handler);
+      g_signal_handler_disconnect (gtk_tree_view_get_selection
+                                   (GTK_TREE_VIEW (priv->tree_view)),
+                                   priv->selection_changed_handler);
+      g_object_unref (priv->tree_view);
+      priv->tree_view = NULL;
+    }
+
+  if (priv->regex_button)
+    {
+      g_object_unref (priv->regex_button);
+      priv->regex_button = NULL;
+    }
+
+  if (priv->progress_bar)
+    {
+      g_object_unref (priv->progress_bar);
+      priv->progress_bar = NULL;
+    }
+
+  if (priv->store)
+    {
+      g_object_unref (priv->store);
+      priv->store = NULL;
+    }
+
+  G_OBJECT_CLASS (git_pickaxe_dialog_parent_class)->dispose (object);
+}
+
+static void
+git_pickaxe_dialog_finalize (GObject *object)
+{
+  GitPickaxeDialog *self = (GitPickaxeDialog *) object;
+  GitPickaxeDialogPrivate *priv = self->priv;
+
+  g_free (priv->filename);
+  g_free (priv->revision);
+
+  G_OBJECT_CLASS (git_pickaxe_dialog_parent_class)->finalize (object);
+}
+
+GtkWidget *
+git_pickaxe_dialog_new (void)
+{
+  GtkWidget *self = g_object_new (GIT_TYPE_PICKAXE_DIALOG, NULL);
+
+  return self;
+}
+
+static void
+git_pickaxe_dialog_add_rows (GitPickaxeDialog *pdiag)
+{
+  GitPickaxeDialogPrivate *priv = pdiag->priv;
+  guint n_matches = git_pickaxe_get_n_matches (priv->pickaxe);
+
+  for (; priv->n_rows < n_matches; priv->n_rows++)
+    {
+      const GitPickaxeMatch *match
+        = git_pickaxe_get_match (priv->pickaxe, priv->n_rows);
+      const gchar *author = git_commit_get_prop (match->commit, "author");
+      const gchar *summary = git_commit_get_prop (match->commit, "summary");
+      gchar *hash = g_strndup (git_commit_get_hash (match->commit), 8);
+      gchar *display_time = NULL;
+      GtkTreeIter iter;
+      GTimeVal time_;
+
+      if ((time_.tv_sec = git_commit_get_author_time (match->commit)))
+        {
+          time_.tv_usec = 0;
+          display_time = git_format_time_for_display (&time_);
+        }
+
+      gtk_list_store_insert_with_values (priv->store, &iter, -1,
+                                         GIT_PICKAXE_DIALOG_COL_HASH, hash,
+                                         GIT_PICKAXE_DIALOG_COL_AUTHOR,
+                                         author ? author : "",
+                                         GIT_PICKAXE_DIALOG_COL_DATE,
+                                         display_time ? display_time : "",
+                                         GIT_PICKAXE_DIALOG_COL_SUMMARY,
+                                         summary ? summary : "",
+                                         GIT_PICKAXE_DIALOG_COL_POSITION,
+                                         match->position,
+                                         GIT_PICKAXE_DIALOG_COL_MATCH,
+                                         priv->n_rows,
+                                         -1);
+
+      g_free (display_time);
+      g_free (hash);
+    }
+}
+
+static void
+git_pickaxe_dialog_update_progress (GitPickaxeDialog *pdiag)
+{
+  GitPickaxeDialogPrivate *priv = pdiag->priv;
+  guint n_commits_done, n_commits;
+  gchar *text;
+
+  git_pickaxe_get_progress (priv->pickaxe, &n_commits_done, &n_commits);
+
+  text = g_strdup_printf (_("Searched %u of %u commits, %u found"),
+                          n_commits_done, n_commits, priv->n_rows);
+  gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar), text);
+  g_free (text);
+
+  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 n_commits > 0
+                                 ? n_commits_done / (gdouble) n_commits
+                                 : 0.0);
+}
+
+static void
+git_pickaxe_dialog_on_progress (GitPickaxe *pickaxe,
+                                GitPickaxeDialog *pdiag)
+{
+  git_pickaxe_dialog_add_rows (pdiag);
+  git_pickaxe_dialog_update_progress (pdiag);
+}
+
+static void
+git_pickaxe_dialog_on_completed (GitPickaxe *pickaxe,
+                                 const GError *error,
+                                 GitPickaxeDialog *pdiag)
+{
+  GitPickaxeDialogPrivate *priv = pdiag->priv;
+
+  git_pickaxe_dialog_add_rows (pdiag);
+
+  gtk_widget_set_sensitive (priv->stop_button, FALSE);
+
+  if (error)
+    {
+      gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (priv->progress_bar),
+                                     0.0);
+      gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 error->message);
+    }
+  else
+    {
+      gchar *text = g_strdup_printf (_("%u commits found"), priv->n_rows);
+      gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (priv->progress_bar),
+                                     1.0);
+      gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 text);
+      g_free (text);
+    }
+}
+
+/* Replaces any running search with a new one for the text in the
+   entry */
+static void
+git_pickaxe_dialog_run (GitPickaxeDialog *pdiag)
+{
+  GitPickaxeDialogPrivate *priv = pdiag->priv;
+  const gchar *text = gtk_entry_get_text (GTK_ENTRY (priv->entry));
+  GitPickaxeMode mode;
+  GError *error = NULL;
+
+  git_pickaxe_dialog_unref_pickaxe (pdiag);
+  gtk_list_store_clear (priv->store);
+  priv->n_rows = 0;
+
+  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (priv->progress_bar), 0.0);
+  gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar), "");
+
+  if (priv->filename == NULL || *text == '\0')
+    return;
+
+  mode = (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON
+                                        (priv->regex_button))
+          ? GIT_PICKAXE_MODE_REGEX : GIT_PICKAXE_MODE_STRING);
+
+  priv->pickaxe = git_pickaxe_new ();
+  priv->completed_handler
+    = g_signal_connect (priv->pickaxe, "completed",
+                        G_CALLBACK (git_pickaxe_dialog_on_completed),
+                        pdiag);
+  priv->progress_handler
+    = g_signal_connect (priv->pickaxe, "progress",
+                        G_CALLBACK (git_pickaxe_dialog_on_progress),
+                        pdiag);
+
+  if (git_pickaxe_start (priv->pickaxe, priv->filename, priv->revision,
+                         text, mode, &error))
+    {
+      gtk_widget_set_sensitive (priv->stop_button, TRUE);
+      gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 _("Listing commits"));
+    }
+  else
+    {
+      gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 error->message);
+      g_error_free (error);
+    }
+}
+
+static void
+git_pickaxe_dialog_on_find (GtkWidget *widget,
+                            GitPickaxeDialog *pdiag)
+{
+  git_pickaxe_dialog_run (pdiag);
+}
+
+static void
+git_pickaxe_dialog_on_stop (GtkButton *button,
+                            GitPickaxeDialog *pdiag)
+{
+  if (pdiag->priv->pickaxe)
+    git_pickaxe_cancel (pdiag->priv->pickaxe);
+}
+
+static void
+git_pickaxe_dialog_on_row_activated (GtkTreeView *tree_view,
+                                     GtkTreePath *path,
+                                     GtkTreeViewColumn *column,
+                                     GitPickaxeDialog *pdiag)
+{
+  gtk_dialog_response (GTK_DIALOG (pdiag),
+                       GIT_PICKAXE_DIALOG_RESPONSE_VIEW_BLAME);
+}
+
+static void
+git_pickaxe_dialog_on_selection_changed (GtkTreeSelection *selection,
+                                         GitPickaxeDialog *pdiag)
+{
+  gtk_dialog_set_response_sensitive
+    (GTK_DIALOG (pdiag), GIT_PICKAXE_DIALOG_RESPONSE_VIEW_BLAME,
+     gtk_tree_selection_get_selected (selection, NULL, NULL));
+}
+
+/* Starts searching the history of the file from the revision or HEAD
+   if revision is NULL for the commits that add or remove text. The
+   text can be changed in the dialog to search again. Any error is
+   shown in the dialog */
+void
+git_pickaxe_dialog_start (GitPickaxeDialog *pdiag,
+                          const gchar *filename,
+                          const gchar *revision,
+                          const gchar *text)
+{
+  GitPickaxeDialogPrivate *priv;
+  gchar *title, *basename;
+
+  g_return_if_fail (GIT_IS_PICKAXE_DIALOG (pdiag));
+  g_return_if_fail (filename != NULL);
+
+  priv = pdiag->priv;
+
+  g_free (priv->filename);
+  priv->filename = g_strdup (filename);
+  g_free (priv->revision);
+  priv->revision = g_strdup (revision);
+
+  basename = g_path_get_basename (filename);
+  title = g_strdup_printf (_("Search History of %s"), basename);
+  gtk_window_set_title (GTK_WINDOW (pdiag), title);
+  g_free (title);
+  g_free (basename);
+
+  gtk_entry_set_text (GTK_ENTRY (priv->entry), text ? text : "");
+
+  git_pickaxe_dialog_run (pdiag);
+}
+
+const gchar *
+git_pickaxe_dialog_get_filename (GitPickaxeDialog *pdiag)
+{
+  g_return_val_if_fail (GIT_IS_PICKAXE_DIALOG (pdiag), NULL);
+
+  return pdiag->priv->filename;
+}
+
+/* Returns the commit of the selected match or NULL if no match is
+   selected. The commit is owned by the search */
+GitCommit *
+git_pickaxe_dialog_get_selected_commit (GitPickaxeDialog *pdiag)
+{
+  GitPickaxeDialogPrivate *priv;
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+  guint match_num;
+
+  g_return_val_if_fail (GIT_IS_PICKAXE_DIALOG (pdiag), NULL);
+
+  priv = pdiag->priv;
+
+  if (priv->pickaxe == NULL || priv->tree_view == NULL
+      || !gtk_tree_selection_get_selected (gtk_tree_view_get_selection
+                                           (GTK_TREE_VIEW (priv->tree_view)),
+                                           &model, &iter))
+    return NULL;
+
+  gtk_tree_model_get (model, &iter,
+                      GIT_PICKAXE_DIALOG_COL_MATCH, &match_num,
+                      -1);
+
+  return git_pickaxe_get_match (priv->pickaxe, match_num)->commit;
+}
@@ -0,0 +1,81 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_PICKAXE_DIALOG_H__
+#define __GIT_PICKAXE_DIALOG_H__
+
+#include <gtk/gtkdialog.h>
+#include "git-commit.h"
+
+G_BEGIN_DECLS
+
+#define GIT_TYPE_PICKAXE_DIALOG                                         \
+  (git_pickaxe_dialog_get_type())
+#define GIT_PICKAXE_DIALOG(obj)                                         \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                   \
+                               GIT_TYPE_PICKAXE_DIALOG,                 \
+                               GitPickaxeDialog))
+#define GIT_PICKAXE_DIALOG_CLASS(klass)                                 \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            GIT_TYPE_PICKAXE_DIALOG,                    \
+                            GitPickaxeDialogClass))
+#define GIT_IS_PICKAXE_DIALOG(obj)                                      \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),                                   \
+                               GIT_TYPE_PICKAXE_DIALOG))
+#define GIT_IS_PICKAXE_DIALOG_CLASS(klass)                              \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),                                    \
+                            GIT_TYPE_PICKAXE_DIALOG))
+#define GIT_PICKAXE_DIALOG_GET_CLASS(obj)                               \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                    \
+                              GIT_TYPE_PICKAXE_DIALOG,                  \
+                              GitPickaxeDialogClass))
+
+typedef struct _GitPickaxeDialog        GitPickaxeDialog;
+typedef struct _GitPickaxeDialogClass   GitPickaxeDialogClass;
+typedef struct _GitPickaxeDialogPrivate GitPickaxeDialogPrivate;
+
+struct _GitPickaxeDialogClass
+{
+  GtkDialogClass parent_class;
+};
+
+struct _GitPickaxeDialog
+{
+  GtkDialog parent;
+
+  GitPickaxeDialogPrivate *priv;
+};
+
+enum {
+  GIT_PICKAXE_DIALOG_RESPONSE_VIEW_BLAME
+};
+
+GType git_pickaxe_dialog_get_type (void) G_GNUC_CONST;
+
+GtkWidget *git_pickaxe_dialog_new (void);
+
+void git_pickaxe_dialog_start (GitPickaxeDialog *pdiag,
+                               const gchar *filename,
+                               const gchar *revision,
+                               const gchar *text);
+
+const gchar *git_pickaxe_dialog_get_filename (GitPickaxeDialog *pdiag);
+GitCommit *git_pickaxe_dialog_get_selected_commit (GitPickaxeDialog *pdiag);
+
+G_END_DECLS
+
+#endif /* __GIT_PICKAXE_DIALOG_H__ */
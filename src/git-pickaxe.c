@@ -0,0 +1,736 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Searches the history of a file for the commits that add or remove
+   a string with git log -S or -G. The commits that touch the file are
+   first listed with git-rev-list and split into chunks of consecutive
+   commits. A small pool of git-log processes each search one chunk at
+   a time with --no-walk so that the chunks are searched in parallel
+   and the matches are made available as soon as any process finds
+   them */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib-object.h>
+#include <string.h>
+
+#include "git-pickaxe.h"
+#include "git-commit-bag.h"
+#include "git-reader.h"
+#include "git-common.h"
+
+static void git_pickaxe_dispose (GObject *object);
+static void git_pickaxe_finalize (GObject *object);
+
+static gboolean git_pickaxe_on_list_line (GitReader *reader,
+                                          guint length,
+                                          const gchar *str,
+                                          GitPickaxe *pickaxe);
+static void git_pickaxe_on_list_completed (GitReader *reader,
+                                           const GError *error,
+                                           GitPickaxe *pickaxe);
+
+G_DEFINE_TYPE (GitPickaxe, git_pickaxe, G_TYPE_OBJECT);
+
+#define GIT_PICKAXE_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_PICKAXE, \
+                                GitPickaxePrivate))
+
+typedef struct _GitPickaxeHash   GitPickaxeHash;
+typedef struct _GitPickaxeChunk  GitPickaxeChunk;
+typedef struct _GitPickaxeWorker GitPickaxeWorker;
+
+struct _GitPickaxeHash
+{
+  gchar hash[GIT_COMMIT_HASH_LENGTH + 1];
+};
+
+struct _GitPickaxeChunk
+{
+  /* Position of the first commit of the chunk and the commit after
+     the last */
+  guint start, end;
+};
+
+struct _GitPickaxeWorker
+{
+  GitPickaxe *pickaxe;
+  GitReader *reader;
+  guint line_handler, completed_handler;
+  /* The chunk being searched or NULL if the worker is free */
+  GitPickaxeChunk *chunk;
+  /* git-log reports the commits in the order they were given so the
+     position of the next match is searched for from here */
+  guint next_position;
+  /* The match that is currently being read */
+  GitCommit *current_commit;
+  guint current_position;
+};
+
+struct _GitPickaxePrivate
+{
+  GitReader *list_reader;
+  guint list_line_handler, list_completed_handler;
+
+  gchar *repo, *base_part;
+  /* The -S or -G argument for git-log */
+  gchar *pickaxe_arg;
+
+  /* A GitPickaxeHash for every commit that touches the file with the
+     newest first */
+  GArray *commits;
+  /* Number of commits that have been put in a chunk */
+  guint n_commits_chunked, n_commits_done;
+
+  /* Chunks that are waiting to be searched */
+  GQueue *pending;
+  GitPickaxeWorker workers[GIT_PICKAXE_MAX_WORKERS];
+  /* Starting a git-log from a completed handler would restart a
+     reader from its own signal so the workers are always started
+     from an idle handler */
+  guint run_idle;
+
+  /* A GitPickaxeMatch for each commit found in the order they were
+     found */
+  GArray *matches;
+
+  gboolean listing_done, finished;
+};
+
+enum
+  {
+    COMPLETED,
+    PROGRESS,
+
+    LAST_SIGNAL
+  };
+
+static guint client_signals[LAST_SIGNAL];
+
+static void
+git_pickaxe_class_init (GitPickaxeClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->dispose = git_pickaxe_dispose;
+  gobject_class->finalize = git_pickaxe_finalize;
+
+  client_signals[COMPLETED]
+    = g_signal_new ("completed",
+                    G_TYPE_FROM_CLASS (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitPickaxeClass, completed),
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__POINTER,
+                    G_TYPE_NONE, 1,
+                    G_TYPE_POINTER);
+
+  client_signals[PROGRESS]
+    = g_signal_new ("progress",
+                    G_TYPE_FROM_CLASS (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitPickaxeClass, progress),
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__VOID,
+                    G_TYPE_NONE, 0);
+
+  g_type_class_add_private (klass, sizeof (GitPickaxePrivate));
+}
+
+static void
+git_pickaxe_init (GitPickaxe *self)
+{
+  GitPickaxePrivate *priv;
+
+  priv = self->priv = GIT_PICKAXE_GET_PRIVATE (self);
+
+  priv->list_reader = git_reader_new ();
+  priv->list_line_handler
+    = g_signal_connect (priv->list_reader, "line",
+                        G_CALLBACK (git_pickaxe_on_list_line),
+                        self);
+  priv->list_completed_handler
+    = g_signal_connect (priv->list_reader, "completed",
+                        G_CALLBACK (git_pickaxe_on_list_completed),
+                        self);
+
+  priv->commits = g_array_new (FALSE, FALSE, sizeof (GitPickaxeHash));
+  priv->matches = g_array_new (FALSE, FALSE, sizeof (GitPickaxeMatch));
+  priv->pending = g_queue_new ();
+}
+
+static void
+git_pickaxe_chunk_free (GitPickaxeChunk *chunk)
+{
+  g_slice_free (GitPickaxeChunk, chunk);
+}
+
+static void
+git_pickaxe_dispose (GObject *object)
+{
+  GitPickaxe *self = (GitPickaxe *) object;
+  GitPickaxePrivate *priv = self->priv;
+  int i;
+
+  if (priv->list_reader)
+    {
+      g_signal_handler_disconnect (priv->list_reader,
+                                   priv->list_line_handler);
+      g_signal_handler_disconnect (priv->list_reader,
+                                   priv->list_completed_handler);
+      g_object_unref (priv->list_reader);
+      priv->list_reader = NULL;
+    }
+
+  for (i = 0; i < GIT_PICKAXE_MAX_WORKERS; i++)
+    {
+      GitPickaxeWorker *worker = priv->workers + i;
+
+      if (worker->reader)
+        {
+          g_signal_handler_disconnect (worker->reader,
+                                       worker->line_handler);
+          g_signal_handler_disconnect (worker->reader,
+                                       worker->completed_handler);
+          g_object_unref (worker->reader);
+          worker->reader = NULL;
+        }
+      if (worker->chunk)
+        {
+          git_pickaxe_chunk_free (worker->chunk);
+          worker->chunk = NULL;
+        }
+      if (worker->current_commit)
+        {
+          g_object_unref (worker->current_commit);
+          worker->current_commit = NULL;
+        }
+    }
+
+  if (priv->run_idle)
+    {
+      g_source_remove (priv->run_idle);
+      priv->run_idle = 0;
+    }
+
+  G_OBJECT_CLASS (git_pickaxe_parent_class)->dispose (object);
+}
+
+static void
+git_pickaxe_finalize (GObject *object)
+{
+  GitPickaxe *self = (GitPickaxe *) object;
+  GitPickaxePrivate *priv = self->priv;
+  guint i;
+
+  for (i = 0; i < priv->matches->len; i++)
+    g_object_unref (g_array_index (priv->matches,
+                                   GitPickaxeMatch, i).commit);
+
+  g_array_free (priv->matches, TRUE);
+  g_array_free (priv->commits, TRUE);
+  g_queue_foreach (priv->pending, (GFunc) git_pickaxe_chunk_free, NULL);
+  g_queue_free (priv->pending);
+
+  g_free (priv->repo);
+  g_free (priv->base_part);
+  g_free (priv->pickaxe_arg);
+
+  G_OBJECT_CLASS (git_pickaxe_parent_class)->finalize (object);
+}
+
+GitPickaxe *
+git_pickaxe_new (void)
+{
+  GitPickaxe *self = g_object_new (GIT_TYPE_PICKAXE, NULL);
+
+  return self;
+}
+
+/* Stops all of the git processes. The partial matches of the workers
+   are thrown away */
+static void
+git_pickaxe_stop_workers (GitPickaxe *pickaxe)
+{
+  GitPickaxePrivate *priv = pickaxe->priv;
+  int i;
+
+  git_reader_cancel (priv->list_reader);
+
+  for (i = 0; i < GIT_PICKAXE_MAX_WORKERS; i++)
+    {
+      GitPickaxeWorker *worker = priv->workers + i;
+
+      if (worker->chunk)
+        {
+          git_reader_cancel (worker->reader);
+          git_pickaxe_chunk_free (worker->chunk);
+          worker->chunk = NULL;
+        }
+      if (worker->current_commit)
+        {
+          g_object_unref (worker->current_commit);
+          worker->current_commit = NULL;
+        }
+    }
+}
+
+static void
+git_pickaxe_finish (GitPickaxe *pickaxe, const GError *error)
+{
+  GitPickaxePrivate *priv = pickaxe->priv;
+
+  if (priv->finished)
+    return;
+
+  priv->finished = TRUE;
+
+  if (error)
+    git_pickaxe_stop_workers (pickaxe);
+
+  g_signal_emit (pickaxe, client_signals[COMPLETED], 0, error);
+}
+
+/* Starts a git-log for the commits of the chunk */
+static gboolean
+git_pickaxe_start_worker (GitPickaxeWorker *worker,
+                          GitPickaxeChunk *chunk,
+                          GError **error)
+{
+  GitPickaxePrivate *priv = worker->pickaxe->priv;
+  const gchar **args;
+  guint i, n_args = 0;
+  gboolean ret;
+
+  args = g_new (const gchar *, chunk->end - chunk->start + 8);
+
+  args[n_args++] = "log";
+  args[n_args++] = "--no-walk=unsorted";
+  args[n_args++] = "--format=commit %H%n"
+    "author %an%n"
+    "author-mail <%ae>%n"
+    "author-time %at%n"
+    "summary %s";
+  args[n_args++] = priv->pickaxe_arg;
+  for (i = chunk->start; i < chunk->end; i++)
+    args[n_args++] = g_array_index (priv->commits, GitPickaxeHash, i).hash;
+  args[n_args++] = "--";
+  args[n_args++] = priv->base_part;
+  args[n_args] = NULL;
+
+  ret = git_reader_startv (worker->reader, priv->repo, args, error);
+
+  g_free (args);
+
+  if (ret)
+    {
+      worker->chunk = chunk;
+      worker->next_position = chunk->start;
+    }
+
+  return ret;
+}
+
+static void
+git_pickaxe_run_workers (GitPickaxe *pickaxe)
+{
+  GitPickaxePrivate *priv = pickaxe->priv;
+  gboolean busy = FALSE;
+  int i;
+
+  if (priv->finished)
+    return;
+
+  for (i = 0; i < GIT_PICKAXE_MAX_WORKERS; i++)
+    {
+      GitPickaxeWorker *worker = priv->workers + i;
+
+      if (worker->chunk == NULL && !g_queue_is_empty (priv->pending))
+        {
+          GitPickaxeChunk *chunk = g_queue_pop_head (priv->pending);
+          GError *error = NULL;
+
+          if (!git_pickaxe_start_worker (worker, chunk, &error))
+            {
+              git_pickaxe_chunk_free (chunk);
+              git_pickaxe_finish (pickaxe, error);
+              g_error_free (error);
+              return;
+            }
+        }
+
+      if (worker->chunk)
+        busy = TRUE;
+    }
+
+  if (!busy && priv->listing_done)
+    git_pickaxe_finish (pickaxe, NULL);
+}
+
+static gboolean
+git_pickaxe_on_run_idle (gpointer data)
+{
+  GitPickaxe *pickaxe = (GitPickaxe *) data;
+
+  pickaxe->priv->run_idle = 0;
+
+  git_pickaxe_run_workers (pickaxe);
+
+  return FALSE;
+}
+
+static void
+git_pickaxe_queue_run (GitPickaxe *pickaxe)
+{
+  GitPickaxePrivate *priv = pickaxe->priv;
+
+  if (priv->run_idle == 0)
+    priv->run_idle = g_idle_add (git_pickaxe_on_run_idle, pickaxe);
+}
+
+/* Puts the commits that have been listed but not yet searched into a
+   new chunk */
+static void
+git_pickaxe_add_chunk (GitPickaxe *pickaxe)
+{
+  GitPickaxePrivate *priv = pickaxe->priv;
+  GitPickaxeChunk *chunk;
+
+  if (priv->n_commits_chunked >= priv->commits->len)
+    return;
+
+  chunk = g_slice_new (GitPickaxeChunk);
+  chunk->start = priv->n_commits_chunked;
+  chunk->end = priv->commits->len;
+  priv->n_commits_chunked = chunk->end;
+
+  g_queue_push_tail (priv->pending, chunk);
+
+  git_pickaxe_queue_run (pickaxe);
+}
+
+/* Moves the match that has been read by the worker into the list of
+   matches */
+static void
+git_pickaxe_end_match (GitPickaxeWorker *worker)
+{
+  GitPickaxe *pickaxe = worker->pickaxe;
+  GitPickaxeMatch match;
+
+  if (worker->current_commit == NULL)
+    return;
+
+  match.commit = worker->current_commit;
+  match.position = worker->current_position;
+  g_array_append_val (pickaxe->priv->matches, match);
+
+  worker->current_commit = NULL;
+
+  g_signal_emit (pickaxe, client_signals[PROGRESS], 0);
+}
+
+static void
+git_pickaxe_parse_error (GitPickaxe *pickaxe)
+{
+  GError *error = NULL;
+
+  g_set_error (&error, GIT_ERROR, GIT_ERROR_PARSE_ERROR,
+               "Invalid data from git-log received");
+  git_pickaxe_finish (pickaxe, error);
+  g_error_free (error);
+}
+
+/* Each match has a "key value" line for each of the properties in
+   the format passed to git-log starting with the hash */
+static gboolean
+git_pickaxe_on_worker_line (GitReader *reader,
+                            guint length, const gchar *str,
+                            GitPickaxeWorker *worker)
+{
+  GitPickaxe *pickaxe = worker->pickaxe;
+  GitPickaxePrivate *priv = pickaxe->priv;
+  const gchar *sep;
+
+  if (length > 0 && str[length - 1] == '\n')
+    length--;
+
+  if (length == 0)
+    return TRUE;
+
+  if (length == strlen ("commit ") + GIT_COMMIT_HASH_LENGTH
+      && !strncmp (str, "commit ", strlen ("commit ")))
+    {
+      GitCommitBag *commit_bag = git_commit_bag_get_default ();
+      const gchar *hash = str + strlen ("commit ");
+      gchar *hash_copy;
+      guint pos;
+
+      git_pickaxe_end_match (worker);
+
+      for (pos = worker->next_position; pos < worker->chunk->end; pos++)
+        if (!strncmp (g_array_index (priv->commits,
+                                     GitPickaxeHash, pos).hash,
+                      hash, GIT_COMMIT_HASH_LENGTH))
+          break;
+
+      if (pos >= worker->chunk->end)
+        {
+          git_pickaxe_parse_error (pickaxe);
+          return FALSE;
+        }
+
+      worker->next_position = pos + 1;
+
+      hash_copy = g_strndup (hash, GIT_COMMIT_HASH_LENGTH);
+      worker->current_commit
+        = g_object_ref (git_commit_bag_get (commit_bag, hash_copy,
+                                            priv->repo));
+      worker->current_position = pos;
+      g_free (hash_copy);
+    }
+  else if (worker->current_commit == NULL)
+    {
+      git_pickaxe_parse_error (pickaxe);
+      return FALSE;
+    }
+  else if ((sep = memchr (str, ' ', length)))
+    {
+      gchar *key = g_strndup (str, sep - str);
+
+      if (git_commit_get_prop (worker->current_commit, key) == NULL)
+        {
+          gchar *value = g_strndup (sep + 1, str + length - sep - 1);
+          git_commit_set_prop (worker->current_commit, key, value);
+          g_free (value);
+        }
+
+      g_free (key);
+    }
+
+  return TRUE;
+}
+
+static void
+git_pickaxe_on_worker_completed (GitReader *reader,
+                                 const GError *error,
+                                 GitPickaxeWorker *worker)
+{
+  GitPickaxe *pickaxe = worker->pickaxe;
+  GitPickaxePrivate *priv = pickaxe->priv;
+  GitPickaxeChunk *chunk = worker->chunk;
+
+  if (chunk == NULL)
+    return;
+
+  worker->chunk = NULL;
+
+  if (error)
+    {
+      git_pickaxe_chunk_free (chunk);
+      git_pickaxe_finish (pickaxe, error);
+      return;
+    }
+
+  git_pickaxe_end_match (worker);
+
+  priv->n_commits_done += chunk->end - chunk->start;
+  git_pickaxe_chunk_free (chunk);
+
+  g_signal_emit (pickaxe, client_signals[PROGRESS], 0);
+
+  git_pickaxe_queue_run (pickaxe);
+}
+
+static gboolean
+git_pickaxe_on_list_line (GitReader *reader,
+                          guint length, const gchar *str,
+                          GitPickaxe *pickaxe)
+{
+  GitPickaxePrivate *priv = pickaxe->priv;
+  GitPickaxeHash hash;
+
+  if (length != GIT_COMMIT_HASH_LENGTH + 1
+      || str[GIT_COMMIT_HASH_LENGTH] != '\n')
+    {
+      GError *error = NULL;
+
+      g_set_error (&error, GIT_ERROR, GIT_ERROR_PARSE_ERROR,
+                   "Invalid data from git-rev-list received");
+      git_pickaxe_finish (pickaxe, error);
+      g_error_free (error);
+
+      return FALSE;
+    }
+
+  memcpy (hash.hash, str, GIT_COMMIT_HASH_LENGTH);
+  hash.hash[GIT_COMMIT_HASH_LENGTH] = '\0';
+  g_array_append_val (priv->commits, hash);
+
+  /* The newest commits can be searched while the rest of the history
+     is still being listed */
+  if (priv->commits->len - priv->n_commits_chunked >= GIT_PICKAXE_CHUNK_SIZE)
+    git_pickaxe_add_chunk (pickaxe);
+
+  return TRUE;
+}
+
+static void
+git_pickaxe_on_list_completed (GitReader *reader,
+                               const GError *error,
+                               GitPickaxe *pickaxe)
+{
+  GitPickaxePrivate *priv = pickaxe->priv;
+
+  if (error)
+    {
+      git_pickaxe_finish (pickaxe, error);
+      return;
+    }
+
+  git_pickaxe_add_chunk (pickaxe);
+  priv->listing_done = TRUE;
+
+  g_signal_emit (pickaxe, client_signals[PROGRESS], 0);
+
+  git_pickaxe_queue_run (pickaxe);
+}
+
+/* Starts searching the history of the file from the given revision
+   or HEAD if revision is NULL for commits that change the number of
+   occurrences of text or, in the regex mode, that add or remove a
+   line matching it. This can only be called once */
+gboolean
+git_pickaxe_start (GitPickaxe *pickaxe,
+                   const gchar *filename,
+                   const gchar *revision,
+                   const gchar *text,
+                   GitPickaxeMode mode,
+                   GError **error)
+{
+  GitPickaxePrivate *priv;
+  int i;
+
+  g_return_val_if_fail (GIT_IS_PICKAXE (pickaxe), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (text != NULL && *text != '\0', FALSE);
+
+  priv = pickaxe->priv;
+
+  g_return_val_if_fail (priv->repo == NULL, FALSE);
+
+  if (!git_find_repo (filename, &priv->repo, &priv->base_part))
+    {
+      g_set_error (error, GIT_ERROR, GIT_ERROR_NO_REPO,
+                   "No repo found for %s", filename);
+      return FALSE;
+    }
+
+  /* The text is attached to the option so that it can't be mistaken
+     for another option if it starts with a dash */
+  priv->pickaxe_arg = g_strconcat (mode == GIT_PICKAXE_MODE_REGEX
+                                   ? "-G" : "-S", text, NULL);
+
+  for (i = 0; i < GIT_PICKAXE_MAX_WORKERS; i++)
+    {
+      GitPickaxeWorker *worker = priv->workers + i;
+
+      worker->pickaxe = pickaxe;
+      worker->reader = git_reader_new ();
+      worker->line_handler
+        = g_signal_connect (worker->reader, "line",
+                            G_CALLBACK (git_pickaxe_on_worker_line),
+                            worker);
+      worker->completed_handler
+        = g_signal_connect (worker->reader, "completed",
+                            G_CALLBACK (git_pickaxe_on_worker_completed),
+                            worker);
+    }
+
+  return git_reader_start (priv->list_reader, priv->repo, error,
+                           "rev-list", revision ? revision : "HEAD",
+                           "--", priv->base_part, NULL);
+}
+
+/* Stops the search. The matches that have already been found are
+   kept */
+void
+git_pickaxe_cancel (GitPickaxe *pickaxe)
+{
+  GError *error = NULL;
+
+  g_return_if_fail (GIT_IS_PICKAXE (pickaxe));
+
+  if (pickaxe->priv->finished || pickaxe->priv->repo == NULL)
+    return;
+
+  g_set_error (&error, GIT_ERROR, GIT_ERROR_CANCELLED, "Search cancelled");
+  git_pickaxe_finish (pickaxe, error);
+  g_error_free (error);
+}
+
+gboolean
+git_pickaxe_is_finished (GitPickaxe *pickaxe)
+{
+  g_return_val_if_fail (GIT_IS_PICKAXE (pickaxe), FALSE);
+
+  return pickaxe->priv->finished;
+}
+
+/* Gets the number of commits that have been searched and the number
+   of commits that touch the file. The total is only complete once
+   git-rev-list has finished */
+void
+git_pickaxe_get_progress (GitPickaxe *pickaxe,
+                          guint *n_commits_done,
+                          guint *n_commits)
+{
+  GitPickaxePrivate *priv;
+
+  g_return_if_fail (GIT_IS_PICKAXE (pickaxe));
+
+  priv = pickaxe->priv;
+
+  if (n_commits_done)
+    *n_commits_done = priv->n_commits_done;
+  if (n_commits)
+    *n_commits = priv->commits->len;
+}
+
+guint
+git_pickaxe_get_n_matches (GitPickaxe *pickaxe)
+{
+  g_return_val_if_fail (GIT_IS_PICKAXE (pickaxe), 0);
+
+  return pickaxe->priv->matches->len;
+}
+
+const GitPickaxeMatch *
+git_pickaxe_get_match (GitPickaxe *pickaxe, guint match_num)
+{
+  GitPickaxePrivate *priv;
+
+  g_return_val_if_fail (GIT_IS_PICKAXE (pickaxe), NULL);
+
+  priv = pickaxe->priv;
+
+  g_return_val_if_fail (match_num < priv->matches->len, NULL);
+
+  return &g_array_index (priv->matches, GitPickaxeMatch, match_num);
+}
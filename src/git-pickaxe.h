@@ -0,0 +1,111 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_PICKAXE_H__
+#define __GIT_PICKAXE_H__
+
+#include <glib-object.h>
+#include "git-commit.h"
+
+G_BEGIN_DECLS
+
+#define GIT_TYPE_PICKAXE                                                \
+  (git_pickaxe_get_type())
+#define GIT_PICKAXE(obj)                                                \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                   \
+                               GIT_TYPE_PICKAXE,                        \
+                               GitPickaxe))
+#define GIT_PICKAXE_CLASS(klass)                                        \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            GIT_TYPE_PICKAXE,                           \
+                            GitPickaxeClass))
+#define GIT_IS_PICKAXE(obj)                                             \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),                                   \
+                               GIT_TYPE_PICKAXE))
+#define GIT_IS_PICKAXE_CLASS(klass)                                     \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),                                    \
+                            GIT_TYPE_PICKAXE))
+#define GIT_PICKAXE_GET_CLASS(obj)                                      \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                    \
+                              GIT_TYPE_PICKAXE,                         \
+                              GitPickaxeClass))
+
+typedef struct _GitPickaxe        GitPickaxe;
+typedef struct _GitPickaxeClass   GitPickaxeClass;
+typedef struct _GitPickaxePrivate GitPickaxePrivate;
+typedef struct _GitPickaxeMatch   GitPickaxeMatch;
+
+struct _GitPickaxeClass
+{
+  GObjectClass parent_class;
+
+  void (* completed) (GitPickaxe *pickaxe, const GError *error);
+  void (* progress) (GitPickaxe *pickaxe);
+};
+
+struct _GitPickaxe
+{
+  GObject parent;
+
+  GitPickaxePrivate *priv;
+};
+
+typedef enum {
+  /* Commits that change the number of occurrences of the text */
+  GIT_PICKAXE_MODE_STRING,
+  /* Commits with an added or removed line matching the regex */
+  GIT_PICKAXE_MODE_REGEX
+} GitPickaxeMode;
+
+struct _GitPickaxeMatch
+{
+  GitCommit *commit;
+  /* Position of the commit in the history of the file with 0 for
+     the newest */
+  guint position;
+};
+
+/* Maximum number of git-log processes that are run at the same
+   time */
+#define GIT_PICKAXE_MAX_WORKERS 4
+/* Number of commits searched by each git-log */
+#define GIT_PICKAXE_CHUNK_SIZE 64
+
+GType git_pickaxe_get_type (void) G_GNUC_CONST;
+
+GitPickaxe *git_pickaxe_new (void);
+
+gboolean git_pickaxe_start (GitPickaxe *pickaxe,
+                            const gchar *filename,
+                            const gchar *revision,
+                            const gchar *text,
+                            GitPickaxeMode mode,
+                            GError **error);
+void git_pickaxe_cancel (GitPickaxe *pickaxe);
+gboolean git_pickaxe_is_finished (GitPickaxe *pickaxe);
+
+void git_pickaxe_get_progress (GitPickaxe *pickaxe,
+                               guint *n_commits_done,
+                               guint *n_commits);
+
+guint git_pickaxe_get_n_matches (GitPickaxe *pickaxe);
+const GitPickaxeMatch *git_pickaxe_get_match (GitPickaxe *pickaxe,
+                                              guint match_num);
+
+G_END_DECLS
+
+#endif /* __GIT_PICKAXE_H__ */
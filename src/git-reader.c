@@ -31,6 +31,9 @@
 #include "git-reader.h"
 #include "git-common.h"
 #include "git-marshal.h"
+#include "git-trace.h"
+#include "git-memory.h"
+#include "git-watchdog.h"
 
 static void git_reader_dispose (GObject *object);
 static void git_reader_finalize (GObject *object);
@@ -55,6 +58,19 @@ struct _GitReaderPrivate
   gint child_exit_code;
   GString *error_string;
   GString *line_string;
+
+  gboolean got_first_byte;
+  GitTraceTime spawn_time;
+
+  /* Size of the buffers that has been added to the memory accounting */
+  gsize accounted_size;
+
+  /* Longer lines are split into pieces of this size or 0 if lines
+     are never split */
+  gsize max_line_length;
+
+  /* Character that ends each line */
+  gchar line_terminator;
 };
 
 enum
@@ -109,6 +125,7 @@ git_reader_init (GitReader *self)
 
   priv->error_string = g_string_new ("");
   priv->line_string = g_string_new ("");
+  priv->line_terminator = '\n';
 }
 
 static void
@@ -147,11 +164,16 @@ git_reader_close_process (GitReader *source,
               /* Otherwise try killing it */
               if (wait_ret == 0)
                 {
+                  const gchar *old_operation
+                    = git_watchdog_set_operation ("waiting for git to exit");
+
                   kill (priv->child_pid, SIGTERM);
 
                   while ((wait_ret = waitpid (priv->child_pid, &status_ret,
                                               0)) == -1
                          && errno == EINTR);
+
+                  git_watchdog_set_operation (old_operation);
                 }
             }
 
@@ -179,6 +201,9 @@ git_reader_finalize (GObject *object)
   g_string_free (self->priv->error_string, TRUE);
   g_string_free (self->priv->line_string, TRUE);
 
+  git_memory_add (GIT_MEMORY_READER_BUFFERS,
+                  -(gssize) self->priv->accounted_size);
+
   G_OBJECT_CLASS (git_reader_parent_class)->finalize (object);
 }
 
@@ -198,6 +223,22 @@ git_reader_new (void)
   return self;
 }
 
+/* Updates the memory accounting after the buffers may have grown */
+static void
+git_reader_account_buffers (GitReader *reader)
+{
+  GitReaderPrivate *priv = reader->priv;
+  gsize size = priv->line_string->allocated_len
+    + priv->error_string->allocated_len;
+
+  if (size != priv->accounted_size)
+    {
+      git_memory_add (GIT_MEMORY_READER_BUFFERS,
+                      (gssize) size - (gssize) priv->accounted_size);
+      priv->accounted_size = size;
+    }
+}
+
 static void
 git_reader_check_complete (GitReader *reader)
 {
@@ -264,10 +305,13 @@ git_reader_check_lines (GitReader *reader)
   gchar *start = priv->line_string->str, *end;
   gsize len = priv->line_string->len;
   gboolean ret = TRUE;
+  GitTraceTime parse_time;
 
   g_object_ref (reader);
 
-  while ((end = memchr (start, '\n', len)))
+  GIT_TRACE_BEGIN (parse, parse_time);
+
+  while ((end = memchr (start, priv->line_terminator, len)))
     {
       g_signal_emit (reader, client_signals[LINE], 0,
                      end - start + 1, start, &line_return);
@@ -283,11 +327,30 @@ git_reader_check_lines (GitReader *reader)
         }
     }
 
+  /* Without a limit a file with no newlines would be buffered
+     completely before anything sees it */
+  while (ret && priv->max_line_length > 0 && len >= priv->max_line_length)
+    {
+      g_signal_emit (reader, client_signals[LINE], 0,
+                     priv->max_line_length, start, &line_return);
+
+      len -= priv->max_line_length;
+      start += priv->max_line_length;
+
+      if (!line_return)
+        {
+          git_reader_close_process (reader, TRUE);
+          ret = FALSE;
+        }
+    }
+
   /* Move the remaining incomplete line to the beginning of the
      string */
   memmove (priv->line_string->str, start, len);
   g_string_truncate (priv->line_string, len);
 
+  GIT_TRACE_END (parse, parse_time);
+
   g_object_unref (reader);
 
   return ret;
@@ -337,11 +400,20 @@ git_reader_on_child_stdout (GIOChannel *io_source,
       break;
 
     case G_IO_STATUS_NORMAL:
+      if (!priv->got_first_byte)
+        {
+          GIT_TRACE (reader__first_byte);
+          GIT_TRACE_MARK (priv->spawn_time, "reader first byte", NULL);
+          priv->got_first_byte = TRUE;
+        }
       g_string_append_len (priv->line_string, buf, bytes_read);
+      git_reader_account_buffers (reader);
       ret = git_reader_check_lines (reader);
       break;
 
     case G_IO_STATUS_EOF:
+      GIT_TRACE (reader__eof);
+      GIT_TRACE_MARK (priv->spawn_time, "reader", NULL);
       priv->child_stdout_source = 0;
       git_reader_check_complete (reader);
       ret = FALSE;
@@ -375,6 +447,7 @@ git_reader_on_child_stderr (GIOChannel *io_source,
 
     case G_IO_STATUS_NORMAL:
       g_string_append_len (priv->error_string, buf, bytes_read);
+      git_reader_account_buffers (reader);
       break;
 
     case G_IO_STATUS_EOF:
@@ -390,42 +463,42 @@ git_reader_on_child_stderr (GIOChannel *io_source,
   return ret;
 }
 
+/* Starts git with the NULL-terminated array of arguments. This is
+   for callers that build the command line at run time such as a list
+   of commits to pass to git-log */
 gboolean
-git_reader_start (GitReader *reader,
-                  const gchar *working_directory,
-                  GError **error,
-                  ...)
+git_reader_startv (GitReader *reader,
+                   const gchar *working_directory,
+                   const gchar * const *argv,
+                   GError **error)
 {
   GitReaderPrivate *priv;
   gchar **args;
-  const gchar *arg;
   gboolean spawn_ret;
   gint stdout_fd, stderr_fd;
-  va_list ap_copy, ap;
-  int argc = 1, i;
+  int argc = 0, i;
 
   g_return_val_if_fail (GIT_IS_READER (reader), FALSE);
+  g_return_val_if_fail (argv != NULL, FALSE);
   g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
   priv = reader->priv;
 
   git_reader_close_process (reader, TRUE);
 
-  /* Count the number of arguments */
-  va_start (ap, error);
-  G_VA_COPY (ap_copy, ap);
-  while ((arg = va_arg (ap, const gchar *)))
+  while (argv[argc])
     argc++;
 
   /* Copy the arguments to a string array */
-  args = g_new (gchar *, argc + 1);
+  args = g_new (gchar *, argc + 2);
   args[0] = g_strdup ("git");
-  i = 1;
-  while ((arg = va_arg (ap_copy, const gchar *)))
-    args[i++] = g_strdup (arg);
-  args[i] = NULL;
+  for (i = 0; i < argc; i++)
+    args[i + 1] = g_strdup (argv[i]);
+  args[i + 1] = NULL;
 
-  va_end (ap);
+  GIT_TRACE (reader__spawn);
+  priv->spawn_time = GIT_TRACE_NOW ();
+  priv->got_first_byte = FALSE;
 
   spawn_ret = g_spawn_async_with_pipes (working_directory, args, NULL,
                                         G_SPAWN_SEARCH_PATH
@@ -469,3 +542,70 @@ git_reader_start (GitReader *reader,
 
   return TRUE;
 }
+
+gboolean
+git_reader_start (GitReader *reader,
+                  const gchar *working_directory,
+                  GError **error,
+                  ...)
+{
+  const gchar **args;
+  const gchar *arg;
+  gboolean ret;
+  va_list ap_copy, ap;
+  int argc = 0, i;
+
+  g_return_val_if_fail (GIT_IS_READER (reader), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  /* Count the number of arguments */
+  va_start (ap, error);
+  G_VA_COPY (ap_copy, ap);
+  while ((arg = va_arg (ap, const gchar *)))
+    argc++;
+
+  args = g_new (const gchar *, argc + 1);
+  i = 0;
+  while ((arg = va_arg (ap_copy, const gchar *)))
+    args[i++] = arg;
+  args[i] = NULL;
+
+  va_end (ap);
+
+  ret = git_reader_startv (reader, working_directory, args, error);
+
+  g_free (args);
+
+  return ret;
+}
+
+/* Sets the length after which a line that hasn't been terminated yet
+   is emitted in pieces. Only the last piece of such a line ends with
+   the line terminator. Zero means lines are never split */
+void
+git_reader_set_max_line_length (GitReader *reader, gsize max_length)
+{
+  g_return_if_fail (GIT_IS_READER (reader));
+
+  reader->priv->max_line_length = max_length;
+}
+
+/* Sets the character that ends each line. This is a newline by
+   default but can be set to '\0' to read the output of a command run
+   with -z so that paths don't need unquoting */
+void
+git_reader_set_line_terminator (GitReader *reader, gchar terminator)
+{
+  g_return_if_fail (GIT_IS_READER (reader));
+
+  reader->priv->line_terminator = terminator;
+}
+
+/* Stops the current process without emitting the completed signal */
+void
+git_reader_cancel (GitReader *reader)
+{
+  g_return_if_fail (GIT_IS_READER (reader));
+
+  git_reader_close_process (reader, TRUE);
+}
@@ -70,6 +70,13 @@ gboolean git_reader_start (GitReader *reader,
                            const gchar *working_directory,
                            GError **error,
                            ...) G_GNUC_NULL_TERMINATED;
+gboolean git_reader_startv (GitReader *reader,
+                            const gchar *working_directory,
+                            const gchar * const *argv,
+                            GError **error);
+void git_reader_set_max_line_length (GitReader *reader, gsize max_length);
+void git_reader_set_line_terminator (GitReader *reader, gchar terminator);
+void git_reader_cancel (GitReader *reader);
 
 G_END_DECLS
 
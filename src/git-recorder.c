@@ -0,0 +1,513 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The recorder writes the interactions with the main window to a file
+   so that they can be replayed later to measure how long each step
+   takes. Each line of the file is the time in seconds since the
+   recording started followed by the name of the event and its
+   arguments, all separated by tabs. Arguments are escaped with
+   g_strescape. The recorded times are only informational. Replaying
+   runs each step as soon as the previous one has finished loading and
+   painting so that the results don't depend on how fast the person
+   recording was. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtkmain.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "git-recorder.h"
+#include "git-main-window.h"
+#include "git-source-view.h"
+#include "git-annotated-source.h"
+#include "git-commit.h"
+#include "git-common.h"
+
+#define GIT_RECORDER_HEADER "# blame-browse recording 1\n"
+
+typedef struct _GitRecorderStep GitRecorderStep;
+typedef struct _GitRecorderReplay GitRecorderReplay;
+
+struct _GitRecorderStep
+{
+  GitRecorderEvent event;
+  gchar *arg1, *arg2;
+};
+
+struct _GitRecorderReplay
+{
+  GitMainWindow *main_window;
+  GitSourceView *sview;
+  guint state_handler;
+
+  GArray *steps;
+  guint next_step;
+  gboolean waiting;
+  guint settled_source;
+
+  GTimer *step_timer;
+  /* Latency in seconds of each step, separated by event */
+  GArray *latencies[GIT_RECORDER_N_EVENTS];
+};
+
+static const gchar * const
+git_recorder_event_names[GIT_RECORDER_N_EVENTS] =
+  {
+    "open",
+    "revision",
+    "scroll",
+    "select-commit",
+    "back",
+    "forward"
+  };
+
+static FILE *git_recorder_file = NULL;
+static GTimer *git_recorder_timer = NULL;
+
+static void git_recorder_replay_next (GitRecorderReplay *replay);
+
+/* Starts writing all of the interactions to filename */
+gboolean
+git_recorder_start (const gchar *filename, GError **error)
+{
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_val_if_fail (git_recorder_file == NULL, FALSE);
+
+  if ((git_recorder_file = g_fopen (filename, "w")) == NULL)
+    {
+      g_set_error (error, GIT_ERROR, GIT_ERROR_RECORDING,
+                   "%s: %s", filename, g_strerror (errno));
+      return FALSE;
+    }
+
+  fputs (GIT_RECORDER_HEADER, git_recorder_file);
+
+  git_recorder_timer = g_timer_new ();
+
+  return TRUE;
+}
+
+void
+git_recorder_stop (void)
+{
+  if (git_recorder_file == NULL)
+    return;
+
+  fclose (git_recorder_file);
+  git_recorder_file = NULL;
+
+  g_timer_destroy (git_recorder_timer);
+  git_recorder_timer = NULL;
+}
+
+gboolean
+git_recorder_is_recording (void)
+{
+  return git_recorder_file != NULL;
+}
+
+static void
+git_recorder_write_arg (const gchar *arg)
+{
+  gchar *escaped = g_strescape (arg ? arg : "", NULL);
+
+  fprintf (git_recorder_file, "\t%s", escaped);
+
+  g_free (escaped);
+}
+
+/* Records an event if a recording is in progress. The arguments are
+   ignored if they are NULL */
+void
+git_recorder_record (GitRecorderEvent event,
+                     const gchar *arg1,
+                     const gchar *arg2)
+{
+  g_return_if_fail (event >= 0 && event < GIT_RECORDER_N_EVENTS);
+
+  if (git_recorder_file == NULL)
+    return;
+
+  fprintf (git_recorder_file, "%.3f\t%s",
+           g_timer_elapsed (git_recorder_timer, NULL),
+           git_recorder_event_names[event]);
+
+  if (arg1 || arg2)
+    git_recorder_write_arg (arg1);
+  if (arg2)
+    git_recorder_write_arg (arg2);
+
+  fputc ('\n', git_recorder_file);
+
+  /* Flush every event so that the recording survives a crash */
+  fflush (git_recorder_file);
+}
+
+/* Records that the source view was scrolled by delta pixels to
+   offset. The offset is what is replayed so that programmatic
+   scrolls that weren't recorded don't make the replay drift */
+void
+git_recorder_record_scroll (gint delta, gint offset)
+{
+  gchar delta_str[16], offset_str[16];
+
+  if (git_recorder_file == NULL)
+    return;
+
+  g_snprintf (delta_str, sizeof (delta_str), "%i", delta);
+  g_snprintf (offset_str, sizeof (offset_str), "%i", offset);
+
+  git_recorder_record (GIT_RECORDER_SCROLL, delta_str, offset_str);
+}
+
+static gboolean
+git_recorder_parse (const gchar *filename, GArray *steps, GError **error)
+{
+  gchar *contents, **lines;
+  gboolean ret = TRUE;
+  guint i;
+
+  if (!g_file_get_contents (filename, &contents, NULL, error))
+    return FALSE;
+
+  lines = g_strsplit (contents, "\n", 0);
+  g_free (contents);
+
+  for (i = 0; ret && lines[i]; i++)
+    {
+      gchar **fields;
+      GitRecorderStep step;
+      guint n_fields;
+
+      if (lines[i][0] == '\0' || lines[i][0] == '#')
+        continue;
+
+      fields = g_strsplit (lines[i], "\t", 0);
+      n_fields = g_strv_length (fields);
+
+      for (step.event = 0; step.event < GIT_RECORDER_N_EVENTS; step.event++)
+        if (n_fields >= 2
+            && !strcmp (fields[1], git_recorder_event_names[step.event]))
+          break;
+
+      if (step.event >= GIT_RECORDER_N_EVENTS
+          || ((step.event == GIT_RECORDER_OPEN
+               || step.event == GIT_RECORDER_REVISION)
+              && n_fields < 3)
+          || (step.event == GIT_RECORDER_SCROLL && n_fields < 4)
+          || (step.event == GIT_RECORDER_SELECT_COMMIT && n_fields < 3))
+        {
+          g_set_error (error, GIT_ERROR, GIT_ERROR_RECORDING,
+                       "%s:%u: invalid event", filename, i + 1);
+          ret = FALSE;
+        }
+      else
+        {
+          step.arg1 = n_fields >= 3 ? g_strcompress (fields[2]) : NULL;
+          step.arg2 = n_fields >= 4 ? g_strcompress (fields[3]) : NULL;
+          g_array_append_val (steps, step);
+        }
+
+      g_strfreev (fields);
+    }
+
+  g_strfreev (lines);
+
+  return ret;
+}
+
+static void
+git_recorder_free_steps (GArray *steps)
+{
+  guint i;
+
+  for (i = 0; i < steps->len; i++)
+    {
+      GitRecorderStep *step = &g_array_index (steps, GitRecorderStep, i);
+
+      g_free (step->arg1);
+      g_free (step->arg2);
+    }
+
+  g_array_free (steps, TRUE);
+}
+
+static gint
+git_recorder_compare_latency (gconstpointer a, gconstpointer b)
+{
+  gdouble da = *(const gdouble *) a, db = *(const gdouble *) b;
+
+  return da < db ? -1 : da > db ? 1 : 0;
+}
+
+/* Gets the pth percentile of a sorted array using the nearest rank */
+static gdouble
+git_recorder_percentile (GArray *latencies, gdouble p)
+{
+  guint rank = (guint) (p / 100.0 * latencies->len + 0.999999);
+
+  return g_array_index (latencies, gdouble, MAX (rank, 1) - 1);
+}
+
+static void
+git_recorder_print_report (GitRecorderReplay *replay)
+{
+  guint i;
+
+  printf ("%-14s %6s %9s %9s %9s %9s\n",
+          "step", "count", "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+  for (i = 0; i < GIT_RECORDER_N_EVENTS; i++)
+    {
+      GArray *latencies = replay->latencies[i];
+
+      if (latencies->len == 0)
+        continue;
+
+      g_array_sort (latencies, git_recorder_compare_latency);
+
+      printf ("%-14s %6u %9.1f %9.1f %9.1f %9.1f\n",
+              git_recorder_event_names[i],
+              latencies->len,
+              git_recorder_percentile (latencies, 50.0) * 1000.0,
+              git_recorder_percentile (latencies, 90.0) * 1000.0,
+              git_recorder_percentile (latencies, 99.0) * 1000.0,
+              g_array_index (latencies, gdouble,
+                             latencies->len - 1) * 1000.0);
+    }
+
+  fflush (stdout);
+}
+
+static void
+git_recorder_replay_finish (GitRecorderReplay *replay)
+{
+  guint i;
+
+  git_recorder_print_report (replay);
+
+  g_signal_handler_disconnect (replay->sview, replay->state_handler);
+  g_object_unref (replay->sview);
+
+  /* Destroying the window quits the main loop */
+  gtk_widget_destroy (GTK_WIDGET (replay->main_window));
+  g_object_unref (replay->main_window);
+
+  git_recorder_free_steps (replay->steps);
+  for (i = 0; i < GIT_RECORDER_N_EVENTS; i++)
+    g_array_free (replay->latencies[i], TRUE);
+  g_timer_destroy (replay->step_timer);
+
+  g_slice_free (GitRecorderReplay, replay);
+}
+
+static gboolean
+git_recorder_on_settled (gpointer data)
+{
+  GitRecorderReplay *replay = (GitRecorderReplay *) data;
+  GitRecorderStep *step;
+  gdouble latency;
+
+  replay->settled_source = 0;
+
+  switch (git_source_view_get_state (replay->sview))
+    {
+    case GIT_SOURCE_VIEW_LOADING:
+      /* Wait for the state to change */
+      return FALSE;
+
+    case GIT_SOURCE_VIEW_CONFIRM:
+      /* There is no way to record the answer to the confirmation so
+         always load the whole file to keep the replay deterministic */
+      git_source_view_confirm_load (replay->sview, GIT_SOURCE_VIEW_LOAD_FULL);
+      return FALSE;
+
+    default:
+      break;
+    }
+
+  latency = g_timer_elapsed (replay->step_timer, NULL);
+  step = &g_array_index (replay->steps, GitRecorderStep,
+                         replay->next_step);
+  g_array_append_val (replay->latencies[step->event], latency);
+
+  replay->waiting = FALSE;
+  replay->next_step++;
+
+  git_recorder_replay_next (replay);
+
+  return FALSE;
+}
+
+static void
+git_recorder_wait_until_settled (GitRecorderReplay *replay)
+{
+  /* The low priority idle runs after GTK has finished resizing and
+     redrawing so the step includes the time to paint */
+  if (replay->settled_source == 0)
+    replay->settled_source
+      = g_idle_add_full (G_PRIORITY_LOW, git_recorder_on_settled,
+                         replay, NULL);
+}
+
+static void
+git_recorder_on_state_changed (GitRecorderReplay *replay)
+{
+  if (replay->waiting)
+    git_recorder_wait_until_settled (replay);
+}
+
+static GitCommit *
+git_recorder_find_commit (GitSourceView *sview, const gchar *hash)
+{
+  GitAnnotatedSource *source = git_source_view_get_source (sview);
+  gsize i, n_lines;
+
+  if (source == NULL)
+    return NULL;
+
+  n_lines = git_annotated_source_get_n_lines (source);
+
+  for (i = 0; i < n_lines; i++)
+    {
+      const GitAnnotatedSourceLine *line
+        = git_annotated_source_peek_line (source, i);
+
+      if (!strcmp (git_commit_get_hash (line->commit), hash))
+        return line->commit;
+    }
+
+  return NULL;
+}
+
+static void
+git_recorder_replay_next (GitRecorderReplay *replay)
+{
+  GitRecorderStep *step;
+
+  if (replay->next_step >= replay->steps->len)
+    {
+      git_recorder_replay_finish (replay);
+      return;
+    }
+
+  step = &g_array_index (replay->steps, GitRecorderStep, replay->next_step);
+
+  replay->waiting = TRUE;
+  g_timer_start (replay->step_timer);
+
+  switch (step->event)
+    {
+    case GIT_RECORDER_OPEN:
+    case GIT_RECORDER_REVISION:
+      git_main_window_set_file (replay->main_window, step->arg1,
+                                step->arg2 && *step->arg2
+                                ? step->arg2 : NULL);
+      break;
+
+    case GIT_RECORDER_SCROLL:
+      git_source_view_scroll_to (replay->sview, atoi (step->arg2));
+      break;
+
+    case GIT_RECORDER_SELECT_COMMIT:
+      {
+        GitCommit *commit = git_recorder_find_commit (replay->sview,
+                                                      step->arg1);
+
+        if (commit)
+          g_signal_emit_by_name (replay->sview, "commit-selected", commit);
+        else
+          g_warning ("Commit %s not found in the replayed source",
+                     step->arg1);
+      }
+      break;
+
+    case GIT_RECORDER_BACK:
+      git_main_window_go_back (replay->main_window);
+      break;
+
+    case GIT_RECORDER_FORWARD:
+      git_main_window_go_forward (replay->main_window);
+      break;
+
+    case GIT_RECORDER_N_EVENTS:
+      g_assert_not_reached ();
+    }
+
+  git_recorder_wait_until_settled (replay);
+}
+
+static gboolean
+git_recorder_on_start (gpointer data)
+{
+  git_recorder_replay_next ((GitRecorderReplay *) data);
+
+  return FALSE;
+}
+
+/* Replays the recording in filename against main_window and prints
+   the latency percentiles of each type of step to stdout. The window
+   is destroyed once the replay has finished */
+gboolean
+git_recorder_replay (GitMainWindow *main_window,
+                     const gchar *filename,
+                     GError **error)
+{
+  GitRecorderReplay *replay;
+  GArray *steps;
+  guint i;
+
+  g_return_val_if_fail (GIT_IS_MAIN_WINDOW (main_window), FALSE);
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  steps = g_array_new (FALSE, FALSE, sizeof (GitRecorderStep));
+
+  if (!git_recorder_parse (filename, steps, error))
+    {
+      git_recorder_free_steps (steps);
+      return FALSE;
+    }
+
+  replay = g_slice_new0 (GitRecorderReplay);
+  replay->main_window = g_object_ref (main_window);
+  replay->sview
+    = g_object_ref (git_main_window_get_source_view (main_window));
+  replay->steps = steps;
+  replay->step_timer = g_timer_new ();
+  for (i = 0; i < GIT_RECORDER_N_EVENTS; i++)
+    replay->latencies[i] = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+  replay->state_handler
+    = g_signal_connect_swapped (replay->sview, "notify::state",
+                                G_CALLBACK (git_recorder_on_state_changed),
+                                replay);
+
+  /* Start from the main loop so that the window can be destroyed
+     even if there are no steps */
+  g_idle_add (git_recorder_on_start, replay);
+
+  return TRUE;
+}
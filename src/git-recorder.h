@@ -0,0 +1,54 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_RECORDER_H__
+#define __GIT_RECORDER_H__
+
+#include <glib.h>
+
+#include "git-main-window.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+  {
+    GIT_RECORDER_OPEN,
+    GIT_RECORDER_REVISION,
+    GIT_RECORDER_SCROLL,
+    GIT_RECORDER_SELECT_COMMIT,
+    GIT_RECORDER_BACK,
+    GIT_RECORDER_FORWARD,
+
+    GIT_RECORDER_N_EVENTS
+  } GitRecorderEvent;
+
+gboolean git_recorder_start (const gchar *filename, GError **error);
+void git_recorder_stop (void);
+gboolean git_recorder_is_recording (void);
+
+void git_recorder_record (GitRecorderEvent event,
+                          const gchar *arg1,
+                          const gchar *arg2);
+void git_recorder_record_scroll (gint delta, gint offset);
+
+gboolean git_recorder_replay (GitMainWindow *main_window,
+                              const gchar *filename,
+                              GError **error);
+
+G_END_DECLS
+
+#endif /* __GIT_RECORDER_H__ */
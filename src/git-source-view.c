@@ -21,19 +21,33 @@
 
 #include <gtk/gtkwidget.h>
 #include <gtk/gtktooltip.h>
+#include <gtk/gtkclipboard.h>
+#include <gtk/gtkselection.h>
+#include <gdk/gdkkeysyms.h>
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "git-source-view.h"
 #include "git-annotated-source.h"
+#include "git-blame-estimator.h"
 #include "git-marshal.h"
 #include "git-common.h"
 #include "git-enum-types.h"
+#include "git-glyph-cache.h"
+#include "git-highlighter.h"
+#include "git-trace.h"
+#include "git-memory.h"
+#include "git-recorder.h"
+#include "git-alloc.h"
+#include "git-watchdog.h"
 
 static void git_source_view_dispose (GObject *object);
 static void git_source_view_realize (GtkWidget *widget);
+static void git_source_view_style_set (GtkWidget *widget,
+                                       GtkStyle *previous_style);
 static gboolean git_source_view_expose_event (GtkWidget *widget,
                                               GdkEventExpose *event);
 static void git_source_view_set_scroll_adjustments (GtkWidget *widget,
@@ -47,27 +61,72 @@ static gboolean git_source_view_button_press_event (GtkWidget *widget,
                                                     GdkEventButton *event);
 static gboolean git_source_view_button_release_event (GtkWidget *widget,
                                                       GdkEventButton *event);
+static gboolean git_source_view_focus_change_event (GtkWidget *widget,
+                                                    GdkEventFocus *event);
+static gboolean git_source_view_leave_notify_event (GtkWidget *widget,
+                                                    GdkEventCrossing *event);
+static gboolean git_source_view_key_press_event (GtkWidget *widget,
+                                                 GdkEventKey *event);
 static void git_source_view_get_property (GObject *object, guint property_id,
                                           GValue *value, GParamSpec *pspec);
 
+static void git_source_view_on_estimated (GitBlameEstimator *estimator,
+                                          const GError *error,
+                                          GitSourceView *sview);
+
 static gboolean git_source_view_query_tooltip (GtkWidget *widget,
                                                gint x, gint y,
                                                gboolean keyboard_tooltip,
                                                GtkTooltip *tooltip);
 
+static void git_source_view_on_trim (gpointer data);
+
+static void git_source_view_get_commit_color (GitSourceView *sview,
+                                              GitCommit *commit,
+                                              GdkColor *color);
+
 G_DEFINE_TYPE (GitSourceView, git_source_view, GTK_TYPE_WIDGET);
 
 #define GIT_SOURCE_VIEW_GET_PRIVATE(obj) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_SOURCE_VIEW, \
                                 GitSourceViewPrivate))
 
+typedef struct _GitSourceViewRow GitSourceViewRow;
+typedef struct _GitSourceViewClipboardData GitSourceViewClipboardData;
+
 struct _GitSourceViewPrivate
 {
   GitAnnotatedSource *paint_source, *load_source;
   guint loading_completed_handler;
+  guint loading_progress_handler;
+
+  /* The estimator is run before the blame to decide how to load the
+     file */
+  GitBlameEstimator *estimator;
+  guint estimator_completed_handler;
+  gchar *load_filename, *load_revision;
+  /* TRUE if the files are blamed with --reverse. The estimator only
+     understands single revisions so it is skipped in this mode */
+  gboolean reverse;
+  /* TRUE if the load source is only blaming the visible lines */
+  gboolean load_is_preview;
+  /* TRUE if the whole file should be blamed once the preview has
+     finished */
+  gboolean load_full_after_preview;
+  /* Estimated number of seconds for the full blame or -1 if not
+     known */
+  gdouble load_estimate;
+  GTimer *load_timer;
 
   guint line_height, max_line_width, max_hash_length;
 
+  /* The gutter between the hashes and the text shows the line number
+     and optionally the line number in the commit that the line came
+     from. The width is worked out once when the source is measured */
+  gboolean show_line_numbers, show_orig_line_numbers;
+  guint max_orig_line;
+  gint gutter_width;
+
   GtkAdjustment *hadjustment, *vadjustment;
   guint hadjustment_value_changed_handler;
   guint vadjustment_value_changed_handler;
@@ -81,12 +140,112 @@ struct _GitSourceViewPrivate
 
   GdkCursor *hand_cursor;
   gboolean hand_cursor_set;
+
+  /* Cache of rendered ASCII glyphs used to paint lines without going
+     through Pango. This is created lazily and thrown away whenever
+     the style changes */
+  GitGlyphCache *glyph_cache;
+
+  /* The selection runs from the anchor, where the button was
+     pressed, to the cursor. The positions are a line number and a
+     byte offset into the text of that line */
+  gint anchor_line, anchor_byte;
+  gint cursor_line, cursor_byte;
+  gboolean has_selection;
+  /* TRUE while the button is held down to drag out a selection */
+  gboolean selecting;
+
+  /* Map from each commit to a GArray of the runs of consecutive lines
+     that it annotates. This is built whenever a new source is
+     painted so that the lines of the hovered commit can be found
+     without scanning the whole file */
+  GHashTable *commit_runs;
+  /* The commit whose lines are highlighted because the pointer is
+     over one of its hashes */
+  GitCommit *hover_commit;
+  /* The author whose lines are highlighted or NULL. The lines are
+     found from the paint source's ownership summary */
+  gchar *highlight_author;
+
+  /* Colours for the syntax highlighting worked out from the default
+     colours and the widget's style */
+  GdkColor style_colors[GIT_HIGHLIGHT_N_STYLES];
+
+  GitSourceViewColorMode color_mode;
+  /* Map from each commit to its GdkColor in the age colour mode. This
+     is worked out from the author times whenever a new source is
+     painted so that nothing has to be calculated while painting */
+  GHashTable *age_colors;
+
+  /* The line that is moved with the keyboard */
+  gint current_line;
+
+  /* Direct-mapped cache of Pango layouts for the rows that can't be
+     painted from the glyph cache. It is indexed by the line number
+     modulo the size */
+  GitSourceViewRow *row_cache;
+
+  /* When the current line is moved the rows that are about to be
+     scrolled into view are prepared in an idle handler */
+  guint prerender_idle;
+
+  /* A big copy that is being gathered before the clipboard is
+     claimed */
+  GitSourceViewClipboardData *copy_data;
+  guint copy_idle;
+  gint prerender_line, prerender_end, prerender_direction;
+  GTimer *move_timer;
+  gdouble move_speed;
+
+  /* Highlights the paint source in a thread */
+  GitHighlighter *highlighter;
+  guint highlighter_changed_handler;
+
+  /* Whether the caches are released when over the memory budget */
+  gboolean trim_registered;
+};
+
+struct _GitSourceViewRow
+{
+  gint line_num;
+  PangoLayout *layout;
+  /* Estimated size added to the memory accounting */
+  gsize memory_size;
+};
+
+typedef struct _GitSourceViewRun GitSourceViewRun;
+
+struct _GitSourceViewRun
+{
+  /* First line of the run and the line after the last */
+  guint start, end;
+};
+
+struct _GitSourceViewClipboardData
+{
+  GitAnnotatedSource *source;
+  gint start_line, start_byte;
+  gint end_line, end_byte;
+  gboolean with_annotations;
+
+  /* Map from each commit to the prefix that is added to its lines
+     when copying with annotations */
+  GHashTable *prefixes;
+
+  /* The text as it is being gathered. The buffer is allocated with
+     the measured size of the selection, length bytes of it have been
+     filled in and next_line is the next line to copy */
+  gchar *text;
+  gsize length, alloc_length;
+  gint next_line;
+  gboolean complete;
 };
 
 enum
   {
     SET_SCROLL_ADJUSTMENTS,
     COMMIT_SELECTED,
+    LOAD_PROGRESS,
 
     LAST_SIGNAL
   };
@@ -105,6 +264,65 @@ static guint client_signals[LAST_SIGNAL];
 
 #define GIT_SOURCE_VIEW_GAP 3
 
+/* Line height to assume when deciding how many lines are visible
+   before any source has been measured */
+#define GIT_SOURCE_VIEW_DEFAULT_LINE_HEIGHT 16
+
+/* Number of lines to blame when only the start of a suspicious file
+   is requested */
+#define GIT_SOURCE_VIEW_HEADER_LINES 500
+
+/* Number of rows in the layout cache */
+#define GIT_SOURCE_VIEW_ROW_CACHE_SIZE 1024
+
+/* Rough estimate of the memory used by a PangoLayout for a line on
+   top of three bytes per byte of text for the glyphs and attributes.
+   Pango doesn't expose the real size */
+#define GIT_SOURCE_VIEW_LAYOUT_OVERHEAD 512
+
+/* Number of rows to prepare in each call of the prerender handler */
+#define GIT_SOURCE_VIEW_PRERENDER_CHUNK 32
+
+/* Selections with more bytes than this are gathered in the
+   background before the clipboard is claimed instead of when another
+   application asks for them. They are never claimed as the PRIMARY
+   selection */
+#define GIT_SOURCE_VIEW_MAX_SYNC_COPY (1024 * 1024)
+
+/* Number of lines to gather in each call of the copy idle handler */
+#define GIT_SOURCE_VIEW_COPY_CHUNK 2048
+
+/* Number of seconds of movement at the current speed to prerender
+   ahead of the visible rows */
+#define GIT_SOURCE_VIEW_PRERENDER_TIME 0.5
+
+/* Minimum difference in luminance between a highlighted style and
+   the background. Colours with less contrast are blended towards the
+   style's text colour until they have enough */
+#define GIT_SOURCE_VIEW_MIN_STYLE_CONTRAST 0.4
+
+/* Colours for each of the syntax highlighting styles. These are
+   picked for a light background and are adjusted to the widget's
+   style whenever it changes */
+static const GdkColor
+git_source_view_default_style_colors[GIT_HIGHLIGHT_N_STYLES] =
+  {
+    /* None */
+    { 0, 0x0000, 0x0000, 0x0000 },
+    /* Keyword */
+    { 0, 0x2020, 0x4a4a, 0x8787 },
+    /* Type */
+    { 0, 0x4e4e, 0x9a9a, 0x0606 },
+    /* String */
+    { 0, 0xcece, 0x5c5c, 0x0000 },
+    /* Comment */
+    { 0, 0x7575, 0x5050, 0x7b7b },
+    /* Number */
+    { 0, 0xa4a4, 0x0000, 0x0000 },
+    /* Preprocessor */
+    { 0, 0x5c5c, 0x3535, 0x6666 }
+  };
+
 static void
 git_source_view_class_init (GitSourceViewClass *klass)
 {
@@ -116,12 +334,17 @@ git_source_view_class_init (GitSourceViewClass *klass)
   gobject_class->get_property = git_source_view_get_property;
 
   widget_class->realize = git_source_view_realize;
+  widget_class->style_set = git_source_view_style_set;
   widget_class->expose_event = git_source_view_expose_event;
   widget_class->size_allocate = git_source_view_size_allocate;
   widget_class->query_tooltip = git_source_view_query_tooltip;
   widget_class->motion_notify_event = git_source_view_motion_notify_event;
   widget_class->button_press_event = git_source_view_button_press_event;
   widget_class->button_release_event = git_source_view_button_release_event;
+  widget_class->focus_in_event = git_source_view_focus_change_event;
+  widget_class->focus_out_event = git_source_view_focus_change_event;
+  widget_class->leave_notify_event = git_source_view_leave_notify_event;
+  widget_class->key_press_event = git_source_view_key_press_event;
 
   klass->set_scroll_adjustments = git_source_view_set_scroll_adjustments;
 
@@ -158,6 +381,15 @@ git_source_view_class_init (GitSourceViewClass *klass)
                     G_TYPE_NONE, 1,
                     GIT_TYPE_COMMIT);
 
+  client_signals[LOAD_PROGRESS]
+    = g_signal_new ("load-progress",
+                    G_OBJECT_CLASS_TYPE (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitSourceViewClass, load_progress),
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__VOID,
+                    G_TYPE_NONE, 0);
+
   g_type_class_add_private (klass, sizeof (GitSourceViewPrivate));
 }
 
@@ -168,6 +400,9 @@ git_source_view_init (GitSourceView *self)
 
   priv = self->priv = GIT_SOURCE_VIEW_GET_PRIVATE (self);
 
+  memcpy (priv->style_colors, git_source_view_default_style_colors,
+          sizeof (priv->style_colors));
+
   g_object_set (self,
                 "has-tooltip", TRUE,
                 "can-focus", TRUE,
@@ -175,6 +410,18 @@ git_source_view_init (GitSourceView *self)
 
   priv->state = GIT_SOURCE_VIEW_READY;
   priv->state_error = NULL;
+
+  priv->estimator = git_blame_estimator_new ();
+  priv->estimator_completed_handler
+    = g_signal_connect (priv->estimator, "completed",
+                        G_CALLBACK (git_source_view_on_estimated), self);
+  priv->load_estimate = -1.0;
+  priv->load_timer = g_timer_new ();
+  priv->move_timer = g_timer_new ();
+  priv->show_line_numbers = TRUE;
+
+  git_memory_add_trim_func (git_source_view_on_trim, self);
+  priv->trim_registered = TRUE;
 }
 
 static void
@@ -186,6 +433,8 @@ git_source_view_unref_loading_source (GitSourceView *sview)
     {
       g_signal_handler_disconnect (priv->load_source,
                                    priv->loading_completed_handler);
+      g_signal_handler_disconnect (priv->load_source,
+                                   priv->loading_progress_handler);
       g_object_unref (priv->load_source);
       priv->load_source = NULL;
     }
@@ -223,12 +472,132 @@ git_source_view_unref_vadjustment (GitSourceView *sview)
     }
 }
 
+static void git_source_view_cancel_copy (GitSourceView *sview);
+static void git_source_view_set_text_for_line
+                                   (GitSourceView *sview,
+                                    PangoLayout *layout,
+                                    const GitAnnotatedSourceLine *line);
+
+static void
+git_source_view_stop_highlighter (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+
+  if (priv->highlighter)
+    {
+      g_signal_handler_disconnect (priv->highlighter,
+                                   priv->highlighter_changed_handler);
+      g_object_unref (priv->highlighter);
+      priv->highlighter = NULL;
+    }
+}
+
+static void
+git_source_view_stop_prerender (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+
+  if (priv->prerender_idle)
+    {
+      g_source_remove (priv->prerender_idle);
+      priv->prerender_idle = 0;
+    }
+}
+
+static void
+git_source_view_clear_row_cache (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  int i;
+
+  git_source_view_stop_prerender (sview);
+
+  if (priv->row_cache)
+    for (i = 0; i < GIT_SOURCE_VIEW_ROW_CACHE_SIZE; i++)
+      if (priv->row_cache[i].layout)
+        {
+          git_memory_add (GIT_MEMORY_LAYOUTS,
+                          -(gssize) priv->row_cache[i].memory_size);
+          g_object_unref (priv->row_cache[i].layout);
+          priv->row_cache[i].layout = NULL;
+          priv->row_cache[i].memory_size = 0;
+        }
+}
+
+/* Gets a layout with the text of a line already set. The layout is
+   owned by the row cache and is only valid until the next row with
+   the same slot is requested */
+static PangoLayout *
+git_source_view_get_row_layout (GitSourceView *sview, gint line_num)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  GitSourceViewRow *row;
+  const GitAnnotatedSourceLine *line;
+  gsize memory_size;
+
+  if (priv->row_cache == NULL)
+    priv->row_cache = g_new0 (GitSourceViewRow,
+                              GIT_SOURCE_VIEW_ROW_CACHE_SIZE);
+
+  row = priv->row_cache + line_num % GIT_SOURCE_VIEW_ROW_CACHE_SIZE;
+
+  if (row->layout == NULL)
+    row->layout = gtk_widget_create_pango_layout (GTK_WIDGET (sview), NULL);
+  else if (row->line_num == line_num)
+    return row->layout;
+
+  GIT_TRACE1 (layout__create, line_num);
+
+  line = git_annotated_source_get_line (priv->paint_source, line_num);
+  git_source_view_set_text_for_line (sview, row->layout, line);
+  row->line_num = line_num;
+
+  memory_size = GIT_SOURCE_VIEW_LAYOUT_OVERHEAD + line->text_length * 3;
+  git_memory_add (GIT_MEMORY_LAYOUTS,
+                  (gssize) memory_size - (gssize) row->memory_size);
+  row->memory_size = memory_size;
+
+  return row->layout;
+}
+
+/* Called when the memory budget is exceeded to release everything
+   that can be rebuilt when it is next painted */
+static void
+git_source_view_on_trim (gpointer data)
+{
+  GitSourceView *sview = (GitSourceView *) data;
+  GitSourceViewPrivate *priv = sview->priv;
+
+  git_source_view_clear_row_cache (sview);
+
+  if (priv->glyph_cache)
+    {
+      git_glyph_cache_free (priv->glyph_cache);
+      priv->glyph_cache = NULL;
+    }
+
+  if (priv->paint_source)
+    git_annotated_source_free_column_maps (priv->paint_source);
+}
+
 static void
 git_source_view_dispose (GObject *object)
 {
   GitSourceView *self = (GitSourceView *) object;
   GitSourceViewPrivate *priv = self->priv;
 
+  if (priv->trim_registered)
+    {
+      git_memory_remove_trim_func (git_source_view_on_trim, self);
+      priv->trim_registered = FALSE;
+    }
+
+  /* This waits for the highlighter's thread so it has to be done
+     before the source goes */
+  git_source_view_stop_highlighter (self);
+
+  git_source_view_cancel_copy (self);
+
   if (priv->paint_source)
     {
       g_object_unref (priv->paint_source);
@@ -240,6 +609,35 @@ git_source_view_dispose (GObject *object)
 
   git_source_view_unref_loading_source (self);
 
+  if (priv->estimator)
+    {
+      g_signal_handler_disconnect (priv->estimator,
+                                   priv->estimator_completed_handler);
+      g_object_unref (priv->estimator);
+      priv->estimator = NULL;
+    }
+
+  if (priv->load_filename)
+    {
+      g_free (priv->load_filename);
+      priv->load_filename = NULL;
+    }
+  if (priv->load_revision)
+    {
+      g_free (priv->load_revision);
+      priv->load_revision = NULL;
+    }
+  if (priv->highlight_author)
+    {
+      g_free (priv->highlight_author);
+      priv->highlight_author = NULL;
+    }
+  if (priv->load_timer)
+    {
+      g_timer_destroy (priv->load_timer);
+      priv->load_timer = NULL;
+    }
+
   if (priv->state_error)
     {
       g_error_free (priv->state_error);
@@ -252,33 +650,106 @@ git_source_view_dispose (GObject *object)
       priv->hand_cursor = NULL;
     }
 
+  if (priv->glyph_cache)
+    {
+      git_glyph_cache_free (priv->glyph_cache);
+      priv->glyph_cache = NULL;
+    }
+
+  if (priv->commit_runs)
+    {
+      g_hash_table_destroy (priv->commit_runs);
+      priv->commit_runs = NULL;
+    }
+  if (priv->age_colors)
+    {
+      g_hash_table_destroy (priv->age_colors);
+      priv->age_colors = NULL;
+    }
+  priv->hover_commit = NULL;
+
+  git_source_view_clear_row_cache (self);
+  if (priv->row_cache)
+    {
+      g_free (priv->row_cache);
+      priv->row_cache = NULL;
+    }
+  if (priv->move_timer)
+    {
+      g_timer_destroy (priv->move_timer);
+      priv->move_timer = NULL;
+    }
+
   G_OBJECT_CLASS (git_source_view_parent_class)->dispose (object);
 }
 
-static void
-git_source_view_set_text_for_line (PangoLayout *layout,
-                                   const GitAnnotatedSourceLine *line)
+static int
+git_source_view_get_trimmed_length (const GitAnnotatedSourceLine *line)
 {
-  int len = strlen (line->text);
+  int len = line->text_length;
 
   /* Remove any trailing spaces in the text */
   while (len > 0 && isspace (line->text[len - 1]))
     len--;
 
-  pango_layout_set_text (layout, line->text, len);
-  pango_layout_set_attributes (layout, NULL);
+  return len;
 }
 
 static void
-git_source_view_set_text_for_commit (PangoLayout *layout, GitCommit *commit)
+git_source_view_set_text_for_line (GitSourceView *sview,
+                                   PangoLayout *layout,
+                                   const GitAnnotatedSourceLine *line)
 {
-  const gchar *hash = git_commit_get_hash (commit), *p;
-  int len = strlen (hash);
+  pango_layout_set_text (layout, line->text,
+                         git_source_view_get_trimmed_length (line));
+
+  if (line->n_runs > 0)
+    {
+      PangoAttrList *attrs = pango_attr_list_new ();
+      guint i;
+
+      for (i = 0; i < line->n_runs; i++)
+        {
+          const GitHighlightRun *run = line->runs + i;
+          const GdkColor *color = sview->priv->style_colors + run->style;
+          PangoAttribute *attr;
+
+          if (run->style == GIT_HIGHLIGHT_STYLE_NONE)
+            continue;
+
+          attr = pango_attr_foreground_new (color->red, color->green,
+                                            color->blue);
+          attr->start_index = run->start;
+          attr->end_index = run->start + run->length;
+          pango_attr_list_insert (attrs, attr);
+        }
+
+      pango_layout_set_attributes (layout, attrs);
+      pango_attr_list_unref (attrs);
+    }
+  else
+    pango_layout_set_attributes (layout, NULL);
+}
+
+static gboolean
+git_source_view_is_wip_hash (const gchar *hash)
+{
+  const gchar *p;
 
   /* If the hash is all zeroes then it represents lines in the working
      copy that have not been committed */
   for (p = hash; *p == '0'; p++);
-  if (p - hash == len && len == GIT_COMMIT_HASH_LENGTH)
+
+  return *p == '\0' && p - hash == GIT_COMMIT_HASH_LENGTH;
+}
+
+static void
+git_source_view_set_text_for_commit (PangoLayout *layout, GitCommit *commit)
+{
+  const gchar *hash = git_commit_get_hash (commit);
+  int len = strlen (hash);
+
+  if (git_source_view_is_wip_hash (hash))
     pango_layout_set_markup (layout, "<i>WIP</i>", -1);
   else
     {
@@ -307,7 +778,7 @@ git_source_view_update_scroll_adjustments (GitSourceView *sview)
       priv->hadjustment->step_increment = 10.0;
       priv->hadjustment->page_increment = widget->allocation.width;
       priv->hadjustment->page_size = widget->allocation.width
-        - priv->max_hash_length - GIT_SOURCE_VIEW_GAP;
+        - priv->max_hash_length - priv->gutter_width - GIT_SOURCE_VIEW_GAP;
 
       if (priv->hadjustment->value + priv->hadjustment->page_size
           > priv->hadjustment->upper)
@@ -337,6 +808,50 @@ git_source_view_update_scroll_adjustments (GitSourceView *sview)
     }
 }
 
+static gint
+git_source_view_count_digits (guint number)
+{
+  gint digits = 1;
+
+  while (number >= 10)
+    {
+      number /= 10;
+      digits++;
+    }
+
+  return digits;
+}
+
+static GitGlyphCache *git_source_view_get_glyph_cache (GitSourceView *sview);
+
+static void
+git_source_view_update_gutter_width (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  gint digit_width, gutter_width = 0;
+
+  if (priv->paint_source && GTK_WIDGET_REALIZED (sview))
+    {
+      digit_width = git_glyph_cache_get_digit_width
+        (git_source_view_get_glyph_cache (sview));
+
+      if (priv->show_line_numbers)
+        gutter_width += git_source_view_count_digits
+          (git_annotated_source_get_n_lines (priv->paint_source))
+          * digit_width + GIT_SOURCE_VIEW_GAP * 2;
+      if (priv->show_orig_line_numbers)
+        gutter_width += git_source_view_count_digits (priv->max_orig_line)
+          * digit_width + GIT_SOURCE_VIEW_GAP * 2;
+    }
+
+  if (gutter_width != priv->gutter_width)
+    {
+      priv->gutter_width = gutter_width;
+      git_source_view_update_scroll_adjustments (sview);
+      gtk_widget_queue_draw (GTK_WIDGET (sview));
+    }
+}
+
 static void
 git_source_view_calculate_line_height (GitSourceView *sview)
 {
@@ -349,22 +864,45 @@ git_source_view_calculate_line_height (GitSourceView *sview)
                                                             NULL);
       int line_num;
       PangoRectangle logical_rect;
+      PangoFontMetrics *metrics;
       guint line_height = 1, max_line_width = 1, max_hash_length = 1;
+      guint max_orig_line = 0;
+      guint char_width;
+      /* This measures every line so it can take a long time for a
+         big file */
+      const gchar *old_operation
+        = git_watchdog_set_operation ("calculating line height");
+
+      /* Lines that were loaded from the cache might not have their
+         text decoded yet. Rather than decoding the whole file just to
+         measure it the width of these lines is estimated from the
+         length */
+      metrics = pango_context_get_metrics (pango_layout_get_context (layout),
+                                           GTK_WIDGET (sview)->style->font_desc,
+                                           NULL);
+      char_width = PANGO_PIXELS (pango_font_metrics_get_approximate_char_width
+                                 (metrics));
+      pango_font_metrics_unref (metrics);
 
       for (line_num = 0;
            line_num < git_annotated_source_get_n_lines (priv->paint_source);
            line_num++)
         {
           const GitAnnotatedSourceLine *line
-            = git_annotated_source_get_line (priv->paint_source, line_num);
+            = git_annotated_source_peek_line (priv->paint_source, line_num);
 
-          git_source_view_set_text_for_line (layout, line);
-          pango_layout_get_pixel_extents (layout, NULL, &logical_rect);
+          if (line->text)
+            {
+              git_source_view_set_text_for_line (sview, layout, line);
+              pango_layout_get_pixel_extents (layout, NULL, &logical_rect);
 
-          if (logical_rect.height > line_height)
-            line_height = logical_rect.height;
-          if (logical_rect.width > max_line_width)
-            max_line_width = logical_rect.width;
+              if (logical_rect.height > line_height)
+                line_height = logical_rect.height;
+              if (logical_rect.width > max_line_width)
+                max_line_width = logical_rect.width;
+            }
+          else if (line->text_length * char_width > max_line_width)
+            max_line_width = line->text_length * char_width;
 
           git_source_view_set_text_for_commit (layout, line->commit);
           pango_layout_get_pixel_extents (layout, NULL, &logical_rect);
@@ -373,16 +911,85 @@ git_source_view_calculate_line_height (GitSourceView *sview)
             line_height = logical_rect.height;
           if (logical_rect.width > max_hash_length)
             max_hash_length = logical_rect.width;
+          if (line->orig_line > max_orig_line)
+            max_orig_line = line->orig_line;
         }
 
       priv->line_height = line_height;
       priv->max_line_width = max_line_width;
       priv->max_hash_length = max_hash_length + GIT_SOURCE_VIEW_GAP * 2;
+      priv->max_orig_line = max_orig_line;
+      git_source_view_update_gutter_width (sview);
 
       g_object_unref (layout);
 
       git_source_view_update_scroll_adjustments (sview);
+
+      git_watchdog_set_operation (old_operation);
+    }
+}
+
+static gdouble
+git_source_view_get_luminance (const GdkColor *color)
+{
+  return (0.299 * color->red + 0.587 * color->green + 0.114 * color->blue)
+    / 65535.0;
+}
+
+/* Adjusts the highlighting colours so that they can be read against
+   the base colour of the style */
+static void
+git_source_view_update_style_colors (GitSourceView *sview)
+{
+  GtkStyle *style = GTK_WIDGET (sview)->style;
+  const GdkColor *base = &style->base[GTK_STATE_NORMAL];
+  const GdkColor *text = &style->text[GTK_STATE_NORMAL];
+  gdouble base_luminance = git_source_view_get_luminance (base);
+  int i;
+
+  for (i = 0; i < GIT_HIGHLIGHT_N_STYLES; i++)
+    {
+      const GdkColor *color = git_source_view_default_style_colors + i;
+      GdkColor *blended = sview->priv->style_colors + i;
+      gdouble amount;
+
+      for (amount = 0.0; amount <= 1.0; amount += 0.125)
+        {
+          blended->red = color->red + (text->red - color->red) * amount;
+          blended->green = (color->green
+                            + (text->green - color->green) * amount);
+          blended->blue = color->blue + (text->blue - color->blue) * amount;
+
+          if (fabs (git_source_view_get_luminance (blended) - base_luminance)
+              >= GIT_SOURCE_VIEW_MIN_STYLE_CONTRAST)
+            break;
+        }
+    }
+}
+
+static void
+git_source_view_style_set (GtkWidget *widget, GtkStyle *previous_style)
+{
+  GitSourceView *sview = (GitSourceView *) widget;
+  GitSourceViewPrivate *priv = sview->priv;
+
+  if (GTK_WIDGET_CLASS (git_source_view_parent_class)->style_set)
+    GTK_WIDGET_CLASS (git_source_view_parent_class)
+      ->style_set (widget, previous_style);
+
+  git_source_view_update_style_colors (sview);
+
+  /* The font may have changed so the glyphs need rendering again */
+  if (priv->glyph_cache)
+    {
+      git_glyph_cache_free (priv->glyph_cache);
+      priv->glyph_cache = NULL;
     }
+  git_source_view_clear_row_cache (sview);
+
+  priv->line_height = 0;
+  git_source_view_calculate_line_height (sview);
+  gtk_widget_queue_draw (widget);
 }
 
 static void
@@ -404,7 +1011,8 @@ git_source_view_realize (GtkWidget *widget)
   attribs.event_mask = gtk_widget_get_events (widget)
     | GDK_EXPOSURE_MASK | GDK_POINTER_MOTION_MASK
     | GDK_LEAVE_NOTIFY_MASK | GDK_ENTER_NOTIFY_MASK
-    | GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK;
+    | GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK
+    | GDK_KEY_PRESS_MASK;
 
   widget->window = gdk_window_new (gtk_widget_get_parent_window (widget),
                                    &attribs,
@@ -420,89 +1028,548 @@ git_source_view_realize (GtkWidget *widget)
   git_source_view_calculate_line_height (GIT_SOURCE_VIEW (widget));
 }
 
-static gboolean
-git_source_view_expose_event (GtkWidget *widget,
-                              GdkEventExpose *event)
+static GitGlyphCache *
+git_source_view_get_glyph_cache (GitSourceView *sview)
 {
-  GitSourceView *sview = (GitSourceView *) widget;
   GitSourceViewPrivate *priv = sview->priv;
-  gsize line_start, line_end, line_num, n_lines;
-  gint y;
-  PangoLayout *layout;
-  cairo_t *cr;
 
-  if (priv->paint_source && priv->line_height)
-    {
-      layout = gtk_widget_create_pango_layout (widget, NULL);
-      cr = gdk_cairo_create (widget->window);
+  if (priv->glyph_cache == NULL)
+    priv->glyph_cache
+      = git_glyph_cache_new (gtk_widget_get_pango_context (GTK_WIDGET (sview)));
 
-      n_lines = git_annotated_source_get_n_lines (priv->paint_source);
-      line_start = (event->area.y + priv->y_offset) / priv->line_height;
-      line_end = (event->area.y + priv->y_offset
-                  + event->area.height + priv->line_height - 1)
-        / priv->line_height;
+  return priv->glyph_cache;
+}
 
-      if (line_end > n_lines)
-        line_end = n_lines;
-      if (line_start > line_end)
-        line_start = line_end;
+/* Plain ASCII lines can be painted directly from the glyph
+   cache. Insensitive text is drawn embossed by the theme so that
+   still needs to go through Pango */
+static gboolean
+git_source_view_use_glyph_cache (GitSourceView *sview,
+                                 const GitAnnotatedSourceLine *line)
+{
+  return ((line->flags & GIT_ANNOTATED_SOURCE_LINE_ASCII)
+          && GTK_WIDGET_STATE (sview) != GTK_STATE_INSENSITIVE
+          && git_glyph_cache_is_monospace
+          (git_source_view_get_glyph_cache (sview)));
+}
 
-      for (line_num = line_start; line_num < line_end; line_num++)
-        {
-          GdkRectangle clip_rect;
-          const GitAnnotatedSourceLine *line
-            = git_annotated_source_get_line (priv->paint_source, line_num);
-          GdkColor color;
-          y = line_num * priv->line_height - priv->y_offset;
+static gint
+git_source_view_get_text_x (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
 
-          git_source_view_set_text_for_commit (layout, line->commit);
-          git_commit_get_color (line->commit, &color);
+  return -priv->x_offset + priv->max_hash_length + priv->gutter_width
+    + GIT_SOURCE_VIEW_GAP;
+}
 
-          cairo_set_source_rgb (cr, color.red / 65535.0, color.green / 65535.0,
-                                color.blue / 65535.0);
-          cairo_rectangle (cr, 0, y, priv->max_hash_length, priv->line_height);
-          cairo_fill_preserve (cr);
+static gint
+git_source_view_byte_to_x (GitSourceView *sview, PangoLayout *layout,
+                           gint line_num, gint byte)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  const GitAnnotatedSourceLine *line
+    = git_annotated_source_get_line (priv->paint_source, line_num);
+  gint text_x = git_source_view_get_text_x (sview);
 
-          /* Invert the color so that the text is guaranteed to be a
-             different (albeit clashing) colour */
-          color.red = ~color.red;
-          color.green = ~color.green;
-          color.blue = ~color.blue;
-          cairo_set_source_rgb (cr, color.red / 65535.0, color.green / 65535.0,
-                                color.blue / 65535.0);
-          cairo_save (cr);
-          cairo_clip (cr);
-          cairo_move_to (cr, 0, y);
-          pango_cairo_show_layout (cr, layout);
-          cairo_restore (cr);
+  if (git_source_view_use_glyph_cache (sview, line))
+    {
+      GitColumnMap *map
+        = git_annotated_source_get_column_map (priv->paint_source, line_num);
 
-          git_source_view_set_text_for_line (layout, line);
+      return text_x + git_column_map_byte_to_column (map, byte)
+        * git_glyph_cache_get_advance (priv->glyph_cache);
+    }
+  else
+    {
+      PangoRectangle pos;
 
-          clip_rect.x = priv->max_hash_length + GIT_SOURCE_VIEW_GAP;
-          clip_rect.width = widget->allocation.width;
-          clip_rect.y = y;
-          clip_rect.height = priv->line_height;
+      git_source_view_set_text_for_line (sview, layout, line);
+      pango_layout_index_to_pos (layout,
+                                 MIN (byte, git_source_view_get_trimmed_length
+                                      (line)),
+                                 &pos);
 
-          gtk_paint_layout (widget->style,
-                            widget->window,
-                            GTK_WIDGET_STATE (widget),
-                            TRUE,
-                            &clip_rect,
-                            widget,
+      return text_x + PANGO_PIXELS (pos.x);
+    }
+}
+
+/* Finds the character boundary nearest to the given point. Points
+   above or below the text snap to the start or end of the file */
+static void
+git_source_view_get_position_at (GitSourceView *sview, gint x, gint y,
+                                 gint *line_num_ret, gint *byte_ret)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  gint n_lines = git_annotated_source_get_n_lines (priv->paint_source);
+  const GitAnnotatedSourceLine *line;
+  gint line_num, byte, trimmed_length;
+
+  y += priv->y_offset;
+
+  if (y < 0 || n_lines < 1)
+    {
+      *line_num_ret = 0;
+      *byte_ret = 0;
+      return;
+    }
+
+  line_num = y / priv->line_height;
+  if (line_num >= n_lines)
+    {
+      line_num = n_lines - 1;
+      x = G_MAXINT / 2;
+    }
+
+  line = git_annotated_source_get_line (priv->paint_source, line_num);
+  trimmed_length = git_source_view_get_trimmed_length (line);
+  x -= git_source_view_get_text_x (sview);
+
+  if (x <= 0)
+    byte = 0;
+  else if (git_source_view_use_glyph_cache (sview, line))
+    {
+      GitColumnMap *map
+        = git_annotated_source_get_column_map (priv->paint_source, line_num);
+      gint advance = git_glyph_cache_get_advance (priv->glyph_cache);
+
+      byte = git_column_map_column_to_byte (map, (x + advance / 2) / advance);
+    }
+  else
+    {
+      PangoLayout *layout
+        = gtk_widget_create_pango_layout (GTK_WIDGET (sview), NULL);
+      gint index, trailing;
+
+      git_source_view_set_text_for_line (sview, layout, line);
+      pango_layout_xy_to_index (layout, MIN (x, G_MAXINT / PANGO_SCALE)
+                                * PANGO_SCALE, 0, &index, &trailing);
+      g_object_unref (layout);
+
+      /* Move past the character if the point was in its trailing
+         half */
+      for (byte = index; trailing > 0 && byte < trimmed_length; trailing--)
+        byte = g_utf8_next_char (line->text + byte) - line->text;
+    }
+
+  *line_num_ret = line_num;
+  *byte_ret = MIN (byte, trimmed_length);
+}
+
+/* Gets the selection with the start before the end. Returns FALSE if
+   nothing is selected */
+static gboolean
+git_source_view_get_selection_bounds (GitSourceView *sview,
+                                      gint *start_line, gint *start_byte,
+                                      gint *end_line, gint *end_byte)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+
+  if (!priv->has_selection || priv->paint_source == NULL)
+    return FALSE;
+
+  if (priv->anchor_line < priv->cursor_line
+      || (priv->anchor_line == priv->cursor_line
+          && priv->anchor_byte < priv->cursor_byte))
+    {
+      *start_line = priv->anchor_line;
+      *start_byte = priv->anchor_byte;
+      *end_line = priv->cursor_line;
+      *end_byte = priv->cursor_byte;
+    }
+  else
+    {
+      *start_line = priv->cursor_line;
+      *start_byte = priv->cursor_byte;
+      *end_line = priv->anchor_line;
+      *end_byte = priv->anchor_byte;
+    }
+
+  return TRUE;
+}
+
+static void
+git_source_view_set_selection (GitSourceView *sview,
+                               gint anchor_line, gint anchor_byte,
+                               gint cursor_line, gint cursor_byte)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  gboolean has_selection = (anchor_line != cursor_line
+                            || anchor_byte != cursor_byte);
+
+  if (has_selection == priv->has_selection
+      && (!has_selection
+          || (anchor_line == priv->anchor_line
+              && anchor_byte == priv->anchor_byte
+              && cursor_line == priv->cursor_line
+              && cursor_byte == priv->cursor_byte)))
+    return;
+
+  priv->anchor_line = anchor_line;
+  priv->anchor_byte = anchor_byte;
+  priv->cursor_line = cursor_line;
+  priv->cursor_byte = cursor_byte;
+  priv->has_selection = has_selection;
+
+  gtk_widget_queue_draw (GTK_WIDGET (sview));
+}
+
+/* Paints the line numbers for a row from the glyph cache */
+static void
+git_source_view_draw_gutter (GitSourceView *sview, cairo_t *cr,
+                             const GitAnnotatedSourceLine *line,
+                             gint line_num, gint y)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  GtkWidget *widget = GTK_WIDGET (sview);
+  gint x = priv->max_hash_length + priv->gutter_width;
+
+  gdk_cairo_set_source_color (cr,
+                              &widget->style->bg[GTK_WIDGET_STATE (widget)]);
+  cairo_rectangle (cr, priv->max_hash_length, y,
+                   priv->gutter_width, priv->line_height);
+  cairo_fill (cr);
+
+  /* The original line number goes on the right next to the text */
+  if (priv->show_orig_line_numbers)
+    {
+      gdk_cairo_set_source_color (cr, &widget->style->fg[GTK_STATE_INSENSITIVE]);
+      git_glyph_cache_draw_number (priv->glyph_cache, cr,
+                                   x - GIT_SOURCE_VIEW_GAP, y,
+                                   line->orig_line);
+      x -= git_source_view_count_digits (priv->max_orig_line)
+        * git_glyph_cache_get_digit_width (priv->glyph_cache)
+        + GIT_SOURCE_VIEW_GAP * 2;
+    }
+
+  if (priv->show_line_numbers)
+    {
+      gdk_cairo_set_source_color (cr,
+                                  &widget->style->fg[GTK_WIDGET_STATE (widget)]);
+      git_glyph_cache_draw_number (priv->glyph_cache, cr,
+                                   x - GIT_SOURCE_VIEW_GAP, y,
+                                   line_num + 1);
+    }
+}
+
+static void
+git_source_view_draw_glyph_range (GitSourceView *sview, cairo_t *cr,
+                                  GitColumnMap *map,
+                                  const GitAnnotatedSourceLine *line,
+                                  gint x, gint y,
+                                  gsize start, gsize end,
+                                  const GdkColor *color)
+{
+  gdk_cairo_set_source_color (cr, (GdkColor *) color);
+  git_glyph_cache_draw (sview->priv->glyph_cache, cr, x, y,
+                        git_column_map_byte_to_column (map, start),
+                        line->text + start, end - start);
+}
+
+/* Draws part of a line from the glyph cache in the colours of its
+   highlighting runs. Returns FALSE without drawing anything if the
+   text has characters that aren't in the cache */
+static gboolean
+git_source_view_draw_glyphs (GitSourceView *sview, cairo_t *cr,
+                             GitColumnMap *map,
+                             const GitAnnotatedSourceLine *line,
+                             gint x, gint y,
+                             gsize start, gsize end)
+{
+  GtkWidget *widget = GTK_WIDGET (sview);
+  const GdkColor *text_color = &widget->style->text[GTK_WIDGET_STATE (widget)];
+  gsize pos = start;
+  guint i;
+
+  if (end <= start)
+    return TRUE;
+
+  if (!git_glyph_cache_can_draw (sview->priv->glyph_cache,
+                                 line->text + start, end - start))
+    return FALSE;
+
+  for (i = 0; i < line->n_runs && pos < end; i++)
+    {
+      const GitHighlightRun *run = line->runs + i;
+      gsize run_end = run->start + run->length;
+
+      if (run_end <= pos)
+        continue;
+      if (run->start >= end)
+        break;
+
+      if (run->start > pos)
+        {
+          git_source_view_draw_glyph_range (sview, cr, map, line, x, y,
+                                            pos, run->start, text_color);
+          pos = run->start;
+        }
+
+      git_source_view_draw_glyph_range
+        (sview, cr, map, line, x, y, pos, MIN (run_end, end),
+         run->style == GIT_HIGHLIGHT_STYLE_NONE
+         ? text_color : sview->priv->style_colors + run->style);
+      pos = MIN (run_end, end);
+    }
+
+  if (pos < end)
+    git_source_view_draw_glyph_range (sview, cr, map, line, x, y,
+                                      pos, end, text_color);
+
+  return TRUE;
+}
+
+static gboolean
+git_source_view_expose_event (GtkWidget *widget,
+                              GdkEventExpose *event)
+{
+  GitSourceView *sview = (GitSourceView *) widget;
+  GitSourceViewPrivate *priv = sview->priv;
+  gsize line_start, line_end, line_num, n_lines;
+  gint y;
+  PangoLayout *layout;
+  cairo_t *cr;
+  gint sel_start_line, sel_start_byte, sel_end_line, sel_end_byte;
+  gboolean has_selection;
+  const GitAnnotatedSourceOwner *owner = NULL;
+  guint owner_run = 0;
+  GitTraceTime expose_time;
+
+  GIT_TRACE_BEGIN (expose, expose_time);
+
+  if (priv->paint_source && priv->line_height)
+    {
+      /* The first paint after a load has its allocations counted
+         separately. Everything after that is the steady state */
+      if (git_alloc_get_phase () == GIT_ALLOC_PHASE_COMPLETE)
+        git_alloc_set_phase (GIT_ALLOC_PHASE_FIRST_PAINT);
+
+      layout = gtk_widget_create_pango_layout (widget, NULL);
+      cr = gdk_cairo_create (widget->window);
+
+      git_source_view_get_glyph_cache (sview);
+      has_selection
+        = git_source_view_get_selection_bounds (sview,
+                                                &sel_start_line,
+                                                &sel_start_byte,
+                                                &sel_end_line,
+                                                &sel_end_byte);
+
+      n_lines = git_annotated_source_get_n_lines (priv->paint_source);
+      line_start = (event->area.y + priv->y_offset) / priv->line_height;
+      line_end = (event->area.y + priv->y_offset
+                  + event->area.height + priv->line_height - 1)
+        / priv->line_height;
+
+      if (line_end > n_lines)
+        line_end = n_lines;
+      if (line_start > line_end)
+        line_start = line_end;
+
+      /* Find the first run of the highlighted author's lines that
+         ends after the first exposed line. The runs are then
+         followed along with the lines */
+      if (priv->highlight_author
+          && (owner = git_annotated_source_find_owner
+              (priv->paint_source, priv->highlight_author)))
+        {
+          guint max = owner->runs->len;
+
+          while (max > owner_run)
+            {
+              guint mid = (owner_run + max) / 2;
+
+              if (g_array_index (owner->runs, GitAnnotatedSourceRun,
+                                 mid).end <= line_start)
+                owner_run = mid + 1;
+              else
+                max = mid;
+            }
+        }
+
+      for (line_num = line_start; line_num < line_end; line_num++)
+        {
+          GdkRectangle clip_rect;
+          const GitAnnotatedSourceLine *line
+            = git_annotated_source_get_line (priv->paint_source, line_num);
+          const gchar *hash = git_commit_get_hash (line->commit);
+          GdkColor color;
+          gboolean painted = FALSE;
+          y = line_num * priv->line_height - priv->y_offset;
+
+          git_source_view_get_commit_color (sview, line->commit, &color);
+
+          cairo_set_source_rgb (cr, color.red / 65535.0, color.green / 65535.0,
+                                color.blue / 65535.0);
+          cairo_rectangle (cr, 0, y, priv->max_hash_length, priv->line_height);
+          cairo_fill_preserve (cr);
+
+          /* Invert the color so that the text is guaranteed to be a
+             different (albeit clashing) colour */
+          color.red = ~color.red;
+          color.green = ~color.green;
+          color.blue = ~color.blue;
+          cairo_set_source_rgb (cr, color.red / 65535.0, color.green / 65535.0,
+                                color.blue / 65535.0);
+          cairo_save (cr);
+          cairo_clip (cr);
+          if (!git_source_view_is_wip_hash (hash))
+            painted = git_glyph_cache_draw
+              (priv->glyph_cache, cr, 0, y, 0,
+               hash, MIN (strlen (hash), GIT_SOURCE_VIEW_COMMIT_HASH_LENGTH));
+          if (!painted)
+            {
+              git_source_view_set_text_for_commit (layout, line->commit);
+              cairo_move_to (cr, 0, y);
+              pango_cairo_show_layout (cr, layout);
+            }
+          cairo_restore (cr);
+
+          if (priv->gutter_width > 0)
+            git_source_view_draw_gutter (sview, cr, line, line_num, y);
+
+          clip_rect.x = priv->max_hash_length + priv->gutter_width
+            + GIT_SOURCE_VIEW_GAP;
+          clip_rect.width = widget->allocation.width;
+          clip_rect.y = y;
+          clip_rect.height = priv->line_height;
+
+          /* Highlight all of the lines of the hovered commit */
+          if (line->commit == priv->hover_commit)
+            {
+              gdk_cairo_set_source_color
+                (cr, &widget->style->bg[GTK_STATE_PRELIGHT]);
+              cairo_rectangle (cr, clip_rect.x, y,
+                               clip_rect.width, priv->line_height);
+              cairo_fill (cr);
+            }
+          else if (owner)
+            {
+              while (owner_run < owner->runs->len
+                     && g_array_index (owner->runs, GitAnnotatedSourceRun,
+                                       owner_run).end <= line_num)
+                owner_run++;
+
+              if (owner_run < owner->runs->len
+                  && g_array_index (owner->runs, GitAnnotatedSourceRun,
+                                    owner_run).start <= line_num)
+                {
+                  gdk_cairo_set_source_color
+                    (cr, &widget->style->bg[GTK_STATE_SELECTED]);
+                  cairo_rectangle (cr, clip_rect.x, y,
+                                   clip_rect.width, priv->line_height);
+                  cairo_fill (cr);
+                }
+            }
+
+          if (has_selection
+              && line_num >= sel_start_line && line_num <= sel_end_line)
+            {
+              gint sel_x1, sel_x2;
+
+              /* Lines in the middle of the selection are highlighted
+                 right up to the edge of the widget */
+              if (line_num == sel_start_line)
+                sel_x1 = git_source_view_byte_to_x (sview, layout, line_num,
+                                                    sel_start_byte);
+              else
+                sel_x1 = git_source_view_get_text_x (sview);
+              if (line_num == sel_end_line)
+                sel_x2 = git_source_view_byte_to_x (sview, layout, line_num,
+                                                    sel_end_byte);
+              else
+                sel_x2 = widget->allocation.width;
+              sel_x1 = MAX (sel_x1, clip_rect.x);
+
+              if (sel_x2 > sel_x1)
+                {
+                  gdk_cairo_set_source_color
+                    (cr, &widget->style->base[GTK_WIDGET_HAS_FOCUS (widget)
+                                              ? GTK_STATE_SELECTED
+                                              : GTK_STATE_ACTIVE]);
+                  cairo_rectangle (cr, sel_x1, y, sel_x2 - sel_x1,
+                                   priv->line_height);
+                  cairo_fill (cr);
+                }
+            }
+
+          if (line_num == priv->current_line && GTK_WIDGET_HAS_FOCUS (widget))
+            gtk_paint_focus (widget->style, widget->window,
+                             GTK_WIDGET_STATE (widget), &event->area,
+                             widget, "text",
+                             clip_rect.x, y,
+                             clip_rect.width, priv->line_height);
+
+          painted = FALSE;
+          if (git_source_view_use_glyph_cache (sview, line))
+            {
+              GitColumnMap *map
+                = git_annotated_source_get_column_map (priv->paint_source,
+                                                       line_num);
+              gint text_x = git_source_view_get_text_x (sview);
+              gint advance = git_glyph_cache_get_advance (priv->glyph_cache);
+              gint first_column, last_column;
+              gsize start, end;
+
+              /* Only paint the characters in the exposed columns.
+                 Glyphs may have ink outside of their cell so one
+                 extra column is included on each side */
+              first_column = (clip_rect.x - text_x) / advance - 1;
+              last_column = (clip_rect.x + clip_rect.width - text_x)
+                / advance + 1;
+              start = git_column_map_column_to_byte
+                (map, MAX (first_column, 0));
+              end = MIN (git_column_map_column_to_byte (map,
+                                                        last_column + 1),
+                         git_source_view_get_trimmed_length (line));
+
+              cairo_save (cr);
+              gdk_cairo_rectangle (cr, &clip_rect);
+              cairo_clip (cr);
+              painted = git_source_view_draw_glyphs (sview, cr, map, line,
+                                                     text_x, y, start, end);
+              cairo_restore (cr);
+            }
+          if (painted)
+            continue;
+
+          gtk_paint_layout (widget->style,
+                            widget->window,
+                            GTK_WIDGET_STATE (widget),
+                            TRUE,
+                            &clip_rect,
+                            widget,
                             NULL,
-                            -priv->x_offset + priv->max_hash_length
-                            + GIT_SOURCE_VIEW_GAP,
+                            git_source_view_get_text_x (sview),
                             y,
-                            layout);
+                            git_source_view_get_row_layout (sview,
+                                                            line_num));
         }
 
       cairo_destroy (cr);
       g_object_unref (layout);
+
+      if (git_alloc_get_phase () == GIT_ALLOC_PHASE_FIRST_PAINT)
+        git_alloc_set_phase (GIT_ALLOC_PHASE_STEADY);
     }
 
+  GIT_TRACE_END (expose, expose_time);
+
   return FALSE;
 }
 
+static void
+git_source_view_update_highlight_range (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+
+  if (priv->highlighter && priv->line_height > 0)
+    git_highlighter_set_visible_lines
+      (priv->highlighter,
+       priv->y_offset / priv->line_height,
+       (priv->y_offset + GTK_WIDGET (sview)->allocation.height)
+       / priv->line_height);
+}
+
 static void
 git_source_view_on_adj_changed (GtkAdjustment *adj, GitSourceView *sview)
 {
@@ -513,6 +1580,8 @@ git_source_view_on_adj_changed (GtkAdjustment *adj, GitSourceView *sview)
   if (priv->vadjustment)
     priv->y_offset = priv->vadjustment->value;
 
+  git_source_view_update_highlight_range (sview);
+
   if (GTK_WIDGET_REALIZED (GTK_WIDGET (sview)))
     gdk_window_invalidate_rect (GTK_WIDGET (sview)->window, NULL, FALSE);
 }
@@ -534,8 +1603,13 @@ git_source_view_on_adj_value_changed (GtkAdjustment *adj, GitSourceView *sview)
       gint new_offset = (gint) priv->vadjustment->value;
       dy = priv->y_offset - new_offset;
       priv->y_offset = new_offset;
+
+      if (dy)
+        git_recorder_record_scroll (-dy, new_offset);
     }
 
+  git_source_view_update_highlight_range (sview);
+
   if (GTK_WIDGET_REALIZED (GTK_WIDGET (sview)))
     {
       /* If dx has changed then we have to redraw the whole window
@@ -605,6 +1679,7 @@ git_source_view_size_allocate (GtkWidget *widget,
     ->size_allocate (widget, allocation);
 
   git_source_view_update_scroll_adjustments (GIT_SOURCE_VIEW (widget));
+  git_source_view_update_highlight_range (GIT_SOURCE_VIEW (widget));
 }
 
 static gboolean
@@ -634,7 +1709,7 @@ git_source_view_query_tooltip (GtkWidget *widget,
       || line_num < 0 || line_num >= num_lines)
     return FALSE;
 
-  line = git_annotated_source_get_line (priv->paint_source, line_num);
+  line = git_annotated_source_peek_line (priv->paint_source, line_num);
   commit = line->commit;
 
   markup = g_string_new ("");
@@ -759,123 +1834,1458 @@ git_source_view_set_state (GitSourceView *sview,
 }
 
 static void
-git_source_view_on_completed (GitAnnotatedSource *source,
-                              const GError *error,
-                              GitSourceView *sview)
+git_source_view_free_runs (gpointer runs)
 {
-  GitSourceViewPrivate *priv = sview->priv;
+  g_array_free (runs, TRUE);
+}
 
-  if (error)
-    git_source_view_set_state (sview, GIT_SOURCE_VIEW_ERROR, error);
-  else
+static void
+git_source_view_build_commit_runs (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  guint line_num, n_lines;
+  GitCommit *last_commit = NULL;
+  GitSourceViewRun run = { 0, 0 };
+
+  if (priv->commit_runs)
+    g_hash_table_destroy (priv->commit_runs);
+  priv->commit_runs = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                             NULL,
+                                             git_source_view_free_runs);
+  /* The commits belong to the old source */
+  priv->hover_commit = NULL;
+  if (priv->highlight_author)
     {
-      /* Forget the old painting source */
-      if (priv->paint_source)
-        g_object_unref (priv->paint_source);
-      /* Use the loading source to paint with */
-      priv->paint_source = g_object_ref (source);
+      g_free (priv->highlight_author);
+      priv->highlight_author = NULL;
+    }
 
-      /* Recalculate the line height */
-      priv->line_height = 0;
-      git_source_view_calculate_line_height (sview);
+  n_lines = git_annotated_source_get_n_lines (priv->paint_source);
 
-      gdk_window_invalidate_rect (GTK_WIDGET (sview)->window, NULL, FALSE);
-      git_source_view_update_scroll_adjustments (sview);
+  for (line_num = 0; line_num <= n_lines; line_num++)
+    {
+      GitCommit *commit
+        = (line_num < n_lines
+           ? git_annotated_source_peek_line (priv->paint_source,
+                                             line_num)->commit
+           : NULL);
 
-      git_source_view_set_state (sview, GIT_SOURCE_VIEW_READY, NULL);
+      if (commit != last_commit)
+        {
+          /* Close the run for the previous commit */
+          if (last_commit)
+            {
+              GArray *runs = g_hash_table_lookup (priv->commit_runs,
+                                                  last_commit);
+
+              if (runs == NULL)
+                {
+                  runs = g_array_new (FALSE, FALSE,
+                                      sizeof (GitSourceViewRun));
+                  g_hash_table_insert (priv->commit_runs, last_commit, runs);
+                }
+
+              run.end = line_num;
+              g_array_append_val (runs, run);
+            }
+
+          run.start = line_num;
+          last_commit = commit;
+        }
     }
-
-  git_source_view_unref_loading_source (sview);
 }
 
-void
-git_source_view_set_file (GitSourceView *sview,
-                          const gchar *filename,
-                          const gchar *revision)
+static void
+git_source_view_free_color (gpointer color)
 {
-  GitSourceViewPrivate *priv;
-  GError *error = NULL;
+  g_slice_free (GdkColor, color);
+}
 
-  g_return_if_fail (GIT_IS_SOURCE_VIEW (sview));
-  g_return_if_fail (filename != NULL);
+/* Gives each commit of the paint source a colour for its age on a
+   log scale between the newest and oldest commits in the file */
+static void
+git_source_view_build_age_colors (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  GitAnnotatedSourceAges ages;
+  guint owner_num, n_owners, i;
+  gdouble max_age;
 
-  priv = sview->priv;
+  if (priv->age_colors)
+    g_hash_table_destroy (priv->age_colors);
+  priv->age_colors = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                            NULL,
+                                            git_source_view_free_color);
 
-  /* If we're currently trying to load some source then cancel it */
-  git_source_view_unref_loading_source (sview);
+  git_annotated_source_get_ages (priv->paint_source, &ages);
+  max_age = log1p ((ages.newest_time - ages.oldest_time) / 86400.0);
 
-  priv->load_source = git_annotated_source_new ();
-  priv->loading_completed_handler
-    = g_signal_connect (priv->load_source, "completed",
-                        G_CALLBACK (git_source_view_on_completed), sview);
+  n_owners = git_annotated_source_get_n_owners (priv->paint_source);
 
-  if (!git_annotated_source_fetch (priv->load_source,
-                                   filename, revision,
-                                   &error))
+  for (owner_num = 0; owner_num < n_owners; owner_num++)
     {
-      git_source_view_set_state (sview, GIT_SOURCE_VIEW_ERROR, error);
-      git_source_view_unref_loading_source (sview);
+      const GitAnnotatedSourceOwner *owner
+        = git_annotated_source_get_owner (priv->paint_source, owner_num);
 
-      g_error_free (error);
+      for (i = 0; i < owner->commits->len; i++)
+        {
+          GitCommit *commit = g_array_index (owner->commits,
+                                             GitAnnotatedSourceShare,
+                                             i).commit;
+          gulong time = MIN (git_commit_get_author_time (commit),
+                             ages.newest_time);
+          GdkColor *color = g_slice_new (GdkColor);
+
+          git_age_to_color (max_age > 0.0
+                            ? log1p ((ages.newest_time - time) / 86400.0)
+                            / max_age
+                            : 0.0,
+                            color);
+          g_hash_table_insert (priv->age_colors, commit, color);
+        }
     }
-  else
-    git_source_view_set_state (sview, GIT_SOURCE_VIEW_LOADING, NULL);
 }
 
-GitSourceViewState
-git_source_view_get_state (GitSourceView *sview)
+static void
+git_source_view_get_commit_color (GitSourceView *sview, GitCommit *commit,
+                                  GdkColor *color)
 {
-  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), 0);
+  GitSourceViewPrivate *priv = sview->priv;
+  GdkColor *age_color;
 
-  return sview->priv->state;
+  if (priv->color_mode == GIT_SOURCE_VIEW_COLOR_AGE
+      && priv->age_colors
+      && (age_color = g_hash_table_lookup (priv->age_colors, commit)))
+    *color = *age_color;
+  else
+    git_commit_get_color (commit, color);
 }
 
-const GError *
-git_source_view_get_state_error (GitSourceView *sview)
+static void
+git_source_view_on_highlighted (GitHighlighter *highlighter,
+                                guint first_line,
+                                guint n_lines,
+                                GitSourceView *sview)
 {
-  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), 0);
+  GitSourceViewPrivate *priv = sview->priv;
+  GtkWidget *widget = GTK_WIDGET (sview);
+  GdkRectangle rect;
+  guint line_num;
+
+  /* Throw away any layouts that were made without the runs */
+  if (priv->row_cache)
+    for (line_num = first_line; line_num < first_line + n_lines; line_num++)
+      {
+        GitSourceViewRow *row
+          = priv->row_cache + line_num % GIT_SOURCE_VIEW_ROW_CACHE_SIZE;
+
+        if (row->line_num == (gint) line_num)
+          row->line_num = -1;
+      }
+
+  if (GTK_WIDGET_REALIZED (widget))
+    {
+      rect.x = 0;
+      rect.y = (gint) (first_line * priv->line_height) - priv->y_offset;
+      rect.width = widget->allocation.width;
+      rect.height = n_lines * priv->line_height;
 
-  return sview->priv->state_error;
+      gdk_window_invalidate_rect (widget->window, &rect, FALSE);
+    }
 }
 
-static gboolean
-git_source_view_motion_notify_event (GtkWidget *widget,
-                                     GdkEventMotion *event)
+static void
+git_source_view_start_highlighter (GitSourceView *sview)
 {
-  GitSourceView *sview = (GitSourceView *) widget;
   GitSourceViewPrivate *priv = sview->priv;
-  gboolean show_cursor = FALSE;
+  const GitHighlightLanguage *language;
+  GError *error = NULL;
 
-  /* Show the hand cursor when the pointer is over a commit hash */
-  if (priv->paint_source)
-    {
-      int n_lines = git_annotated_source_get_n_lines (priv->paint_source);
+  git_source_view_stop_highlighter (sview);
 
-      if (event->y < priv->y_offset + priv->line_height * n_lines
-          && event->x < priv->max_hash_length)
-        show_cursor = TRUE;
-    }
+  if (priv->load_filename == NULL
+      || (language = git_highlight_language_for_filename
+          (priv->load_filename)) == NULL)
+    return;
 
-  if (show_cursor)
-    {
-      if (!priv->hand_cursor_set)
-        {
-          /* Create the hand cursor if we haven't already got
-             one. This will be unref'd in the dispose handler */
-          if (priv->hand_cursor == NULL)
-            priv->hand_cursor
-              = gdk_cursor_new_for_display (gtk_widget_get_display (widget),
-                                            GDK_HAND2);
-          gdk_window_set_cursor (widget->window, priv->hand_cursor);
+  priv->highlighter = git_highlighter_new (priv->paint_source, language);
+  priv->highlighter_changed_handler
+    = g_signal_connect (priv->highlighter, "changed",
+                        G_CALLBACK (git_source_view_on_highlighted), sview);
+  git_source_view_update_highlight_range (sview);
 
-          priv->hand_cursor_set = TRUE;
-        }
-    }
-  else
+  if (!git_highlighter_start (priv->highlighter, &error))
     {
-      if (priv->hand_cursor_set)
-        {
-          gdk_window_set_cursor (widget->window, NULL);
+      g_warning ("%s", error->message);
+      g_error_free (error);
+      git_source_view_stop_highlighter (sview);
+    }
+}
+
+static void git_source_view_start_load (GitSourceView *sview,
+                                        guint preview_lines);
+
+static void
+git_source_view_paint_source (GitSourceView *sview,
+                              GitAnnotatedSource *source)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+
+  /* Forget the old painting source */
+  if (priv->paint_source)
+    g_object_unref (priv->paint_source);
+  priv->paint_source = g_object_ref (source);
+  /* The selection refers to lines in the old source */
+  priv->has_selection = FALSE;
+  priv->selecting = FALSE;
+  git_source_view_build_commit_runs (sview);
+  git_source_view_build_age_colors (sview);
+  git_source_view_clear_row_cache (sview);
+  priv->current_line = 0;
+
+  /* Recalculate the line height */
+  priv->line_height = 0;
+  git_source_view_calculate_line_height (sview);
+
+  git_source_view_start_highlighter (sview);
+
+  if (GTK_WIDGET_REALIZED (GTK_WIDGET (sview)))
+    gdk_window_invalidate_rect (GTK_WIDGET (sview)->window, NULL, FALSE);
+  git_source_view_update_scroll_adjustments (sview);
+}
+
+static void
+git_source_view_on_completed (GitAnnotatedSource *source,
+                              const GError *error,
+                              GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+
+  if (error)
+    git_source_view_set_state (sview, GIT_SOURCE_VIEW_ERROR, error);
+  else
+    {
+      /* Use the loading source to paint with */
+      git_source_view_paint_source (sview, source);
+
+      if (priv->load_is_preview && priv->load_full_after_preview)
+        {
+          /* Keep showing the visible lines while the rest of the
+             file is blamed */
+          git_source_view_start_load (sview, 0);
+          return;
+        }
+
+      if (!priv->load_is_preview && !priv->reverse)
+        git_blame_estimator_add_sample (priv->estimator,
+                                        g_timer_elapsed (priv->load_timer,
+                                                         NULL));
+
+      git_source_view_set_state (sview, GIT_SOURCE_VIEW_READY, NULL);
+    }
+
+  git_source_view_unref_loading_source (sview);
+}
+
+static void
+git_source_view_on_progress (GitAnnotatedSource *source,
+                             GitSourceView *sview)
+{
+  g_signal_emit (sview, client_signals[LOAD_PROGRESS], 0);
+}
+
+static guint
+git_source_view_get_n_visible_lines (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  guint line_height, n_lines, file_lines;
+
+  line_height = priv->line_height > 0
+    ? priv->line_height : GIT_SOURCE_VIEW_DEFAULT_LINE_HEIGHT;
+  n_lines = GTK_WIDGET (sview)->allocation.height / line_height + 1;
+
+  /* git-blame fails if the range goes past the end of the file */
+  file_lines = git_blame_estimator_get_min_lines (priv->estimator);
+  if (file_lines > 0 && n_lines > file_lines)
+    n_lines = file_lines;
+
+  return MAX (n_lines, 1);
+}
+
+static void
+git_source_view_start_load (GitSourceView *sview, guint preview_lines)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  GError *error = NULL;
+  gboolean ret;
+
+  git_source_view_unref_loading_source (sview);
+
+  priv->load_source = git_annotated_source_new ();
+  priv->loading_completed_handler
+    = g_signal_connect (priv->load_source, "completed",
+                        G_CALLBACK (git_source_view_on_completed), sview);
+  priv->loading_progress_handler
+    = g_signal_connect (priv->load_source, "progress",
+                        G_CALLBACK (git_source_view_on_progress), sview);
+  priv->load_is_preview = preview_lines > 0;
+
+  git_annotated_source_set_reverse (priv->load_source, priv->reverse);
+  git_annotated_source_set_encoding
+    (priv->load_source,
+     priv->reverse ? NULL
+     : git_blame_estimator_get_encoding (priv->estimator));
+
+  /* If preview_lines is not zero then only that many lines from the
+     start of the file are blamed */
+  if (preview_lines > 0)
+    ret = git_annotated_source_fetch_range
+      (priv->load_source, priv->load_filename, priv->load_revision,
+       1, preview_lines, &error);
+  else
+    {
+      g_timer_start (priv->load_timer);
+      ret = git_annotated_source_fetch (priv->load_source,
+                                        priv->load_filename,
+                                        priv->load_revision,
+                                        &error);
+      /* The estimator has already counted the lines in the file */
+      if (!priv->reverse)
+        git_annotated_source_set_expected_lines
+          (priv->load_source,
+           git_blame_estimator_get_n_lines (priv->estimator));
+    }
+
+  if (!ret)
+    {
+      git_source_view_set_state (sview, GIT_SOURCE_VIEW_ERROR, error);
+      git_source_view_unref_loading_source (sview);
+
+      g_error_free (error);
+    }
+  else
+    git_source_view_set_state (sview, GIT_SOURCE_VIEW_LOADING, NULL);
+}
+
+static void
+git_source_view_on_estimated (GitBlameEstimator *estimator,
+                              const GError *error,
+                              GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+
+  /* If the estimate failed then just try the blame anyway so that
+     it can report the real error */
+  if (error)
+    {
+      priv->load_estimate = -1.0;
+      git_source_view_start_load (sview, 0);
+      return;
+    }
+
+  priv->load_estimate = git_blame_estimator_get_estimate (estimator);
+
+  switch (git_blame_estimator_get_strategy (estimator))
+    {
+    case GIT_BLAME_STRATEGY_FULL:
+      git_source_view_start_load (sview, 0);
+      break;
+
+    case GIT_BLAME_STRATEGY_VIEWPORT_FIRST:
+      priv->load_full_after_preview = TRUE;
+      git_source_view_start_load
+        (sview, git_source_view_get_n_visible_lines (sview));
+      break;
+
+    case GIT_BLAME_STRATEGY_ASK:
+      git_source_view_set_state (sview, GIT_SOURCE_VIEW_CONFIRM, NULL);
+      break;
+    }
+}
+
+void
+git_source_view_set_file (GitSourceView *sview,
+                          const gchar *filename,
+                          const gchar *revision)
+{
+  GitSourceViewPrivate *priv;
+
+  g_return_if_fail (GIT_IS_SOURCE_VIEW (sview));
+  g_return_if_fail (filename != NULL);
+
+  priv = sview->priv;
+
+  /* If we're currently trying to load some source then cancel it */
+  git_source_view_unref_loading_source (sview);
+  git_blame_estimator_cancel (priv->estimator);
+
+  g_free (priv->load_filename);
+  priv->load_filename = g_strdup (filename);
+  g_free (priv->load_revision);
+  priv->load_revision = g_strdup (revision);
+
+  priv->load_estimate = -1.0;
+  priv->load_full_after_preview = FALSE;
+
+  /* If the estimate can't even be started then the blame would fail
+     the same way so let it report the error */
+  if (!priv->reverse
+      && git_blame_estimator_start (priv->estimator, filename, revision, NULL))
+    git_source_view_set_state (sview, GIT_SOURCE_VIEW_LOADING, NULL);
+  else
+    git_source_view_start_load (sview, 0);
+}
+
+/* Shows a source that has already been annotated without running
+   git-blame, such as one rebuilt from the history by a
+   GitTimeline. The filename is only used to pick the highlighting
+   language */
+void
+git_source_view_set_source (GitSourceView *sview,
+                            GitAnnotatedSource *source,
+                            const gchar *filename)
+{
+  GitSourceViewPrivate *priv;
+
+  g_return_if_fail (GIT_IS_SOURCE_VIEW (sview));
+  g_return_if_fail (GIT_IS_ANNOTATED_SOURCE (source));
+
+  priv = sview->priv;
+
+  git_source_view_unref_loading_source (sview);
+  git_blame_estimator_cancel (priv->estimator);
+
+  g_free (priv->load_filename);
+  priv->load_filename = g_strdup (filename);
+  g_free (priv->load_revision);
+  priv->load_revision = NULL;
+
+  git_source_view_paint_source (sview, source);
+
+  git_source_view_set_state (sview, GIT_SOURCE_VIEW_READY, NULL);
+}
+
+/* Continues loading a file after the view has gone into the confirm
+   state because the blame is expected to take a long time */
+void
+git_source_view_confirm_load (GitSourceView *sview,
+                              GitSourceViewLoadMode mode)
+{
+  GitSourceViewPrivate *priv;
+
+  g_return_if_fail (GIT_IS_SOURCE_VIEW (sview));
+
+  priv = sview->priv;
+
+  g_return_if_fail (priv->state == GIT_SOURCE_VIEW_CONFIRM);
+
+  switch (mode)
+    {
+    case GIT_SOURCE_VIEW_LOAD_FULL:
+      git_source_view_start_load (sview, 0);
+      break;
+
+    case GIT_SOURCE_VIEW_LOAD_VISIBLE:
+      priv->load_full_after_preview = FALSE;
+      git_source_view_start_load
+        (sview, git_source_view_get_n_visible_lines (sview));
+      break;
+
+    case GIT_SOURCE_VIEW_LOAD_HEADER:
+      priv->load_full_after_preview = FALSE;
+      git_source_view_start_load (sview,
+                                  git_source_view_get_header_lines (sview));
+      break;
+
+    case GIT_SOURCE_VIEW_LOAD_CANCEL:
+      {
+        GError *error = NULL;
+
+        g_set_error (&error, GIT_ERROR, GIT_ERROR_CANCELLED,
+                     "Blame cancelled");
+        git_source_view_set_state (sview, GIT_SOURCE_VIEW_ERROR, error);
+        g_error_free (error);
+      }
+      break;
+    }
+}
+
+/* Returns the number of lines that will be blamed with
+   GIT_SOURCE_VIEW_LOAD_HEADER */
+guint
+git_source_view_get_header_lines (GitSourceView *sview)
+{
+  guint n_lines;
+
+  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), 0);
+
+  /* The line count of a large file is only a guess so the range is
+     limited to the lines that have actually been counted */
+  n_lines = git_blame_estimator_get_min_lines (sview->priv->estimator);
+
+  return n_lines > 0 ? MIN (n_lines, GIT_SOURCE_VIEW_HEADER_LINES)
+    : GIT_SOURCE_VIEW_HEADER_LINES;
+}
+
+GitBlameEstimator *
+git_source_view_get_estimator (GitSourceView *sview)
+{
+  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), NULL);
+
+  return sview->priv->estimator;
+}
+
+/* Gets the progress of the blame that is currently running. Returns
+   FALSE if nothing is being loaded */
+gboolean
+git_source_view_get_load_progress (GitSourceView *sview,
+                                   GitAnnotatedSourceProgress *progress)
+{
+  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), FALSE);
+
+  if (sview->priv->load_source == NULL
+      || sview->priv->state != GIT_SOURCE_VIEW_LOADING)
+    return FALSE;
+
+  git_annotated_source_get_progress (sview->priv->load_source, progress);
+
+  return TRUE;
+}
+
+/* Returns the estimated number of seconds until the whole file has
+   been blamed or -1 if it isn't known */
+gdouble
+git_source_view_get_load_eta (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv;
+
+  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), -1.0);
+
+  priv = sview->priv;
+
+  if (priv->state != GIT_SOURCE_VIEW_LOADING || priv->load_estimate < 0.0
+      || priv->load_source == NULL)
+    return -1.0;
+  else if (priv->load_is_preview)
+    return priv->load_estimate;
+  else
+    return MAX (priv->load_estimate
+                - g_timer_elapsed (priv->load_timer, NULL), 0.0);
+}
+
+/* Returns the number of seconds by which the blame has gone over its
+   estimate or 0 if it hasn't. The ETA stops at 0 so this is needed
+   to tell an overdue blame apart from one that is nearly done */
+gdouble
+git_source_view_get_load_overrun (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv;
+
+  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), 0.0);
+
+  priv = sview->priv;
+
+  if (priv->state != GIT_SOURCE_VIEW_LOADING || priv->load_estimate < 0.0
+      || priv->load_source == NULL || priv->load_is_preview)
+    return 0.0;
+  else
+    return MAX (g_timer_elapsed (priv->load_timer, NULL)
+                - priv->load_estimate, 0.0);
+}
+
+GitSourceViewState
+git_source_view_get_state (GitSourceView *sview)
+{
+  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), 0);
+
+  return sview->priv->state;
+}
+
+const GError *
+git_source_view_get_state_error (GitSourceView *sview)
+{
+  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), 0);
+
+  return sview->priv->state_error;
+}
+
+GitAnnotatedSource *
+git_source_view_get_source (GitSourceView *sview)
+{
+  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), NULL);
+
+  return sview->priv->paint_source;
+}
+
+/* Gets the bytes of the line that are in the range. Returns FALSE if
+   the line isn't copied at all */
+static gboolean
+git_source_view_get_clipboard_line_range (GitSourceViewClipboardData *data,
+                                          gint line_num,
+                                          const GitAnnotatedSourceLine *line,
+                                          gsize *start, gsize *end)
+{
+  /* Don't annotate an empty last line when the selection ends at
+     the start of it */
+  if (line_num > data->start_line && line_num == data->end_line
+      && data->end_byte == 0)
+    return FALSE;
+
+  *end = line_num == data->end_line ? data->end_byte : line->text_length;
+  *end = MIN (*end, line->text_length);
+  *start = line_num == data->start_line ? data->start_byte : 0;
+  *start = MIN (*start, *end);
+
+  return TRUE;
+}
+
+/* The prefix is only formatted once for each commit and is then
+   shared by all of its lines */
+static const gchar *
+git_source_view_get_clipboard_prefix (GitSourceViewClipboardData *data,
+                                      GitCommit *commit)
+{
+  gchar *prefix;
+
+  if (data->prefixes == NULL)
+    data->prefixes = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                            NULL, g_free);
+
+  if ((prefix = g_hash_table_lookup (data->prefixes, commit)) == NULL)
+    {
+      const gchar *author = git_commit_get_prop (commit, "author");
+
+      prefix = g_strdup_printf ("%.*s %s\t",
+                                GIT_SOURCE_VIEW_COMMIT_HASH_LENGTH,
+                                git_commit_get_hash (commit),
+                                author ? author : "");
+      g_hash_table_insert (data->prefixes, commit, prefix);
+    }
+
+  return prefix;
+}
+
+/* Works out the size of the text without loading any of it */
+static gsize
+git_source_view_measure_clipboard (GitSourceViewClipboardData *data)
+{
+  gsize length = 0, start, end;
+  gint line_num;
+
+  for (line_num = data->start_line; line_num <= data->end_line; line_num++)
+    {
+      const GitAnnotatedSourceLine *line
+        = git_annotated_source_peek_line (data->source, line_num);
+
+      if (!git_source_view_get_clipboard_line_range (data, line_num, line,
+                                                     &start, &end))
+        break;
+
+      if (data->with_annotations)
+        length += strlen (git_source_view_get_clipboard_prefix (data,
+                                                                line->commit));
+      length += end - start;
+    }
+
+  return length;
+}
+
+/* Copies the text of up to max_lines more lines into the buffer.
+   The buffer is allocated with the measured size the first time so
+   that the text is copied straight into its final place. Returns
+   TRUE once the whole range has been copied */
+static gboolean
+git_source_view_gather_clipboard (GitSourceViewClipboardData *data,
+                                  gint max_lines)
+{
+  gsize start, end;
+
+  if (data->complete)
+    return TRUE;
+
+  if (data->text == NULL)
+    {
+      data->alloc_length = git_source_view_measure_clipboard (data);
+      data->text = g_malloc (data->alloc_length + 1);
+      data->length = 0;
+      data->next_line = data->start_line;
+    }
+
+  for (; max_lines > 0 && data->next_line <= data->end_line; max_lines--)
+    {
+      const GitAnnotatedSourceLine *line
+        = git_annotated_source_get_line (data->source, data->next_line);
+      gsize copy;
+
+      if (!git_source_view_get_clipboard_line_range (data, data->next_line,
+                                                     line, &start, &end))
+        {
+          data->next_line = data->end_line + 1;
+          break;
+        }
+
+      data->next_line++;
+
+      /* A corrupt cache block can make a line shorter than it
+         measured but never longer */
+      if (data->with_annotations)
+        {
+          const gchar *prefix
+            = git_source_view_get_clipboard_prefix (data, line->commit);
+
+          copy = MIN (strlen (prefix), data->alloc_length - data->length);
+          memcpy (data->text + data->length, prefix, copy);
+          data->length += copy;
+        }
+
+      copy = MIN (end - start, data->alloc_length - data->length);
+      memcpy (data->text + data->length, line->text + start, copy);
+      data->length += copy;
+    }
+
+  if (data->next_line <= data->end_line)
+    return FALSE;
+
+  data->text[data->length] = '\0';
+  data->complete = TRUE;
+
+  if (data->prefixes)
+    {
+      g_hash_table_destroy (data->prefixes);
+      data->prefixes = NULL;
+    }
+
+  return TRUE;
+}
+
+/* Gathers the whole text of the range at once. The text should be
+   freed with g_free */
+static gchar *
+git_source_view_get_clipboard_text (GitSourceViewClipboardData *data,
+                                    gsize *length)
+{
+  gchar *text;
+
+  git_source_view_gather_clipboard (data, G_MAXINT);
+
+  text = data->text;
+  if (length)
+    *length = data->length;
+
+  data->text = NULL;
+  data->complete = FALSE;
+
+  return text;
+}
+
+static void
+git_source_view_clipboard_get (GtkClipboard *clipboard,
+                               GtkSelectionData *selection_data,
+                               guint info,
+                               gpointer user_data)
+{
+  GitSourceViewClipboardData *data = user_data;
+  gchar *text;
+  gsize length;
+
+  /* A big selection has already been gathered and is kept for as
+     long as the clipboard is owned. GTK copies the data and splits
+     it up for the X server itself */
+  if (data->complete)
+    gtk_selection_data_set_text (selection_data, data->text, data->length);
+  else
+    {
+      text = git_source_view_get_clipboard_text (data, &length);
+      gtk_selection_data_set_text (selection_data, text, length);
+      g_free (text);
+    }
+}
+
+static void
+git_source_view_clipboard_clear (GtkClipboard *clipboard,
+                                 gpointer user_data)
+{
+  GitSourceViewClipboardData *data = user_data;
+
+  g_object_unref (data->source);
+  if (data->prefixes)
+    g_hash_table_destroy (data->prefixes);
+  g_free (data->text);
+
+  g_slice_free (GitSourceViewClipboardData, data);
+}
+
+static void
+git_source_view_set_clipboard_data (GitSourceView *sview,
+                                    GdkAtom selection,
+                                    GitSourceViewClipboardData *data)
+{
+  GtkTargetList *target_list;
+  GtkTargetEntry *targets;
+  gint n_targets;
+
+  target_list = gtk_target_list_new (NULL, 0);
+  gtk_target_list_add_text_targets (target_list, 0);
+  targets = gtk_target_table_new_from_list (target_list, &n_targets);
+  gtk_target_list_unref (target_list);
+
+  if (!gtk_clipboard_set_with_data (gtk_widget_get_clipboard (GTK_WIDGET (sview),
+                                                              selection),
+                                    targets, n_targets,
+                                    git_source_view_clipboard_get,
+                                    git_source_view_clipboard_clear,
+                                    data))
+    git_source_view_clipboard_clear (NULL, data);
+
+  gtk_target_table_free (targets, n_targets);
+}
+
+static void
+git_source_view_cancel_copy (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+
+  if (priv->copy_idle)
+    {
+      g_source_remove (priv->copy_idle);
+      priv->copy_idle = 0;
+    }
+
+  if (priv->copy_data)
+    {
+      git_source_view_clipboard_clear (NULL, priv->copy_data);
+      priv->copy_data = NULL;
+    }
+}
+
+static gboolean
+git_source_view_on_copy_idle (gpointer user_data)
+{
+  GitSourceView *sview = (GitSourceView *) user_data;
+  GitSourceViewPrivate *priv = sview->priv;
+  GitSourceViewClipboardData *data = priv->copy_data;
+
+  if (!git_source_view_gather_clipboard (data, GIT_SOURCE_VIEW_COPY_CHUNK))
+    return TRUE;
+
+  priv->copy_idle = 0;
+  priv->copy_data = NULL;
+
+  if (GTK_WIDGET_REALIZED (GTK_WIDGET (sview)))
+    git_source_view_set_clipboard_data (sview, GDK_SELECTION_CLIPBOARD,
+                                        data);
+  else
+    git_source_view_clipboard_clear (NULL, data);
+
+  return FALSE;
+}
+
+static void
+git_source_view_claim_selection (GitSourceView *sview,
+                                 GdkAtom selection,
+                                 gboolean with_annotations)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  GitSourceViewClipboardData *data;
+
+  if (!GTK_WIDGET_REALIZED (GTK_WIDGET (sview)))
+    return;
+
+  data = g_slice_new0 (GitSourceViewClipboardData);
+
+  if (!git_source_view_get_selection_bounds (sview,
+                                             &data->start_line,
+                                             &data->start_byte,
+                                             &data->end_line,
+                                             &data->end_byte))
+    {
+      g_slice_free (GitSourceViewClipboardData, data);
+      return;
+    }
+
+  data->source = g_object_ref (priv->paint_source);
+  data->with_annotations = with_annotations;
+
+  /* A small selection only stores the range here and the text isn't
+     gathered until another application asks for it */
+  if (git_source_view_measure_clipboard (data)
+      <= GIT_SOURCE_VIEW_MAX_SYNC_COPY)
+    git_source_view_set_clipboard_data (sview, selection, data);
+  /* Dragging over or selecting all of a big file shouldn't gather
+     all of the text just in case it gets pasted */
+  else if (selection != GDK_SELECTION_CLIPBOARD)
+    git_source_view_clipboard_clear (NULL, data);
+  /* Otherwise the text is gathered a few blocks at a time so that the
+     main loop keeps running and the clipboard is claimed once it is
+     ready */
+  else
+    {
+      git_source_view_cancel_copy (sview);
+      priv->copy_data = data;
+      priv->copy_idle = g_idle_add_full (G_PRIORITY_LOW,
+                                         git_source_view_on_copy_idle,
+                                         sview, NULL);
+    }
+}
+
+void
+git_source_view_copy_clipboard (GitSourceView *sview,
+                                gboolean with_annotations)
+{
+  g_return_if_fail (GIT_IS_SOURCE_VIEW (sview));
+
+  git_source_view_claim_selection (sview, GDK_SELECTION_CLIPBOARD,
+                                   with_annotations);
+}
+
+void
+git_source_view_select_all (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv;
+  const GitAnnotatedSourceLine *line;
+  gint n_lines;
+
+  g_return_if_fail (GIT_IS_SOURCE_VIEW (sview));
+
+  priv = sview->priv;
+
+  if (priv->paint_source == NULL
+      || (n_lines = git_annotated_source_get_n_lines (priv->paint_source)) < 1)
+    return;
+
+  line = git_annotated_source_get_line (priv->paint_source, n_lines - 1);
+  git_source_view_set_selection (sview, 0, 0, n_lines - 1,
+                                 line->text_length);
+
+  git_source_view_claim_selection (sview, GDK_SELECTION_PRIMARY, FALSE);
+}
+
+gboolean
+git_source_view_get_has_selection (GitSourceView *sview)
+{
+  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), FALSE);
+
+  return sview->priv->has_selection;
+}
+
+/* Gets the range of lines covered by the selection or the current
+   line if nothing is selected. The line numbers start from 1 and the
+   range is inclusive. A selection that ends at the start of a line
+   doesn't include that line. Returns FALSE if no file is shown */
+gboolean
+git_source_view_get_selected_lines (GitSourceView *sview,
+                                    guint *first_line,
+                                    guint *last_line)
+{
+  GitSourceViewPrivate *priv;
+  gint start_line, start_byte, end_line, end_byte;
+  gint n_lines;
+
+  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), FALSE);
+
+  priv = sview->priv;
+
+  if (priv->paint_source == NULL
+      || (n_lines = git_annotated_source_get_n_lines (priv->paint_source))
+      == 0)
+    return FALSE;
+
+  if (git_source_view_get_selection_bounds (sview,
+                                            &start_line, &start_byte,
+                                            &end_line, &end_byte))
+    {
+      if (end_byte == 0 && end_line > start_line)
+        end_line--;
+    }
+  else
+    start_line = end_line = priv->current_line;
+
+  start_line = CLAMP (start_line, 0, n_lines - 1);
+  end_line = CLAMP (end_line, start_line, n_lines - 1);
+
+  *first_line = start_line + 1;
+  *last_line = end_line + 1;
+
+  return TRUE;
+}
+
+/* Returns a copy of the selected text or NULL if nothing is
+   selected. The text should be freed with g_free */
+gchar *
+git_source_view_get_selected_text (GitSourceView *sview)
+{
+  GitSourceViewClipboardData data;
+
+  g_return_val_if_fail (GIT_IS_SOURCE_VIEW (sview), NULL);
+
+  memset (&data, 0, sizeof (data));
+
+  if (!git_source_view_get_selection_bounds (sview,
+                                             &data.start_line,
+                                             &data.start_byte,
+                                             &data.end_line,
+                                             &data.end_byte))
+    return NULL;
+
+  data.source = sview->priv->paint_source;
+
+  return git_source_view_get_clipboard_text (&data, NULL);
+}
+
+static gboolean
+git_source_view_focus_change_event (GtkWidget *widget,
+                                    GdkEventFocus *event)
+{
+  GitSourceView *sview = (GitSourceView *) widget;
+
+  /* The selection is drawn in a different colour and the current
+     line is only marked when the widget has focus */
+  if (sview->priv->paint_source)
+    gtk_widget_queue_draw (widget);
+
+  return FALSE;
+}
+
+/* Adds the rectangles of the visible lines of a commit to a
+   region */
+static void
+git_source_view_add_commit_to_region (GitSourceView *sview,
+                                      GitCommit *commit,
+                                      GdkRegion *region)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  GtkWidget *widget = GTK_WIDGET (sview);
+  GArray *runs;
+  guint first_line, last_line, min, max;
+
+  if (commit == NULL || priv->commit_runs == NULL || priv->line_height < 1
+      || (runs = g_hash_table_lookup (priv->commit_runs, commit)) == NULL)
+    return;
+
+  first_line = priv->y_offset / priv->line_height;
+  last_line = (priv->y_offset + widget->allocation.height
+               + priv->line_height - 1) / priv->line_height;
+
+  /* Binary search for the first run that ends after the first
+     visible line */
+  for (min = 0, max = runs->len; max > min;)
+    {
+      guint mid = (min + max) / 2;
+
+      if (g_array_index (runs, GitSourceViewRun, mid).end <= first_line)
+        min = mid + 1;
+      else
+        max = mid;
+    }
+
+  for (; min < runs->len; min++)
+    {
+      const GitSourceViewRun *run = &g_array_index (runs, GitSourceViewRun,
+                                                    min);
+      GdkRectangle rect;
+
+      if (run->start >= last_line)
+        break;
+
+      rect.x = 0;
+      rect.width = widget->allocation.width;
+      rect.y = (gint) (MAX (run->start, first_line) * priv->line_height)
+        - priv->y_offset;
+      rect.height = (MIN (run->end, last_line) - MAX (run->start, first_line))
+        * priv->line_height;
+
+      gdk_region_union_with_rect (region, &rect);
+    }
+}
+
+static void
+git_source_view_set_hover_commit (GitSourceView *sview, GitCommit *commit)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  GdkRegion *region;
+
+  if (commit == priv->hover_commit)
+    return;
+
+  /* Only the lines of the old and the new commit need repainting */
+  if (GTK_WIDGET_REALIZED (GTK_WIDGET (sview)))
+    {
+      region = gdk_region_new ();
+      git_source_view_add_commit_to_region (sview, priv->hover_commit,
+                                            region);
+      git_source_view_add_commit_to_region (sview, commit, region);
+      gdk_window_invalidate_region (GTK_WIDGET (sview)->window,
+                                    region, FALSE);
+      gdk_region_destroy (region);
+    }
+
+  priv->hover_commit = commit;
+}
+
+static gboolean
+git_source_view_leave_notify_event (GtkWidget *widget,
+                                    GdkEventCrossing *event)
+{
+  git_source_view_set_hover_commit (GIT_SOURCE_VIEW (widget), NULL);
+
+  return FALSE;
+}
+
+static gint
+git_source_view_get_page_lines (GitSourceView *sview)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+
+  if (priv->line_height < 1)
+    return 1;
+
+  return MAX (GTK_WIDGET (sview)->allocation.height
+              / (gint) priv->line_height, 1);
+}
+
+static gboolean
+git_source_view_on_prerender (gpointer data)
+{
+  GitSourceView *sview = (GitSourceView *) data;
+  GitSourceViewPrivate *priv = sview->priv;
+  gint n_lines, i;
+
+  n_lines = git_annotated_source_get_n_lines (priv->paint_source);
+
+  /* Prepare everything that painting a row would need so that it is
+     ready by the time the row is scrolled into view */
+  for (i = 0; i < GIT_SOURCE_VIEW_PRERENDER_CHUNK; i++)
+    {
+      const GitAnnotatedSourceLine *line;
+
+      if (priv->prerender_line == priv->prerender_end
+          || priv->prerender_line < 0
+          || priv->prerender_line >= n_lines)
+        {
+          priv->prerender_idle = 0;
+          return FALSE;
+        }
+
+      line = git_annotated_source_get_line (priv->paint_source,
+                                            priv->prerender_line);
+
+      if (git_source_view_use_glyph_cache (sview, line))
+        git_annotated_source_get_column_map (priv->paint_source,
+                                             priv->prerender_line);
+      else
+        /* Getting the extents makes Pango shape the text */
+        pango_layout_get_extents
+          (git_source_view_get_row_layout (sview, priv->prerender_line),
+           NULL, NULL);
+
+      priv->prerender_line += priv->prerender_direction;
+    }
+
+  return TRUE;
+}
+
+/* Starts preparing the rows beyond the edge of the window in the
+   direction that the current line is moving. The distance is based
+   on how fast the line has been moving so that holding down a key
+   never catches up with the prerendering */
+static void
+git_source_view_predict_scroll (GitSourceView *sview, gint direction,
+                                gint distance)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  gint page_lines = git_source_view_get_page_lines (sview);
+  gint first_line, ahead;
+  gdouble elapsed;
+
+  elapsed = g_timer_elapsed (priv->move_timer, NULL);
+  g_timer_start (priv->move_timer);
+
+  /* Smooth the speed so that a single quick key press doesn't cause
+     a huge prerender */
+  if (direction == priv->prerender_direction && elapsed > 0.0)
+    priv->move_speed = priv->move_speed * 0.5 + distance / elapsed * 0.5;
+  else
+    priv->move_speed = 0.0;
+
+  ahead = CLAMP ((gint) (priv->move_speed * GIT_SOURCE_VIEW_PRERENDER_TIME),
+                 page_lines, page_lines * 8);
+
+  first_line = priv->y_offset / MAX ((gint) priv->line_height, 1);
+  if (direction > 0)
+    priv->prerender_line = first_line + page_lines + 1;
+  else
+    priv->prerender_line = first_line - 1;
+  priv->prerender_end = priv->prerender_line + ahead * direction;
+  priv->prerender_direction = direction;
+
+  if (priv->prerender_idle == 0)
+    priv->prerender_idle = g_idle_add_full (G_PRIORITY_LOW,
+                                            git_source_view_on_prerender,
+                                            sview, NULL);
+}
+
+static void
+git_source_view_invalidate_line (GitSourceView *sview, gint line_num)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  GtkWidget *widget = GTK_WIDGET (sview);
+  GdkRectangle rect;
+
+  if (!GTK_WIDGET_REALIZED (widget))
+    return;
+
+  rect.x = 0;
+  rect.y = line_num * (gint) priv->line_height - priv->y_offset;
+  rect.width = widget->allocation.width;
+  rect.height = priv->line_height;
+
+  gdk_window_invalidate_rect (widget->window, &rect, FALSE);
+}
+
+static void
+git_source_view_set_current_line (GitSourceView *sview, gint line_num)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  gint n_lines = git_annotated_source_get_n_lines (priv->paint_source);
+  gint top;
+
+  line_num = CLAMP (line_num, 0, n_lines - 1);
+
+  if (line_num == priv->current_line)
+    return;
+
+  git_source_view_predict_scroll (sview,
+                                  line_num > priv->current_line ? 1 : -1,
+                                  ABS (line_num - priv->current_line));
+
+  git_source_view_invalidate_line (sview, priv->current_line);
+  priv->current_line = line_num;
+  git_source_view_invalidate_line (sview, priv->current_line);
+
+  /* Scroll just enough to make the line visible */
+  if (priv->vadjustment)
+    {
+      top = line_num * priv->line_height;
+
+      if (top < priv->vadjustment->value)
+        gtk_adjustment_set_value (priv->vadjustment, top);
+      else if (top + priv->line_height
+               > priv->vadjustment->value + priv->vadjustment->page_size)
+        gtk_adjustment_set_value (priv->vadjustment,
+                                  MIN (top + priv->line_height
+                                       - priv->vadjustment->page_size,
+                                       priv->vadjustment->upper
+                                       - priv->vadjustment->page_size));
+    }
+}
+
+static GitCommit *
+git_source_view_get_line_commit (GitSourceView *sview, gint line_num)
+{
+  return git_annotated_source_peek_line (sview->priv->paint_source,
+                                         line_num)->commit;
+}
+
+/* Finds the start of the next or previous group of lines annotated
+   by a different commit */
+static gint
+git_source_view_find_group (GitSourceView *sview, gint direction)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  gint n_lines = git_annotated_source_get_n_lines (priv->paint_source);
+  gint line_num = priv->current_line;
+  GitCommit *commit = git_source_view_get_line_commit (sview, line_num);
+
+  if (direction > 0)
+    {
+      while (line_num < n_lines - 1
+             && git_source_view_get_line_commit (sview, line_num) == commit)
+        line_num++;
+    }
+  else
+    {
+      /* Move to the start of the previous group if already at the
+         start of this one */
+      if (line_num > 0
+          && git_source_view_get_line_commit (sview, line_num - 1) != commit)
+        commit = git_source_view_get_line_commit (sview, --line_num);
+
+      while (line_num > 0
+             && git_source_view_get_line_commit (sview, line_num - 1)
+             == commit)
+        line_num--;
+    }
+
+  return line_num;
+}
+
+/* Finds the next or previous group of lines by a different commit
+   from the same author as the current line */
+static gint
+git_source_view_find_author_change (GitSourceView *sview, gint direction)
+{
+  GitSourceViewPrivate *priv = sview->priv;
+  gint n_lines = git_annotated_source_get_n_lines (priv->paint_source);
+  GitCommit *commit
+    = git_source_view_get_line_commit (sview, priv->current_line);
+  const gchar *author = git_commit_get_prop (commit, "author");
+  gint line_num;
+
+  for (line_num = priv->current_line + direction;
+       line_num >= 0 && line_num < n_lines;
+       line_num += direction)
+    {
+      GitCommit *other = git_source_view_get_line_commit (sview, line_num);
+
+      if (other != commit
+          && g_strcmp0 (git_commit_get_prop (other, "author"), author) == 0)
+        {
+          /* Go to the start of the group */
+          while (line_num > 0
+                 && git_source_view_get_line_commit (sview, line_num - 1)
+                 == other)
+            line_num--;
+
+          return line_num;
+        }
+    }
+
+  return priv->current_line;
+}
+
+static gboolean
+git_source_view_key_press_event (GtkWidget *widget,
+                                 GdkEventKey *event)
+{
+  GitSourceView *sview = (GitSourceView *) widget;
+  GitSourceViewPrivate *priv = sview->priv;
+  GdkModifierType mods = event->state & gtk_accelerator_get_default_mod_mask ();
+  gint line_num, page_lines;
+
+  if (priv->paint_source == NULL || priv->line_height < 1
+      || git_annotated_source_get_n_lines (priv->paint_source) < 1)
+    goto chain;
+
+  line_num = priv->current_line;
+  page_lines = git_source_view_get_page_lines (sview);
+
+  switch (event->keyval)
+    {
+    case GDK_Up:
+    case GDK_KP_Up:
+    case GDK_Down:
+    case GDK_KP_Down:
+      {
+        gint direction = (event->keyval == GDK_Up
+                          || event->keyval == GDK_KP_Up) ? -1 : 1;
+
+        if (mods == 0)
+          line_num += direction;
+        else if (mods == GDK_CONTROL_MASK)
+          line_num = git_source_view_find_group (sview, direction);
+        else if (mods == GDK_MOD1_MASK)
+          line_num = git_source_view_find_author_change (sview, direction);
+        else
+          goto chain;
+      }
+      break;
+
+    case GDK_Page_Up:
+    case GDK_KP_Page_Up:
+      line_num -= page_lines;
+      break;
+
+    case GDK_Page_Down:
+    case GDK_KP_Page_Down:
+      line_num += page_lines;
+      break;
+
+    case GDK_Home:
+    case GDK_KP_Home:
+      line_num = 0;
+      break;
+
+    case GDK_End:
+    case GDK_KP_End:
+      line_num = G_MAXINT;
+      break;
+
+    case GDK_Return:
+    case GDK_KP_Enter:
+      g_signal_emit (sview, client_signals[COMMIT_SELECTED], 0,
+                     git_source_view_get_line_commit (sview, line_num));
+      return TRUE;
+
+    default:
+      goto chain;
+    }
+
+  git_source_view_set_current_line (sview, line_num);
+
+  return TRUE;
+
+ chain:
+  return GTK_WIDGET_CLASS (git_source_view_parent_class)
+    ->key_press_event (widget, event);
+}
+
+static gboolean
+git_source_view_motion_notify_event (GtkWidget *widget,
+                                     GdkEventMotion *event)
+{
+  GitSourceView *sview = (GitSourceView *) widget;
+  GitSourceViewPrivate *priv = sview->priv;
+  gboolean show_cursor = FALSE;
+  GitCommit *hover_commit = NULL;
+
+  if (priv->selecting)
+    {
+      gint line_num, byte;
+
+      git_source_view_get_position_at (sview, event->x, event->y,
+                                       &line_num, &byte);
+      git_source_view_set_selection (sview,
+                                     priv->anchor_line, priv->anchor_byte,
+                                     line_num, byte);
+    }
+  /* Show the hand cursor when the pointer is over a commit hash */
+  else if (priv->paint_source && priv->line_height > 0)
+    {
+      int n_lines = git_annotated_source_get_n_lines (priv->paint_source);
+      int line_num = (event->y + priv->y_offset) / priv->line_height;
+
+      if (event->y >= 0 && line_num < n_lines
+          && event->x < priv->max_hash_length)
+        {
+          show_cursor = TRUE;
+          hover_commit
+            = git_annotated_source_peek_line (priv->paint_source,
+                                              line_num)->commit;
+        }
+    }
+
+  git_source_view_set_hover_commit (sview, hover_commit);
+
+  if (show_cursor)
+    {
+      if (!priv->hand_cursor_set)
+        {
+          /* Create the hand cursor if we haven't already got
+             one. This will be unref'd in the dispose handler */
+          if (priv->hand_cursor == NULL)
+            priv->hand_cursor
+              = gdk_cursor_new_for_display (gtk_widget_get_display (widget),
+                                            GDK_HAND2);
+          gdk_window_set_cursor (widget->window, priv->hand_cursor);
+
+          priv->hand_cursor_set = TRUE;
+        }
+    }
+  else
+    {
+      if (priv->hand_cursor_set)
+        {
+          gdk_window_set_cursor (widget->window, NULL);
           priv->hand_cursor_set = FALSE;
         }
     }
@@ -887,8 +3297,25 @@ static gboolean
 git_source_view_button_press_event (GtkWidget *widget,
                                     GdkEventButton *event)
 {
+  GitSourceView *sview = (GitSourceView *) widget;
+  GitSourceViewPrivate *priv = sview->priv;
+
   gtk_widget_grab_focus (widget);
 
+  /* Pressing the first button over the text starts a new selection */
+  if (event->button == 1 && event->type == GDK_BUTTON_PRESS
+      && priv->paint_source && priv->line_height > 0
+      && git_annotated_source_get_n_lines (priv->paint_source) > 0
+      && event->x >= priv->max_hash_length)
+    {
+      gint line_num, byte;
+
+      git_source_view_get_position_at (sview, event->x, event->y,
+                                       &line_num, &byte);
+      git_source_view_set_selection (sview, line_num, byte, line_num, byte);
+      priv->selecting = TRUE;
+    }
+
   return FALSE;
 }
 
@@ -899,7 +3326,14 @@ git_source_view_button_release_event (GtkWidget *widget,
   GitSourceView *sview = (GitSourceView *) widget;
   GitSourceViewPrivate *priv = sview->priv;
 
-  if (priv->paint_source && priv->line_height > 0)
+  if (priv->selecting && event->button == 1)
+    {
+      priv->selecting = FALSE;
+
+      /* Make the selected text available to middle-click pasting */
+      git_source_view_claim_selection (sview, GDK_SELECTION_PRIMARY, FALSE);
+    }
+  else if (priv->paint_source && priv->line_height > 0)
     {
       gint n_lines = git_annotated_source_get_n_lines (priv->paint_source);
       gint line_num = (event->y + priv->y_offset) / priv->line_height;
@@ -908,7 +3342,7 @@ git_source_view_button_release_event (GtkWidget *widget,
           && event->x < priv->max_hash_length)
         {
           const GitAnnotatedSourceLine *line
-            = git_annotated_source_get_line (priv->paint_source, line_num);
+            = git_annotated_source_peek_line (priv->paint_source, line_num);
 
           g_signal_emit (sview, client_signals[COMMIT_SELECTED],
                          0, line->commit);
@@ -917,3 +3351,96 @@ git_source_view_button_release_event (GtkWidget *widget,
 
   return FALSE;
 }
+
+void
+git_source_view_set_show_line_numbers (GitSourceView *sview,
+                                       gboolean show_line_numbers,
+                                       gboolean show_orig_line_numbers)
+{
+  GitSourceViewPrivate *priv;
+
+  g_return_if_fail (GIT_IS_SOURCE_VIEW (sview));
+
+  priv = sview->priv;
+
+  priv->show_line_numbers = show_line_numbers;
+  priv->show_orig_line_numbers = show_orig_line_numbers;
+
+  git_source_view_update_gutter_width (sview);
+}
+
+/* Scrolls so that y_offset pixels of the source are above the top of
+   the view. The offset is clamped to the scrollable range */
+void
+git_source_view_scroll_to (GitSourceView *sview, gint y_offset)
+{
+  GtkAdjustment *adj;
+
+  g_return_if_fail (GIT_IS_SOURCE_VIEW (sview));
+
+  if ((adj = sview->priv->vadjustment) == NULL)
+    return;
+
+  gtk_adjustment_set_value (adj, CLAMP (y_offset, adj->lower,
+                                        MAX (adj->lower,
+                                             adj->upper - adj->page_size)));
+}
+
+/* Highlights all of the lines last touched by an author and moves
+   to the first of them. Pass NULL to remove the highlight */
+void
+git_source_view_set_highlight_author (GitSourceView *sview,
+                                      const gchar *author)
+{
+  GitSourceViewPrivate *priv;
+  const GitAnnotatedSourceOwner *owner;
+
+  g_return_if_fail (GIT_IS_SOURCE_VIEW (sview));
+
+  priv = sview->priv;
+
+  if (g_strcmp0 (author, priv->highlight_author) == 0)
+    return;
+
+  g_free (priv->highlight_author);
+  priv->highlight_author = g_strdup (author);
+
+  if (GTK_WIDGET_REALIZED (GTK_WIDGET (sview)))
+    gdk_window_invalidate_rect (GTK_WIDGET (sview)->window, NULL, FALSE);
+
+  if (author && priv->paint_source
+      && (owner = git_annotated_source_find_owner (priv->paint_source,
+                                                   author))
+      && owner->runs->len > 0)
+    git_source_view_set_current_line
+      (sview, g_array_index (owner->runs, GitAnnotatedSourceRun, 0).start);
+}
+
+/* Sets whether the next file set with git_source_view_set_file is
+   blamed with --reverse. See git_annotated_source_set_reverse */
+void
+git_source_view_set_reverse (GitSourceView *sview, gboolean reverse)
+{
+  g_return_if_fail (GIT_IS_SOURCE_VIEW (sview));
+
+  sview->priv->reverse = reverse;
+}
+
+void
+git_source_view_set_color_mode (GitSourceView *sview,
+                                GitSourceViewColorMode color_mode)
+{
+  GitSourceViewPrivate *priv;
+
+  g_return_if_fail (GIT_IS_SOURCE_VIEW (sview));
+
+  priv = sview->priv;
+
+  if (priv->color_mode == color_mode)
+    return;
+
+  priv->color_mode = color_mode;
+
+  if (GTK_WIDGET_REALIZED (GTK_WIDGET (sview)))
+    gdk_window_invalidate_rect (GTK_WIDGET (sview)->window, NULL, FALSE);
+}
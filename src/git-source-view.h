@@ -21,6 +21,8 @@
 #include <gtk/gtkwidget.h>
 #include <gtk/gtkadjustment.h>
 #include "git-commit.h"
+#include "git-annotated-source.h"
+#include "git-blame-estimator.h"
 
 G_BEGIN_DECLS
 
@@ -58,6 +60,7 @@ struct _GitSourceViewClass
                                    GtkAdjustment *vadjustment);
   void (* commit_selected) (GitSourceView *source_view,
                             GitCommit *commit);
+  void (* load_progress) (GitSourceView *source_view);
 };
 
 struct _GitSourceView
@@ -70,9 +73,25 @@ struct _GitSourceView
 typedef enum {
   GIT_SOURCE_VIEW_READY,
   GIT_SOURCE_VIEW_LOADING,
-  GIT_SOURCE_VIEW_ERROR
+  GIT_SOURCE_VIEW_ERROR,
+  GIT_SOURCE_VIEW_CONFIRM
 } GitSourceViewState;
 
+typedef enum {
+  GIT_SOURCE_VIEW_LOAD_FULL,
+  GIT_SOURCE_VIEW_LOAD_VISIBLE,
+  GIT_SOURCE_VIEW_LOAD_HEADER,
+  GIT_SOURCE_VIEW_LOAD_CANCEL
+} GitSourceViewLoadMode;
+
+typedef enum {
+  /* Each commit has its own colour made from its hash */
+  GIT_SOURCE_VIEW_COLOR_COMMIT,
+  /* Commits are coloured by how old they are compared to the rest of
+     the file */
+  GIT_SOURCE_VIEW_COLOR_AGE
+} GitSourceViewColorMode;
+
 GType git_source_view_get_type (void) G_GNUC_CONST;
 
 GtkWidget *git_source_view_new (void);
@@ -81,8 +100,42 @@ void git_source_view_set_file (GitSourceView *sview,
                                const gchar *filename,
                                const gchar *revision);
 
+void git_source_view_set_source (GitSourceView *sview,
+                                 GitAnnotatedSource *source,
+                                 const gchar *filename);
+
 GitSourceViewState git_source_view_get_state (GitSourceView *sview);
 const GError *git_source_view_get_state_error (GitSourceView *sview);
+GitAnnotatedSource *git_source_view_get_source (GitSourceView *sview);
+
+void git_source_view_confirm_load (GitSourceView *sview,
+                                   GitSourceViewLoadMode mode);
+GitBlameEstimator *git_source_view_get_estimator (GitSourceView *sview);
+guint git_source_view_get_header_lines (GitSourceView *sview);
+gdouble git_source_view_get_load_eta (GitSourceView *sview);
+gdouble git_source_view_get_load_overrun (GitSourceView *sview);
+gboolean git_source_view_get_load_progress
+                                   (GitSourceView *sview,
+                                    GitAnnotatedSourceProgress *progress);
+
+void git_source_view_select_all (GitSourceView *sview);
+gboolean git_source_view_get_has_selection (GitSourceView *sview);
+gboolean git_source_view_get_selected_lines (GitSourceView *sview,
+                                             guint *first_line,
+                                             guint *last_line);
+gchar *git_source_view_get_selected_text (GitSourceView *sview);
+void git_source_view_copy_clipboard (GitSourceView *sview,
+                                     gboolean with_annotations);
+
+void git_source_view_set_show_line_numbers (GitSourceView *sview,
+                                            gboolean show_line_numbers,
+                                            gboolean show_orig_line_numbers);
+void git_source_view_scroll_to (GitSourceView *sview, gint y_offset);
+void git_source_view_set_highlight_author (GitSourceView *sview,
+                                           const gchar *author);
+void git_source_view_set_color_mode (GitSourceView *sview,
+                                     GitSourceViewColorMode color_mode);
+void git_source_view_set_reverse (GitSourceView *sview, gboolean reverse);
 
 G_END_DECLS
 
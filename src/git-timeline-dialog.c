@@ -0,0 +1,346 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtk/gtkdialog.h>
+#include <gtk/gtkvbox.h>
+#include <gtk/gtklabel.h>
+#include <gtk/gtkhscale.h>
+#include <gtk/gtkprogressbar.h>
+#include <gtk/gtkscrolledwindow.h>
+#include <gtk/gtkstock.h>
+
+#include "git-timeline-dialog.h"
+#include "git-timeline.h"
+#include "git-source-view.h"
+#include "git-common.h"
+#include "intl.h"
+
+static void git_timeline_dialog_dispose (GObject *object);
+static void git_timeline_dialog_finalize (GObject *object);
+
+static void git_timeline_dialog_on_value_changed (GtkRange *range,
+                                                  GitTimelineDialog *tdiag);
+
+G_DEFINE_TYPE (GitTimelineDialog, git_timeline_dialog, GTK_TYPE_DIALOG);
+
+#define GIT_TIMELINE_DIALOG_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_TIMELINE_DIALOG, \
+                                GitTimelineDialogPrivate))
+
+struct _GitTimelineDialogPrivate
+{
+  GitTimeline *timeline;
+  guint completed_handler, progress_handler;
+
+  gchar *filename;
+
+  GtkWidget *progress_bar, *scale, *label, *source_view;
+  guint value_changed_handler;
+};
+
+static void
+git_timeline_dialog_class_init (GitTimelineDialogClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->dispose = git_timeline_dialog_dispose;
+  gobject_class->finalize = git_timeline_dialog_finalize;
+
+  g_type_class_add_private (klass, sizeof (GitTimelineDialogPrivate));
+}
+
+static void
+git_timeline_dialog_init (GitTimelineDialog *self)
+{
+  GitTimelineDialogPrivate *priv;
+  GtkWidget *content, *scrolled_window;
+
+  priv = self->priv = GIT_TIMELINE_DIALOG_GET_PRIVATE (self);
+
+  gtk_window_set_title (GTK_WINDOW (self), _("Timeline"));
+  gtk_window_set_default_size (GTK_WINDOW (self), 560, 500);
+  gtk_dialog_set_has_separator (GTK_DIALOG (self), FALSE);
+  gtk_container_set_border_width (GTK_CONTAINER (self), 5);
+
+  content = gtk_vbox_new (FALSE, 6);
+  gtk_container_set_border_width (GTK_CONTAINER (content), 5);
+
+  priv->progress_bar = g_object_ref_sink (gtk_progress_bar_new ());
+  gtk_widget_show (priv->progress_bar);
+  gtk_box_pack_start (GTK_BOX (content), priv->progress_bar,
+                      FALSE, FALSE, 0);
+
+  /* The scale isn't shown until the history has been read */
+  priv->scale = g_object_ref_sink (gtk_hscale_new_with_range (0, 1, 1));
+  gtk_scale_set_digits (GTK_SCALE (priv->scale), 0);
+  gtk_scale_set_draw_value (GTK_SCALE (priv->scale), FALSE);
+  priv->value_changed_handler
+    = g_signal_connect (priv->scale, "value-changed",
+                        G_CALLBACK (git_timeline_dialog_on_value_changed),
+                        self);
+  gtk_box_pack_start (GTK_BOX (content), priv->scale, FALSE, FALSE, 0);
+
+  priv->label = g_object_ref_sink (gtk_label_new (NULL));
+  gtk_misc_set_alignment (GTK_MISC (priv->label), 0.0f, 0.5f);
+  gtk_label_set_ellipsize (GTK_LABEL (priv->label), PANGO_ELLIPSIZE_END);
+  gtk_widget_show (priv->label);
+  gtk_box_pack_start (GTK_BOX (content), priv->label, FALSE, FALSE, 0);
+
+  priv->source_view = g_object_ref_sink (git_source_view_new ());
+  gtk_widget_show (priv->source_view);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
+                                  GTK_POLICY_AUTOMATIC,
+                                  GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scrolled_window),
+                                       GTK_SHADOW_IN);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), priv->source_view);
+  gtk_widget_show (scrolled_window);
+  gtk_box_pack_start (GTK_BOX (content), scrolled_window, TRUE, TRUE, 0);
+
+  gtk_widget_show (content);
+  gtk_box_pack_start (GTK_BOX (GTK_DIALOG (self)->vbox), content,
+                      TRUE, TRUE, 0);
+
+  gtk_dialog_add_button (GTK_DIALOG (self), GTK_STOCK_CLOSE,
+                         GTK_RESPONSE_CLOSE);
+}
+
+static void
+git_timeline_dialog_dispose (GObject *object)
+{
+  GitTimelineDialog *self = (GitTimelineDialog *) object;
+  GitTimelineDialogPrivate *priv = self->priv;
+
+  if (priv->timeline)
+    {
+      g_signal_handler_disconnect (priv->timeline, priv->completed_handler);
+      g_signal_handler_disconnect (priv->timeline, priv->progress_handler);
+      g_object_unref (priv->timeline);
+      priv->timeline = NULL;
+    }
+
+  if (priv->scale)
+    {
+      g_signal_handler_disconnect (priv->scale,
+                                   priv->value_changed_handler);
+      g_object_unref (priv->scale);
+      priv->scale = NULL;
+    }
+
+  if (priv->progress_bar)
+    {
+      g_object_unref (priv->progress_bar);
+      priv->progress_bar = NULL;
+    }
+
+  if (priv->label)
+    {
+      g_object_unref (priv->label);
+      priv->label = NULL;
+    }
+
+  if (priv->source_view)
+    {
+      g_object_unref (priv->source_view);
+      priv->source_view = NULL;
+    }
+
+  G_OBJECT_CLASS (git_timeline_dialog_parent_class)->dispose (object);
+}
+
+static void
+git_timeline_dialog_finalize (GObject *object)
+{
+  GitTimelineDialog *self = (GitTimelineDialog *) object;
+
+  g_free (self->priv->filename);
+
+  G_OBJECT_CLASS (git_timeline_dialog_parent_class)->finalize (object);
+}
+
+GtkWidget *
+git_timeline_dialog_new (void)
+{
+  GtkWidget *self = g_object_new (GIT_TYPE_TIMELINE_DIALOG, NULL);
+
+  return self;
+}
+
+static void
+git_timeline_dialog_update_label (GitTimelineDialog *tdiag,
+                                  guint revision_num)
+{
+  GitTimelineDialogPrivate *priv = tdiag->priv;
+  GitCommit *commit = git_timeline_get_revision (priv->timeline,
+                                                 revision_num);
+  const gchar *author, *summary;
+  gchar *display_time = NULL, *text;
+  GTimeVal time_;
+
+  if ((time_.tv_sec = git_commit_get_author_time (commit)))
+    {
+      time_.tv_usec = 0;
+      display_time = git_format_time_for_display (&time_);
+    }
+
+  author = git_commit_get_prop (commit, "author");
+  summary = git_commit_get_prop (commit, "summary");
+
+  text = g_strdup_printf (_("%u of %u: %.8s %s, %s: %s"),
+                          revision_num + 1,
+                          git_timeline_get_n_revisions (priv->timeline),
+                          git_commit_get_hash (commit),
+                          author ? author : "",
+                          display_time ? display_time : "",
+                          summary ? summary : "");
+  gtk_label_set_text (GTK_LABEL (priv->label), text);
+
+  g_free (text);
+  g_free (display_time);
+}
+
+/* The sources are rebuilt from the timeline instead of being kept
+   for every revision so scrubbing only costs one pass over the
+   lines */
+static void
+git_timeline_dialog_on_value_changed (GtkRange *range,
+                                      GitTimelineDialog *tdiag)
+{
+  GitTimelineDialogPrivate *priv = tdiag->priv;
+  GitAnnotatedSource *source;
+  guint revision_num;
+
+  if (priv->timeline == NULL
+      || git_timeline_get_n_revisions (priv->timeline) == 0)
+    return;
+
+  revision_num = (guint) (gtk_range_get_value (range) + 0.5);
+  revision_num = MIN (revision_num,
+                      git_timeline_get_n_revisions (priv->timeline) - 1);
+
+  source = git_timeline_build_source (priv->timeline, revision_num);
+  git_source_view_set_source (GIT_SOURCE_VIEW (priv->source_view),
+                              source, priv->filename);
+  g_object_unref (source);
+
+  git_timeline_dialog_update_label (tdiag, revision_num);
+}
+
+static void
+git_timeline_dialog_on_progress (GitTimeline *timeline,
+                                 GitTimelineDialog *tdiag)
+{
+  GitTimelineDialogPrivate *priv = tdiag->priv;
+  gchar *text;
+
+  text = g_strdup_printf (_("Read %u revisions"),
+                          git_timeline_get_n_revisions (timeline));
+  gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar), text);
+  g_free (text);
+
+  gtk_progress_bar_pulse (GTK_PROGRESS_BAR (priv->progress_bar));
+}
+
+static void
+git_timeline_dialog_on_completed (GitTimeline *timeline,
+                                  const GError *error,
+                                  GitTimelineDialog *tdiag)
+{
+  GitTimelineDialogPrivate *priv = tdiag->priv;
+  guint n_revisions;
+
+  if (error)
+    {
+      gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 error->message);
+      return;
+    }
+
+  if ((n_revisions = git_timeline_get_n_revisions (timeline)) == 0)
+    {
+      gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 _("No revisions touch the file"));
+      return;
+    }
+
+  gtk_widget_hide (priv->progress_bar);
+
+  /* Start at the newest revision. GtkRange needs a non-empty range
+     so a single revision gets an insensitive scale */
+  gtk_range_set_range (GTK_RANGE (priv->scale), 0,
+                       MAX (n_revisions - 1, 1));
+  gtk_widget_set_sensitive (priv->scale, n_revisions > 1);
+  gtk_widget_show (priv->scale);
+
+  if (gtk_range_get_value (GTK_RANGE (priv->scale)) == n_revisions - 1)
+    git_timeline_dialog_on_value_changed (GTK_RANGE (priv->scale), tdiag);
+  else
+    gtk_range_set_value (GTK_RANGE (priv->scale), n_revisions - 1);
+}
+
+/* Starts reading the history of the file up to the given revision or
+   HEAD if revision is NULL. Any error is shown in the dialog */
+void
+git_timeline_dialog_start (GitTimelineDialog *tdiag,
+                           const gchar *filename,
+                           const gchar *revision)
+{
+  GitTimelineDialogPrivate *priv;
+  GError *error = NULL;
+  gchar *title, *basename;
+
+  g_return_if_fail (GIT_IS_TIMELINE_DIALOG (tdiag));
+  g_return_if_fail (filename != NULL);
+
+  priv = tdiag->priv;
+
+  g_return_if_fail (priv->timeline == NULL);
+
+  priv->filename = g_strdup (filename);
+
+  basename = g_path_get_basename (filename);
+  title = g_strdup_printf (_("Timeline of %s"), basename);
+  gtk_window_set_title (GTK_WINDOW (tdiag), title);
+  g_free (title);
+  g_free (basename);
+
+  priv->timeline = git_timeline_new ();
+  priv->completed_handler
+    = g_signal_connect (priv->timeline, "completed",
+                        G_CALLBACK (git_timeline_dialog_on_completed),
+                        tdiag);
+  priv->progress_handler
+    = g_signal_connect (priv->timeline, "progress",
+                        G_CALLBACK (git_timeline_dialog_on_progress),
+                        tdiag);
+
+  if (git_timeline_start (priv->timeline, filename, revision, &error))
+    gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                               _("Reading history"));
+  else
+    {
+      gtk_progress_bar_set_text (GTK_PROGRESS_BAR (priv->progress_bar),
+                                 error->message);
+      g_error_free (error);
+    }
+}
@@ -0,0 +1,600 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Works out the blame of a file at every revision that touched it.
+   Instead of running git-blame once per revision, the whole history
+   is read in a single git-log with zero-context diffs and each hunk
+   only re-attributes the lines it changes. Every line that ever
+   existed is kept once in a 'weave' in file order along with the
+   revision that added it and the one that removed it so that the
+   blame of any revision can be rebuilt just by picking the lines
+   that were alive at that point. Only the first-parent history is
+   followed so lines that came in through a merge are attributed to
+   the merge commit, and renames are not followed */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib-object.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "git-timeline.h"
+#include "git-annotated-source.h"
+#include "git-commit-bag.h"
+#include "git-reader.h"
+#include "git-common.h"
+
+static void git_timeline_dispose (GObject *object);
+static void git_timeline_finalize (GObject *object);
+
+static gboolean git_timeline_on_line (GitReader *reader,
+                                      guint length,
+                                      const gchar *str,
+                                      GitTimeline *timeline);
+static void git_timeline_on_completed (GitReader *reader,
+                                       const GError *error,
+                                       GitTimeline *timeline);
+
+G_DEFINE_TYPE (GitTimeline, git_timeline, G_TYPE_OBJECT);
+
+#define GIT_TIMELINE_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIT_TYPE_TIMELINE, \
+                                GitTimelinePrivate))
+
+/* Death of a line that is still in the file */
+#define GIT_TIMELINE_ALIVE G_MAXUINT
+
+typedef struct _GitTimelineLine GitTimelineLine;
+
+struct _GitTimelineLine
+{
+  /* Index of the revision that added the line and the one that
+     removed it */
+  guint birth, death;
+  /* Line number in the revision that added it */
+  guint orig_line;
+  guint text_length;
+  const gchar *text;
+};
+
+struct _GitTimelinePrivate
+{
+  GitReader *reader;
+  guint line_handler, completed_handler;
+
+  gchar *repo;
+
+  /* A GitCommit for each revision from oldest to newest */
+  GPtrArray *revisions;
+  /* Number of revisions whose diff has been applied */
+  guint n_revisions_done;
+
+  /* The weave of GitTimelineLines. While a revision's hunks are
+     being applied the lines are copied into next_lines which
+     replaces lines when the revision is finished */
+  GArray *lines, *next_lines;
+  GStringChunk *texts;
+
+  gboolean in_header, changing, finished;
+  /* Position of the next line to copy from lines and the number of
+     lines of the previous revision that have been copied */
+  guint copy_pos, old_line;
+  /* Lines left in the current hunk and the line number in the new
+     revision of the next added line */
+  guint old_remaining, new_remaining, new_line;
+};
+
+enum
+  {
+    COMPLETED,
+    PROGRESS,
+
+    LAST_SIGNAL
+  };
+
+static guint client_signals[LAST_SIGNAL];
+
+static void
+git_timeline_class_init (GitTimelineClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->dispose = git_timeline_dispose;
+  gobject_class->finalize = git_timeline_finalize;
+
+  client_signals[COMPLETED]
+    = g_signal_new ("completed",
+                    G_TYPE_FROM_CLASS (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitTimelineClass, completed),
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__POINTER,
+                    G_TYPE_NONE, 1,
+                    G_TYPE_POINTER);
+
+  client_signals[PROGRESS]
+    = g_signal_new ("progress",
+                    G_TYPE_FROM_CLASS (gobject_class),
+                    G_SIGNAL_RUN_LAST,
+                    G_STRUCT_OFFSET (GitTimelineClass, progress),
+                    NULL, NULL,
+                    g_cclosure_marshal_VOID__VOID,
+                    G_TYPE_NONE, 0);
+
+  g_type_class_add_private (klass, sizeof (GitTimelinePrivate));
+}
+
+static void
+git_timeline_init (GitTimeline *self)
+{
+  GitTimelinePrivate *priv;
+
+  priv = self->priv = GIT_TIMELINE_GET_PRIVATE (self);
+
+  priv->reader = git_reader_new ();
+  priv->line_handler
+    = g_signal_connect (priv->reader, "line",
+                        G_CALLBACK (git_timeline_on_line), self);
+  priv->completed_handler
+    = g_signal_connect (priv->reader, "completed",
+                        G_CALLBACK (git_timeline_on_completed), self);
+
+  priv->revisions = g_ptr_array_new ();
+  priv->lines = g_array_new (FALSE, FALSE, sizeof (GitTimelineLine));
+  priv->next_lines = g_array_new (FALSE, FALSE, sizeof (GitTimelineLine));
+  priv->texts = g_string_chunk_new (4096);
+}
+
+static void
+git_timeline_dispose (GObject *object)
+{
+  GitTimeline *self = (GitTimeline *) object;
+  GitTimelinePrivate *priv = self->priv;
+
+  if (priv->reader)
+    {
+      g_signal_handler_disconnect (priv->reader, priv->line_handler);
+      g_signal_handler_disconnect (priv->reader, priv->completed_handler);
+      g_object_unref (priv->reader);
+      priv->reader = NULL;
+    }
+
+  if (priv->revisions->len > 0)
+    {
+      g_ptr_array_foreach (priv->revisions, (GFunc) g_object_unref, NULL);
+      g_ptr_array_set_size (priv->revisions, 0);
+      priv->n_revisions_done = 0;
+    }
+
+  G_OBJECT_CLASS (git_timeline_parent_class)->dispose (object);
+}
+
+static void
+git_timeline_finalize (GObject *object)
+{
+  GitTimeline *self = (GitTimeline *) object;
+  GitTimelinePrivate *priv = self->priv;
+
+  g_ptr_array_free (priv->revisions, TRUE);
+  g_array_free (priv->lines, TRUE);
+  g_array_free (priv->next_lines, TRUE);
+  g_string_chunk_free (priv->texts);
+  g_free (priv->repo);
+
+  G_OBJECT_CLASS (git_timeline_parent_class)->finalize (object);
+}
+
+GitTimeline *
+git_timeline_new (void)
+{
+  GitTimeline *self = g_object_new (GIT_TYPE_TIMELINE, NULL);
+
+  return self;
+}
+
+/* Whether the line was in the file just before the revision that is
+   being applied */
+static inline gboolean
+git_timeline_line_is_old (const GitTimelineLine *line, guint revision_num)
+{
+  return line->birth < revision_num && line->death >= revision_num;
+}
+
+/* Copies lines to the new weave until n_lines lines of the previous
+   revision have been passed, marking them as removed if kill is
+   TRUE. Returns FALSE if there aren't enough lines */
+static gboolean
+git_timeline_copy_lines (GitTimeline *timeline, guint n_lines,
+                         gboolean kill)
+{
+  GitTimelinePrivate *priv = timeline->priv;
+  guint revision_num = priv->revisions->len - 1;
+
+  while (n_lines > 0)
+    {
+      GitTimelineLine line;
+
+      if (priv->copy_pos >= priv->lines->len)
+        return FALSE;
+
+      line = g_array_index (priv->lines, GitTimelineLine, priv->copy_pos++);
+
+      if (git_timeline_line_is_old (&line, revision_num))
+        {
+          if (kill)
+            line.death = revision_num;
+          priv->old_line++;
+          n_lines--;
+        }
+
+      g_array_append_val (priv->next_lines, line);
+    }
+
+  return TRUE;
+}
+
+static void
+git_timeline_end_revision (GitTimeline *timeline)
+{
+  GitTimelinePrivate *priv = timeline->priv;
+
+  if (priv->changing)
+    {
+      GArray *tmp;
+
+      g_array_append_vals (priv->next_lines,
+                           &g_array_index (priv->lines, GitTimelineLine,
+                                           priv->copy_pos),
+                           priv->lines->len - priv->copy_pos);
+
+      tmp = priv->lines;
+      priv->lines = priv->next_lines;
+      priv->next_lines = tmp;
+      g_array_set_size (priv->next_lines, 0);
+
+      priv->changing = FALSE;
+    }
+
+  priv->copy_pos = 0;
+  priv->old_line = 0;
+
+  if (priv->n_revisions_done < priv->revisions->len)
+    {
+      priv->n_revisions_done = priv->revisions->len;
+      g_signal_emit (timeline, client_signals[PROGRESS], 0);
+    }
+}
+
+static void
+git_timeline_finish (GitTimeline *timeline, const GError *error)
+{
+  GitTimelinePrivate *priv = timeline->priv;
+
+  if (priv->finished)
+    return;
+
+  priv->finished = TRUE;
+
+  g_signal_emit (timeline, client_signals[COMPLETED], 0, error);
+}
+
+static void
+git_timeline_parse_error (GitTimeline *timeline)
+{
+  GError *error = NULL;
+
+  g_set_error (&error, GIT_ERROR, GIT_ERROR_PARSE_ERROR,
+               "Invalid data from git-log received");
+
+  git_timeline_finish (timeline, error);
+
+  g_error_free (error);
+}
+
+/* Parses a hunk header like "@@ -a,b +c,d @@" into the four
+   numbers. The counts are 1 if they are missing */
+static gboolean
+git_timeline_parse_hunk_header (const gchar *str, guint nums[4])
+{
+  const gchar *p = str + 3;
+  gchar *end;
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      if (*p != (i == 0 ? '-' : '+') || !g_ascii_isdigit (p[1]))
+        return FALSE;
+
+      nums[i * 2] = strtoul (p + 1, &end, 10);
+
+      if (*end == ',')
+        {
+          p = end + 1;
+          nums[i * 2 + 1] = strtoul (p, &end, 10);
+          if (end == p)
+            return FALSE;
+        }
+      else
+        nums[i * 2 + 1] = 1;
+
+      if (*end != ' ')
+        return FALSE;
+      p = end + 1;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+git_timeline_start_hunk (GitTimeline *timeline, const gchar *str)
+{
+  GitTimelinePrivate *priv = timeline->priv;
+  guint nums[4], target;
+
+  if (!git_timeline_parse_hunk_header (str, nums))
+    return FALSE;
+
+  priv->changing = TRUE;
+
+  /* If lines are removed then the hunk starts at the first removed
+     line, otherwise the lines are added after the given line */
+  target = nums[1] > 0 ? nums[0] - 1 : nums[0];
+  if (target < priv->old_line
+      || !git_timeline_copy_lines (timeline, target - priv->old_line, FALSE)
+      || !git_timeline_copy_lines (timeline, nums[1], TRUE))
+    return FALSE;
+
+  /* The removed lines have already been marked so the '-' lines only
+     need to be counted */
+  priv->old_remaining = nums[1];
+  priv->new_remaining = nums[3];
+  priv->new_line = nums[2];
+
+  return TRUE;
+}
+
+/* The output of git-log has a header with a "key value" line for
+   each of the properties in the format passed in git_timeline_start
+   followed by a zero-context diff */
+static gboolean
+git_timeline_on_line (GitReader *reader,
+                      guint length, const gchar *str,
+                      GitTimeline *timeline)
+{
+  GitTimelinePrivate *priv = timeline->priv;
+
+  if (priv->old_remaining > 0 || priv->new_remaining > 0)
+    {
+      if (*str == '-' && priv->old_remaining > 0)
+        priv->old_remaining--;
+      else if (*str == '+' && priv->new_remaining > 0)
+        {
+          GitTimelineLine line;
+
+          line.birth = priv->revisions->len - 1;
+          line.death = GIT_TIMELINE_ALIVE;
+          line.orig_line = priv->new_line++;
+          line.text_length = length - 1;
+          line.text = g_string_chunk_insert_len (priv->texts, str + 1,
+                                                 length - 1);
+          g_array_append_val (priv->next_lines, line);
+
+          priv->new_remaining--;
+        }
+      /* Skip "\ No newline at end of file" */
+      else if (*str != '\\')
+        {
+          git_timeline_parse_error (timeline);
+          return FALSE;
+        }
+    }
+  else if (length == strlen ("commit ") + GIT_COMMIT_HASH_LENGTH + 1
+           && !strncmp (str, "commit ", strlen ("commit ")))
+    {
+      GitCommitBag *commit_bag = git_commit_bag_get_default ();
+      gchar *hash = g_strndup (str + strlen ("commit "),
+                               GIT_COMMIT_HASH_LENGTH);
+
+      git_timeline_end_revision (timeline);
+
+      g_ptr_array_add (priv->revisions,
+                       g_object_ref (git_commit_bag_get (commit_bag, hash,
+                                                         priv->repo)));
+      g_free (hash);
+
+      priv->in_header = TRUE;
+    }
+  else if (priv->revisions->len == 0)
+    {
+      git_timeline_parse_error (timeline);
+      return FALSE;
+    }
+  else if (priv->in_header)
+    {
+      const gchar *sep;
+
+      if (!strncmp (str, "diff ", strlen ("diff ")))
+        priv->in_header = FALSE;
+      else
+        {
+          GitCommit *commit = g_ptr_array_index (priv->revisions,
+                                                 priv->revisions->len - 1);
+
+          if (length > 0 && str[length - 1] == '\n')
+            length--;
+
+          if ((sep = memchr (str, ' ', length)))
+            {
+              gchar *key = g_strndup (str, sep - str);
+
+              /* Don't replace properties that a blame has already
+                 filled in */
+              if (git_commit_get_prop (commit, key) == NULL)
+                {
+                  gchar *value = g_strndup (sep + 1, str + length - sep - 1);
+                  git_commit_set_prop (commit, key, value);
+                  g_free (value);
+                }
+
+              g_free (key);
+            }
+        }
+    }
+  else if (!strncmp (str, "@@ ", strlen ("@@ ")))
+    {
+      if (!git_timeline_start_hunk (timeline, str))
+        {
+          git_timeline_parse_error (timeline);
+          return FALSE;
+        }
+    }
+  /* Anything else is part of the diff header */
+
+  return TRUE;
+}
+
+static void
+git_timeline_on_completed (GitReader *reader,
+                           const GError *error,
+                           GitTimeline *timeline)
+{
+  GitTimelinePrivate *priv = timeline->priv;
+
+  if (error == NULL
+      && (priv->old_remaining > 0 || priv->new_remaining > 0))
+    git_timeline_parse_error (timeline);
+  else
+    {
+      git_timeline_end_revision (timeline);
+      git_timeline_finish (timeline, error);
+    }
+}
+
+/* Starts reading the history of the file up to the given revision or
+   HEAD if revision is NULL. This can only be called once */
+gboolean
+git_timeline_start (GitTimeline *timeline,
+                    const gchar *filename,
+                    const gchar *revision,
+                    GError **error)
+{
+  GitTimelinePrivate *priv;
+  gchar *relative;
+  gboolean ret;
+
+  g_return_val_if_fail (GIT_IS_TIMELINE (timeline), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_val_if_fail (filename != NULL, FALSE);
+
+  priv = timeline->priv;
+
+  g_return_val_if_fail (priv->repo == NULL, FALSE);
+
+  if (!git_find_repo (filename, &priv->repo, &relative))
+    {
+      g_set_error (error, GIT_ERROR, GIT_ERROR_NO_REPO,
+                   "No repo found for %s", filename);
+      return FALSE;
+    }
+
+  ret = git_reader_start (priv->reader, priv->repo, error,
+                          "log", "--first-parent", "-m", "--reverse",
+                          "-p", "-U0", "--no-color", "--no-ext-diff",
+                          "--format=commit %H%n"
+                          "author %an%n"
+                          "author-mail <%ae>%n"
+                          "author-time %at%n"
+                          "summary %s",
+                          revision ? revision : "HEAD",
+                          "--", relative, NULL);
+
+  g_free (relative);
+
+  return ret;
+}
+
+/* Returns the number of revisions that have been read so far */
+guint
+git_timeline_get_n_revisions (GitTimeline *timeline)
+{
+  g_return_val_if_fail (GIT_IS_TIMELINE (timeline), 0);
+
+  return timeline->priv->n_revisions_done;
+}
+
+GitCommit *
+git_timeline_get_revision (GitTimeline *timeline, guint revision_num)
+{
+  GitTimelinePrivate *priv;
+
+  g_return_val_if_fail (GIT_IS_TIMELINE (timeline), NULL);
+
+  priv = timeline->priv;
+
+  g_return_val_if_fail (revision_num < priv->n_revisions_done, NULL);
+
+  return g_ptr_array_index (priv->revisions, revision_num);
+}
+
+/* Builds the blame of the file as it was after the given revision
+   from the lines that were alive at that point. The returned source
+   should be unref'd when no longer needed */
+GitAnnotatedSource *
+git_timeline_build_source (GitTimeline *timeline, guint revision_num)
+{
+  GitTimelinePrivate *priv;
+  GitAnnotatedSource *source;
+  GArray *lines;
+  guint i;
+
+  g_return_val_if_fail (GIT_IS_TIMELINE (timeline), NULL);
+
+  priv = timeline->priv;
+
+  g_return_val_if_fail (revision_num < priv->n_revisions_done, NULL);
+
+  lines = g_array_new (FALSE, TRUE, sizeof (GitAnnotatedSourceLine));
+
+  for (i = 0; i < priv->lines->len; i++)
+    {
+      const GitTimelineLine *tline
+        = &g_array_index (priv->lines, GitTimelineLine, i);
+
+      if (tline->birth <= revision_num && tline->death > revision_num)
+        {
+          GitAnnotatedSourceLine line;
+
+          memset (&line, 0, sizeof (line));
+          line.commit = g_ptr_array_index (priv->revisions, tline->birth);
+          line.orig_line = tline->orig_line;
+          line.text_length = tline->text_length;
+          line.text = (gchar *) tline->text;
+          g_array_append_val (lines, line);
+        }
+    }
+
+  source = git_annotated_source_new ();
+  git_annotated_source_load_lines (source, priv->repo,
+                                   (GitAnnotatedSourceLine *) lines->data,
+                                   lines->len);
+
+  g_array_free (lines, TRUE);
+
+  return source;
+}
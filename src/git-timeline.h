@@ -0,0 +1,84 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_TIMELINE_H__
+#define __GIT_TIMELINE_H__
+
+#include <glib-object.h>
+#include "git-commit.h"
+#include "git-annotated-source.h"
+
+G_BEGIN_DECLS
+
+#define GIT_TYPE_TIMELINE                                               \
+  (git_timeline_get_type())
+#define GIT_TIMELINE(obj)                                               \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                   \
+                               GIT_TYPE_TIMELINE,                       \
+                               GitTimeline))
+#define GIT_TIMELINE_CLASS(klass)                                       \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            GIT_TYPE_TIMELINE,                          \
+                            GitTimelineClass))
+#define GIT_IS_TIMELINE(obj)                                            \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),                                   \
+                               GIT_TYPE_TIMELINE))
+#define GIT_IS_TIMELINE_CLASS(klass)                                    \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),                                    \
+                            GIT_TYPE_TIMELINE))
+#define GIT_TIMELINE_GET_CLASS(obj)                                     \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                    \
+                              GIT_TYPE_TIMELINE,                        \
+                              GitTimelineClass))
+
+typedef struct _GitTimeline        GitTimeline;
+typedef struct _GitTimelineClass   GitTimelineClass;
+typedef struct _GitTimelinePrivate GitTimelinePrivate;
+
+struct _GitTimelineClass
+{
+  GObjectClass parent_class;
+
+  void (* completed) (GitTimeline *timeline, const GError *error);
+  void (* progress) (GitTimeline *timeline);
+};
+
+struct _GitTimeline
+{
+  GObject parent;
+
+  GitTimelinePrivate *priv;
+};
+
+GType git_timeline_get_type (void) G_GNUC_CONST;
+
+GitTimeline *git_timeline_new (void);
+
+gboolean git_timeline_start (GitTimeline *timeline,
+                             const gchar *filename,
+                             const gchar *revision,
+                             GError **error);
+
+guint git_timeline_get_n_revisions (GitTimeline *timeline);
+GitCommit *git_timeline_get_revision (GitTimeline *timeline,
+                                      guint revision_num);
+GitAnnotatedSource *git_timeline_build_source (GitTimeline *timeline,
+                                               guint revision_num);
+
+G_END_DECLS
+
+#endif /* __GIT_TIMELINE_H__ */
@@ -0,0 +1,94 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_TRACE_H__
+#define __GIT_TRACE_H__
+
+/* Static trace points for profiling. Each point is a USDT probe in
+   the blame_browse provider when sys/sdt.h is available so that it
+   can be used with perf, bpftrace or systemtap. Probes named
+   foo__begin and foo__end show up as foo-begin and foo-end. When
+   built with --enable-sysprof each begin/end pair is also recorded as
+   a mark in the sysprof capture. Everything compiles to nothing when
+   neither is available. */
+
+#include <glib.h>
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#endif
+
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+G_BEGIN_DECLS
+
+typedef gint64 GitTraceTime;
+
+#ifdef HAVE_SYS_SDT_H
+
+#define GIT_TRACE(probe) \
+  DTRACE_PROBE (blame_browse, probe)
+#define GIT_TRACE1(probe, a) \
+  DTRACE_PROBE1 (blame_browse, probe, a)
+#define GIT_TRACE2(probe, a, b) \
+  DTRACE_PROBE2 (blame_browse, probe, a, b)
+
+#else /* HAVE_SYS_SDT_H */
+
+#define GIT_TRACE(probe) G_STMT_START { } G_STMT_END
+#define GIT_TRACE1(probe, a) G_STMT_START { } G_STMT_END
+#define GIT_TRACE2(probe, a, b) G_STMT_START { } G_STMT_END
+
+#endif /* HAVE_SYS_SDT_H */
+
+#ifdef HAVE_SYSPROF
+
+#define GIT_TRACE_NOW() SYSPROF_CAPTURE_CURRENT_TIME
+#define GIT_TRACE_MARK(begin, name, message)                    \
+  sysprof_collector_mark ((begin),                              \
+                          SYSPROF_CAPTURE_CURRENT_TIME - (begin), \
+                          "blame-browse", (name), (message))
+
+#else /* HAVE_SYSPROF */
+
+#define GIT_TRACE_NOW() ((GitTraceTime) 0)
+#define GIT_TRACE_MARK(begin, name, message) \
+  G_STMT_START { (void) (begin); } G_STMT_END
+
+#endif /* HAVE_SYSPROF */
+
+/* Fires the probe##__begin probe and stores the time in the
+   GitTraceTime lvalue begin */
+#define GIT_TRACE_BEGIN(probe, begin)           \
+  G_STMT_START {                                \
+    GIT_TRACE (probe##__begin);                 \
+    (begin) = GIT_TRACE_NOW ();                 \
+  } G_STMT_END
+
+/* Fires the probe##__end probe and adds a sysprof mark covering the
+   time since the matching GIT_TRACE_BEGIN */
+#define GIT_TRACE_END(probe, begin)             \
+  G_STMT_START {                                \
+    GIT_TRACE (probe##__end);                   \
+    GIT_TRACE_MARK ((begin), #probe, NULL);     \
+  } G_STMT_END
+
+G_END_DECLS
+
+#endif /* __GIT_TRACE_H__ */
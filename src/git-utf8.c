@@ -0,0 +1,123 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <string.h>
+
+#include "git-utf8.h"
+
+/* Mask with the top bit of every byte in a word set */
+#define GIT_UTF8_HIGH_BITS ((gulong) 0x8080808080808080ULL)
+
+/* Checks whether a string is all ASCII. This looks at a whole word at
+   a time so that the common case of plain source code is fast */
+gboolean
+git_utf8_is_ascii (const gchar *str, gsize length)
+{
+  const guchar *p = (const guchar *) str, *end = p + length;
+  gulong word;
+
+  /* Check bytes until the pointer is aligned */
+  while (p < end && ((gsize) p & (sizeof (gulong) - 1)))
+    if (*(p++) & 0x80)
+      return FALSE;
+
+  for (; p + sizeof (gulong) <= end; p += sizeof (gulong))
+    {
+      memcpy (&word, p, sizeof (gulong));
+
+      if ((word & GIT_UTF8_HIGH_BITS))
+        return FALSE;
+    }
+
+  while (p < end)
+    if (*(p++) & 0x80)
+      return FALSE;
+
+  return TRUE;
+}
+
+/* Validates a string that may contain embedded zeroes. is_ascii is
+   set to whether the string only contains ASCII characters. Pure
+   ASCII strings are always valid so the full validator is only run
+   on strings that have at least one high byte */
+gboolean
+git_utf8_validate (const gchar *str, gsize length, gboolean *is_ascii)
+{
+  if (git_utf8_is_ascii (str, length))
+    {
+      if (is_ascii)
+        *is_ascii = TRUE;
+      return TRUE;
+    }
+
+  if (is_ascii)
+    *is_ascii = FALSE;
+
+  return g_utf8_validate (str, length, NULL);
+}
+
+/* Converts a string to UTF-8. If charset is NULL or the conversion
+   fails then the locale's charset is tried and then finally
+   ISO-8859-1 which can represent any sequence of bytes. The returned
+   string is always valid UTF-8 and is nul-terminated */
+gchar *
+git_utf8_convert (const gchar *str, gsize length,
+                  const gchar *charset, gsize *length_out)
+{
+  const gchar *locale_charset;
+  gsize bytes_written;
+  gchar *ret;
+
+  if (charset
+      && (ret = g_convert (str, length, "UTF-8", charset,
+                           NULL, &bytes_written, NULL)))
+    {
+      if (length_out)
+        *length_out = bytes_written;
+      return ret;
+    }
+
+  if (!g_get_charset (&locale_charset)
+      && (ret = g_convert (str, length, "UTF-8", locale_charset,
+                           NULL, &bytes_written, NULL)))
+    {
+      if (length_out)
+        *length_out = bytes_written;
+      return ret;
+    }
+
+  ret = g_convert (str, length, "UTF-8", "ISO-8859-1",
+                   NULL, &bytes_written, NULL);
+
+  /* This shouldn't fail but just in case use a placeholder rather
+     than passing invalid data to Pango */
+  if (ret == NULL)
+    {
+      ret = g_strdup ("?");
+      bytes_written = 1;
+    }
+
+  if (length_out)
+    *length_out = bytes_written;
+
+  return ret;
+}
@@ -0,0 +1,34 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_UTF8_H__
+#define __GIT_UTF8_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gboolean git_utf8_is_ascii (const gchar *str, gsize length);
+gboolean git_utf8_validate (const gchar *str, gsize length,
+                            gboolean *is_ascii);
+gchar *git_utf8_convert (const gchar *str, gsize length,
+                         const gchar *charset,
+                         gsize *length_out);
+
+G_END_DECLS
+
+#endif /* __GIT_UTF8_H__ */
@@ -0,0 +1,320 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The watchdog detects when the main loop stops iterating for a long
+   time. A high priority timeout in the main loop keeps bumping a
+   counter and a separate thread checks that the counter keeps
+   changing. If it doesn't, the thread sends a signal to the main
+   thread which records its own backtrace so that the stall can be
+   logged along with whatever operation was marked as running with
+   git_watchdog_set_operation. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include <time.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#endif
+
+#include "git-watchdog.h"
+
+/* Number of milliseconds between each beat of the main loop */
+#define GIT_WATCHDOG_BEAT_INTERVAL 100
+
+/* Maximum number of frames of the main thread's stack to log */
+#define GIT_WATCHDOG_MAX_FRAMES 64
+
+/* Number of microseconds to wait for the main thread to record its
+   backtrace */
+#define GIT_WATCHDOG_CAPTURE_TIMEOUT 500000
+
+/* Maximum number of seconds between each check of the counter */
+#define GIT_WATCHDOG_MAX_POLL_INTERVAL 1.0
+
+static GThread *git_watchdog_thread = NULL;
+static guint git_watchdog_beat_source = 0;
+static volatile gint git_watchdog_beats = 0;
+/* The thread waits on the condition between checks so that it can
+   be woken up straight away when the watchdog is stopped */
+static GMutex *git_watchdog_mutex = NULL;
+static GCond *git_watchdog_cond = NULL;
+static gboolean git_watchdog_stopping = FALSE;
+static gdouble git_watchdog_threshold = 0.0;
+static const gchar * volatile git_watchdog_operation = NULL;
+
+#if defined (G_OS_UNIX) && defined (HAVE_EXECINFO_H)
+#define GIT_WATCHDOG_CAN_BACKTRACE 1
+
+static pthread_t git_watchdog_main_thread;
+static void *git_watchdog_frames[GIT_WATCHDOG_MAX_FRAMES];
+static volatile sig_atomic_t git_watchdog_n_frames = 0;
+static volatile sig_atomic_t git_watchdog_captured = 0;
+
+static void
+git_watchdog_on_signal (int signum)
+{
+  /* This runs in the main thread wherever it is stuck */
+  git_watchdog_n_frames = backtrace (git_watchdog_frames,
+                                     GIT_WATCHDOG_MAX_FRAMES);
+  git_watchdog_captured = 1;
+}
+#endif /* G_OS_UNIX && HAVE_EXECINFO_H */
+
+static gboolean
+git_watchdog_on_beat (gpointer data)
+{
+  g_atomic_int_inc (&git_watchdog_beats);
+
+  return TRUE;
+}
+
+static gdouble
+git_watchdog_time_diff (const GTimeVal *a, const GTimeVal *b)
+{
+  return (a->tv_sec - b->tv_sec) + (a->tv_usec - b->tv_usec) / 1000000.0;
+}
+
+static void
+git_watchdog_print_time (const GTimeVal *now)
+{
+  time_t secs = now->tv_sec;
+  struct tm *tm;
+  gchar buf[64];
+#ifdef HAVE_LOCALTIME_R
+  struct tm tm_buf;
+
+  tm = localtime_r (&secs, &tm_buf);
+#else
+  tm = localtime (&secs);
+#endif
+
+  strftime (buf, sizeof (buf), "%Y-%m-%d %H:%M:%S", tm);
+  fprintf (stderr, "[%s.%03ld] ", buf, (long) now->tv_usec / 1000);
+}
+
+static void
+git_watchdog_report_stall (const GTimeVal *now, gdouble stalled)
+{
+  const gchar *operation = g_atomic_pointer_get (&git_watchdog_operation);
+
+  git_watchdog_print_time (now);
+  fprintf (stderr, "%s: main loop has not run for %.1f seconds",
+           g_get_prgname (), stalled);
+  if (operation)
+    fprintf (stderr, " during \"%s\"", operation);
+  fputs ("\n", stderr);
+
+#ifdef GIT_WATCHDOG_CAN_BACKTRACE
+  {
+    gulong waited;
+
+    git_watchdog_captured = 0;
+    pthread_kill (git_watchdog_main_thread, SIGUSR2);
+
+    for (waited = 0;
+         !git_watchdog_captured && waited < GIT_WATCHDOG_CAPTURE_TIMEOUT;
+         waited += 10000)
+      g_usleep (10000);
+
+    if (git_watchdog_captured)
+      {
+        fputs ("Main thread backtrace:\n", stderr);
+        fflush (stderr);
+        backtrace_symbols_fd (git_watchdog_frames, git_watchdog_n_frames,
+                              STDERR_FILENO);
+      }
+    else
+      fputs ("The main thread did not respond to the signal\n", stderr);
+  }
+#endif /* GIT_WATCHDOG_CAN_BACKTRACE */
+
+  fflush (stderr);
+}
+
+static gpointer
+git_watchdog_thread_func (gpointer data)
+{
+  GTimeVal now, last_change;
+  gint last_beats = g_atomic_int_get (&git_watchdog_beats);
+  gboolean reported = FALSE;
+  /* Check a few times per threshold so that the stall is reported
+     soon after it crosses the threshold */
+  glong poll_interval
+    = MIN (git_watchdog_threshold / 4, GIT_WATCHDOG_MAX_POLL_INTERVAL)
+    * G_USEC_PER_SEC;
+
+  g_get_current_time (&last_change);
+
+  g_mutex_lock (git_watchdog_mutex);
+
+  for (;;)
+    {
+      GTimeVal wake_time;
+      gint beats;
+
+      g_get_current_time (&wake_time);
+      g_time_val_add (&wake_time, poll_interval);
+
+      while (!git_watchdog_stopping
+             && g_cond_timed_wait (git_watchdog_cond, git_watchdog_mutex,
+                                   &wake_time));
+
+      if (git_watchdog_stopping)
+        break;
+
+      g_mutex_unlock (git_watchdog_mutex);
+
+      beats = g_atomic_int_get (&git_watchdog_beats);
+      g_get_current_time (&now);
+
+      if (beats != last_beats)
+        {
+          if (reported)
+            {
+              git_watchdog_print_time (&now);
+              fprintf (stderr, "%s: main loop resumed after %.1f seconds\n",
+                       g_get_prgname (),
+                       git_watchdog_time_diff (&now, &last_change));
+              reported = FALSE;
+            }
+
+          last_beats = beats;
+          last_change = now;
+        }
+      else if (!reported
+               && git_watchdog_time_diff (&now, &last_change)
+               >= git_watchdog_threshold)
+        {
+          git_watchdog_report_stall (&now,
+                                     git_watchdog_time_diff (&now,
+                                                             &last_change));
+          reported = TRUE;
+        }
+
+      g_mutex_lock (git_watchdog_mutex);
+    }
+
+  g_mutex_unlock (git_watchdog_mutex);
+
+  return NULL;
+}
+
+/* Starts watching the main loop of the calling thread. Stalls longer
+   than threshold seconds are logged to stderr */
+void
+git_watchdog_start (gdouble threshold)
+{
+  GError *error = NULL;
+
+  g_return_if_fail (git_watchdog_thread == NULL);
+
+  if (threshold <= 0.0)
+    return;
+
+  git_watchdog_threshold = threshold;
+
+#ifdef GIT_WATCHDOG_CAN_BACKTRACE
+  {
+    struct sigaction sa;
+
+    git_watchdog_main_thread = pthread_self ();
+
+    /* The first call to backtrace may allocate memory so it is done
+       now rather than in the signal handler */
+    backtrace (git_watchdog_frames, GIT_WATCHDOG_MAX_FRAMES);
+
+    memset (&sa, 0, sizeof (sa));
+    sa.sa_handler = git_watchdog_on_signal;
+    sigemptyset (&sa.sa_mask);
+    /* Restart any system call that the main thread is blocked in
+       such as waitpid */
+    sa.sa_flags = SA_RESTART;
+    sigaction (SIGUSR2, &sa, NULL);
+  }
+#endif /* GIT_WATCHDOG_CAN_BACKTRACE */
+
+  git_watchdog_beat_source
+    = g_timeout_add_full (G_PRIORITY_HIGH, GIT_WATCHDOG_BEAT_INTERVAL,
+                          git_watchdog_on_beat, NULL, NULL);
+
+  git_watchdog_mutex = g_mutex_new ();
+  git_watchdog_cond = g_cond_new ();
+  git_watchdog_stopping = FALSE;
+  git_watchdog_thread = g_thread_create (git_watchdog_thread_func, NULL,
+                                         TRUE, &error);
+
+  if (git_watchdog_thread == NULL)
+    {
+      g_warning ("%s", error->message);
+      g_error_free (error);
+      g_source_remove (git_watchdog_beat_source);
+      git_watchdog_beat_source = 0;
+      g_cond_free (git_watchdog_cond);
+      git_watchdog_cond = NULL;
+      g_mutex_free (git_watchdog_mutex);
+      git_watchdog_mutex = NULL;
+    }
+}
+
+void
+git_watchdog_stop (void)
+{
+  if (git_watchdog_thread == NULL)
+    return;
+
+  g_mutex_lock (git_watchdog_mutex);
+  git_watchdog_stopping = TRUE;
+  g_cond_signal (git_watchdog_cond);
+  g_mutex_unlock (git_watchdog_mutex);
+
+  g_thread_join (git_watchdog_thread);
+  git_watchdog_thread = NULL;
+
+  g_cond_free (git_watchdog_cond);
+  git_watchdog_cond = NULL;
+  g_mutex_free (git_watchdog_mutex);
+  git_watchdog_mutex = NULL;
+
+  g_source_remove (git_watchdog_beat_source);
+  git_watchdog_beat_source = 0;
+}
+
+/* Sets a label for what the main thread is doing so that it can be
+   included when a stall is logged. The label must be a static
+   string. The previous label is returned so that it can be put back
+   when the operation finishes */
+const gchar *
+git_watchdog_set_operation (const gchar *label)
+{
+  const gchar *old_label = g_atomic_pointer_get (&git_watchdog_operation);
+
+  g_atomic_pointer_set (&git_watchdog_operation, label);
+
+  return old_label;
+}
@@ -0,0 +1,37 @@
+/* This file is part of blame-browse.
+ * Copyright (C) 2008  Neil Roberts  <bpeeluk@yahoo.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIT_WATCHDOG_H__
+#define __GIT_WATCHDOG_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Environment variable with the number of seconds that the main loop
+   can be blocked before it is reported. The watchdog is only started
+   if this is set to a number greater than 0 */
+#define GIT_WATCHDOG_THRESHOLD_ENV "BLAME_BROWSE_STALL_THRESHOLD"
+
+void git_watchdog_start (gdouble threshold);
+void git_watchdog_stop (void);
+
+const gchar *git_watchdog_set_operation (const gchar *label);
+
+G_END_DECLS
+
+#endif /* __GIT_WATCHDOG_H__ */
@@ -23,16 +23,91 @@
 #include <gtk/gtkwindow.h>
 
 #include "git-main-window.h"
+#include "git-watchdog.h"
+#include "git-blame-cache.h"
+#include "git-memory.h"
+#include "git-recorder.h"
+#include "git-bench.h"
+#include "git-alloc.h"
 #include "intl.h"
 
+static gchar *record_filename = NULL;
+static gchar *replay_filename = NULL;
+static gboolean bench = FALSE;
+static gint bench_runs = 10;
+static gchar *bench_baseline = NULL;
+static gchar *bench_save = NULL;
+
+static GOptionEntry
+main_options[] =
+  {
+    { "record", 0, 0, G_OPTION_ARG_FILENAME, &record_filename,
+      N_("Record the interactions to FILE"), N_("FILE") },
+    { "replay", 0, 0, G_OPTION_ARG_FILENAME, &replay_filename,
+      N_("Replay the interactions in FILE and report the latencies"),
+      N_("FILE") },
+    { "bench", 0, 0, G_OPTION_ARG_NONE, &bench,
+      N_("Run the benchmarks and exit"), NULL },
+    { "bench-runs", 0, 0, G_OPTION_ARG_INT, &bench_runs,
+      N_("Number of times to run each benchmark"), N_("N") },
+    { "bench-compare", 0, 0, G_OPTION_ARG_FILENAME, &bench_baseline,
+      N_("Compare the benchmarks with the baseline in FILE"), N_("FILE") },
+    { "bench-save", 0, 0, G_OPTION_ARG_FILENAME, &bench_save,
+      N_("Save the benchmark results to FILE as a baseline"), N_("FILE") },
+    { NULL }
+  };
+
 int
 main (int argc, char **argv)
 {
   GtkWidget *main_win;
   const gchar *filename = NULL, *revision = NULL;
+  const gchar *threshold, *budget;
+  GOptionContext *context;
+  GError *error = NULL;
+
+  /* This has to be done before anything allocates memory with GLib */
+  git_alloc_install ();
+
+  /* Syntax highlighting is done in a separate thread */
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
 
   g_set_application_name (_("Blame Browse"));
 
+  /* GTK isn't initialized until after the options are parsed so that
+     the benchmarks can run without a display */
+  context = g_option_context_new ("[revision] [filename]");
+  g_option_context_add_main_entries (context, main_options, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (FALSE));
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      fprintf (stderr, "%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  /* Exits with 2 if a benchmark is significantly slower than the
+     baseline so that it can be used in scripts */
+  if (bench || bench_baseline || bench_save)
+    {
+      gboolean regressed;
+
+      g_type_init ();
+
+      if (!git_bench_run (MAX (bench_runs, 1), bench_baseline, bench_save,
+                          &regressed, &error))
+        {
+          fprintf (stderr, "%s\n", error->message);
+          g_error_free (error);
+          return 1;
+        }
+
+      return regressed ? 2 : 0;
+    }
+
   gtk_init (&argc, &argv);
 
   if (argc > 1)
@@ -56,12 +131,50 @@ main (int argc, char **argv)
   gtk_window_set_default_size (GTK_WINDOW (main_win), 560, 460);
   g_signal_connect (main_win, "destroy", G_CALLBACK (gtk_main_quit), NULL);
 
-  if (filename)
+  if (record_filename
+      && !git_recorder_start (record_filename, &error))
+    {
+      fprintf (stderr, "%s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+
+  /* The recording opens its own files */
+  if (replay_filename)
+    {
+      if (!git_recorder_replay (GIT_MAIN_WINDOW (main_win),
+                                replay_filename, &error))
+        {
+          fprintf (stderr, "%s\n", error->message);
+          g_error_free (error);
+          return 1;
+        }
+    }
+  else if (filename)
     git_main_window_set_file (GIT_MAIN_WINDOW (main_win), filename, revision);
 
   gtk_widget_show (main_win);
 
+  /* SIGUSR1 prints the memory usage to stderr */
+  git_memory_install_dump_signal ();
+  if ((budget = g_getenv (GIT_MEMORY_BUDGET_ENV)))
+    git_memory_set_budget (g_ascii_strtoull (budget, NULL, 10)
+                           * 1024 * 1024);
+
+  /* Report whenever the main loop is blocked for too long */
+  if ((threshold = g_getenv (GIT_WATCHDOG_THRESHOLD_ENV)))
+    git_watchdog_start (g_ascii_strtod (threshold, NULL));
+
   gtk_main ();
 
+  git_watchdog_stop ();
+  git_recorder_stop ();
+
+  /* Let any blames that are still being written to the cache finish */
+  git_blame_cache_flush ();
+
+  /* Report the counts for the last phase */
+  git_alloc_set_phase (GIT_ALLOC_PHASE_NONE);
+
   return 0;
 }